@@ -0,0 +1,895 @@
+/*
+ * bench - Kernel microbenchmarks
+ *
+ * Every metric is printed as one "BENCH <name> <value> <unit>" line so
+ * results can be scraped from the serial log.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <ocean/syscall.h>
+#include <ocean/ipc_proto.h>
+#include <ocean/irq.h>
+#include <ocean/rs.h>
+
+#define BENCH_PATH          "/boot/bench.elf"
+#define BENCH_DEFAULT_ITERS 32
+#define BENCH_CHURN_WAVE    16
+#define BENCH_SYSCALL_ROUNDS 1000   /* getpid calls per iteration */
+#define BENCH_IPC_ROUNDS    100     /* Round trips per iteration */
+#define BENCH_IRQ_ROUNDS    100     /* Interrupts per iteration */
+#define BENCH_FAULT_PAGES   64      /* Pages the COW child writes */
+#define BENCH_PAGE_SIZE     4096
+#define BENCH_READ_CHUNK    4096
+
+static char *nop_argv[] = { "bench", "nop", NULL };
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static void report(const char *name, uint64_t value, const char *unit)
+{
+    printf("BENCH %s %llu %s\n", name, (unsigned long long)value, unit);
+}
+
+static void print_usage(void)
+{
+    printf("usage: bench [--help] [spawn|churn|thread|sync|syscall|ipc|recover|irq|fault|file|kernel|boot|all]"
+           " [ITERATIONS]\n");
+    printf("  spawn   process creation rate: fork+exec, vfork+exec, spawn\n");
+    printf("  churn   waves of %d live children spawned then reaped\n",
+           BENCH_CHURN_WAVE);
+    printf("  thread  pthread create+join of a trivial thread\n");
+    printf("  sync    futex mutex: uncontended lock/unlock, condvar ping-pong\n");
+    printf("  syscall null syscall (getpid)\n");
+    printf("  ipc     call/reply round trip to a server thread\n");
+    printf("  recover server killed mid-call: parked standby vs cold respawn\n");
+    printf("  irq     interrupt handler to userspace driver thread wakeup\n");
+    printf("  fault   copy-on-write faults in a forked child\n");
+    printf("  file    sequential %d-byte reads of %s\n", BENCH_READ_CHUNK, BENCH_PATH);
+    printf("  kernel  in-kernel slab and page allocator (reported by the kernel)\n");
+    printf("  boot    cycles spent in each kernel boot phase (reported by the kernel)\n");
+    printf("  all     run every benchmark\n");
+}
+
+static int wait_child(int pid)
+{
+    while (1) {
+        int status = 0;
+        int child_pid = wait(&status);
+
+        if (child_pid == pid) {
+            return status;
+        }
+        if (child_pid < 0) {
+            return -1;
+        }
+    }
+}
+
+static int create_fork_exec(void)
+{
+    int pid = fork();
+
+    if (pid == 0) {
+        execv(BENCH_PATH, nop_argv);
+        _exit(127);
+    }
+
+    return pid;
+}
+
+static int create_vfork_exec(void)
+{
+    int pid = vfork();
+
+    if (pid == 0) {
+        execv(BENCH_PATH, nop_argv);
+        _exit(127);
+    }
+
+    return pid;
+}
+
+static int create_spawn(void)
+{
+    return spawn(BENCH_PATH, nop_argv, NULL, 0, 0);
+}
+
+/*
+ * Time create + exit + reap of a trivial child. Returns cycles per
+ * iteration, or 0 on failure.
+ */
+static uint64_t time_creation(const char *label, int (*create)(void), int iters)
+{
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < iters; i++) {
+        int pid = create();
+        if (pid < 0) {
+            printf("bench: %s failed at iteration %d (%d)\n", label, i, pid);
+            return 0;
+        }
+        if (wait_child(pid) != 0) {
+            printf("bench: %s child %d did not exit cleanly\n", label, pid);
+            return 0;
+        }
+    }
+
+    return (rdtsc() - start) / (uint64_t)iters;
+}
+
+static int bench_spawn(int iters)
+{
+    uint64_t fork_exec = time_creation("fork+exec", create_fork_exec, iters);
+    uint64_t vfork_exec = time_creation("vfork+exec", create_vfork_exec, iters);
+    uint64_t spawned = time_creation("spawn", create_spawn, iters);
+
+    if (fork_exec == 0 || vfork_exec == 0 || spawned == 0) {
+        return 1;
+    }
+
+    report("proc.fork_exec", fork_exec, "cycles/op");
+    report("proc.vfork_exec", vfork_exec, "cycles/op");
+    report("proc.spawn", spawned, "cycles/op");
+    report("proc.spawn_speedup", (fork_exec * 100) / spawned, "percent");
+    return 0;
+}
+
+/*
+ * Spawn/exit churn: keep a wave of children alive at once so PID
+ * allocation, lookup and reaping work against a populated table.
+ */
+static int bench_churn(int iters)
+{
+    uint64_t start = rdtsc();
+    int total = 0;
+
+    for (int round = 0; round < iters; round++) {
+        int live = 0;
+
+        for (int i = 0; i < BENCH_CHURN_WAVE; i++) {
+            int pid = spawn(BENCH_PATH, nop_argv, NULL, 0, 0);
+            if (pid < 0) {
+                printf("bench: churn spawn failed in round %d (%d)\n", round, pid);
+                break;
+            }
+            live++;
+        }
+
+        for (; live > 0; live--) {
+            int status = 0;
+            if (wait(&status) < 0 || status != 0) {
+                printf("bench: churn reap failed in round %d\n", round);
+                return 1;
+            }
+            total++;
+        }
+    }
+
+    if (total == 0) {
+        return 1;
+    }
+
+    report("proc.churn", (rdtsc() - start) / (uint64_t)total, "cycles/op");
+    return 0;
+}
+
+static void *thread_nop(void *arg)
+{
+    return arg;
+}
+
+/*
+ * Thread create + exit + join. Compare with proc.spawn for the cost of
+ * parallelism without a new address space.
+ */
+static int bench_thread(int iters)
+{
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < iters; i++) {
+        pthread_t thread;
+        void *result = NULL;
+        int rc = pthread_create(&thread, NULL, thread_nop, (void *)(long)i);
+
+        if (rc != 0) {
+            printf("bench: pthread_create failed at iteration %d (%d)\n", i, rc);
+            return 1;
+        }
+        if (pthread_join(thread, &result) != 0 || result != (void *)(long)i) {
+            printf("bench: pthread_join failed at iteration %d\n", i);
+            return 1;
+        }
+    }
+
+    report("thread.create_join", (rdtsc() - start) / (uint64_t)iters, "cycles/op");
+    return 0;
+}
+
+#define BENCH_LOCK_ROUNDS 1000
+
+struct pingpong {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int turn;                       /* 0: main thread, 1: partner */
+    int rounds;
+};
+
+static void *pingpong_partner(void *arg)
+{
+    struct pingpong *pp = arg;
+
+    pthread_mutex_lock(&pp->lock);
+    for (int i = 0; i < pp->rounds; i++) {
+        while (pp->turn != 1) {
+            pthread_cond_wait(&pp->cond, &pp->lock);
+        }
+        pp->turn = 0;
+        pthread_cond_signal(&pp->cond);
+    }
+    pthread_mutex_unlock(&pp->lock);
+    return NULL;
+}
+
+/*
+ * Uncontended mutex cost (never enters the kernel) and a condvar
+ * ping-pong between two threads (one futex wake + wait per handoff).
+ */
+static int bench_sync(int iters)
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    struct pingpong pp = {
+        PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, iters
+    };
+    pthread_t partner;
+    uint64_t start;
+    int rounds = iters * BENCH_LOCK_ROUNDS;
+
+    start = rdtsc();
+    for (int i = 0; i < rounds; i++) {
+        pthread_mutex_lock(&lock);
+        pthread_mutex_unlock(&lock);
+    }
+    report("sync.mutex_uncontended", (rdtsc() - start) / (uint64_t)rounds,
+           "cycles/op");
+
+    if (pthread_create(&partner, NULL, pingpong_partner, &pp) != 0) {
+        printf("bench: sync partner thread failed\n");
+        return 1;
+    }
+
+    start = rdtsc();
+    pthread_mutex_lock(&pp.lock);
+    for (int i = 0; i < iters; i++) {
+        pp.turn = 1;
+        pthread_cond_signal(&pp.cond);
+        while (pp.turn != 0) {
+            pthread_cond_wait(&pp.cond, &pp.lock);
+        }
+    }
+    pthread_mutex_unlock(&pp.lock);
+    uint64_t elapsed = rdtsc() - start;
+
+    pthread_join(partner, NULL);
+    report("sync.condvar_pingpong", elapsed / (uint64_t)iters, "cycles/roundtrip");
+    return 0;
+}
+
+/*
+ * Null syscall: the cheapest round trip into the kernel and back
+ */
+static int bench_syscall(int iters)
+{
+    int rounds = iters * BENCH_SYSCALL_ROUNDS;
+    int pid = getpid();
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < rounds; i++) {
+        if (getpid() != pid) {
+            printf("bench: getpid changed at iteration %d\n", i);
+            return 1;
+        }
+    }
+
+    report("syscall.null", (rdtsc() - start) / (uint64_t)rounds, "cycles/op");
+    return 0;
+}
+
+#define BENCH_IPC_PING  1
+#define BENCH_IPC_STOP  2
+
+static void *ipc_server(void *arg)
+{
+    uint32_t ep = (uint32_t)(long)arg;
+
+    for (;;) {
+        uint64_t tag, r1, r2, r3, r4;
+
+        if (ipc_recv(ep, &tag, &r1, &r2, &r3, &r4) < 0) {
+            return (void *)1L;
+        }
+        ipc_reply(IPC_MAKE_TAG(IPC_TAG_LABEL(tag), 0, 0, IPC_FLAG_REPLY),
+                  r1 + 1, 0, 0, 0);
+        if (IPC_TAG_LABEL(tag) == BENCH_IPC_STOP) {
+            return NULL;
+        }
+    }
+}
+
+/*
+ * Synchronous call/reply to a server thread blocked in recv: two
+ * context switches and two message copies per round trip.
+ */
+static int bench_ipc(int iters)
+{
+    struct ipc_call_frame frame;
+    pthread_t server;
+    void *result = NULL;
+    int rounds = iters * BENCH_IPC_ROUNDS;
+    int ep = endpoint_create(0);
+    uint64_t start;
+
+    if (ep < 0) {
+        printf("bench: endpoint_create failed (%d)\n", ep);
+        return 1;
+    }
+    if (pthread_create(&server, NULL, ipc_server, (void *)(long)ep) != 0) {
+        printf("bench: ipc server thread failed\n");
+        endpoint_destroy(ep);
+        return 1;
+    }
+
+    start = rdtsc();
+    for (int i = 0; i < rounds; i++) {
+        memset(&frame, 0, sizeof(frame));
+        frame.tag = IPC_MAKE_TAG(BENCH_IPC_PING, 1, 0, 0);
+        frame.r1 = (uint64_t)i;
+        if (ipc_call(ep, &frame) < 0 || frame.r1 != (uint64_t)i + 1) {
+            printf("bench: ipc call failed at iteration %d\n", i);
+            return 1;
+        }
+    }
+    uint64_t elapsed = rdtsc() - start;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.tag = IPC_MAKE_TAG(BENCH_IPC_STOP, 0, 0, 0);
+    ipc_call(ep, &frame);
+    pthread_join(server, &result);
+    endpoint_destroy(ep);
+
+    if (result != NULL) {
+        printf("bench: ipc server failed\n");
+        return 1;
+    }
+
+    report("ipc.call_rtt", elapsed / (uint64_t)rounds, "cycles/roundtrip");
+    return 0;
+}
+
+#define BENCH_RS_READY  1
+#define BENCH_RS_CRASH  2
+#define BENCH_RS_STOP   3
+
+/*
+ * Child image for the recover benchmark: a server for ep. It reports
+ * ready on ready_ep, then parks until ep is handed to it, at once as the
+ * primary or when the primary dies as the standby. BENCH_RS_CRASH kills
+ * it in the middle of the call, unless the call is a replay; the reply
+ * says in r2 whether it was.
+ */
+static int recover_server(uint32_t ep, uint32_t ready_ep)
+{
+    struct ipc_call_frame frame;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.tag = IPC_MAKE_TAG(BENCH_RS_READY, 0, 0, 0);
+    if (ipc_call(ready_ep, &frame) < 0 || rs_park(ep) < 0) {
+        return 1;
+    }
+
+    for (;;) {
+        uint64_t tag, r1, r2, r3, r4;
+
+        if (ipc_recv(ep, &tag, &r1, &r2, &r3, &r4) < 0) {
+            return 1;
+        }
+
+        uint64_t replayed = (IPC_TAG_FLAGS(tag) & IPC_FLAG_REPLAYED) ? 1 : 0;
+        if (IPC_TAG_LABEL(tag) == BENCH_RS_CRASH && !replayed) {
+            _exit(1);
+        }
+        ipc_reply(IPC_MAKE_TAG(IPC_TAG_LABEL(tag), 0, 0, IPC_FLAG_REPLY),
+                  r1 + 1, replayed, 0, 0);
+        if (IPC_TAG_LABEL(tag) == BENCH_RS_STOP) {
+            return 0;
+        }
+    }
+}
+
+struct recover_bench {
+    int ep;                         /* Supervised by us */
+    int ready_ep;                   /* Servers check in here */
+    char ep_arg[16];
+    char ready_arg[16];
+};
+
+struct recover_call {
+    uint32_t ep;
+    int iter;
+    uint64_t cycles;                /* 0 if the call failed */
+};
+
+static int spawn_recover_server(struct recover_bench *rb)
+{
+    char *argv[] = { "bench", "recover-server", rb->ep_arg, rb->ready_arg, NULL };
+
+    return spawn(BENCH_PATH, argv, NULL, 0, 0);
+}
+
+/* Answer count servers' ready calls */
+static int recover_wait_ready(struct recover_bench *rb, int count)
+{
+    for (int i = 0; i < count; i++) {
+        uint64_t tag, r1, r2, r3, r4;
+
+        if (ipc_recv((uint32_t)rb->ready_ep, &tag, &r1, &r2, &r3, &r4) < 0) {
+            return -1;
+        }
+        ipc_reply(IPC_MAKE_TAG(BENCH_RS_READY, 0, 0, IPC_FLAG_REPLY), 0, 0, 0, 0);
+    }
+    return 0;
+}
+
+/*
+ * The call that kills the server, timed until the replayed request is
+ * answered by whoever serves the endpoint next
+ */
+static void *recover_client(void *arg)
+{
+    struct recover_call *call = arg;
+    struct ipc_call_frame frame;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.tag = IPC_MAKE_TAG(BENCH_RS_CRASH, 1, 0, 0);
+    frame.r1 = (uint64_t)call->iter;
+
+    uint64_t start = rdtsc();
+    if (ipc_call(call->ep, &frame) < 0 ||
+        frame.r1 != (uint64_t)call->iter + 1 || frame.r2 != 1) {
+        call->cycles = 0;
+        return NULL;
+    }
+    call->cycles = rdtsc() - start;
+    return NULL;
+}
+
+/* Stop the server left standing; the endpoint passes back to us */
+static int recover_stop(struct recover_bench *rb, int pid)
+{
+    struct ipc_call_frame frame;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.tag = IPC_MAKE_TAG(BENCH_RS_STOP, 0, 0, 0);
+    if (ipc_call((uint32_t)rb->ep, &frame) < 0) {
+        return -1;
+    }
+    return wait_child(pid) == 0 ? 0 : -1;
+}
+
+/* Crash a server with a parked standby behind it */
+static uint64_t recover_standby(struct recover_bench *rb, int iter)
+{
+    struct recover_call call = { .ep = (uint32_t)rb->ep, .iter = iter };
+    int primary = spawn_recover_server(rb);
+    int standby = spawn_recover_server(rb);
+
+    if (primary < 0 || standby < 0 ||
+        rs_supervise((uint32_t)rb->ep, standby) < 0 ||
+        rs_handover((uint32_t)rb->ep, primary) < 0 ||
+        recover_wait_ready(rb, 2) < 0) {
+        return 0;
+    }
+
+    recover_client(&call);
+    if (wait_child(primary) != 1 || recover_stop(rb, standby) < 0) {
+        return 0;
+    }
+    return call.cycles;
+}
+
+/* Crash a server with nothing behind it and start a new one */
+static uint64_t recover_cold(struct recover_bench *rb, int iter)
+{
+    struct recover_call call = { .ep = (uint32_t)rb->ep, .iter = iter };
+    pthread_t client;
+    int primary = spawn_recover_server(rb);
+
+    if (primary < 0 ||
+        rs_supervise((uint32_t)rb->ep, 0) < 0 ||
+        rs_handover((uint32_t)rb->ep, primary) < 0 ||
+        recover_wait_ready(rb, 1) < 0) {
+        return 0;
+    }
+    if (pthread_create(&client, NULL, recover_client, &call) != 0) {
+        return 0;
+    }
+
+    /* With no standby the endpoint and the replay wait for us */
+    if (wait_child(primary) != 1) {
+        return 0;
+    }
+    int fresh = spawn_recover_server(rb);
+    if (fresh < 0 ||
+        rs_handover((uint32_t)rb->ep, fresh) < 0 ||
+        recover_wait_ready(rb, 1) < 0) {
+        return 0;
+    }
+
+    pthread_join(client, NULL);
+    if (recover_stop(rb, fresh) < 0) {
+        return 0;
+    }
+    return call.cycles;
+}
+
+/*
+ * Fault injection: a server dies in the middle of a call and the caller
+ * waits for the replayed request to be answered. With a standby parked
+ * on the endpoint the kernel hands it over as the server exits; without
+ * one we respawn the server ourselves, as a supervisor would have to.
+ */
+static int bench_recover(int iters)
+{
+    struct recover_bench rb;
+    uint64_t standby_total = 0;
+    uint64_t cold_total = 0;
+    int failed = 1;
+
+    rb.ep = endpoint_create(0);
+    rb.ready_ep = endpoint_create(0);
+    if (rb.ep < 0 || rb.ready_ep < 0) {
+        printf("bench: endpoint_create failed (%d, %d)\n", rb.ep, rb.ready_ep);
+        goto out;
+    }
+    snprintf(rb.ep_arg, sizeof(rb.ep_arg), "%d", rb.ep);
+    snprintf(rb.ready_arg, sizeof(rb.ready_arg), "%d", rb.ready_ep);
+
+    for (int i = 0; i < iters; i++) {
+        uint64_t standby = recover_standby(&rb, i);
+        uint64_t cold = standby ? recover_cold(&rb, i) : 0;
+
+        if (!standby || !cold) {
+            printf("bench: recover failed at iteration %d (%s)\n", i,
+                   standby ? "cold" : "standby");
+            goto out;
+        }
+        standby_total += standby;
+        cold_total += cold;
+    }
+    failed = 0;
+
+out:
+    /* Parked or waiting children see the endpoints go and exit */
+    if (rb.ep >= 0) {
+        rs_release((uint32_t)rb.ep);
+        endpoint_destroy(rb.ep);
+    }
+    if (rb.ready_ep >= 0) {
+        endpoint_destroy(rb.ready_ep);
+    }
+    if (failed) {
+        return 1;
+    }
+
+    report("rs.recover_standby", standby_total / (uint64_t)iters, "cycles");
+    report("rs.recover_cold", cold_total / (uint64_t)iters, "cycles");
+    report("rs.recover_speedup", (cold_total * 100) / standby_total, "percent");
+    return 0;
+}
+
+static char fault_pages[BENCH_FAULT_PAGES * BENCH_PAGE_SIZE];
+
+/*
+ * Copy-on-write fault cost: after fork every page of fault_pages is
+ * shared read-only, so the child's first write to each one traps. The
+ * child times its own faults and hands back cycles per page as its exit
+ * status; an exit status is a full int here, which is plenty.
+ */
+static int bench_fault(int iters)
+{
+    uint64_t total = 0;
+
+    /* Make sure every page is present before it is shared */
+    for (int p = 0; p < BENCH_FAULT_PAGES; p++) {
+        fault_pages[p * BENCH_PAGE_SIZE] = 1;
+    }
+
+    for (int i = 0; i < iters; i++) {
+        int pid = fork();
+
+        if (pid == 0) {
+            uint64_t start = rdtsc();
+
+            for (int p = 0; p < BENCH_FAULT_PAGES; p++) {
+                fault_pages[p * BENCH_PAGE_SIZE] = 2;
+            }
+
+            uint64_t per_page = (rdtsc() - start) / BENCH_FAULT_PAGES;
+            _exit(per_page > 0x7fffffff ? 0x7fffffff : (int)per_page);
+        }
+        if (pid < 0) {
+            printf("bench: fork failed at iteration %d (%d)\n", i, pid);
+            return 1;
+        }
+
+        int status = wait_child(pid);
+        if (status <= 0) {
+            printf("bench: fault child %d failed (%d)\n", pid, status);
+            return 1;
+        }
+        total += (uint64_t)status;
+    }
+
+    report("mm.cow_fault", total / (uint64_t)iters, "cycles/page");
+    return 0;
+}
+
+/*
+ * Sequential reads of a boot module: open, read to EOF in fixed chunks,
+ * close. Reported per read call.
+ */
+static int bench_file(int iters)
+{
+    static char buf[BENCH_READ_CHUNK];
+    uint64_t reads = 0;
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < iters; i++) {
+        int fd = open(BENCH_PATH, O_RDONLY, 0);
+        int64_t n;
+
+        if (fd < 0) {
+            printf("bench: open %s failed (%d)\n", BENCH_PATH, fd);
+            return 1;
+        }
+        while ((n = read(fd, buf, sizeof(buf))) > 0) {
+            reads++;
+        }
+        close(fd);
+        if (n < 0) {
+            printf("bench: read failed at iteration %d (%lld)\n", i, (long long)n);
+            return 1;
+        }
+    }
+
+    if (reads == 0) {
+        return 1;
+    }
+
+    report("file.read_4k", (rdtsc() - start) / reads, "cycles/op");
+    return 0;
+}
+
+/* Allocator benchmarks run inside the kernel and print their own lines */
+#define BENCH_IRQ_BIT   0           /* Bits of the driver's notification */
+#define BENCH_IRQ_STOP  1
+
+struct irq_bench {
+    int irq;
+    int ntfn;                       /* Driver thread waits here */
+    int done;                       /* Main thread waits here */
+    uint64_t total;                 /* Sum of handler-to-driver cycles */
+    int handled;
+    volatile int failed;
+};
+
+static void *irq_driver(void *arg)
+{
+    struct irq_bench *ib = arg;
+    struct irq_object_info info;
+
+    for (;;) {
+        int64_t bits = notify_wait((uint32_t)ib->ntfn);
+        uint64_t now = rdtsc();
+
+        if (bits < 0) {
+            break;
+        }
+        if (bits & (1ULL << BENCH_IRQ_BIT)) {
+            if (irq_info(ib->irq, &info) < 0) {
+                break;
+            }
+            ib->total += now - info.last_tsc;
+            ib->handled++;
+            irq_ack(ib->irq, 1);
+            notify_signal((uint32_t)ib->done, 1);
+        }
+        if (bits & (1ULL << BENCH_IRQ_STOP)) {
+            return NULL;
+        }
+    }
+
+    /* Release the main thread from its wait */
+    ib->failed = 1;
+    notify_signal((uint32_t)ib->done, 1);
+    return (void *)1L;
+}
+
+/*
+ * A software interrupt bound to a driver thread blocked in notify_wait:
+ * measures from the kernel handler signalling the notification to the
+ * driver running in userspace, the path a real device interrupt takes.
+ */
+static int bench_irq(int iters)
+{
+    struct irq_bench ib;
+    pthread_t driver;
+    void *result = NULL;
+    int rounds = iters * BENCH_IRQ_ROUNDS;
+    int rc = 0;
+
+    memset(&ib, 0, sizeof(ib));
+    ib.ntfn = notify_create();
+    ib.done = notify_create();
+    if (ib.ntfn < 0 || ib.done < 0) {
+        printf("bench: notify_create failed (%d, %d)\n", ib.ntfn, ib.done);
+        return 1;
+    }
+    ib.irq = irq_bind_soft((uint32_t)ib.ntfn, BENCH_IRQ_BIT);
+    if (ib.irq < 0) {
+        printf("bench: irq bind failed (%d)\n", ib.irq);
+        notify_destroy((uint32_t)ib.ntfn);
+        notify_destroy((uint32_t)ib.done);
+        return 1;
+    }
+    if (pthread_create(&driver, NULL, irq_driver, &ib) != 0) {
+        printf("bench: irq driver thread failed\n");
+        notify_destroy((uint32_t)ib.ntfn);
+        notify_destroy((uint32_t)ib.done);
+        return 1;
+    }
+
+    for (int i = 0; i < rounds; i++) {
+        int ret = irq_trigger(ib.irq, 0);
+
+        if (ret < 0 || notify_wait((uint32_t)ib.done) < 0 || ib.failed) {
+            printf("bench: irq round %d failed (%d)\n", i, ret);
+            rc = 1;
+            break;
+        }
+    }
+
+    notify_signal((uint32_t)ib.ntfn, 1ULL << BENCH_IRQ_STOP);
+    pthread_join(driver, &result);
+    notify_destroy((uint32_t)ib.ntfn);     /* Unbinds the IRQ */
+    notify_destroy((uint32_t)ib.done);
+
+    if (rc != 0 || result != NULL || ib.handled == 0) {
+        printf("bench: irq driver failed\n");
+        return 1;
+    }
+
+    report("irq.wakeup", ib.total / (uint64_t)ib.handled, "cycles");
+    return 0;
+}
+
+static int bench_boot(void)
+{
+    int ret = kstat(KSTAT_BOOT, 0);
+
+    if (ret < 0) {
+        printf("bench: boot phase timings unavailable (%d)\n", ret);
+        return 1;
+    }
+    return 0;
+}
+
+static int bench_kernel(void)
+{
+    int ret = kstat(KSTAT_BENCH, 0);
+
+    if (ret < 0) {
+        printf("bench: kernel benchmarks failed (%d)\n", ret);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *which = argc > 1 ? argv[1] : "all";
+    int iters = BENCH_DEFAULT_ITERS;
+    int rc = 0;
+
+    /* Child image used by the process-creation benchmarks */
+    if (strcmp(which, "nop") == 0) {
+        return 0;
+    }
+    /* And the server the recover benchmark crashes */
+    if (strcmp(which, "recover-server") == 0) {
+        if (argc < 4) {
+            return 1;
+        }
+        return recover_server((uint32_t)atoi(argv[2]), (uint32_t)atoi(argv[3]));
+    }
+
+    if (strcmp(which, "--help") == 0) {
+        print_usage();
+        return 0;
+    }
+
+    if (argc > 2) {
+        iters = atoi(argv[2]);
+        if (iters <= 0) {
+            print_usage();
+            return 1;
+        }
+    }
+
+    int all = strcmp(which, "all") == 0;
+    int matched = 0;
+
+    if (all || strcmp(which, "spawn") == 0) {
+        rc |= bench_spawn(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "churn") == 0) {
+        rc |= bench_churn(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "thread") == 0) {
+        rc |= bench_thread(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "sync") == 0) {
+        rc |= bench_sync(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "syscall") == 0) {
+        rc |= bench_syscall(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "ipc") == 0) {
+        rc |= bench_ipc(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "recover") == 0) {
+        rc |= bench_recover(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "irq") == 0) {
+        rc |= bench_irq(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "fault") == 0) {
+        rc |= bench_fault(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "file") == 0) {
+        rc |= bench_file(iters);
+        matched = 1;
+    }
+    if (all || strcmp(which, "kernel") == 0) {
+        rc |= bench_kernel();
+        matched = 1;
+    }
+    if (all || strcmp(which, "boot") == 0) {
+        rc |= bench_boot();
+        matched = 1;
+    }
+
+    if (!matched) {
+        print_usage();
+        return 1;
+    }
+
+    return rc;
+}
@@ -7,21 +7,21 @@
  *   - LBA28/LBA48 addressing
  *   - Device identification
  *
- * NOTE: This driver requires port I/O syscalls which are
- * not yet implemented. For now, it simulates disk operations.
+ * The legacy channel ports are claimed with ioport_claim() and driven
+ * with in/out directly. The write self-test overwrites a sector, so it
+ * only runs when asked for with --write-test.
  */
 
 #include <stdio.h>
 #include <string.h>
 #include <ocean/syscall.h>
+#include <ocean/io.h>
 #include <ocean/ipc_proto.h>
+#include <ocean/service.h>
 
 #define ATA_VERSION "0.1.0"
 #define MAX_ATA_DEVICES 4
 
-/* Port I/O simulation (until kernel provides port I/O syscalls) */
-#define SIMULATED_IO 1
-
 /* ATA device info */
 struct ata_device {
     uint8_t  present;           /* Device present */
@@ -48,6 +48,7 @@ static struct ata_device ata_devices[MAX_ATA_DEVICES];
 static struct ata_channel channels[2];
 static int num_devices = 0;
 static int ata_endpoint = -1;
+static int write_test = 0;
 
 /* Statistics */
 static uint64_t sectors_read = 0;
@@ -55,67 +56,16 @@ static uint64_t sectors_written = 0;
 static uint64_t errors = 0;
 
 /*
- * Port I/O helpers (simulated until kernel provides syscalls)
+ * Port I/O goes straight to the controller through the ports claimed in
+ * ata_claim_channel(); a read of the control port is the 400ns delay.
  */
-#if SIMULATED_IO
-
-static uint8_t inb(uint16_t port)
-{
-    (void)port;
-    /* Simulate device ready status */
-    return ATA_SR_DRDY;
-}
-
-static uint16_t inw(uint16_t port)
-{
-    (void)port;
-    return 0;
-}
-
-static void outb(uint16_t port, uint8_t value)
-{
-    (void)port;
-    (void)value;
-}
-
-static void io_wait(void)
+static void io_wait(struct ata_channel *ch)
 {
-    /* Small delay - read status port 4 times */
     for (int i = 0; i < 4; i++) {
-        inb(channels[0].ctrl_base);
+        inb(ch->ctrl_base);
     }
 }
 
-#else
-
-/* Real port I/O using kernel syscalls */
-static uint8_t inb(uint16_t port)
-{
-    /* TODO: sys_io_port_in(port, 1) */
-    return 0;
-}
-
-static uint16_t inw(uint16_t port)
-{
-    /* TODO: sys_io_port_in(port, 2) */
-    return 0;
-}
-
-static void outb(uint16_t port, uint8_t value)
-{
-    /* TODO: sys_io_port_out(port, value, 1) */
-}
-
-static void io_wait(void)
-{
-    inb(channels[0].ctrl_base);
-    inb(channels[0].ctrl_base);
-    inb(channels[0].ctrl_base);
-    inb(channels[0].ctrl_base);
-}
-
-#endif
-
 /*
  * Wait for BSY flag to clear
  */
@@ -158,7 +108,7 @@ static int ata_wait_drq(struct ata_channel *ch)
 static void ata_select_drive(struct ata_channel *ch, int drive)
 {
     outb(ch->io_base + ATA_REG_DRIVE, 0xA0 | (drive << 4));
-    io_wait();
+    io_wait(ch);
 }
 
 /*
@@ -167,9 +117,9 @@ static void ata_select_drive(struct ata_channel *ch, int drive)
 static void ata_soft_reset(struct ata_channel *ch)
 {
     outb(ch->ctrl_base, 0x04);  /* Set SRST */
-    io_wait();
+    io_wait(ch);
     outb(ch->ctrl_base, 0x00);  /* Clear SRST */
-    io_wait();
+    io_wait(ch);
     ata_wait_bsy(ch);
 }
 
@@ -190,11 +140,11 @@ static int ata_identify(struct ata_channel *ch, int drive, struct ata_device *de
 
     /* Send IDENTIFY command */
     outb(ch->io_base + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
-    io_wait();
+    io_wait(ch);
 
-    /* Check if device exists */
+    /* Check if device exists (a floating bus reads all ones) */
     uint8_t status = inb(ch->io_base + ATA_REG_STATUS);
-    if (status == 0) {
+    if (status == 0 || status == 0xFF) {
         return ATA_ERR_NODEV;  /* No device */
     }
 
@@ -366,17 +316,39 @@ static int ata_write_sectors(struct ata_device *dev, uint64_t lba,
         }
 
         for (int i = 0; i < 256; i++) {
-            /* outw not implemented, use two outb */
-            outb(ch->io_base + ATA_REG_DATA, *buf & 0xFF);
-            outb(ch->io_base + ATA_REG_DATA + 1, (*buf >> 8) & 0xFF);
-            buf++;
+            outw(ch->io_base + ATA_REG_DATA, *buf++);
         }
     }
 
+    /* Commit the drive's write cache */
+    outb(ch->io_base + ATA_REG_COMMAND, dev->lba48 ? ATA_CMD_FLUSH_EXT : ATA_CMD_FLUSH);
+    if (ata_wait_bsy(ch) != 0) {
+        errors++;
+        return ATA_ERR_TIMEOUT;
+    }
+
     sectors_written += count;
     return ATA_OK;
 }
 
+/*
+ * Claim a channel's command block and device control port
+ */
+static int ata_claim_channel(struct ata_channel *ch)
+{
+    int err = ioport_claim(ch->io_base, 8);
+    if (err < 0) {
+        return err;
+    }
+
+    err = ioport_claim(ch->ctrl_base, 1);
+    if (err < 0) {
+        ioport_release(ch->io_base, 8);
+        return err;
+    }
+    return 0;
+}
+
 /*
  * Probe for ATA devices
  */
@@ -395,6 +367,18 @@ static void ata_probe(void)
 
     /* Probe each channel */
     for (int ch = 0; ch < 2; ch++) {
+        int err = ata_claim_channel(&channels[ch]);
+        if (err < 0) {
+            printf("[ata] Cannot claim %s channel ports (%d)\n",
+                   ch ? "secondary" : "primary", err);
+            continue;
+        }
+
+        /* Nothing attached: the bus floats high */
+        if (inb(channels[ch].io_base + ATA_REG_STATUS) == 0xFF) {
+            continue;
+        }
+
         ata_soft_reset(&channels[ch]);
 
         for (int drv = 0; drv < 2; drv++) {
@@ -404,7 +388,7 @@ static void ata_probe(void)
             dev->channel = ch;
             dev->drive = drv;
 
-            int err = ata_identify(&channels[ch], drv, dev);
+            err = ata_identify(&channels[ch], drv, dev);
             if (err == ATA_OK && dev->present) {
                 num_devices++;
 
@@ -422,22 +406,7 @@ static void ata_probe(void)
     }
 
     if (num_devices == 0) {
-        printf("[ata] No ATA devices found (simulated mode)\n");
-
-        /* Create simulated device for testing */
-        struct ata_device *dev = &ata_devices[0];
-        dev->present = 1;
-        dev->channel = 0;
-        dev->drive = 0;
-        dev->atapi = 0;
-        dev->lba48 = 1;
-        dev->sectors = 2097152;  /* 1 GB */
-        dev->sector_size = 512;
-        strncpy(dev->model, "QEMU HARDDISK (simulated)", sizeof(dev->model) - 1);
-        strncpy(dev->serial, "QM00001", sizeof(dev->serial) - 1);
-        num_devices = 1;
-
-        printf("[ata] Created simulated device: %s\n", dev->model);
+        printf("[ata] No ATA devices found\n");
     }
 }
 
@@ -460,6 +429,7 @@ static void ata_init(void)
     ata_probe();
 
     printf("[ata] ATA driver initialized\n");
+    service_ready(0);
 }
 
 /*
@@ -483,8 +453,8 @@ static void ata_serve(void)
             }
         }
 
-        /* Self-test: write sector 1000 */
-        if (i == 20 && num_devices > 0) {
+        /* Self-test: write sector 1000 (destroys its contents) */
+        if (i == 20 && num_devices > 0 && write_test) {
             uint8_t buffer[512];
             memset(buffer, 0x55, sizeof(buffer));
             int err = ata_write_sectors(&ata_devices[0], 1000, 1, buffer);
@@ -530,8 +500,11 @@ static void ata_dump(void)
  */
 int main(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--write-test") == 0) {
+            write_test = 1;
+        }
+    }
 
     printf("\n========================================\n");
     printf("  Ocean ATA Driver v%s\n", ATA_VERSION);
@@ -15,6 +15,7 @@
 #include <string.h>
 #include <ocean/syscall.h>
 #include <ocean/ipc_proto.h>
+#include <ocean/service.h>
 
 #define EXT2_VERSION "0.1.0"
 
@@ -549,6 +550,7 @@ static void ext2_init(void)
     ext2_mount(1);
 
     printf("[ext2] Ext2 driver initialized\n");
+    service_ready(0);
 }
 
 /*
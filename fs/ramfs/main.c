@@ -14,6 +14,7 @@
 #include <string.h>
 #include <ocean/syscall.h>
 #include <ocean/ipc_proto.h>
+#include <ocean/service.h>
 
 #define RAMFS_VERSION   "0.1.0"
 #define MAX_INODES      128
@@ -196,6 +197,7 @@ static void ramfs_init(void)
     printf("[ramfs] Created endpoint %d\n", ramfs_endpoint);
 
     printf("[ramfs] RAMFS initialized with root directory\n");
+    service_ready(0);
 }
 
 /*
@@ -47,6 +47,13 @@
 /* Tag flags */
 #define IPC_FLAG_REPLY      (1 << 0)    /* This is a reply */
 #define IPC_FLAG_ERROR      (1 << 1)    /* Error response */
+#define IPC_FLAG_REPLAYED   (1 << 5)    /* Resent by the kernel: the server
+                                         * that got it first died (SYS_RS) */
+
+/* Reply tag carrying an E_* code (below); 0 is success */
+#define IPC_MAKE_REPLY(label, len, err) \
+    (IPC_MAKE_TAG(label, len, 0, IPC_FLAG_REPLY | ((err) ? IPC_FLAG_ERROR : 0)) | \
+     ((uint64_t)((err) & IPC_TAG_ERROR_MASK) << IPC_TAG_ERROR_SHIFT))
 
 /*
  * Per-process IPC window.
@@ -138,6 +145,40 @@ struct ipc_call_frame {
 #define E_EXIST         9       /* Already exists */
 #define E_NODEV         10      /* No such device */
 
+/*
+ * Init Protocol
+ *
+ * A core service started by init calls INIT_SVC_READY on EP_INIT once it
+ * serves requests: r1 its PID, r2 the well-known endpoint it claimed (0 if
+ * none). Init replies E_OK, or E_NOENT if it did not start that PID, and
+ * holds back services needing that endpoint until then. Init checks r1
+ * against the caller's PID from the kernel (SYS_IPC_CALLER), E_PERM if
+ * they differ; only rs may announce another PID. Such a PID, one init did
+ * not start, is taken as the new instance of the service on that
+ * endpoint once the service has been up (see RS_TAKEOVER). INIT_CHILD_EXIT is
+ * init's own reaper thread telling the main loop that a child exited, and
+ * INIT_START_TICK its watchdog waking it to check start deadlines.
+ */
+#define INIT_SVC_READY      0x700   /* Service is up */
+#define INIT_CHILD_EXIT     0x701   /* Internal: a child was reaped */
+#define INIT_START_TICK     0x702   /* Internal: check start deadlines */
+
+/*
+ * Reincarnation Server Protocol
+ *
+ * rs (EP_RS) keeps a hot standby for each core service the manifest marks
+ * .standby: a second instance, initialized and parked on the well-known
+ * endpoint with RS_CTL_PARK. When the running instance dies the kernel
+ * passes the endpoint, queued callers and all, to the standby, and
+ * replays calls that were in flight with IPC_FLAG_REPLAYED. The standby
+ * then calls RS_TAKEOVER (r1 its PID, r2 the endpoint) and serves. rs
+ * goes by the caller's PID from the kernel rather than r1, replies E_OK,
+ * reports the new PID to init with INIT_SVC_READY and starts the next
+ * standby. RS_CHILD_EXIT is rs's own reaper thread.
+ */
+#define RS_TAKEOVER         0x800   /* A standby now serves the endpoint */
+#define RS_CHILD_EXIT       0x801   /* Internal: a child was reaped */
+
 /*
  * Memory Server Protocol
  */
@@ -149,6 +190,23 @@ struct ipc_call_frame {
 #define MEM_UNMAP           0x103   /* Unmap memory region */
 #define MEM_GRANT           0x104   /* Grant memory to another process */
 #define MEM_QUERY           0x105   /* Query memory info */
+#define MEM_SHM_CREATE      0x106   /* Create a named shared memory object */
+#define MEM_SHM_OPEN        0x107   /* Get access to one by name */
+#define MEM_SHM_UNLINK      0x108   /* Remove a name */
+
+/*
+ * MEM_ALLOC_PHYS hands a driver a DMA buffer: physically contiguous,
+ * below 4 GiB, zeroed, mapped into the caller and pinned until
+ * MEM_FREE_PHYS or exit. The request words are struct mem_alloc_req,
+ * the reply words struct mem_alloc_reply; MEM_FREE_PHYS takes the
+ * physical address in r1.
+ */
+#define MEM_MAX_ALLOC_PAGES 1024
+
+/* MEM_ALLOC_PHYS flags: memory type of the caller's mapping */
+#define MEM_CACHE_WB        0       /* Write-back */
+#define MEM_CACHE_UC        1       /* Uncached */
+#define MEM_CACHE_WC        2       /* Write-combining */
 
 /* MEM_ALLOC_PHYS request */
 struct mem_alloc_req {
@@ -160,8 +218,19 @@ struct mem_alloc_req {
 struct mem_alloc_reply {
     uint64_t phys_addr;     /* Physical address */
     uint64_t pages;         /* Pages allocated */
+    uint64_t virt_addr;     /* Where the buffer is mapped in the caller */
 };
 
+/*
+ * Named shared memory. The memory server owns the objects behind the
+ * names, so they outlive their creators until unlinked, and grants each
+ * caller the rights it asks for (SHM_RIGHT_* in ocean/shm.h). The name,
+ * NUL-padded, fills r2-r4; MEM_SHM_CREATE takes the pages in r1 and
+ * MEM_SHM_OPEN the rights. Both reply with the object ID in r1 and its
+ * pages in r2; the caller then maps it with SYS_SHM.
+ */
+#define MEM_SHM_NAME_MAX    24      /* Bytes, including the NUL */
+
 /* MEM_MAP request */
 struct mem_map_req {
     uint64_t virt_addr;     /* Virtual address (0 = any) */
@@ -176,6 +245,31 @@ struct mem_map_reply {
     uint64_t pages;         /* Pages mapped */
 };
 
+/*
+ * External Pager Protocol
+ *
+ * Sent by the kernel, as a call from the faulting thread, to the endpoint
+ * behind a pager-backed region (SYS_PAGER). Words:
+ *   r1  region ID
+ *   r2  byte offset of the page in the region, PAGER_ACCESS_* in the low bits
+ *   r3  pages from there on not present yet, at most PAGER_MAX_CLUSTER
+ *   r4  the cookie the pager gave when mapping the region
+ * The pager supplies at least the faulting page with PAGER_CTL_SUPPLY and
+ * replies E_OK; an error reply, or none, fails the fault. Supplying the
+ * whole r3 run saves the faults a sequential reader would take next.
+ */
+#define PAGER_FAULT         0x600
+
+#define PAGER_ACCESS_READ   (1 << 0)
+#define PAGER_ACCESS_WRITE  (1 << 1)
+#define PAGER_ACCESS_EXEC   (1 << 2)
+#define PAGER_ACCESS_MASK   0xFFF
+
+#define PAGER_FAULT_OFFSET(r2)  ((r2) & ~(uint64_t)PAGER_ACCESS_MASK)
+#define PAGER_FAULT_ACCESS(r2)  ((uint32_t)((r2) & PAGER_ACCESS_MASK))
+
+#define PAGER_MAX_CLUSTER   16      /* Pages per supply */
+
 /*
  * Process Server Protocol
  */
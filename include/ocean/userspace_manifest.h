@@ -7,21 +7,39 @@
 
 #include <ocean/ipc_proto.h>
 
+/* A boot module; the shell spawns a privileged one with SPAWN_PRIVILEGED */
 struct ocean_boot_module_spec {
     const char *name;
     const char *path;
     const char *summary;
     int runnable_from_shell;
+    int privileged;
 };
 
+/*
+ * A core service. Init starts every service whose needs are ready, all at
+ * once; needs is a set of well-known endpoints (OCEAN_SERVICE_NEEDS()),
+ * each of which another service in the list must claim and announce with
+ * INIT_SVC_READY before this one is spawned. For a standby service rs
+ * keeps a second instance parked on its endpoint to take over if the
+ * first dies (see the Reincarnation Server Protocol); rs must need it.
+ * A service not ready start_timeout_ms after its spawn (0 for
+ * OCEAN_SERVICE_START_TIMEOUT_MS) has failed, and so have its dependents.
+ */
 struct ocean_service_spec {
     const char *name;
     const char *path;
     const char *summary;
     uint32_t well_known_ep;
-    int priority;
+    uint32_t needs;
+    int standby;
+    uint32_t start_timeout_ms;
 };
 
+#define OCEAN_SERVICE_START_TIMEOUT_MS  5000
+
+#define OCEAN_SERVICE_NEEDS(ep) (1u << (ep))
+
 static const struct ocean_boot_module_spec ocean_boot_module_specs[] = {
     {
         .name = "init",
@@ -34,6 +52,7 @@ static const struct ocean_boot_module_spec ocean_boot_module_specs[] = {
         .path = "/boot/sh.elf",
         .summary = "Interactive shell",
         .runnable_from_shell = 1,
+        .privileged = 1,
     },
     {
         .name = "echo",
@@ -53,6 +72,13 @@ static const struct ocean_boot_module_spec ocean_boot_module_specs[] = {
         .summary = "List the read-only boot directory",
         .runnable_from_shell = 1,
     },
+    {
+        .name = "bench",
+        .path = "/boot/bench.elf",
+        .summary = "Run kernel microbenchmarks",
+        .runnable_from_shell = 1,
+        .privileged = 1,
+    },
 };
 
 static const struct ocean_service_spec ocean_service_specs[] = {
@@ -61,49 +87,57 @@ static const struct ocean_service_spec ocean_service_specs[] = {
         .path = "/boot/mem.elf",
         .summary = "Memory policy server",
         .well_known_ep = EP_MEM,
-        .priority = 0,
+        .needs = 0,
+        .standby = 1,
     },
     {
         .name = "proc",
         .path = "/boot/proc.elf",
         .summary = "Process lifecycle server",
         .well_known_ep = EP_PROC,
-        .priority = 1,
+        .needs = 0,
     },
     {
         .name = "blk",
         .path = "/boot/blk.elf",
         .summary = "Block device multiplexer",
         .well_known_ep = EP_BLK,
-        .priority = 2,
+        .needs = 0,
     },
     {
         .name = "ata",
         .path = "/boot/ata.elf",
         .summary = "ATA disk driver",
         .well_known_ep = 0,
-        .priority = 3,
+        .needs = OCEAN_SERVICE_NEEDS(EP_BLK),
     },
     {
         .name = "vfs",
         .path = "/boot/vfs.elf",
         .summary = "Virtual filesystem server",
         .well_known_ep = EP_VFS,
-        .priority = 4,
+        .needs = 0,
     },
     {
         .name = "ramfs",
         .path = "/boot/ramfs.elf",
         .summary = "In-memory bootstrap filesystem",
         .well_known_ep = 0,
-        .priority = 4,
+        .needs = OCEAN_SERVICE_NEEDS(EP_VFS),
     },
     {
         .name = "ext2",
         .path = "/boot/ext2.elf",
         .summary = "Read-only ext2 filesystem driver",
         .well_known_ep = 0,
-        .priority = 4,
+        .needs = OCEAN_SERVICE_NEEDS(EP_BLK) | OCEAN_SERVICE_NEEDS(EP_VFS),
+    },
+    {
+        .name = "rs",
+        .path = "/boot/rs.elf",
+        .summary = "Reincarnation server",
+        .well_known_ep = EP_RS,
+        .needs = OCEAN_SERVICE_NEEDS(EP_MEM),
     },
 };
 
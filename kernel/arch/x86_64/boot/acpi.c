@@ -0,0 +1,222 @@
+/*
+ * Ocean Kernel - ACPI Table Discovery
+ *
+ * Walks the XSDT (or the RSDT on ACPI 1.0 firmware) from the RSDP that
+ * Limine hands us and parses the MADT once at boot. Tables live in
+ * firmware-owned memory that the HHDM may not cover, so every table is
+ * mapped through paging_map_mmio() before it is read.
+ */
+
+#include <ocean/acpi.h>
+#include <ocean/boot.h>
+#include <ocean/vmm.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+extern int memcmp(const void *s1, const void *s2, size_t n);
+
+static const struct acpi_sdt_header *acpi_root;    /* XSDT or RSDT */
+static bool acpi_root_is_xsdt;
+
+static struct acpi_madt_info madt_info;
+static bool madt_valid;
+
+static bool acpi_checksum_ok(const void *table, u32 length)
+{
+    const u8 *p = table;
+    u8 sum = 0;
+
+    for (u32 i = 0; i < length; i++) {
+        sum += p[i];
+    }
+    return sum == 0;
+}
+
+/* Map a table: the header first, to learn its length, then all of it */
+static const struct acpi_sdt_header *acpi_map_table(phys_addr_t phys)
+{
+    const struct acpi_sdt_header *hdr;
+
+    hdr = paging_map_mmio(phys, sizeof(*hdr));
+    if (!hdr || hdr->length < sizeof(*hdr)) {
+        return NULL;
+    }
+    if (!paging_map_mmio(phys, hdr->length)) {
+        return NULL;
+    }
+    if (!acpi_checksum_ok(hdr, hdr->length)) {
+        kprintf("ACPI: bad checksum on %.4s at 0x%llx\n", hdr->signature, phys);
+        return NULL;
+    }
+    return hdr;
+}
+
+const struct acpi_sdt_header *acpi_find_table(const char *signature)
+{
+    u32 entries;
+
+    if (!acpi_root) {
+        return NULL;
+    }
+
+    if (acpi_root_is_xsdt) {
+        const u64 *ptrs = (const u64 *)(acpi_root + 1);
+
+        entries = (acpi_root->length - sizeof(*acpi_root)) / sizeof(u64);
+        for (u32 i = 0; i < entries; i++) {
+            const struct acpi_sdt_header *hdr = acpi_map_table(ptrs[i]);
+            if (hdr && memcmp(hdr->signature, signature, 4) == 0) {
+                return hdr;
+            }
+        }
+    } else {
+        const u32 *ptrs = (const u32 *)(acpi_root + 1);
+
+        entries = (acpi_root->length - sizeof(*acpi_root)) / sizeof(u32);
+        for (u32 i = 0; i < entries; i++) {
+            const struct acpi_sdt_header *hdr = acpi_map_table(ptrs[i]);
+            if (hdr && memcmp(hdr->signature, signature, 4) == 0) {
+                return hdr;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void acpi_parse_madt(const struct acpi_madt *madt)
+{
+    const u8 *p = (const u8 *)(madt + 1);
+    const u8 *end = (const u8 *)madt + madt->header.length;
+
+    memset(&madt_info, 0, sizeof(madt_info));
+    madt_info.lapic_address = madt->lapic_address;
+    madt_info.flags = madt->flags;
+    for (u32 irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        madt_info.isa_irqs[irq].gsi = irq;
+    }
+
+    while (p + sizeof(struct acpi_madt_entry) <= end) {
+        const struct acpi_madt_entry *entry = (const void *)p;
+
+        if (entry->length < sizeof(*entry) || p + entry->length > end) {
+            break;
+        }
+
+        switch (entry->type) {
+        case ACPI_MADT_LAPIC: {
+            const struct acpi_madt_lapic *lapic = (const void *)entry;
+
+            if ((lapic->flags & ACPI_MADT_CPU_ENABLED) &&
+                madt_info.nr_cpus < ACPI_MAX_CPUS) {
+                madt_info.cpu_apic_ids[madt_info.nr_cpus++] = lapic->apic_id;
+            }
+            break;
+        }
+        case ACPI_MADT_X2APIC: {
+            const struct acpi_madt_x2apic *x2 = (const void *)entry;
+
+            if ((x2->flags & ACPI_MADT_CPU_ENABLED) &&
+                madt_info.nr_cpus < ACPI_MAX_CPUS) {
+                madt_info.cpu_apic_ids[madt_info.nr_cpus++] = x2->x2apic_id;
+            }
+            break;
+        }
+        case ACPI_MADT_IOAPIC: {
+            const struct acpi_madt_ioapic *io = (const void *)entry;
+
+            if (madt_info.nr_ioapics < ACPI_MAX_IOAPICS) {
+                struct acpi_ioapic_info *info = &madt_info.ioapics[madt_info.nr_ioapics++];
+                info->id = io->ioapic_id;
+                info->gsi_base = io->gsi_base;
+                info->address = io->address;
+            }
+            break;
+        }
+        case ACPI_MADT_ISO: {
+            const struct acpi_madt_iso *iso = (const void *)entry;
+
+            if (iso->bus == 0 && iso->source < ACPI_ISA_IRQS) {
+                madt_info.isa_irqs[iso->source].gsi = iso->gsi;
+                madt_info.isa_irqs[iso->source].flags = iso->flags;
+            }
+            break;
+        }
+        case ACPI_MADT_LAPIC_OVERRIDE: {
+            const struct acpi_madt_lapic_override *ovr = (const void *)entry;
+            madt_info.lapic_address = ovr->address;
+            break;
+        }
+        default:
+            break;
+        }
+
+        p += entry->length;
+    }
+
+    madt_valid = true;
+}
+
+const struct acpi_madt_info *acpi_madt(void)
+{
+    return madt_valid ? &madt_info : NULL;
+}
+
+int acpi_init(void)
+{
+    const struct boot_info *boot = get_boot_info();
+    const struct acpi_rsdp *rsdp;
+    const struct acpi_sdt_header *madt;
+
+    if (!boot->rsdp) {
+        kprintf("ACPI: no RSDP from bootloader\n");
+        return -ENODEV;
+    }
+
+    /* Base revisions before 3 report the RSDP as an HHDM pointer */
+    rsdp = boot->rsdp;
+    if ((u64)rsdp < boot->hhdm_offset) {
+        rsdp = paging_map_mmio((phys_addr_t)(u64)rsdp, sizeof(*rsdp));
+    }
+    if (!rsdp || memcmp(rsdp->signature, "RSD PTR ", 8) != 0 ||
+        !acpi_checksum_ok(rsdp, 20)) {
+        kprintf("ACPI: invalid RSDP\n");
+        return -ENODEV;
+    }
+
+    if (rsdp->revision >= 2 && rsdp->xsdt_address) {
+        acpi_root = acpi_map_table(rsdp->xsdt_address);
+        acpi_root_is_xsdt = acpi_root != NULL;
+    }
+    if (!acpi_root) {
+        acpi_root = acpi_map_table(rsdp->rsdt_address);
+    }
+    if (!acpi_root) {
+        kprintf("ACPI: no usable RSDT/XSDT\n");
+        return -ENODEV;
+    }
+
+    kprintf("ACPI: revision %u, %s at %p\n", rsdp->revision,
+            acpi_root_is_xsdt ? "XSDT" : "RSDT", acpi_root);
+
+    madt = acpi_find_table("APIC");
+    if (!madt) {
+        kprintf("ACPI: no MADT\n");
+        return -ENODEV;
+    }
+    acpi_parse_madt((const struct acpi_madt *)madt);
+
+    kprintf("ACPI: MADT: %u CPUs, %u IOAPICs, LAPIC at 0x%llx\n",
+            madt_info.nr_cpus, madt_info.nr_ioapics, madt_info.lapic_address);
+    for (u32 irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        if (madt_info.isa_irqs[irq].gsi != irq || madt_info.isa_irqs[irq].flags) {
+            kprintf("  ISA IRQ %u -> GSI %u (flags 0x%x)\n", irq,
+                    madt_info.isa_irqs[irq].gsi, madt_info.isa_irqs[irq].flags);
+        }
+    }
+
+    return 0;
+}
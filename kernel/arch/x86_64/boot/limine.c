@@ -8,6 +8,7 @@
 #include <ocean/defs.h>
 #include <ocean/boot.h>
 #include <ocean/process.h>
+#include <ocean/bootprof.h>
 #include "limine.h"
 
 /* External functions */
@@ -20,20 +21,30 @@ extern char *strstr(const char *haystack, const char *needle);
 extern void gdt_init(void);
 extern void idt_init(void);
 extern void pic_remap(void);
+extern int acpi_init(void);
+extern int apic_init(void);
+extern int pci_init(void);
 
 /* Memory management */
 extern void pmm_init(void);
 extern void pmm_dump_stats(void);
 extern void pmm_dump_free_areas(void);
 extern void vmm_init(void);
+extern void shm_init(void);
+extern void pager_init(void);
 extern void kheap_dump_stats(void);
+extern void kstack_dump_stats(void);
 extern void *kmalloc(size_t size);
 extern void kfree(void *ptr);
 
 /* Process and scheduler */
+extern void rcu_init(void);
+extern void rcu_dump_stats(void);
 extern void process_init(void);
 extern void sched_init(void);
+extern void futex_init(void);
 extern void timer_init(void);
+extern void trace_init(void);
 extern void schedule(void);
 extern struct thread *kthread_create(int (*fn)(void *), void *arg, const char *name);
 extern void thread_start(struct thread *t);
@@ -43,7 +54,8 @@ extern void process_dump(void);
 /* Syscalls and user mode */
 extern void syscall_init(void);
 extern void exec_test_user_mode(void);
-extern pid_t exec_elf(const void *elf_data, size_t elf_size, const char *name);
+extern pid_t exec_elf_argv(const void *elf_data, size_t elf_size, const char *name,
+                           const char *const argv[]);
 
 /* IPC */
 extern void ipc_init(void);
@@ -169,6 +181,42 @@ const struct boot_info *get_boot_info(void)
     return &boot_info;
 }
 
+/* init's argv comes from its module command line, split on spaces */
+#define INIT_MAX_ARGS   8
+static char init_cmdline[64];
+
+/*
+ * Copy src into init_cmdline and point argv at each word; argv is
+ * NULL-terminated and holds at most INIT_MAX_ARGS words. Returns the count.
+ */
+static int init_split_cmdline(const char *src, const char **argv)
+{
+    char *buf = init_cmdline;
+    int argc = 0;
+    u64 i;
+
+    for (i = 0; src[i] && i < sizeof(init_cmdline) - 1; i++) {
+        buf[i] = src[i];
+    }
+    buf[i] = '\0';
+
+    while (*buf && argc < INIT_MAX_ARGS) {
+        while (*buf == ' ') {
+            *buf++ = '\0';
+        }
+        if (!*buf) {
+            break;
+        }
+        argv[argc++] = buf;
+        while (*buf && *buf != ' ') {
+            buf++;
+        }
+    }
+    argv[argc] = NULL;
+
+    return argc;
+}
+
 /*
  * Print memory map
  */
@@ -219,8 +267,11 @@ static void print_memory_map(void)
  */
 void _start(void)
 {
+    u64 entry_tsc = rdtsc();
+
     /* Clear BSS */
     memset(_bss_start, 0, _bss_end - _bss_start);
+    boot_phase_init(entry_tsc);
 
     /* Initialize early serial console */
     serial_early_init();
@@ -354,6 +405,7 @@ static void kernel_main(void)
      * Phase 1: CPU Setup
      */
     kprintf("=== Phase 1: CPU Setup ===\n");
+    boot_phase("cpu");
 
     /* Initialize GDT with TSS */
     gdt_init();
@@ -376,15 +428,19 @@ static void kernel_main(void)
     kprintf("=== Phase 2: Memory Setup ===\n");
 
     /* Initialize Physical Memory Manager */
+    boot_phase("pmm");
     pmm_init();
 
     /* Dump PMM stats for verification */
+    boot_phase("pmm.dump");
     pmm_dump_stats();
 
     /* Initialize Virtual Memory Manager (includes kernel heap) */
+    boot_phase("vmm");
     vmm_init();
 
     /* Test kernel heap */
+    boot_phase("heap.test");
     kprintf("\nTesting kernel heap (kmalloc/kfree)...\n");
     void *test1 = kmalloc(64);
     void *test2 = kmalloc(128);
@@ -404,15 +460,39 @@ static void kernel_main(void)
      */
     kprintf("\n=== Phase 3: Core Services ===\n");
 
+    /* Deferred reclamation for the lockless process/thread/endpoint lookups */
+    boot_phase("rcu");
+    rcu_init();
+
     /* Initialize process subsystem */
+    boot_phase("process");
     process_init();
 
     /* Initialize scheduler */
+    boot_phase("sched");
     sched_init();
+    futex_init();
+
+    /*
+     * Move interrupt delivery to the LAPIC/IOAPIC (needs the MADT and
+     * MMIO mappings, so after the VMM); stay on the 8259 without them
+     */
+    boot_phase("acpi");
+    if (acpi_init() == 0) {
+        apic_init();
+    }
+
+    /* Enumerate PCI: ECAM from the MCFG, or the 0xCF8 ports without one */
+    boot_phase("pci");
+    pci_init();
 
     /* Initialize timer (provides preemption) */
+    boot_phase("timer");
     timer_init();
 
+    /* Tracepoints; the TSC is calibrated against the timer from here */
+    trace_init();
+
     kprintf("\nPhase 3 complete: Scheduler initialized\n");
 
     /*
@@ -421,17 +501,23 @@ static void kernel_main(void)
     kprintf("\n=== Phase 4: User Space & IPC ===\n");
 
     /* Initialize system calls */
+    boot_phase("ipc");
     syscall_init();
 
     /* Initialize IPC subsystem */
     ipc_init();
 
+    /* Shared memory objects */
+    shm_init();
+    pager_init();
+
     kprintf("\n");
     kprintf("==================================================\n");
     kprintf("  Kernel initialization complete!\n");
     kprintf("==================================================\n\n");
 
     /* Test IPC between kernel threads */
+    boot_phase("selftest");
     ipc_test();
 
     /* Exercise the well-known endpoint claim/cleanup path */
@@ -442,11 +528,14 @@ static void kernel_main(void)
 
     /* Dump scheduler stats */
     sched_dump_stats();
+    kstack_dump_stats();
+    rcu_dump_stats();
 
     /*
      * Phase 5: Start Init Process
      */
     kprintf("\n=== Phase 5: Starting Init ===\n");
+    boot_phase("init.load");
 
     /* Look for init module loaded by bootloader (use cached copy) */
     pid_t init_pid = -1;
@@ -461,8 +550,10 @@ static void kernel_main(void)
                 kprintf("Found init module at %p, size %llu bytes\n",
                         mod->address, mod->size);
 
-                /* Execute init */
-                init_pid = exec_elf(mod->address, mod->size, "init");
+                /* Execute init; its module command line is its argv */
+                const char *init_argv[INIT_MAX_ARGS + 1];
+                init_split_cmdline(mod->cmdline, init_argv);
+                init_pid = exec_elf_argv(mod->address, mod->size, "init", init_argv);
 
                 if (init_pid > 0) {
                     kprintf("Init started with PID %d\n", init_pid);
@@ -478,6 +569,8 @@ static void kernel_main(void)
         ipc_log_window_status(init_pid);
     }
 
+    boot_phase_done();
+
     if (init_pid <= 0) {
         kprintf("No init module found, running test program...\n");
         exec_test_user_mode();
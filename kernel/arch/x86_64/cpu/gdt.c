@@ -10,11 +10,16 @@
 
 /* External functions */
 extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
 extern int kprintf(const char *fmt, ...);
 
 /* Per-CPU GDT structures */
 static struct cpu_gdt cpu_gdts[MAX_CPUS] __aligned(16);
 
+static_assert(offsetof(struct cpu_gdt, io_bitmap) ==
+              offsetof(struct cpu_gdt, tss) + IO_BITMAP_OFFSET,
+              "I/O bitmap must directly follow the TSS");
+
 /* Current CPU ID (will be set properly with SMP init) */
 static __attribute__((section(".data"))) int current_cpu_id = 0;
 
@@ -56,8 +61,8 @@ static void tss_init(struct tss *tss)
 {
     memset(tss, 0, sizeof(struct tss));
 
-    /* Set IOPB offset to beyond TSS size (no I/O bitmap) */
-    tss->iopb_offset = sizeof(struct tss);
+    /* No I/O bitmap until a process with port access runs */
+    tss->iopb_offset = IO_BITMAP_DISABLED;
 
     /* RSP0 will be set when we switch to user mode */
     /* IST entries will be set up for specific interrupt handlers */
@@ -135,7 +140,9 @@ void gdt_init_cpu(int cpu_id)
      * Entry 6 (0x30): TSS - 16-byte system descriptor
      */
     tss_init(&gdt->tss);
-    gdt_set_tss(&gdt->tss_entry, (u64)&gdt->tss, sizeof(struct tss) - 1);
+    memset(gdt->io_bitmap, 0xFF, sizeof(gdt->io_bitmap));
+    gdt_set_tss(&gdt->tss_entry, (u64)&gdt->tss,
+                IO_BITMAP_OFFSET + IO_BITMAP_BYTES);
 
     /*
      * Set up GDTR
@@ -221,6 +228,36 @@ struct tss *tss_get_current(void)
     return &cpu_gdts[current_cpu_id].tss;
 }
 
+/*
+ * Load an I/O permission bitmap into the current CPU's TSS
+ */
+void tss_load_io_bitmap(const u8 *bitmap, u32 len, u64 seq)
+{
+    struct cpu_gdt *gdt = &cpu_gdts[current_cpu_id];
+
+    if (gdt->io_bitmap_seq != seq) {
+        u32 copy = len > gdt->io_bitmap_len ? len : gdt->io_bitmap_len;
+
+        /* Bytes past len are all ones in the source too */
+        memcpy(gdt->io_bitmap, bitmap, copy);
+        gdt->io_bitmap_seq = seq;
+        gdt->io_bitmap_len = len;
+    }
+    gdt->tss.iopb_offset = IO_BITMAP_OFFSET;
+}
+
+void tss_disable_io_bitmap(void)
+{
+    cpu_gdts[current_cpu_id].tss.iopb_offset = IO_BITMAP_DISABLED;
+}
+
+u64 tss_io_bitmap_seq(void)
+{
+    struct cpu_gdt *gdt = &cpu_gdts[current_cpu_id];
+
+    return gdt->tss.iopb_offset == IO_BITMAP_OFFSET ? gdt->io_bitmap_seq : 0;
+}
+
 /*
  * Initialize GDT for BSP (Bootstrap Processor)
  */
@@ -13,6 +13,7 @@
 
 #include <ocean/types.h>
 #include <ocean/defs.h>
+#include <ocean/smp.h>
 
 /*
  * Segment selectors
@@ -123,6 +124,16 @@ struct tss {
 /* TSS size */
 #define TSS_SIZE            sizeof(struct tss)
 
+/*
+ * I/O permission bitmap: one bit per port, set = denied. It follows the
+ * TSS with the extra all-ones byte the CPU requires, and the TSS limit
+ * always covers it; pointing iopb_offset past the limit turns it off.
+ */
+#define IO_BITMAP_PORTS     65536
+#define IO_BITMAP_BYTES     (IO_BITMAP_PORTS / 8)
+#define IO_BITMAP_OFFSET    sizeof(struct tss)
+#define IO_BITMAP_DISABLED  0xFFFF
+
 /* Access byte flags */
 #define GDT_ACCESS_PRESENT  (1 << 7)    /* Segment present */
 #define GDT_ACCESS_DPL0     (0 << 5)    /* Ring 0 */
@@ -172,10 +183,12 @@ struct cpu_gdt {
     struct tss_entry tss_entry;                  /* TSS (16 bytes) */
     struct gdt_ptr   gdtr;                       /* GDT register value */
     struct tss       tss;                        /* Task State Segment */
-} __aligned(16);
+    u8               io_bitmap[IO_BITMAP_BYTES + 1];
 
-/* Maximum CPUs supported */
-#define MAX_CPUS            256
+    /* Version of the bitmap io_bitmap holds and how many bytes it uses */
+    u64              io_bitmap_seq;
+    u32              io_bitmap_len;
+} __aligned(16);
 
 /* GDT functions */
 void gdt_init(void);
@@ -188,4 +201,16 @@ void tss_set_ist(int ist, u64 stack);
 /* Get current CPU's TSS */
 struct tss *tss_get_current(void);
 
+/*
+ * Enable the current CPU's I/O bitmap with the first len bytes of bitmap.
+ * seq names that version of the bitmap: if it is what the TSS already
+ * holds nothing is copied, and otherwise only the bytes either version
+ * uses are.
+ */
+void tss_load_io_bitmap(const u8 *bitmap, u32 len, u64 seq);
+void tss_disable_io_bitmap(void);
+
+/* seq of the bitmap loaded and enabled on this CPU, 0 if none */
+u64 tss_io_bitmap_seq(void);
+
 #endif /* _OCEAN_GDT_H */
@@ -0,0 +1,244 @@
+/*
+ * Ocean Kernel - I/O Port Access
+ *
+ * Each process with port access has a full 8 KiB bitmap of its own. The
+ * TSS copy is refreshed on context switch only when the incoming
+ * bitmap's version differs from the one loaded, and then only over the
+ * bytes either version uses; switching to a process without port access
+ * just moves the TSS bitmap offset out of range.
+ */
+
+#include <ocean/ioport.h>
+#include <ocean/pci.h>
+#include <ocean/process.h>
+#include <ocean/spinlock.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+#include "gdt.h"
+
+/* External functions */
+extern void *kmalloc(size_t size);
+extern void kfree(void *ptr);
+extern void *memset(void *s, int c, size_t n);
+
+struct ioport_claim {
+    u32 base;
+    u32 count;                  /* 0 = free slot */
+    pid_t owner;
+};
+
+static struct ioport_claim ioport_claims[IOPORT_MAX_CLAIMS];
+static DEFINE_SPINLOCK(ioport_lock);
+
+/* Bitmap versions; 0 means "none loaded" */
+static u64 ioport_seq;
+
+/* Ports the kernel drives itself, and ones that can reset the machine */
+static const struct {
+    u32 base;
+    u32 count;
+} ioport_reserved[] = {
+    { 0x20, 2 },                /* Master PIC */
+    { 0x40, 4 },                /* PIT */
+    { 0x60, 1 },                /* Keyboard controller data */
+    { 0x64, 1 },                /* Keyboard controller command: CPU reset */
+    { 0x70, 2 },                /* CMOS index (bit 7 gates NMI) and data */
+    { 0x80, 1 },                /* POST port, used for I/O delays */
+    { 0x92, 1 },                /* System control port A: fast reset */
+    { 0xA0, 2 },                /* Slave PIC */
+    { 0x3F8, 8 },               /* COM1, the kernel console */
+    { 0xCF8, 8 },               /* PCI configuration mechanism #1 */
+};
+
+static inline bool ranges_overlap(u32 a, u32 alen, u32 b, u32 blen)
+{
+    return a < b + blen && b < a + alen;
+}
+
+static void ioport_set_access(u8 *bitmap, u32 base, u32 count, bool allow)
+{
+    for (u32 port = base; port < base + count; port++) {
+        if (allow) {
+            bitmap[port / 8] &= (u8)~(1 << (port % 8));
+        } else {
+            bitmap[port / 8] |= (u8)(1 << (port % 8));
+        }
+    }
+}
+
+/* Ports of a PCI I/O BAR belong to whoever holds the device's claim */
+static int ioport_check_pci(pid_t pid, u32 base, u32 count)
+{
+    for (u32 i = 0; i < pci_device_count(); i++) {
+        struct pci_dev *dev = pci_device(i);
+
+        for (int b = 0; b < PCI_MAX_BARS; b++) {
+            struct pci_bar *bar = &dev->info.bars[b];
+
+            if (!(bar->flags & PCI_BAR_IO) || !bar->base ||
+                !ranges_overlap(base, count, (u32)bar->base, (u32)bar->size)) {
+                continue;
+            }
+            if ((pid_t)dev->info.owner != pid) {
+                return -EPERM;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Reload the calling CPU if proc is what it runs */
+static void ioport_refresh(struct process *proc)
+{
+    if (proc == get_current_process()) {
+        u64 flags = local_irq_save();
+
+        ioport_switch(proc);
+        local_irq_restore(flags);
+    }
+}
+
+int ioport_claim(struct process *proc, u32 base, u32 count)
+{
+    struct ioport_claim *slot = NULL;
+    u8 *bitmap = NULL;
+    u64 flags;
+    int ret;
+
+    if (count == 0 || base >= IO_BITMAP_PORTS || count > IO_BITMAP_PORTS - base) {
+        return -EINVAL;
+    }
+    for (u32 i = 0; i < ARRAY_SIZE(ioport_reserved); i++) {
+        if (ranges_overlap(base, count, ioport_reserved[i].base,
+                           ioport_reserved[i].count)) {
+            return -EPERM;
+        }
+    }
+    ret = ioport_check_pci(proc->pid, base, count);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (!proc->io_bitmap) {
+        bitmap = kmalloc(IO_BITMAP_BYTES);
+        if (!bitmap) {
+            return -ENOMEM;
+        }
+        memset(bitmap, 0xFF, IO_BITMAP_BYTES);
+    }
+
+    spin_lock_irqsave(&ioport_lock, &flags);
+    for (int i = 0; i < IOPORT_MAX_CLAIMS; i++) {
+        struct ioport_claim *c = &ioport_claims[i];
+
+        if (!c->count) {
+            if (!slot) {
+                slot = c;
+            }
+        } else if (ranges_overlap(base, count, c->base, c->count)) {
+            spin_unlock_irqrestore(&ioport_lock, flags);
+            kfree(bitmap);
+            return -EBUSY;
+        }
+    }
+    if (!slot) {
+        spin_unlock_irqrestore(&ioport_lock, flags);
+        kfree(bitmap);
+        return -ENOSPC;
+    }
+    slot->base = base;
+    slot->count = count;
+    slot->owner = proc->pid;
+
+    if (!proc->io_bitmap) {
+        proc->io_bitmap = bitmap;
+        bitmap = NULL;
+    }
+    ioport_set_access(proc->io_bitmap, base, count, true);
+    if ((base + count + 7) / 8 > proc->io_bitmap_len) {
+        proc->io_bitmap_len = (base + count + 7) / 8;
+    }
+    __atomic_store_n(&proc->io_bitmap_seq, ++ioport_seq, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&ioport_lock, flags);
+
+    kfree(bitmap);      /* Lost a race to install one */
+    ioport_refresh(proc);
+    return 0;
+}
+
+int ioport_release(struct process *proc, u32 base, u32 count)
+{
+    u64 flags;
+    int ret = -ENOENT;
+
+    spin_lock_irqsave(&ioport_lock, &flags);
+    for (int i = 0; i < IOPORT_MAX_CLAIMS; i++) {
+        struct ioport_claim *c = &ioport_claims[i];
+
+        if (c->count == count && c->base == base && c->owner == proc->pid) {
+            c->count = 0;
+            ioport_set_access(proc->io_bitmap, base, count, false);
+            __atomic_store_n(&proc->io_bitmap_seq, ++ioport_seq, __ATOMIC_RELEASE);
+            ret = 0;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&ioport_lock, flags);
+
+    if (ret == 0) {
+        ioport_refresh(proc);
+    }
+    return ret;
+}
+
+void ioport_release_all(struct process *proc)
+{
+    u8 *bitmap;
+    u64 flags;
+
+    spin_lock_irqsave(&ioport_lock, &flags);
+    for (int i = 0; i < IOPORT_MAX_CLAIMS; i++) {
+        if (ioport_claims[i].count && ioport_claims[i].owner == proc->pid) {
+            ioport_claims[i].count = 0;
+        }
+    }
+    bitmap = proc->io_bitmap;
+    proc->io_bitmap = NULL;
+    proc->io_bitmap_len = 0;
+    proc->io_bitmap_seq = 0;
+    spin_unlock_irqrestore(&ioport_lock, flags);
+
+    if (bitmap) {
+        ioport_refresh(proc);
+        kfree(bitmap);
+    }
+}
+
+void ioport_switch(struct process *next)
+{
+    u64 seq;
+
+    if (!next || !next->io_bitmap) {
+        if (tss_io_bitmap_seq()) {
+            tss_disable_io_bitmap();
+        }
+        return;
+    }
+
+    seq = __atomic_load_n(&next->io_bitmap_seq, __ATOMIC_ACQUIRE);
+    if (tss_io_bitmap_seq() != seq) {
+        tss_load_io_bitmap(next->io_bitmap, next->io_bitmap_len, seq);
+    }
+}
+
+bool ioport_fault_fixup(void)
+{
+    struct process *proc = get_current_process();
+
+    if (!proc || !proc->io_bitmap ||
+        tss_io_bitmap_seq() == __atomic_load_n(&proc->io_bitmap_seq, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    ioport_switch(proc);
+    return true;
+}
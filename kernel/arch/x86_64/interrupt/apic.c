@@ -0,0 +1,230 @@
+/*
+ * Ocean Kernel - Local APIC
+ *
+ * Brings up the boot CPU's local APIC in x2APIC mode when the CPU has it
+ * (EOI is then a single WRMSR) and in xAPIC MMIO mode otherwise. The CPU
+ * table numbers CPUs for interrupt affinity: the boot CPU is 0 and the
+ * other enabled MADT entries follow in table order. Application
+ * processors are not started yet, so only CPU 0 is online.
+ */
+
+#include <ocean/acpi.h>
+#include <ocean/irq.h>
+#include <ocean/vmm.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+#include "apic.h"
+#include "idt.h"
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+static volatile u32 *lapic_mmio;
+static bool lapic_x2apic;
+static bool lapic_enabled;
+
+static u32 apic_cpu_ids[ACPI_MAX_CPUS];
+static bool apic_cpu_up[ACPI_MAX_CPUS];
+static u32 apic_nr_cpus = 1;
+
+static inline void cpuid(u32 leaf, u32 *eax, u32 *ebx, u32 *ecx, u32 *edx)
+{
+    __asm__ __volatile__("cpuid"
+                         : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                         : "a"(leaf), "c"(0));
+}
+
+static inline u32 lapic_read(u32 reg)
+{
+    if (lapic_x2apic) {
+        return (u32)rdmsr(MSR_X2APIC_BASE + (reg >> 4));
+    }
+    return lapic_mmio[reg / 4];
+}
+
+static inline void lapic_write(u32 reg, u32 val)
+{
+    if (lapic_x2apic) {
+        wrmsr(MSR_X2APIC_BASE + (reg >> 4), val);
+        return;
+    }
+    lapic_mmio[reg / 4] = val;
+}
+
+bool lapic_active(void)
+{
+    return lapic_enabled;
+}
+
+u32 lapic_id(void)
+{
+    u32 id = lapic_read(LAPIC_ID);
+
+    /* xAPIC keeps the 8-bit ID in the top byte */
+    return lapic_x2apic ? id : id >> 24;
+}
+
+void lapic_eoi(void)
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/*
+ * Number CPUs from the MADT with the boot CPU first
+ */
+static void apic_build_cpu_table(u32 bsp_id)
+{
+    const struct acpi_madt_info *madt = acpi_madt();
+
+    apic_cpu_ids[0] = bsp_id;
+    apic_cpu_up[0] = true;
+    apic_nr_cpus = 1;
+
+    if (!madt) {
+        return;
+    }
+    for (u32 i = 0; i < madt->nr_cpus && apic_nr_cpus < ACPI_MAX_CPUS; i++) {
+        if (madt->cpu_apic_ids[i] != bsp_id) {
+            apic_cpu_ids[apic_nr_cpus++] = madt->cpu_apic_ids[i];
+        }
+    }
+}
+
+int lapic_init(void)
+{
+    const struct acpi_madt_info *madt = acpi_madt();
+    u32 eax, ebx, ecx, edx;
+    u64 base;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_APIC)) {
+        kprintf("LAPIC: not present\n");
+        return -ENODEV;
+    }
+
+    base = rdmsr(MSR_APIC_BASE);
+    if (madt && madt->lapic_address) {
+        base = (base & ~APIC_BASE_ADDR_MASK) | madt->lapic_address;
+    }
+
+    /* Disabled -> xAPIC -> x2APIC is the only legal way up */
+    wrmsr(MSR_APIC_BASE, (base & ~APIC_BASE_X2APIC) | APIC_BASE_ENABLE);
+    if (ecx & CPUID_ECX_X2APIC) {
+        wrmsr(MSR_APIC_BASE, base | APIC_BASE_ENABLE | APIC_BASE_X2APIC);
+        lapic_x2apic = true;
+    } else {
+        lapic_mmio = paging_map_mmio(base & APIC_BASE_ADDR_MASK, PAGE_SIZE);
+        if (!lapic_mmio) {
+            kprintf("LAPIC: cannot map registers at 0x%llx\n",
+                    base & APIC_BASE_ADDR_MASK);
+            return -ENOMEM;
+        }
+    }
+
+    /* Accept every priority; no timer or error interrupts yet */
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | VEC_APIC_TIMER);
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_ESR, 0);
+
+    /*
+     * LINT0 stays in ExtINT (virtual wire) so the 8259 keeps working until
+     * an IOAPIC takes over; LINT1 is the NMI line on PC platforms.
+     */
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_EXTINT);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | VEC_APIC_SPURIOUS);
+    lapic_eoi();
+
+    lapic_enabled = true;
+    apic_build_cpu_table(lapic_id());
+
+    kprintf("LAPIC: %s mode, id %u, version 0x%x, %u CPUs in MADT\n",
+            lapic_x2apic ? "x2APIC" : "xAPIC", apic_cpu_ids[0],
+            lapic_read(LAPIC_VERSION) & 0xFF, apic_nr_cpus);
+    return 0;
+}
+
+/*
+ * Switch interrupt delivery from the 8259 to the LAPIC and IOAPICs
+ */
+int apic_init(void)
+{
+    u64 flags;
+    int ret;
+
+    flags = local_irq_save();
+
+    ret = lapic_init();
+    if (ret == 0) {
+        ret = ioapic_init();
+        if (ret == 0) {
+            /* The PICs are masked now; take LINT0 off virtual wire */
+            lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+        } else {
+            kprintf("APIC: no IOAPIC, ISA IRQs stay on the 8259\n");
+        }
+    }
+
+    local_irq_restore(flags);
+    return ret;
+}
+
+/*
+ * Send vector to the calling CPU as a fixed, edge-triggered self-IPI
+ */
+int irq_raise_vector(int vector)
+{
+    u64 flags;
+
+    if (!lapic_enabled) {
+        return -ENODEV;
+    }
+    if (vector < IRQ_VECTOR_DYN_FIRST || vector > IRQ_VECTOR_DYN_LAST) {
+        return -EINVAL;
+    }
+
+    flags = local_irq_save();
+    if (!lapic_x2apic) {
+        while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+            cpu_pause();
+        }
+    }
+    lapic_write(LAPIC_ICR_LOW, LAPIC_ICR_SELF | (u32)vector);
+    local_irq_restore(flags);
+
+    return 0;
+}
+
+u32 irq_nr_cpus(void)
+{
+    return apic_nr_cpus;
+}
+
+bool irq_cpu_online(u32 cpu)
+{
+    return cpu < apic_nr_cpus && apic_cpu_up[cpu];
+}
+
+u32 irq_cpu_apic_id(u32 cpu)
+{
+    return cpu < apic_nr_cpus ? apic_cpu_ids[cpu] : 0;
+}
+
+u32 irq_this_cpu(void)
+{
+    u32 id;
+
+    if (!lapic_enabled) {
+        return 0;
+    }
+    id = lapic_id();
+    for (u32 cpu = 0; cpu < apic_nr_cpus; cpu++) {
+        if (apic_cpu_ids[cpu] == id) {
+            return cpu;
+        }
+    }
+    return 0;
+}
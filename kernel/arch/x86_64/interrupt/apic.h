@@ -0,0 +1,83 @@
+/*
+ * Ocean Kernel - Local APIC and IOAPIC
+ *
+ * Register layout and the arch-internal interface used by idt.c and
+ * timer.c. Drivers route interrupts through <ocean/irq.h> instead.
+ */
+
+#ifndef _OCEAN_APIC_H
+#define _OCEAN_APIC_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/*
+ * Local APIC
+ */
+#define MSR_APIC_BASE           0x1B
+#define APIC_BASE_BSP           (1ULL << 8)
+#define APIC_BASE_X2APIC        (1ULL << 10)
+#define APIC_BASE_ENABLE        (1ULL << 11)
+#define APIC_BASE_ADDR_MASK     0x000FFFFFFFFFF000ULL
+
+/* x2APIC registers are MSRs at 0x800 + (xAPIC MMIO offset >> 4) */
+#define MSR_X2APIC_BASE         0x800
+
+/* Register offsets (xAPIC MMIO) */
+#define LAPIC_ID                0x020
+#define LAPIC_VERSION           0x030
+#define LAPIC_TPR               0x080   /* Task priority */
+#define LAPIC_EOI               0x0B0
+#define LAPIC_SVR               0x0F0   /* Spurious interrupt vector */
+#define LAPIC_ESR               0x280   /* Error status */
+#define LAPIC_ICR_LOW           0x300
+#define LAPIC_ICR_HIGH          0x310
+#define LAPIC_LVT_TIMER         0x320
+#define LAPIC_LVT_LINT0         0x350
+#define LAPIC_LVT_LINT1         0x360
+#define LAPIC_LVT_ERROR         0x370
+
+#define LAPIC_SVR_ENABLE        (1 << 8)
+#define LAPIC_LVT_MASKED        (1 << 16)
+#define LAPIC_LVT_NMI           (4 << 8)    /* Delivery mode NMI */
+#define LAPIC_LVT_EXTINT        (7 << 8)    /* Delivery mode ExtINT (8259) */
+#define LAPIC_ICR_PENDING       (1 << 12)   /* xAPIC delivery status */
+#define LAPIC_ICR_SELF          (1 << 18)   /* Destination shorthand: self */
+
+/* CPUID.01H feature bits */
+#define CPUID_EDX_APIC          (1 << 9)
+#define CPUID_ECX_X2APIC        (1 << 21)
+
+/*
+ * IOAPIC (indirect access through a select/window register pair)
+ */
+#define IOAPIC_REGSEL           0x00
+#define IOAPIC_WINDOW           0x10
+
+#define IOAPIC_REG_ID           0x00
+#define IOAPIC_REG_VERSION      0x01
+#define IOAPIC_REG_REDTBL(n)    (0x10 + 2 * (n))
+
+/* Redirection entry (low dword; destination APIC ID in bits 56-63) */
+#define IOAPIC_RTE_POLARITY_LOW (1 << 13)
+#define IOAPIC_RTE_LEVEL        (1 << 15)
+#define IOAPIC_RTE_MASKED       (1 << 16)
+#define IOAPIC_RTE_DEST_SHIFT   56
+
+/* LAPIC, then IOAPICs; on failure interrupts stay on the 8259 */
+int apic_init(void);
+
+/* Local APIC of the calling CPU */
+int lapic_init(void);
+bool lapic_active(void);
+u32 lapic_id(void);
+void lapic_eoi(void);
+
+/* Program every IOAPIC from the MADT; ISA IRQs start masked */
+int ioapic_init(void);
+bool ioapic_active(void);
+
+/* Mask/unmask ISA IRQ irq (0-15) in IOAPIC mode */
+void ioapic_set_isa_masked(int irq, bool masked);
+
+#endif /* _OCEAN_APIC_H */
@@ -6,7 +6,12 @@
 
 #include <ocean/types.h>
 #include <ocean/defs.h>
+#include <ocean/sched.h>
+#include <ocean/irq.h>
+#include <ocean/ioport.h>
+#include <ocean/spinlock.h>
 #include "idt.h"
+#include "apic.h"
 #include "../cpu/gdt.h"
 
 /* External functions */
@@ -22,6 +27,19 @@ static struct idt_ptr idtr;
 /* IRQ handler table */
 static irq_handler_t irq_handlers[16];
 
+/* Dynamically allocated vectors */
+struct irq_vector {
+    irq_vector_fn_t fn;
+    void *data;
+    bool allocated;
+};
+
+static struct irq_vector irq_vectors[IRQ_NR_DYN_VECTORS];
+static DEFINE_SPINLOCK(irq_vector_lock);
+
+/* Entry stubs for the dynamic vectors (isr.asm) */
+extern isr_fn_t irq_stub_table[IRQ_NR_DYN_VECTORS];
+
 /* Exception names for debugging */
 const char *exception_names[32] = {
     [VEC_DIVIDE_ERROR]        = "Divide Error (#DE)",
@@ -154,6 +172,12 @@ void idt_init(void)
     idt_set_gate(VEC_ATA_PRIMARY,   irq14, IDT_TYPE_INTERRUPT, 0);
     idt_set_gate(VEC_ATA_SECONDARY, irq15, IDT_TYPE_INTERRUPT, 0);
 
+    /* Dynamic device vectors (48-239); 0x80 is set below for syscalls */
+    for (int i = 0; i < IRQ_NR_DYN_VECTORS; i++) {
+        idt_set_gate(IRQ_VECTOR_DYN_FIRST + i, irq_stub_table[i],
+                     IDT_TYPE_INTERRUPT, 0);
+    }
+
     /*
      * Set up APIC and IPI handlers
      */
@@ -178,6 +202,18 @@ void idt_init(void)
     kprintf("IDT loaded: %d entries at 0x%llx\n", IDT_ENTRIES, (u64)&idt);
 }
 
+/*
+ * On the way back to user mode no kernel lock is held, so a thread whose
+ * process is exiting leaves here. The timer gets every thread here within
+ * a tick, even one that never makes a syscall.
+ */
+static void exit_to_user_check(void)
+{
+    if (current_thread && (current_thread->flags & TF_GROUP_EXIT)) {
+        thread_exit(0);
+    }
+}
+
 /*
  * Exception handler (C entry point)
  *
@@ -186,8 +222,23 @@ void idt_init(void)
 void exception_handler(struct trap_frame *frame)
 {
     if (frame->int_no == VEC_PAGE_FAULT) {
-        extern void page_fault_handler(u64 error_code);
-        page_fault_handler(frame->error_code);
+        extern void page_fault_handler(u64 error_code, u64 rip);
+        bool from_user = (frame->cs & 3) == 3;
+
+        if (from_user) {
+            sched_account_kernel_enter();
+        }
+        page_fault_handler(frame->error_code, frame->rip);
+        if (from_user) {
+            exit_to_user_check();
+            sched_account_kernel_exit();
+        }
+        return;
+    }
+
+    /* A port access against a stale I/O bitmap is retried once reloaded */
+    if (frame->int_no == VEC_GENERAL_PROTECTION && (frame->cs & 3) == 3 &&
+        ioport_fault_fixup()) {
         return;
     }
 
@@ -230,30 +281,113 @@ void exception_handler(struct trap_frame *frame)
     }
 }
 
+/*
+ * Acknowledge an interrupt
+ *
+ * ISA IRQs are acknowledged at the 8259 until an IOAPIC has taken them
+ * over; everything else arrives through the local APIC.
+ */
+static void irq_eoi(u64 vector)
+{
+    if (vector >= VEC_IRQ_BASE && vector < VEC_IRQ_BASE + 16 && !ioapic_active()) {
+        if (vector >= VEC_IRQ_BASE + 8) {
+            outb(0xA0, 0x20);  /* EOI to slave PIC */
+        }
+        outb(0x20, 0x20);      /* EOI to master PIC */
+        return;
+    }
+
+    if (lapic_active()) {
+        lapic_eoi();
+    }
+}
+
 /*
  * IRQ handler (C entry point)
  *
- * Called from assembly ISR stubs for hardware IRQs (vectors 32-47)
+ * Called from assembly ISR stubs for hardware IRQs, dynamic device
+ * vectors and the APIC/IPI vectors
  */
 void irq_handler(struct trap_frame *frame)
 {
-    int irq = (int)(frame->int_no - VEC_IRQ_BASE);
+    u64 vector = frame->int_no;
+    bool from_user = (frame->cs & 3) == 3;
 
-    /* Call registered handler if any */
-    if (irq >= 0 && irq < 16 && irq_handlers[irq]) {
-        irq_handlers[irq](frame);
+    if (from_user) {
+        sched_account_kernel_enter();
     }
 
-    /*
-     * Send End-Of-Interrupt to PIC
-     *
-     * For now, use legacy 8259 PIC. Will switch to APIC later.
-     * If IRQ came from slave PIC (IRQ 8-15), send EOI to both.
-     */
-    if (irq >= 8) {
-        outb(0xA0, 0x20);  /* EOI to slave PIC */
+    if (vector >= VEC_IRQ_BASE && vector < VEC_IRQ_BASE + 16) {
+        int irq = (int)(vector - VEC_IRQ_BASE);
+
+        /* Call registered handler if any */
+        if (irq_handlers[irq]) {
+            irq_handlers[irq](frame);
+        }
+    } else if (vector >= IRQ_VECTOR_DYN_FIRST && vector <= IRQ_VECTOR_DYN_LAST) {
+        struct irq_vector *v = &irq_vectors[vector - IRQ_VECTOR_DYN_FIRST];
+        irq_vector_fn_t fn = __atomic_load_n(&v->fn, __ATOMIC_ACQUIRE);
+
+        if (fn) {
+            fn((u8)vector, v->data);
+        }
     }
-    outb(0x20, 0x20);      /* EOI to master PIC */
+
+    /* A spurious interrupt is not in service, so it takes no EOI */
+    if (vector != VEC_APIC_SPURIOUS) {
+        irq_eoi(vector);
+    }
+
+    if (from_user) {
+        exit_to_user_check();
+        sched_account_kernel_exit();
+    }
+}
+
+/*
+ * Allocate a dynamic vector
+ */
+int irq_alloc_vector(irq_vector_fn_t fn, void *data)
+{
+    u64 flags;
+    int vector = -ENOSPC;
+
+    spin_lock_irqsave(&irq_vector_lock, &flags);
+    for (int i = 0; i < IRQ_NR_DYN_VECTORS; i++) {
+        struct irq_vector *v = &irq_vectors[i];
+
+        if (v->allocated || IRQ_VECTOR_DYN_FIRST + i == VEC_SYSCALL) {
+            continue;
+        }
+        v->allocated = true;
+        v->data = data;
+        __atomic_store_n(&v->fn, fn, __ATOMIC_RELEASE);
+        vector = IRQ_VECTOR_DYN_FIRST + i;
+        break;
+    }
+    spin_unlock_irqrestore(&irq_vector_lock, flags);
+
+    return vector;
+}
+
+/*
+ * Release a dynamic vector; its source must already be masked
+ */
+void irq_free_vector(int vector)
+{
+    struct irq_vector *v;
+    u64 flags;
+
+    if (vector < IRQ_VECTOR_DYN_FIRST || vector > IRQ_VECTOR_DYN_LAST) {
+        return;
+    }
+    v = &irq_vectors[vector - IRQ_VECTOR_DYN_FIRST];
+
+    spin_lock_irqsave(&irq_vector_lock, &flags);
+    __atomic_store_n(&v->fn, NULL, __ATOMIC_RELEASE);
+    v->data = NULL;
+    v->allocated = false;
+    spin_unlock_irqrestore(&irq_vector_lock, flags);
 }
 
 /*
@@ -267,6 +401,23 @@ void irq_register(int irq, irq_handler_t handler)
     }
 }
 
+/*
+ * Register an IRQ handler unless one is already installed
+ */
+int irq_try_register(int irq, irq_handler_t handler)
+{
+    irq_handler_t expected = NULL;
+
+    if (irq < 0 || irq >= 16) {
+        return -EINVAL;
+    }
+    if (!__atomic_compare_exchange_n(&irq_handlers[irq], &expected, handler, false,
+                                     __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return -EBUSY;
+    }
+    return 0;
+}
+
 /*
  * Unregister an IRQ handler
  */
@@ -168,6 +168,9 @@ typedef void (*irq_handler_t)(struct trap_frame *frame);
 void irq_register(int irq, irq_handler_t handler);
 void irq_unregister(int irq);
 
+/* Like irq_register(), but -EBUSY if the IRQ already has a handler */
+int irq_try_register(int irq, irq_handler_t handler);
+
 /* 8259 PIC functions */
 void pic_remap(void);
 void pic_disable(void);
@@ -0,0 +1,322 @@
+/*
+ * Ocean Kernel - IOAPIC Interrupt Routing
+ *
+ * Each IOAPIC serves a contiguous range of global system interrupts
+ * (GSIs) starting at its MADT gsi_base; pin n is GSI gsi_base + n. A
+ * redirection entry holds the vector, trigger mode, polarity, mask bit
+ * and the destination APIC ID, so steering an interrupt to another CPU
+ * is a single entry rewrite.
+ *
+ * ISA IRQs keep their vectors 32-47 and go to the boot CPU, following the
+ * MADT's interrupt source overrides (the PIT's IRQ 0 is usually GSI 2).
+ * Physical destination mode carries an 8-bit APIC ID; CPUs above 255
+ * would need interrupt remapping, which we do not set up.
+ */
+
+#include <ocean/acpi.h>
+#include <ocean/irq.h>
+#include <ocean/vmm.h>
+#include <ocean/spinlock.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+#include "apic.h"
+#include "idt.h"
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+struct ioapic {
+    volatile u32 *mmio;
+    u32 id;
+    u32 gsi_base;
+    u32 nr_pins;
+};
+
+static struct ioapic ioapics[ACPI_MAX_IOAPICS];
+static u32 nr_ioapics;
+static bool ioapic_enabled;
+
+/* GSI serving each ISA IRQ */
+static u32 isa_gsi[ACPI_ISA_IRQS];
+
+/* Serialises select/window register pairs and read-modify-write of entries */
+static DEFINE_SPINLOCK(ioapic_lock);
+
+static u32 ioapic_read(struct ioapic *io, u32 reg)
+{
+    io->mmio[IOAPIC_REGSEL / 4] = reg;
+    return io->mmio[IOAPIC_WINDOW / 4];
+}
+
+static void ioapic_write(struct ioapic *io, u32 reg, u32 val)
+{
+    io->mmio[IOAPIC_REGSEL / 4] = reg;
+    io->mmio[IOAPIC_WINDOW / 4] = val;
+}
+
+static u64 ioapic_read_rte(struct ioapic *io, u32 pin)
+{
+    u64 lo = ioapic_read(io, IOAPIC_REG_REDTBL(pin));
+    u64 hi = ioapic_read(io, IOAPIC_REG_REDTBL(pin) + 1);
+
+    return (hi << 32) | lo;
+}
+
+/* Mask first so the pin never fires with a half-written entry */
+static void ioapic_write_rte(struct ioapic *io, u32 pin, u64 rte)
+{
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin), IOAPIC_RTE_MASKED);
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin) + 1, (u32)(rte >> 32));
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin), (u32)rte);
+}
+
+static struct ioapic *ioapic_for_gsi(u32 gsi, u32 *pin)
+{
+    for (u32 i = 0; i < nr_ioapics; i++) {
+        struct ioapic *io = &ioapics[i];
+
+        if (gsi >= io->gsi_base && gsi < io->gsi_base + io->nr_pins) {
+            *pin = gsi - io->gsi_base;
+            return io;
+        }
+    }
+    return NULL;
+}
+
+static int ioapic_dest(u32 cpu, u64 *dest)
+{
+    u32 apic_id;
+
+    if (!irq_cpu_online(cpu)) {
+        return -EINVAL;
+    }
+    apic_id = irq_cpu_apic_id(cpu);
+    if (apic_id > 0xFF) {
+        return -EINVAL;
+    }
+    *dest = (u64)apic_id << IOAPIC_RTE_DEST_SHIFT;
+    return 0;
+}
+
+bool ioapic_active(void)
+{
+    return ioapic_enabled;
+}
+
+int irq_route_gsi(u32 gsi, int vector, u32 cpu, u32 flags)
+{
+    struct ioapic *io;
+    u64 rte, dest, irqflags;
+    u32 pin;
+    int ret;
+
+    if (!ioapic_enabled) {
+        return -ENODEV;
+    }
+    if (vector < VEC_IRQ_BASE || vector > IRQ_VECTOR_DYN_LAST ||
+        vector == VEC_SYSCALL) {
+        return -EINVAL;
+    }
+    io = ioapic_for_gsi(gsi, &pin);
+    if (!io) {
+        return -ENODEV;
+    }
+    ret = ioapic_dest(cpu, &dest);
+    if (ret < 0) {
+        return ret;
+    }
+
+    rte = (u64)vector | IOAPIC_RTE_MASKED | dest;
+    if (flags & IRQ_TRIGGER_LEVEL) {
+        rte |= IOAPIC_RTE_LEVEL;
+    }
+    if (flags & IRQ_POLARITY_LOW) {
+        rte |= IOAPIC_RTE_POLARITY_LOW;
+    }
+
+    spin_lock_irqsave(&ioapic_lock, &irqflags);
+    ioapic_write_rte(io, pin, rte);
+    spin_unlock_irqrestore(&ioapic_lock, irqflags);
+
+    return 0;
+}
+
+static int ioapic_update_rte(u32 gsi, u64 clear, u64 set)
+{
+    struct ioapic *io;
+    u64 flags;
+    u32 pin;
+
+    if (!ioapic_enabled) {
+        return -ENODEV;
+    }
+    io = ioapic_for_gsi(gsi, &pin);
+    if (!io) {
+        return -ENODEV;
+    }
+
+    spin_lock_irqsave(&ioapic_lock, &flags);
+    ioapic_write_rte(io, pin, (ioapic_read_rte(io, pin) & ~clear) | set);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
+
+    return 0;
+}
+
+int irq_mask_gsi(u32 gsi)
+{
+    return ioapic_update_rte(gsi, 0, IOAPIC_RTE_MASKED);
+}
+
+int irq_unmask_gsi(u32 gsi)
+{
+    return ioapic_update_rte(gsi, IOAPIC_RTE_MASKED, 0);
+}
+
+int irq_set_affinity(u32 gsi, u32 cpu)
+{
+    u64 dest;
+    int ret = ioapic_dest(cpu, &dest);
+
+    if (ret < 0) {
+        return ret;
+    }
+    return ioapic_update_rte(gsi, 0xFFULL << IOAPIC_RTE_DEST_SHIFT, dest);
+}
+
+void ioapic_set_isa_masked(int irq, bool masked)
+{
+    if (irq < 0 || irq >= ACPI_ISA_IRQS) {
+        return;
+    }
+    if (masked) {
+        irq_mask_gsi(isa_gsi[irq]);
+    } else {
+        irq_unmask_gsi(isa_gsi[irq]);
+    }
+}
+
+/*
+ * Does the kernel own gsi? Every ISA IRQ's line does, including the one
+ * an override moved (the PIT usually sits on GSI 2), as does any pin the
+ * kernel has unmasked for itself.
+ */
+bool irq_gsi_reserved(u32 gsi)
+{
+    struct ioapic *io;
+    u64 flags, rte;
+    u32 pin;
+
+    if (!ioapic_enabled) {
+        return false;
+    }
+    for (int irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        if (isa_gsi[irq] == gsi) {
+            return true;
+        }
+    }
+    io = ioapic_for_gsi(gsi, &pin);
+    if (!io) {
+        return false;
+    }
+    spin_lock_irqsave(&ioapic_lock, &flags);
+    rte = ioapic_read_rte(io, pin);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
+
+    return !(rte & IOAPIC_RTE_MASKED);
+}
+
+/* Does ISA IRQ irq share its GSI with another ISA IRQ? */
+bool irq_isa_shared(int irq)
+{
+    if (!ioapic_enabled || irq < 0 || irq >= ACPI_ISA_IRQS) {
+        return false;
+    }
+    for (int other = 0; other < ACPI_ISA_IRQS; other++) {
+        if (other != irq && isa_gsi[other] == isa_gsi[irq]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void irq_unmask_legacy(int irq)
+{
+    if (ioapic_enabled) {
+        ioapic_set_isa_masked(irq, false);
+    } else {
+        pic_unmask_irq(irq);
+    }
+}
+
+void irq_mask_legacy(int irq)
+{
+    if (ioapic_enabled) {
+        ioapic_set_isa_masked(irq, true);
+    } else {
+        pic_mask_irq(irq);
+    }
+}
+
+/* ISA defaults are edge/active-high; an override may say otherwise */
+static u32 isa_route_flags(u16 mps)
+{
+    u32 flags = 0;
+
+    if ((mps & ACPI_MPS_TRIGGER_MASK) == ACPI_MPS_TRIGGER_LEVEL) {
+        flags |= IRQ_TRIGGER_LEVEL;
+    }
+    if ((mps & ACPI_MPS_POLARITY_MASK) == ACPI_MPS_POLARITY_LOW) {
+        flags |= IRQ_POLARITY_LOW;
+    }
+    return flags;
+}
+
+int ioapic_init(void)
+{
+    const struct acpi_madt_info *madt = acpi_madt();
+
+    if (!madt || madt->nr_ioapics == 0 || !lapic_active()) {
+        return -ENODEV;
+    }
+
+    for (u32 i = 0; i < madt->nr_ioapics; i++) {
+        struct ioapic *io = &ioapics[nr_ioapics];
+
+        io->mmio = paging_map_mmio(madt->ioapics[i].address, PAGE_SIZE);
+        if (!io->mmio) {
+            kprintf("IOAPIC: cannot map 0x%llx\n", madt->ioapics[i].address);
+            continue;
+        }
+        io->id = madt->ioapics[i].id;
+        io->gsi_base = madt->ioapics[i].gsi_base;
+        io->nr_pins = ((ioapic_read(io, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+
+        for (u32 pin = 0; pin < io->nr_pins; pin++) {
+            ioapic_write_rte(io, pin, IOAPIC_RTE_MASKED);
+        }
+
+        kprintf("IOAPIC %u: GSIs %u-%u at 0x%llx\n", io->id, io->gsi_base,
+                io->gsi_base + io->nr_pins - 1, madt->ioapics[i].address);
+        nr_ioapics++;
+    }
+
+    if (nr_ioapics == 0) {
+        return -ENODEV;
+    }
+    ioapic_enabled = true;
+
+    /* ISA IRQs keep vectors 32-47 on the boot CPU; 2 is the old cascade */
+    for (int irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        isa_gsi[irq] = madt->isa_irqs[irq].gsi;
+        if (irq == 2) {
+            continue;
+        }
+        if (irq_route_gsi(isa_gsi[irq], VEC_IRQ(irq), 0,
+                          isa_route_flags(madt->isa_irqs[irq].flags)) < 0) {
+            kprintf("IOAPIC: no pin for ISA IRQ %d (GSI %u)\n", irq, isa_gsi[irq]);
+        }
+    }
+
+    pic_disable();
+    return 0;
+}
@@ -0,0 +1,489 @@
+/*
+ * Ocean Kernel - IRQ Objects
+ *
+ * Delivers device interrupts to userspace drivers. The handler does the
+ * least it can in interrupt context: mask the source, note the time and
+ * signal the bound notification bit. The driver thread blocked in
+ * SYS_NOTIFY_WAIT wakes, services the device and sends IRQ_CTL_ACK,
+ * which unmasks the source again.
+ *
+ * A small static table holds the objects; an object's ID is its slot
+ * index plus one. The table lock also guards the mask state, and is taken
+ * by the handlers with interrupts already off.
+ */
+
+#include <ocean/irq.h>
+#include <ocean/ipc.h>
+#include <ocean/pci.h>
+#include <ocean/spinlock.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+#include "idt.h"
+
+/* External functions */
+extern void *memset(void *s, int c, size_t n);
+
+enum irq_object_state {
+    IRQ_OBJ_FREE = 0,
+    IRQ_OBJ_BINDING,            /* Source being set up */
+    IRQ_OBJ_LIVE,
+    IRQ_OBJ_DYING,              /* Source being released */
+};
+
+struct irq_object {
+    enum irq_object_state state;
+    u32 source;
+    u64 arg;
+    pid_t owner;
+    struct notification *ntfn; /* Referenced */
+    u32 bit;
+    u32 nr_queues;
+    int vectors[IRQ_OBJ_MAX_QUEUES];
+    struct pci_dev *pci;        /* IRQ_SRC_MSI */
+    bool maskable;              /* Plain MSI may lack per-vector masking */
+    u64 masked;
+    u64 count;
+    u64 last_tsc;
+};
+
+static struct irq_object irq_objects[IRQ_OBJ_MAX];
+static struct irq_object *irq_isa_objects[16];
+static DEFINE_SPINLOCK(irq_object_lock);
+
+/* Called with irq_object_lock held */
+static void irq_object_set_masked(struct irq_object *obj, u32 queue, bool masked)
+{
+    switch (obj->source) {
+    case IRQ_SRC_ISA:
+        if (masked) {
+            irq_mask_legacy((int)obj->arg);
+        } else {
+            irq_unmask_legacy((int)obj->arg);
+        }
+        break;
+    case IRQ_SRC_GSI:
+        if (masked) {
+            irq_mask_gsi((u32)obj->arg);
+        } else {
+            irq_unmask_gsi((u32)obj->arg);
+        }
+        break;
+    case IRQ_SRC_MSI:
+        if (obj->maskable) {
+            pci_mask_irq(obj->pci, queue, masked);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void irq_object_fire(struct irq_object *obj, u32 queue)
+{
+    u64 tsc = rdtsc();
+
+    spin_lock(&irq_object_lock);
+    if (obj->state != IRQ_OBJ_FREE && queue < obj->nr_queues) {
+        obj->count++;
+        obj->last_tsc = tsc;
+        if (!(obj->masked & (1ULL << queue))) {
+            obj->masked |= 1ULL << queue;
+            irq_object_set_masked(obj, queue, true);
+        }
+        notification_signal(obj->ntfn, 1ULL << (obj->bit + queue));
+    }
+    spin_unlock(&irq_object_lock);
+}
+
+static void irq_object_vector_handler(u8 vector, void *data)
+{
+    struct irq_object *obj = data;
+
+    /*
+     * A vector fired before its queue was recorded is dropped; drivers
+     * enable device interrupts only once the bind has returned.
+     */
+    for (u32 i = 0; i < obj->nr_queues; i++) {
+        if (obj->vectors[i] == vector) {
+            irq_object_fire(obj, i);
+            return;
+        }
+    }
+}
+
+static void irq_object_isa_handler(struct trap_frame *frame)
+{
+    int irq = (int)(frame->int_no - VEC_IRQ_BASE);
+    struct irq_object *obj = __atomic_load_n(&irq_isa_objects[irq], __ATOMIC_ACQUIRE);
+
+    if (obj) {
+        irq_object_fire(obj, 0);
+    }
+}
+
+/* Install the source, masked (MSI vectors mask themselves on first fire) */
+static int irq_object_setup(struct irq_object *obj, u32 flags, u32 nvec)
+{
+    int vector;
+    int ret;
+
+    switch (obj->source) {
+    case IRQ_SRC_ISA:
+        /* Register first: a line the kernel handles must not be masked */
+        __atomic_store_n(&irq_isa_objects[obj->arg], obj, __ATOMIC_RELEASE);
+        ret = irq_try_register((int)obj->arg, irq_object_isa_handler);
+        if (ret < 0) {
+            __atomic_store_n(&irq_isa_objects[obj->arg], NULL, __ATOMIC_RELEASE);
+            return ret;
+        }
+        irq_mask_legacy((int)obj->arg);
+        obj->nr_queues = 1;
+        return 0;
+
+    case IRQ_SRC_GSI:
+    case IRQ_SRC_SOFT:
+        obj->nr_queues = 1;
+        vector = irq_alloc_vector(irq_object_vector_handler, obj);
+        if (vector < 0) {
+            return vector;
+        }
+        obj->vectors[0] = vector;
+        if (obj->source == IRQ_SRC_GSI) {
+            ret = irq_route_gsi((u32)obj->arg, vector, 0, flags);
+            if (ret < 0) {
+                irq_free_vector(vector);
+                return ret;
+            }
+        }
+        return 0;
+
+    case IRQ_SRC_MSI:
+        ret = pci_alloc_irq_vectors(obj->pci, nvec, irq_object_vector_handler, obj);
+        if (ret < 0) {
+            return ret;
+        }
+        for (int i = 0; i < ret; i++) {
+            obj->vectors[i] = pci_irq_vector(obj->pci, (u32)i);
+        }
+        __atomic_store_n(&obj->nr_queues, (u32)ret, __ATOMIC_RELEASE);
+        obj->maskable = pci_mask_irq(obj->pci, 0, false) == 0;
+        return 0;
+
+    default:
+        return -EINVAL;
+    }
+}
+
+/* Release the source; the object must no longer be LIVE */
+static void irq_object_teardown(struct irq_object *obj)
+{
+    switch (obj->source) {
+    case IRQ_SRC_ISA:
+        irq_mask_legacy((int)obj->arg);
+        irq_unregister((int)obj->arg);
+        __atomic_store_n(&irq_isa_objects[obj->arg], NULL, __ATOMIC_RELEASE);
+        break;
+    case IRQ_SRC_GSI:
+        irq_mask_gsi((u32)obj->arg);
+        irq_free_vector(obj->vectors[0]);
+        break;
+    case IRQ_SRC_SOFT:
+        irq_free_vector(obj->vectors[0]);
+        break;
+    case IRQ_SRC_MSI:
+        pci_free_irq_vectors(obj->pci);
+        break;
+    default:
+        break;
+    }
+}
+
+static void irq_object_free(struct irq_object *obj)
+{
+    struct notification *ntfn = obj->ntfn;
+    u64 flags;
+
+    spin_lock_irqsave(&irq_object_lock, &flags);
+    memset(obj, 0, sizeof(*obj));
+    spin_unlock_irqrestore(&irq_object_lock, flags);
+
+    notification_put(ntfn);
+}
+
+/* Is the source already bound? Called with irq_object_lock held */
+static bool irq_source_busy(u32 source, u64 arg)
+{
+    for (int i = 0; i < IRQ_OBJ_MAX; i++) {
+        struct irq_object *obj = &irq_objects[i];
+
+        if (obj->state != IRQ_OBJ_FREE && obj->source == source &&
+            source != IRQ_SRC_SOFT && obj->arg == arg) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int irq_object_bind(pid_t pid, bool privileged, u32 source, u64 arg,
+                    struct notification *ntfn, u32 bit, u32 flags, u32 nvec)
+{
+    struct irq_object *obj = NULL;
+    struct pci_dev *pci = NULL;
+    u64 lock_flags;
+    bool dead;
+    int ret;
+
+    switch (source) {
+    case IRQ_SRC_ISA:
+        if (arg >= 16) {
+            return -EINVAL;
+        }
+        if (!privileged && !pci_owns_irq_line(pid, (u32)arg)) {
+            return -EPERM;
+        }
+        /* 2 is the cascade, or under an override the timer's GSI */
+        if (arg == 2 || irq_isa_shared((int)arg)) {
+            return -EBUSY;
+        }
+        nvec = 1;
+        break;
+    case IRQ_SRC_GSI:
+        if (arg > 0xFFFFFFFFULL) {
+            return -EINVAL;
+        }
+        if (!privileged && !pci_owns_irq_line(pid, (u32)arg)) {
+            return -EPERM;
+        }
+        /* An ISA IRQ's line is bound as IRQ_SRC_ISA or not at all */
+        if (irq_gsi_reserved((u32)arg)) {
+            return -EBUSY;
+        }
+        nvec = 1;
+        break;
+    case IRQ_SRC_MSI:
+        pci = pci_find_bdf((u32)arg);
+        if (!pci) {
+            return -ENODEV;
+        }
+        if ((pid_t)pci->info.owner != pid) {
+            return -EPERM;
+        }
+        if (nvec == 0 || nvec > IRQ_OBJ_MAX_QUEUES) {
+            return -EINVAL;
+        }
+        break;
+    case IRQ_SRC_SOFT:
+        nvec = 1;
+        break;
+    default:
+        return -EINVAL;
+    }
+    if (bit + nvec > NTFN_BITS) {
+        return -EINVAL;
+    }
+
+    spin_lock_irqsave(&irq_object_lock, &lock_flags);
+    if (irq_source_busy(source, arg)) {
+        spin_unlock_irqrestore(&irq_object_lock, lock_flags);
+        return -EBUSY;
+    }
+    for (int i = 0; i < IRQ_OBJ_MAX; i++) {
+        if (irq_objects[i].state == IRQ_OBJ_FREE) {
+            obj = &irq_objects[i];
+            break;
+        }
+    }
+    if (!obj) {
+        spin_unlock_irqrestore(&irq_object_lock, lock_flags);
+        return -ENOSPC;
+    }
+    __atomic_fetch_add(&ntfn->refcount, 1, __ATOMIC_RELAXED);
+    obj->state = IRQ_OBJ_BINDING;
+    obj->source = source;
+    obj->arg = arg;
+    obj->owner = pid;
+    obj->ntfn = ntfn;
+    obj->bit = bit;
+    obj->pci = pci;
+    spin_unlock_irqrestore(&irq_object_lock, lock_flags);
+
+    ret = irq_object_setup(obj, flags, nvec);
+    if (ret < 0) {
+        irq_object_free(obj);
+        return ret;
+    }
+
+    /*
+     * notification_destroy() marks the notification dead before it looks
+     * for objects to unbind, so either it sees this one LIVE or we see it
+     * dead here.
+     */
+    spin_lock_irqsave(&irq_object_lock, &lock_flags);
+    dead = __atomic_load_n(&ntfn->flags, __ATOMIC_ACQUIRE) & NTFN_FLAG_DEAD;
+    if (!dead) {
+        obj->state = IRQ_OBJ_LIVE;
+        if (source == IRQ_SRC_ISA || source == IRQ_SRC_GSI) {
+            irq_object_set_masked(obj, 0, false);
+        }
+    } else {
+        obj->state = IRQ_OBJ_DYING;
+    }
+    spin_unlock_irqrestore(&irq_object_lock, lock_flags);
+
+    if (dead) {
+        irq_object_teardown(obj);
+        irq_object_free(obj);
+        return -ENOENT;
+    }
+    return (int)(obj - irq_objects) + 1;
+}
+
+/* Look up a LIVE object of pid's; called with irq_object_lock held */
+static struct irq_object *irq_object_lookup(pid_t pid, u32 id, int *err)
+{
+    struct irq_object *obj;
+
+    if (id == 0 || id > IRQ_OBJ_MAX) {
+        *err = -EINVAL;
+        return NULL;
+    }
+    obj = &irq_objects[id - 1];
+    if (obj->state != IRQ_OBJ_LIVE) {
+        *err = -ENOENT;
+        return NULL;
+    }
+    if (obj->owner != pid) {
+        *err = -EPERM;
+        return NULL;
+    }
+    return obj;
+}
+
+int irq_object_unbind(pid_t pid, u32 id)
+{
+    struct irq_object *obj;
+    u64 flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&irq_object_lock, &flags);
+    obj = irq_object_lookup(pid, id, &ret);
+    if (obj) {
+        obj->state = IRQ_OBJ_DYING;
+    }
+    spin_unlock_irqrestore(&irq_object_lock, flags);
+
+    if (!obj) {
+        return ret;
+    }
+    irq_object_teardown(obj);
+    irq_object_free(obj);
+    return 0;
+}
+
+int irq_object_ack(pid_t pid, u32 id, u64 queue_mask)
+{
+    struct irq_object *obj;
+    u64 flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&irq_object_lock, &flags);
+    obj = irq_object_lookup(pid, id, &ret);
+    if (obj) {
+        u64 pending = obj->masked & queue_mask;
+
+        obj->masked &= ~pending;
+        for (u32 i = 0; pending; i++, pending >>= 1) {
+            if (pending & 1) {
+                irq_object_set_masked(obj, i, false);
+            }
+        }
+    }
+    spin_unlock_irqrestore(&irq_object_lock, flags);
+
+    return ret;
+}
+
+int irq_object_trigger(pid_t pid, u32 id, u32 queue)
+{
+    struct irq_object *obj;
+    u64 flags;
+    int vector = -EINVAL;
+    int ret = 0;
+
+    spin_lock_irqsave(&irq_object_lock, &flags);
+    obj = irq_object_lookup(pid, id, &ret);
+    if (obj && obj->source != IRQ_SRC_ISA && queue < obj->nr_queues) {
+        vector = obj->vectors[queue];
+    }
+    spin_unlock_irqrestore(&irq_object_lock, flags);
+
+    if (!obj) {
+        return ret;
+    }
+    if (vector < 0) {
+        return -EINVAL;
+    }
+    return irq_raise_vector(vector);
+}
+
+int irq_object_info(pid_t pid, u32 id, struct irq_object_info *info)
+{
+    struct irq_object *obj;
+    u64 flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&irq_object_lock, &flags);
+    obj = irq_object_lookup(pid, id, &ret);
+    if (obj) {
+        info->source = obj->source;
+        info->nr_queues = obj->nr_queues;
+        info->notification = obj->ntfn->id;
+        info->bit = obj->bit;
+        info->arg = obj->arg;
+        info->masked = obj->masked;
+        info->count = obj->count;
+        info->last_tsc = obj->last_tsc;
+    }
+    spin_unlock_irqrestore(&irq_object_lock, flags);
+
+    return ret;
+}
+
+/* Unbind every LIVE object matching (ntfn, or pci if ntfn is NULL) */
+static void irq_unbind_matching(struct notification *ntfn, struct pci_dev *pci)
+{
+    for (;;) {
+        struct irq_object *obj = NULL;
+        u64 flags;
+
+        spin_lock_irqsave(&irq_object_lock, &flags);
+        for (int i = 0; i < IRQ_OBJ_MAX; i++) {
+            struct irq_object *o = &irq_objects[i];
+
+            if (o->state == IRQ_OBJ_LIVE &&
+                (ntfn ? o->ntfn == ntfn :
+                        o->source == IRQ_SRC_MSI && o->pci == pci)) {
+                obj = o;
+                obj->state = IRQ_OBJ_DYING;
+                break;
+            }
+        }
+        spin_unlock_irqrestore(&irq_object_lock, flags);
+
+        if (!obj) {
+            break;
+        }
+        irq_object_teardown(obj);
+        irq_object_free(obj);
+    }
+}
+
+void irq_unbind_notification(struct notification *ntfn)
+{
+    irq_unbind_matching(ntfn, NULL);
+}
+
+void irq_unbind_pci(struct pci_dev *dev)
+{
+    irq_unbind_matching(NULL, dev);
+}
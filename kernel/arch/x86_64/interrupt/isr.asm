@@ -22,6 +22,7 @@ global irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15
 global isr_apic_timer, isr_apic_spurious
 global isr_ipi_reschedule, isr_ipi_tlb
 global isr_syscall
+global irq_stub_table
 
 ;------------------------------------------------------------------------------
 ; Macro: ISR without error code
@@ -118,6 +119,19 @@ IRQ 13, 45      ; FPU
 IRQ 14, 46      ; Primary ATA
 IRQ 15, 47      ; Secondary ATA
 
+;------------------------------------------------------------------------------
+; Dynamic device vectors (48-239), handed out by irq_alloc_vector()
+;------------------------------------------------------------------------------
+
+%assign vec 48
+%rep 0xF0 - 48
+irq_vec%[vec]:
+    push qword 0            ; Dummy error code
+    push qword vec          ; Vector number
+    jmp irq_common_stub
+%assign vec vec + 1
+%endrep
+
 ;------------------------------------------------------------------------------
 ; APIC/IPI handlers
 ;------------------------------------------------------------------------------
@@ -261,3 +275,16 @@ irq_common_stub:
 
     ; Return from interrupt
     iretq
+
+;------------------------------------------------------------------------------
+; Entry points of the dynamic vectors, indexed by vector - 48
+;------------------------------------------------------------------------------
+
+section .rodata
+align 8
+irq_stub_table:
+%assign vec 48
+%rep 0xF0 - 48
+    dq irq_vec%[vec]
+%assign vec vec + 1
+%endrep
@@ -7,6 +7,9 @@
 #include <ocean/types.h>
 #include <ocean/defs.h>
 #include <ocean/sched.h>
+#include <ocean/rcu.h>
+#include <ocean/profile.h>
+#include <ocean/irq.h>
 #include "idt.h"
 
 /* External functions */
@@ -64,19 +67,35 @@ extern int kprintf(const char *fmt, ...);
  */
 static volatile u64 timer_ticks = 0;
 
+/*
+ * While the profiler samples faster than HZ the PIT runs at a multiple of
+ * HZ; only every timer_subticks-th interrupt is a scheduler tick.
+ */
+static u32 timer_subticks = 1;
+static u32 timer_subtick;
+
 /*
  * Timer interrupt handler
  *
- * Called on each PIT interrupt (HZ times per second)
+ * Called on each PIT interrupt (HZ times per second, or faster while
+ * profiling)
  */
 static void timer_interrupt_handler(struct trap_frame *frame)
 {
-    (void)frame;
+    profile_tick(frame->rip, frame->rbp, (u8)(frame->cs & 3));
+
+    if (++timer_subtick < timer_subticks) {
+        return;
+    }
+    timer_subtick = 0;
 
     timer_ticks++;
 
     /* Call scheduler tick handler */
     sched_tick();
+
+    /* Let RCU see whether this CPU is quiescent */
+    rcu_check_callbacks((frame->cs & 3) == 3);
 }
 
 /*
@@ -108,6 +127,21 @@ static void pit_set_frequency(u32 hz)
     outb(PIT_CHANNEL0, (divisor >> 8) & 0xFF);
 }
 
+/*
+ * Run the PIT at hz, a multiple of HZ, for the sampling profiler. The
+ * scheduler tick rate and timer_get_ticks() are unaffected.
+ */
+void timer_set_sample_rate(u32 hz)
+{
+    u64 flags = local_irq_save();
+
+    timer_subticks = hz > HZ ? hz / HZ : 1;
+    timer_subtick = 0;
+    pit_set_frequency(timer_subticks * HZ);
+
+    local_irq_restore(flags);
+}
+
 /*
  * Initialize the PIT timer
  */
@@ -123,8 +157,8 @@ void timer_init(void)
     /* Register our timer interrupt handler */
     irq_register(0, timer_interrupt_handler);
 
-    /* Enable IRQ 0 (timer) on the PIC */
-    pic_unmask_irq(0);
+    /* Enable IRQ 0 (timer) on the PIC or IOAPIC */
+    irq_unmask_legacy(0);
 
     kprintf("Timer initialized\n");
 }
@@ -234,6 +234,59 @@ phys_addr_t paging_get_phys(pml4e_t *pml4, u64 virt)
     return (*pte & PTE_ADDR_MASK) | (virt & (PAGE_SIZE - 1));
 }
 
+/*
+ * Is virt mapped in the kernel page tables, by a 4K, 2M or 1G page?
+ */
+static bool kernel_addr_mapped(u64 virt)
+{
+    pml4e_t pml4e = kernel_pml4[PML4_INDEX(virt)];
+    pdpe_t pdpe;
+    pde_t pde;
+
+    if (!(pml4e & PTE_PRESENT)) {
+        return false;
+    }
+    pdpe = ((pdpe_t *)phys_to_virt_local(pml4e & PTE_ADDR_MASK))[PDPT_INDEX(virt)];
+    if (!(pdpe & PTE_PRESENT) || (pdpe & PTE_HUGE)) {
+        return pdpe & PTE_PRESENT;
+    }
+    pde = ((pde_t *)phys_to_virt_local(pdpe & PTE_ADDR_MASK))[PD_INDEX(virt)];
+    if (!(pde & PTE_PRESENT) || (pde & PTE_HUGE)) {
+        return pde & PTE_PRESENT;
+    }
+
+    return (((pte_t *)phys_to_virt_local(pde & PTE_ADDR_MASK))[PT_INDEX(virt)] &
+            PTE_PRESENT) != 0;
+}
+
+/*
+ * Map device memory into the HHDM and return its virtual address
+ *
+ * Limine's HHDM only covers memory-map entries, so MMIO such as the local
+ * APIC and IOAPIC registers has to be mapped before use. Pages the HHDM
+ * already covers are left alone; new ones are mapped uncached. The kernel
+ * half is shared by every address space, so the mapping is global.
+ */
+void *paging_map_mmio(phys_addr_t phys, u64 size)
+{
+    phys_addr_t start = phys & ~(PAGE_SIZE - 1);
+    phys_addr_t end = (phys + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    for (phys_addr_t page = start; page < end; page += PAGE_SIZE) {
+        u64 virt = (u64)phys_to_virt_local(page);
+
+        if (kernel_addr_mapped(virt)) {
+            continue;
+        }
+        if (paging_map(kernel_pml4, virt, page,
+                       PTE_WRITABLE | PTE_PCD | PTE_PWT | PTE_GLOBAL | PTE_NX) != 0) {
+            return NULL;
+        }
+    }
+
+    return phys_to_virt_local(phys);
+}
+
 /*
  * Create a new PML4 for a user process
  * Copies kernel mappings (upper half) from kernel PML4
@@ -300,6 +353,34 @@ void paging_switch(struct address_space *as)
     }
 }
 
+/*
+ * Page Attribute Table
+ *
+ * A 4 KiB PTE picks its memory type with PAT:PCD:PWT as an index into
+ * this MSR. Entries 0-3 keep their power-on types, so PCD and PWT mean
+ * what they always have (PTE_CACHE_UC is entry 3), and entry 5 is
+ * write-combining for PTE_CACHE_WC. Limine hands over the same layout;
+ * programming it here means we do not depend on that.
+ */
+#define MSR_PAT             0x277
+
+#define PAT_UC              0x00
+#define PAT_WC              0x01
+#define PAT_WT              0x04
+#define PAT_WP              0x05
+#define PAT_WB              0x06
+#define PAT_UC_MINUS        0x07
+
+#define PAT_ENTRY(i, type)  ((u64)(type) << ((i) * 8))
+
+static void pat_init(void)
+{
+    wrmsr(MSR_PAT, PAT_ENTRY(0, PAT_WB) | PAT_ENTRY(1, PAT_WT) |
+                   PAT_ENTRY(2, PAT_UC_MINUS) | PAT_ENTRY(3, PAT_UC) |
+                   PAT_ENTRY(4, PAT_WP) | PAT_ENTRY(5, PAT_WC) |
+                   PAT_ENTRY(6, PAT_UC_MINUS) | PAT_ENTRY(7, PAT_UC));
+}
+
 /*
  * Initialize paging subsystem
  *
@@ -327,6 +408,8 @@ void paging_init(void)
     }
     kprintf("  Kernel PML4 entries (256-511): %d\n", kernel_entries);
 
+    pat_init();
+
     kprintf("Paging initialized\n");
 }
 
@@ -345,5 +428,5 @@ void kernel_space_init(void)
     INIT_LIST_HEAD(&kernel_space.vma_list);
     kernel_space.vma_count = 0;
     kernel_space.ref_count = 1;
-    spin_init(&kernel_space.lock);
+    mutex_init(&kernel_space.lock);
 }
@@ -0,0 +1,341 @@
+/*
+ * Ocean Kernel - Message-Signalled Interrupts
+ *
+ * An MSI is a memory write by the device to the local APIC window at
+ * 0xFEE00000; the destination APIC ID sits in the address and the vector
+ * in the data, so every queue can interrupt a different CPU on its own
+ * vector with no shared line to scan.
+ *
+ * MSI-X gives each queue its own table entry (address, data and a mask
+ * bit) in a BAR, which is what multi-queue devices such as NVMe and
+ * virtio use. Plain MSI is limited to one vector here: multiple-message
+ * MSI needs a naturally aligned block of vectors, which the vector pool
+ * does not hand out.
+ */
+
+#include <ocean/pci.h>
+#include <ocean/irq.h>
+#include <ocean/vmm.h>
+#include <ocean/spinlock.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+static DEFINE_SPINLOCK(msi_lock);
+
+/* Physical destination mode carries an 8-bit APIC ID */
+static bool msi_cpu_reachable(u32 cpu)
+{
+    return irq_cpu_online(cpu) && irq_cpu_apic_id(cpu) <= 0xFF;
+}
+
+static u32 msi_address(u32 cpu)
+{
+    return PCI_MSI_ADDR_BASE | (irq_cpu_apic_id(cpu) << PCI_MSI_ADDR_DEST_SHIFT);
+}
+
+/* The index-th reachable CPU, wrapping; -ENODEV if there is none */
+static int msi_pick_cpu(u32 index)
+{
+    u32 count = 0;
+
+    for (u32 cpu = 0; cpu < irq_nr_cpus(); cpu++) {
+        if (msi_cpu_reachable(cpu)) {
+            count++;
+        }
+    }
+    if (count == 0) {
+        return -ENODEV;
+    }
+
+    index %= count;
+    for (u32 cpu = 0; cpu < irq_nr_cpus(); cpu++) {
+        if (msi_cpu_reachable(cpu) && index-- == 0) {
+            return (int)cpu;
+        }
+    }
+    return -ENODEV;
+}
+
+static volatile u32 *msix_entry(struct pci_dev *dev, u32 index)
+{
+    return dev->msix_table + index * (PCI_MSIX_ENTRY_SIZE / 4);
+}
+
+/* Rewrite an entry masked, then restore its previous mask state */
+static void msix_write_entry(struct pci_dev *dev, u32 index, int vector, u32 cpu)
+{
+    volatile u32 *entry = msix_entry(dev, index);
+    u32 ctrl = entry[PCI_MSIX_ENTRY_CTRL / 4];
+
+    entry[PCI_MSIX_ENTRY_CTRL / 4] = ctrl | PCI_MSIX_ENTRY_MASKED;
+    entry[PCI_MSIX_ENTRY_ADDR_LO / 4] = msi_address(cpu);
+    entry[PCI_MSIX_ENTRY_ADDR_HI / 4] = 0;
+    entry[PCI_MSIX_ENTRY_DATA / 4] = (u32)vector;
+    entry[PCI_MSIX_ENTRY_CTRL / 4] = ctrl;
+}
+
+static void msix_set_masked(struct pci_dev *dev, u32 index, bool masked)
+{
+    volatile u32 *entry = msix_entry(dev, index);
+    u32 ctrl = entry[PCI_MSIX_ENTRY_CTRL / 4];
+
+    if (masked) {
+        ctrl |= PCI_MSIX_ENTRY_MASKED;
+    } else {
+        ctrl &= ~PCI_MSIX_ENTRY_MASKED;
+    }
+    entry[PCI_MSIX_ENTRY_CTRL / 4] = ctrl;
+}
+
+static void msi_write_msg(struct pci_dev *dev, int vector, u32 cpu)
+{
+    u32 cap = dev->info.msi_cap;
+    u16 flags = pci_read16(dev, cap + PCI_MSI_FLAGS);
+
+    pci_write32(dev, cap + PCI_MSI_ADDRESS_LO, msi_address(cpu));
+    if (flags & PCI_MSI_FLAGS_64BIT) {
+        pci_write32(dev, cap + PCI_MSI_ADDRESS_HI, 0);
+        pci_write16(dev, cap + PCI_MSI_DATA_64, (u16)vector);
+    } else {
+        pci_write16(dev, cap + PCI_MSI_DATA_32, (u16)vector);
+    }
+}
+
+static void pci_release_vectors(struct pci_dev *dev, u32 count)
+{
+    for (u32 i = 0; i < count; i++) {
+        irq_free_vector(dev->irq_vectors[i]);
+        dev->irq_vectors[i] = 0;
+    }
+}
+
+static int msix_enable(struct pci_dev *dev, u32 nvec, irq_vector_fn_t fn, void *data)
+{
+    u32 cap = dev->info.msix_cap;
+    u32 table = pci_read32(dev, cap + PCI_MSIX_TABLE);
+    u32 bir = table & PCI_MSIX_BIR_MASK;
+    u32 size = dev->info.msix_vectors;
+    struct pci_bar *bar;
+    u16 ctrl;
+    u32 n = 0;
+    int ret = 0;
+
+    if (bir >= PCI_MAX_BARS) {
+        return -ENODEV;
+    }
+    bar = &dev->info.bars[bir];
+    if (!bar->base || (bar->flags & PCI_BAR_IO)) {
+        return -ENODEV;
+    }
+    if (!dev->msix_table) {
+        dev->msix_table = paging_map_mmio(bar->base + (table & ~PCI_MSIX_BIR_MASK),
+                                          (u64)size * PCI_MSIX_ENTRY_SIZE);
+        if (!dev->msix_table) {
+            return -ENOMEM;
+        }
+    }
+
+    if (nvec > size) {
+        nvec = size;
+    }
+    if (nvec > PCI_MAX_DEV_IRQS) {
+        nvec = PCI_MAX_DEV_IRQS;
+    }
+
+    /* Enabled under the function mask, so no entry fires half-written */
+    ctrl = pci_read16(dev, cap + PCI_MSIX_FLAGS);
+    pci_write16(dev, cap + PCI_MSIX_FLAGS,
+                ctrl | PCI_MSIX_FLAGS_ENABLE | PCI_MSIX_FLAGS_MASKALL);
+
+    for (u32 i = 0; i < size; i++) {
+        msix_set_masked(dev, i, true);
+    }
+
+    for (; n < nvec; n++) {
+        int vector = irq_alloc_vector(fn, data);
+        int cpu = msi_pick_cpu(n);
+
+        if (vector < 0 || cpu < 0) {
+            if (vector >= 0) {
+                irq_free_vector(vector);
+            }
+            ret = vector < 0 ? vector : cpu;
+            break;
+        }
+        dev->irq_vectors[n] = vector;
+        dev->irq_cpus[n] = (u32)cpu;
+        msix_write_entry(dev, n, vector, (u32)cpu);
+        msix_set_masked(dev, n, false);
+    }
+
+    if (n == 0) {
+        pci_write16(dev, cap + PCI_MSIX_FLAGS, ctrl & ~PCI_MSIX_FLAGS_ENABLE);
+        return ret;
+    }
+
+    dev->msix = true;
+    dev->nr_irqs = n;
+    pci_write16(dev, cap + PCI_MSIX_FLAGS,
+                (ctrl | PCI_MSIX_FLAGS_ENABLE) & ~PCI_MSIX_FLAGS_MASKALL);
+    return (int)n;
+}
+
+static int msi_enable(struct pci_dev *dev, irq_vector_fn_t fn, void *data)
+{
+    u32 cap = dev->info.msi_cap;
+    u16 flags;
+    int vector, cpu;
+
+    cpu = msi_pick_cpu(0);
+    if (cpu < 0) {
+        return cpu;
+    }
+    vector = irq_alloc_vector(fn, data);
+    if (vector < 0) {
+        return vector;
+    }
+
+    flags = pci_read16(dev, cap + PCI_MSI_FLAGS);
+    pci_write16(dev, cap + PCI_MSI_FLAGS,
+                flags & ~(PCI_MSI_FLAGS_ENABLE | PCI_MSI_FLAGS_QSIZE));
+    msi_write_msg(dev, vector, (u32)cpu);
+    pci_write16(dev, cap + PCI_MSI_FLAGS,
+                (flags & ~PCI_MSI_FLAGS_QSIZE) | PCI_MSI_FLAGS_ENABLE);
+
+    dev->msix = false;
+    dev->nr_irqs = 1;
+    dev->irq_vectors[0] = vector;
+    dev->irq_cpus[0] = (u32)cpu;
+    return 1;
+}
+
+int pci_alloc_irq_vectors(struct pci_dev *dev, u32 nvec,
+                          irq_vector_fn_t fn, void *data)
+{
+    u64 flags;
+    int ret;
+
+    if (!dev || !fn || nvec == 0) {
+        return -EINVAL;
+    }
+
+    spin_lock_irqsave(&msi_lock, &flags);
+    if (dev->nr_irqs) {
+        ret = -EBUSY;
+    } else if (dev->info.msix_cap) {
+        ret = msix_enable(dev, nvec, fn, data);
+    } else if (dev->info.msi_cap) {
+        ret = msi_enable(dev, fn, data);
+    } else {
+        ret = -ENODEV;
+    }
+    if (ret > 0) {
+        u16 cmd = pci_read16(dev, PCI_COMMAND);
+
+        pci_write16(dev, PCI_COMMAND,
+                    cmd | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER | PCI_COMMAND_INTX_OFF);
+    }
+    spin_unlock_irqrestore(&msi_lock, flags);
+
+    return ret;
+}
+
+void pci_free_irq_vectors(struct pci_dev *dev)
+{
+    u64 flags;
+    u16 ctrl;
+
+    spin_lock_irqsave(&msi_lock, &flags);
+    if (dev->nr_irqs == 0) {
+        spin_unlock_irqrestore(&msi_lock, flags);
+        return;
+    }
+
+    if (dev->msix) {
+        u32 cap = dev->info.msix_cap;
+
+        for (u32 i = 0; i < dev->nr_irqs; i++) {
+            msix_set_masked(dev, i, true);
+        }
+        ctrl = pci_read16(dev, cap + PCI_MSIX_FLAGS);
+        pci_write16(dev, cap + PCI_MSIX_FLAGS, ctrl & ~PCI_MSIX_FLAGS_ENABLE);
+    } else {
+        u32 cap = dev->info.msi_cap;
+
+        ctrl = pci_read16(dev, cap + PCI_MSI_FLAGS);
+        pci_write16(dev, cap + PCI_MSI_FLAGS, ctrl & ~PCI_MSI_FLAGS_ENABLE);
+    }
+
+    /* The device is quiet now; hand the vectors back */
+    pci_release_vectors(dev, dev->nr_irqs);
+    dev->nr_irqs = 0;
+
+    ctrl = pci_read16(dev, PCI_COMMAND);
+    pci_write16(dev, PCI_COMMAND, ctrl & ~PCI_COMMAND_INTX_OFF);
+    spin_unlock_irqrestore(&msi_lock, flags);
+}
+
+int pci_irq_vector(struct pci_dev *dev, u32 index)
+{
+    u64 flags;
+    int vector = -EINVAL;
+
+    spin_lock_irqsave(&msi_lock, &flags);
+    if (index < dev->nr_irqs) {
+        vector = dev->irq_vectors[index];
+    }
+    spin_unlock_irqrestore(&msi_lock, flags);
+
+    return vector;
+}
+
+int pci_set_irq_affinity(struct pci_dev *dev, u32 index, u32 cpu)
+{
+    u64 flags;
+
+    if (!msi_cpu_reachable(cpu)) {
+        return -EINVAL;
+    }
+
+    spin_lock_irqsave(&msi_lock, &flags);
+    if (index >= dev->nr_irqs) {
+        spin_unlock_irqrestore(&msi_lock, flags);
+        return -EINVAL;
+    }
+    if (dev->msix) {
+        msix_write_entry(dev, index, dev->irq_vectors[index], cpu);
+    } else {
+        /* The vector is unchanged, so one dword write moves it atomically */
+        pci_write32(dev, dev->info.msi_cap + PCI_MSI_ADDRESS_LO, msi_address(cpu));
+    }
+    dev->irq_cpus[index] = cpu;
+    spin_unlock_irqrestore(&msi_lock, flags);
+
+    return 0;
+}
+
+int pci_mask_irq(struct pci_dev *dev, u32 index, bool masked)
+{
+    u64 flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&msi_lock, &flags);
+    if (index >= dev->nr_irqs) {
+        ret = -EINVAL;
+    } else if (dev->msix) {
+        msix_set_masked(dev, index, masked);
+    } else {
+        u32 cap = dev->info.msi_cap;
+        u16 ctrl = pci_read16(dev, cap + PCI_MSI_FLAGS);
+        u32 reg = cap + ((ctrl & PCI_MSI_FLAGS_64BIT) ? PCI_MSI_MASK_64 : PCI_MSI_MASK_32);
+
+        if (!(ctrl & PCI_MSI_FLAGS_MASKBIT)) {
+            ret = -ENODEV;
+        } else {
+            pci_write32(dev, reg, masked ? 1 : 0);
+        }
+    }
+    spin_unlock_irqrestore(&msi_lock, flags);
+
+    return ret;
+}
@@ -0,0 +1,505 @@
+/*
+ * Ocean Kernel - PCI Enumeration
+ *
+ * Configuration space is reached through ECAM when the MCFG table lists a
+ * region for the bus (4 KiB per function, PCIe extended registers
+ * included) and through the 0xCF8/0xCFC port pair otherwise, which only
+ * covers segment 0 and the first 256 bytes.
+ *
+ * The scan starts at each root bus and follows PCI-to-PCI bridges to
+ * their secondary buses. Each function found gets its BARs sized and its
+ * MSI/MSI-X capabilities located; the result is a fixed table that
+ * SYS_PCI hands to userspace.
+ */
+
+#include <ocean/pci.h>
+#include <ocean/acpi.h>
+#include <ocean/process.h>
+#include <ocean/rcu.h>
+#include <ocean/vmm.h>
+#include <ocean/spinlock.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+#define PCI_CONFIG_ADDRESS  0xCF8
+#define PCI_CONFIG_DATA     0xCFC
+
+#define PCI_MAX_ECAM        8
+#define PCI_CAP_TTL         48      /* Bound on a malformed capability list */
+
+struct pci_ecam_region {
+    phys_addr_t base;
+    u16 segment;
+    u8 start_bus;
+    u8 end_bus;
+};
+
+static struct pci_ecam_region ecam_regions[PCI_MAX_ECAM];
+static u32 nr_ecam_regions;
+
+static struct pci_dev pci_devices[PCI_MAX_DEVICES];
+static u32 nr_pci_devices;
+
+/* Buses already scanned on the current segment */
+static u64 pci_bus_seen[256 / 64];
+
+/* Serialises the address/data port pair */
+static DEFINE_SPINLOCK(pci_port_lock);
+
+/* Serialises claims */
+static DEFINE_SPINLOCK(pci_claim_lock);
+
+static volatile u8 *pci_ecam_map(u16 segment, u8 bus, u8 slot, u8 func)
+{
+    for (u32 i = 0; i < nr_ecam_regions; i++) {
+        struct pci_ecam_region *r = &ecam_regions[i];
+
+        if (r->segment == segment && bus >= r->start_bus && bus <= r->end_bus) {
+            phys_addr_t phys = r->base + ((phys_addr_t)(bus - r->start_bus) << 20) +
+                               ((phys_addr_t)slot << 15) + ((phys_addr_t)func << 12);
+            return paging_map_mmio(phys, PAGE_SIZE);
+        }
+    }
+    return NULL;
+}
+
+static inline u32 pci_port_address(struct pci_dev *dev, u32 offset)
+{
+    return 0x80000000U | ((u32)dev->info.bus << 16) | ((u32)dev->info.slot << 11) |
+           ((u32)dev->info.func << 8) | (offset & 0xFC);
+}
+
+static bool pci_port_reachable(struct pci_dev *dev, u32 offset)
+{
+    return dev->info.segment == 0 && offset < 0x100;
+}
+
+static u32 pci_port_read(struct pci_dev *dev, u32 offset)
+{
+    u64 flags;
+    u32 val;
+
+    spin_lock_irqsave(&pci_port_lock, &flags);
+    outl(PCI_CONFIG_ADDRESS, pci_port_address(dev, offset));
+    val = inl(PCI_CONFIG_DATA);
+    spin_unlock_irqrestore(&pci_port_lock, flags);
+
+    return val >> ((offset & 3) * 8);
+}
+
+u8 pci_read8(struct pci_dev *dev, u32 offset)
+{
+    if (dev->ecam) {
+        return dev->ecam[offset];
+    }
+    return pci_port_reachable(dev, offset) ? (u8)pci_port_read(dev, offset) : 0xFF;
+}
+
+u16 pci_read16(struct pci_dev *dev, u32 offset)
+{
+    if (dev->ecam) {
+        return *(volatile u16 *)(dev->ecam + offset);
+    }
+    return pci_port_reachable(dev, offset) ? (u16)pci_port_read(dev, offset) : 0xFFFF;
+}
+
+u32 pci_read32(struct pci_dev *dev, u32 offset)
+{
+    if (dev->ecam) {
+        return *(volatile u32 *)(dev->ecam + offset);
+    }
+    return pci_port_reachable(dev, offset) ? pci_port_read(dev, offset) : 0xFFFFFFFFU;
+}
+
+/* Sub-dword port writes go to the matching byte lane of the data port */
+void pci_write8(struct pci_dev *dev, u32 offset, u8 val)
+{
+    u64 flags;
+
+    if (dev->ecam) {
+        dev->ecam[offset] = val;
+        return;
+    }
+    if (!pci_port_reachable(dev, offset)) {
+        return;
+    }
+    spin_lock_irqsave(&pci_port_lock, &flags);
+    outl(PCI_CONFIG_ADDRESS, pci_port_address(dev, offset));
+    outb(PCI_CONFIG_DATA + (offset & 3), val);
+    spin_unlock_irqrestore(&pci_port_lock, flags);
+}
+
+void pci_write16(struct pci_dev *dev, u32 offset, u16 val)
+{
+    u64 flags;
+
+    if (dev->ecam) {
+        *(volatile u16 *)(dev->ecam + offset) = val;
+        return;
+    }
+    if (!pci_port_reachable(dev, offset)) {
+        return;
+    }
+    spin_lock_irqsave(&pci_port_lock, &flags);
+    outl(PCI_CONFIG_ADDRESS, pci_port_address(dev, offset));
+    outw(PCI_CONFIG_DATA + (offset & 2), val);
+    spin_unlock_irqrestore(&pci_port_lock, flags);
+}
+
+void pci_write32(struct pci_dev *dev, u32 offset, u32 val)
+{
+    u64 flags;
+
+    if (dev->ecam) {
+        *(volatile u32 *)(dev->ecam + offset) = val;
+        return;
+    }
+    if (!pci_port_reachable(dev, offset)) {
+        return;
+    }
+    spin_lock_irqsave(&pci_port_lock, &flags);
+    outl(PCI_CONFIG_ADDRESS, pci_port_address(dev, offset));
+    outl(PCI_CONFIG_DATA, val);
+    spin_unlock_irqrestore(&pci_port_lock, flags);
+}
+
+u32 pci_device_count(void)
+{
+    return nr_pci_devices;
+}
+
+struct pci_dev *pci_device(u32 index)
+{
+    return index < nr_pci_devices ? &pci_devices[index] : NULL;
+}
+
+struct pci_dev *pci_find_bdf(u32 bdf)
+{
+    for (u32 i = 0; i < nr_pci_devices; i++) {
+        struct pci_device_info *info = &pci_devices[i].info;
+
+        if (PCI_BDF(info->segment, info->bus, info->slot, info->func) == bdf) {
+            return &pci_devices[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Claim dev for pid. A claim held by a process that has since gone away
+ * is taken over; -EBUSY if its owner is still alive.
+ */
+int pci_claim(struct pci_dev *dev, pid_t pid)
+{
+    u64 flags;
+    pid_t owner;
+    int ret = 0;
+
+    spin_lock_irqsave(&pci_claim_lock, &flags);
+    owner = (pid_t)dev->info.owner;
+    if (owner && owner != pid) {
+        rcu_read_lock();
+        if (process_find(owner)) {
+            ret = -EBUSY;
+        }
+        rcu_read_unlock();
+    }
+    if (ret == 0) {
+        dev->info.owner = (u32)pid;
+    }
+    spin_unlock_irqrestore(&pci_claim_lock, flags);
+
+    return ret;
+}
+
+/*
+ * Drop pid's claim on dev. Its MSI/MSI-X vectors go with it, and bus
+ * mastering is turned off so the device cannot write into memory the
+ * driver no longer holds. Only pid can change the owner from here on
+ * (its claim is live), so the teardown runs outside the claim lock.
+ */
+void pci_release(struct pci_dev *dev, pid_t pid)
+{
+    u64 flags;
+    u16 cmd;
+
+    if ((pid_t)__atomic_load_n(&dev->info.owner, __ATOMIC_ACQUIRE) != pid) {
+        return;
+    }
+
+    irq_unbind_pci(dev);
+    cmd = pci_read16(dev, PCI_COMMAND);
+    pci_write16(dev, PCI_COMMAND, cmd & ~PCI_COMMAND_MASTER);
+
+    spin_lock_irqsave(&pci_claim_lock, &flags);
+    if ((pid_t)dev->info.owner == pid) {
+        dev->info.owner = 0;
+    }
+    spin_unlock_irqrestore(&pci_claim_lock, flags);
+}
+
+/*
+ * Drop every claim proc holds; called as it exits, so the next driver
+ * need not wait for the zombie to be reaped
+ */
+void pci_release_all(struct process *proc)
+{
+    for (u32 i = 0; i < nr_pci_devices; i++) {
+        pci_release(&pci_devices[i], proc->pid);
+    }
+}
+
+bool pci_owns_irq_line(pid_t pid, u32 line)
+{
+    for (u32 i = 0; i < nr_pci_devices; i++) {
+        struct pci_device_info *info = &pci_devices[i].info;
+
+        if ((pid_t)__atomic_load_n(&info->owner, __ATOMIC_ACQUIRE) == pid &&
+            info->irq_pin != 0 && info->irq_line == line) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Size each BAR by writing all ones and reading back the writable bits.
+ * Decoding is off meanwhile so the transient address never claims bus
+ * cycles.
+ */
+static void pci_size_bars(struct pci_dev *dev)
+{
+    u32 type = dev->info.header_type & PCI_HEADER_TYPE_MASK;
+    u32 nbars = type == 0 ? 6 : type == PCI_HEADER_BRIDGE ? 2 : 0;
+    u16 cmd;
+    u64 flags;
+
+    flags = local_irq_save();
+    cmd = pci_read16(dev, PCI_COMMAND);
+    pci_write16(dev, PCI_COMMAND, cmd & ~(PCI_COMMAND_IO | PCI_COMMAND_MEMORY));
+
+    for (u32 i = 0; i < nbars; i++) {
+        struct pci_bar *bar = &dev->info.bars[i];
+        u32 reg = PCI_BAR0 + i * 4;
+        u32 orig = pci_read32(dev, reg);
+        u32 mask;
+        u64 base, size;
+
+        pci_write32(dev, reg, 0xFFFFFFFFU);
+        mask = pci_read32(dev, reg);
+        pci_write32(dev, reg, orig);
+
+        if (orig & 1) {
+            /* I/O BAR; the upper half may be hardwired to zero */
+            mask &= ~3U;
+            if (mask == 0) {
+                continue;
+            }
+            if (!(mask & 0xFFFF0000U)) {
+                mask |= 0xFFFF0000U;
+            }
+            bar->base = orig & ~3U;
+            bar->size = (u32)(~mask + 1);
+            bar->flags = PCI_BAR_IO;
+            continue;
+        }
+
+        base = orig & ~0xFULL;
+        size = mask & ~0xFULL;
+        if (orig & 0x8) {
+            bar->flags |= PCI_BAR_PREFETCH;
+        }
+        if ((orig & 0x6) == 0x4 && i + 1 < nbars) {
+            u32 orig_hi = pci_read32(dev, reg + 4);
+            u32 mask_hi;
+
+            pci_write32(dev, reg + 4, 0xFFFFFFFFU);
+            mask_hi = pci_read32(dev, reg + 4);
+            pci_write32(dev, reg + 4, orig_hi);
+
+            base |= (u64)orig_hi << 32;
+            size |= (u64)mask_hi << 32;
+            bar->flags |= PCI_BAR_MEM64;
+            i++;
+        } else {
+            size |= 0xFFFFFFFF00000000ULL;
+        }
+        if ((u32)size == 0 && !(bar->flags & PCI_BAR_MEM64)) {
+            bar->flags = 0;
+            continue;
+        }
+        bar->base = base;
+        bar->size = ~size + 1;
+    }
+
+    pci_write16(dev, PCI_COMMAND, cmd);
+    local_irq_restore(flags);
+}
+
+static void pci_find_caps(struct pci_dev *dev)
+{
+    u32 pos;
+
+    if (!(pci_read16(dev, PCI_STATUS) & PCI_STATUS_CAP_LIST)) {
+        return;
+    }
+
+    pos = pci_read8(dev, PCI_CAP_PTR) & ~3U;
+    for (u32 ttl = PCI_CAP_TTL; pos >= 0x40 && ttl; ttl--) {
+        u8 id = pci_read8(dev, pos);
+
+        if (id == 0xFF) {
+            break;
+        }
+        if (id == PCI_CAP_ID_MSI) {
+            dev->info.msi_cap = (u8)pos;
+        } else if (id == PCI_CAP_ID_MSIX) {
+            dev->info.msix_cap = (u8)pos;
+            dev->info.msix_vectors =
+                (pci_read16(dev, pos + PCI_MSIX_FLAGS) & PCI_MSIX_FLAGS_QSIZE) + 1;
+        }
+        pos = pci_read8(dev, pos + 1) & ~3U;
+    }
+}
+
+static void pci_scan_bus(u16 segment, u8 bus);
+
+/* Returns the header type, or -ENODEV if nothing answers */
+static int pci_scan_function(u16 segment, u8 bus, u8 slot, u8 func)
+{
+    struct pci_dev probe = { 0 };
+    struct pci_dev *dev;
+    u8 header_type;
+
+    probe.info.segment = segment;
+    probe.info.bus = bus;
+    probe.info.slot = slot;
+    probe.info.func = func;
+    probe.ecam = pci_ecam_map(segment, bus, slot, func);
+    if (!probe.ecam && segment != 0) {
+        return -ENODEV;
+    }
+    if (pci_read16(&probe, PCI_VENDOR_ID) == 0xFFFF) {
+        return -ENODEV;
+    }
+
+    header_type = pci_read8(&probe, PCI_HEADER_TYPE);
+
+    if (nr_pci_devices < PCI_MAX_DEVICES) {
+        dev = &pci_devices[nr_pci_devices++];
+        *dev = probe;
+        dev->info.header_type = header_type;
+        dev->info.vendor_id = pci_read16(dev, PCI_VENDOR_ID);
+        dev->info.device_id = pci_read16(dev, PCI_DEVICE_ID);
+        dev->info.class_code = pci_read8(dev, PCI_CLASS);
+        dev->info.subclass = pci_read8(dev, PCI_SUBCLASS);
+        dev->info.prog_if = pci_read8(dev, PCI_PROG_IF);
+        dev->info.revision = pci_read8(dev, PCI_REVISION);
+        dev->info.irq_line = pci_read8(dev, PCI_IRQ_LINE);
+        dev->info.irq_pin = pci_read8(dev, PCI_IRQ_PIN);
+        pci_size_bars(dev);
+        pci_find_caps(dev);
+    } else if (nr_pci_devices == PCI_MAX_DEVICES) {
+        kprintf("PCI: device table full, ignoring %02x:%02x.%u and later\n",
+                bus, slot, func);
+        nr_pci_devices++;
+    }
+
+    if ((header_type & PCI_HEADER_TYPE_MASK) == PCI_HEADER_BRIDGE) {
+        u8 secondary = pci_read8(&probe, PCI_SECONDARY_BUS);
+
+        if (secondary > bus) {
+            pci_scan_bus(segment, secondary);
+        }
+    }
+
+    return header_type;
+}
+
+static void pci_scan_bus(u16 segment, u8 bus)
+{
+    if (pci_bus_seen[bus / 64] & (1ULL << (bus % 64))) {
+        return;
+    }
+    pci_bus_seen[bus / 64] |= 1ULL << (bus % 64);
+
+    for (u8 slot = 0; slot < 32; slot++) {
+        int header_type = pci_scan_function(segment, bus, slot, 0);
+
+        if (header_type < 0 || !(header_type & PCI_HEADER_MULTIFUNC)) {
+            continue;
+        }
+        for (u8 func = 1; func < 8; func++) {
+            pci_scan_function(segment, bus, slot, func);
+        }
+    }
+}
+
+static void pci_parse_mcfg(void)
+{
+    const struct acpi_mcfg *mcfg;
+    const struct acpi_mcfg_entry *entry, *end;
+
+    mcfg = (const struct acpi_mcfg *)acpi_find_table("MCFG");
+    if (!mcfg) {
+        return;
+    }
+
+    entry = (const struct acpi_mcfg_entry *)(mcfg + 1);
+    end = (const struct acpi_mcfg_entry *)((const u8 *)mcfg + mcfg->header.length);
+    for (; entry < end && nr_ecam_regions < PCI_MAX_ECAM; entry++) {
+        struct pci_ecam_region *r = &ecam_regions[nr_ecam_regions++];
+
+        r->base = entry->base;
+        r->segment = entry->segment;
+        r->start_bus = entry->start_bus;
+        r->end_bus = entry->end_bus;
+        kprintf("PCI: ECAM segment %u buses %u-%u at 0x%llx\n", r->segment,
+                r->start_bus, r->end_bus, r->base);
+    }
+}
+
+int pci_init(void)
+{
+    pci_parse_mcfg();
+
+    if (nr_ecam_regions == 0) {
+        /* Configuration mechanism #1 latches the enable bit */
+        outl(PCI_CONFIG_ADDRESS, 0x80000000U);
+        if (inl(PCI_CONFIG_ADDRESS) != 0x80000000U) {
+            kprintf("PCI: no ECAM and no configuration ports\n");
+            return -ENODEV;
+        }
+        kprintf("PCI: no MCFG, using port I/O configuration access\n");
+        pci_scan_bus(0, 0);
+    } else {
+        for (u32 i = 0; i < nr_ecam_regions; i++) {
+            if (i > 0 && ecam_regions[i].segment != ecam_regions[i - 1].segment) {
+                for (u32 w = 0; w < ARRAY_SIZE(pci_bus_seen); w++) {
+                    pci_bus_seen[w] = 0;
+                }
+            }
+            pci_scan_bus(ecam_regions[i].segment, ecam_regions[i].start_bus);
+        }
+    }
+
+    if (nr_pci_devices > PCI_MAX_DEVICES) {
+        nr_pci_devices = PCI_MAX_DEVICES;
+    }
+
+    kprintf("PCI: %u functions\n", nr_pci_devices);
+    for (u32 i = 0; i < nr_pci_devices; i++) {
+        struct pci_device_info *info = &pci_devices[i].info;
+
+        kprintf("  %04x:%02x:%02x.%u %04x:%04x class %02x.%02x%s%s\n",
+                info->segment, info->bus, info->slot, info->func,
+                info->vendor_id, info->device_id, info->class_code,
+                info->subclass, info->msi_cap ? " MSI" : "",
+                info->msix_cap ? " MSI-X" : "");
+    }
+
+    return 0;
+}
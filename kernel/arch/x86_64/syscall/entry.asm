@@ -183,6 +183,7 @@ syscall_return_to_user:
 ; RDI = user RIP
 ; RSI = user RSP
 ; RDX = user RFLAGS (or 0 for default: 0x202)
+; RCX = initial user RDI (thread argument)
 ;
 enter_usermode:
     ; Use default RFLAGS if not specified
@@ -198,13 +199,15 @@ enter_usermode:
     push qword 0x2b                 ; CS (user code 64-bit: 0x28 | RPL 3)
     push rdi                        ; RIP
 
-    ; Clear all general purpose registers for clean start
+    ; First argument for the entry point
+    mov rdi, rcx
+
+    ; Clear all other general purpose registers for clean start
     xor rax, rax
     xor rbx, rbx
     xor rcx, rcx
     xor rdx, rdx
     xor rsi, rsi
-    xor rdi, rdi
     xor rbp, rbp
     xor r8, r8
     xor r9, r9
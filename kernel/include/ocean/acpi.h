@@ -0,0 +1,168 @@
+/*
+ * Ocean Kernel - ACPI Tables
+ *
+ * Just enough ACPI to configure interrupts and PCI: find tables through
+ * the RSDP's XSDT (or RSDT), summarise the MADT into the CPUs, IOAPICs
+ * and ISA interrupt overrides the APIC code needs, and describe the MCFG
+ * the PCI code reads its ECAM regions from. No AML.
+ */
+
+#ifndef _OCEAN_ACPI_H
+#define _OCEAN_ACPI_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* Common header of every system description table */
+struct acpi_sdt_header {
+    char signature[4];
+    u32 length;                 /* Whole table, header included */
+    u8 revision;
+    u8 checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    u32 oem_revision;
+    u32 creator_id;
+    u32 creator_revision;
+} __packed;
+
+struct acpi_rsdp {
+    char signature[8];          /* "RSD PTR " */
+    u8 checksum;
+    char oem_id[6];
+    u8 revision;                /* 0 = ACPI 1.0 (RSDT only), 2+ = XSDT */
+    u32 rsdt_address;
+    /* ACPI 2.0+ */
+    u32 length;
+    u64 xsdt_address;
+    u8 extended_checksum;
+    u8 reserved[3];
+} __packed;
+
+/*
+ * MADT ("APIC")
+ */
+struct acpi_madt {
+    struct acpi_sdt_header header;
+    u32 lapic_address;          /* 32-bit local APIC base */
+    u32 flags;
+    /* Variable-length entries follow */
+} __packed;
+
+#define ACPI_MADT_PCAT_COMPAT       (1 << 0)    /* 8259 PICs present */
+
+#define ACPI_MADT_LAPIC             0
+#define ACPI_MADT_IOAPIC            1
+#define ACPI_MADT_ISO               2           /* Interrupt source override */
+#define ACPI_MADT_LAPIC_NMI         4
+#define ACPI_MADT_LAPIC_OVERRIDE    5           /* 64-bit local APIC base */
+#define ACPI_MADT_X2APIC            9
+
+struct acpi_madt_entry {
+    u8 type;
+    u8 length;
+} __packed;
+
+struct acpi_madt_lapic {
+    struct acpi_madt_entry entry;
+    u8 processor_id;
+    u8 apic_id;
+    u32 flags;
+} __packed;
+
+#define ACPI_MADT_CPU_ENABLED       (1 << 0)
+#define ACPI_MADT_CPU_ONLINE_CAPABLE (1 << 1)
+
+struct acpi_madt_ioapic {
+    struct acpi_madt_entry entry;
+    u8 ioapic_id;
+    u8 reserved;
+    u32 address;
+    u32 gsi_base;
+} __packed;
+
+struct acpi_madt_iso {
+    struct acpi_madt_entry entry;
+    u8 bus;                     /* Always 0 (ISA) */
+    u8 source;                  /* ISA IRQ */
+    u32 gsi;
+    u16 flags;                  /* ACPI_MPS_* polarity and trigger */
+} __packed;
+
+struct acpi_madt_lapic_override {
+    struct acpi_madt_entry entry;
+    u16 reserved;
+    u64 address;
+} __packed;
+
+struct acpi_madt_x2apic {
+    struct acpi_madt_entry entry;
+    u16 reserved;
+    u32 x2apic_id;
+    u32 flags;
+    u32 processor_uid;
+} __packed;
+
+/* MPS INTI flags (ISO entries) */
+#define ACPI_MPS_POLARITY_MASK      0x3
+#define ACPI_MPS_POLARITY_HIGH      0x1
+#define ACPI_MPS_POLARITY_LOW       0x3
+#define ACPI_MPS_TRIGGER_MASK       0xC
+#define ACPI_MPS_TRIGGER_EDGE       0x4
+#define ACPI_MPS_TRIGGER_LEVEL      0xC
+
+/*
+ * MCFG: PCI Express memory-mapped configuration (ECAM) regions
+ */
+struct acpi_mcfg {
+    struct acpi_sdt_header header;
+    u64 reserved;
+    /* struct acpi_mcfg_entry follow */
+} __packed;
+
+struct acpi_mcfg_entry {
+    u64 base;                   /* ECAM base of bus 0 of the segment */
+    u16 segment;
+    u8 start_bus;
+    u8 end_bus;
+    u32 reserved;
+} __packed;
+
+/*
+ * What the interrupt code needs from the MADT
+ */
+#define ACPI_MAX_CPUS       64
+#define ACPI_MAX_IOAPICS    8
+#define ACPI_ISA_IRQS       16
+
+struct acpi_ioapic_info {
+    u32 id;
+    u32 gsi_base;
+    phys_addr_t address;
+};
+
+struct acpi_isa_irq {
+    u32 gsi;                    /* Identity unless overridden */
+    u16 flags;                  /* ACPI_MPS_*; 0 = ISA default (edge, high) */
+};
+
+struct acpi_madt_info {
+    phys_addr_t lapic_address;
+    u32 flags;                  /* ACPI_MADT_* */
+    u32 nr_cpus;
+    u32 cpu_apic_ids[ACPI_MAX_CPUS];    /* Enabled CPUs, MADT order */
+    u32 nr_ioapics;
+    struct acpi_ioapic_info ioapics[ACPI_MAX_IOAPICS];
+    struct acpi_isa_irq isa_irqs[ACPI_ISA_IRQS];
+};
+
+/* Locate the tables from the bootloader's RSDP and parse the MADT */
+int acpi_init(void);
+
+/* Find a table by signature (e.g. "MCFG"); NULL if absent */
+const struct acpi_sdt_header *acpi_find_table(const char *signature);
+
+/* Parsed MADT, or NULL if there is none */
+const struct acpi_madt_info *acpi_madt(void);
+
+#endif /* _OCEAN_ACPI_H */
@@ -19,7 +19,7 @@ struct limine_file;
  * Cached module info
  * Copied early before bootloader memory is reclaimed
  */
-#define MAX_MODULES 8
+#define MAX_MODULES 16
 
 struct cached_module {
     void *address;      /* Module data address */
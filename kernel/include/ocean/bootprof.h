@@ -0,0 +1,31 @@
+/*
+ * Ocean Kernel - Boot Phase Profiler
+ *
+ * kernel_main() and the subsystems it calls mark where each step of the
+ * init sequence starts with boot_phase(); a phase runs until the next
+ * mark. The TSC stamps go into a static table, so marking works before
+ * the heap and the timer exist. Once init is loaded the table is printed
+ * with each phase's start, duration and share of boot, and
+ * kstat(KSTAT_BOOT) reports it again as BENCH lines for the harness.
+ */
+
+#ifndef _OCEAN_BOOTPROF_H
+#define _OCEAN_BOOTPROF_H
+
+#include <ocean/types.h>
+
+#define BOOT_PHASE_MAX      32
+
+/* Start the table; entry_tsc is the TSC read on kernel entry */
+void boot_phase_init(u64 entry_tsc);
+
+/* End the current phase and start name (a string literal) */
+void boot_phase(const char *name);
+
+/* End the last phase and print the summary */
+void boot_phase_done(void);
+
+/* KSTAT_BOOT: print the summary and one BENCH line per phase */
+int boot_phase_report(void);
+
+#endif /* _OCEAN_BOOTPROF_H */
@@ -307,6 +307,9 @@ static __always_inline u64 rdmsr(u32 msr)
     return ((u64)hi << 32) | lo;
 }
 
+/* User FS base, used as the thread pointer for TLS */
+#define MSR_FS_BASE     0xC0000100
+
 /* Write model-specific register */
 static __always_inline void wrmsr(u32 msr, u64 value)
 {
@@ -0,0 +1,58 @@
+/*
+ * Ocean Kernel - DMA Buffers
+ *
+ * Physically contiguous memory for userspace drivers. A buffer comes
+ * from ZONE_DMA32 so 32-bit devices can reach it, is zeroed, and is
+ * mapped into the driver with the memory type it asks for. The frames
+ * are pinned: the mapping is never paged, copied on fork or freed with
+ * the VMA, only by dma_free() or when the driver exits or execs.
+ *
+ * The memory server hands buffers out. SYS_DMA is reserved to the owner
+ * of EP_MEM and always acts on the client it is answering, so a driver
+ * gets DMA memory by calling the memory server (MEM_ALLOC_PHYS).
+ */
+
+#ifndef _OCEAN_DMA_H
+#define _OCEAN_DMA_H
+
+#include <ocean/types.h>
+#include <ocean/list.h>
+
+struct process;
+
+/* Memory types for the driver's mapping (SYS_DMA and MEM_ALLOC_PHYS flags) */
+#define DMA_CACHE_WB        0       /* Write-back; fine for cache-coherent devices */
+#define DMA_CACHE_UC        1       /* Uncached */
+#define DMA_CACHE_WC        2       /* Write-combining */
+
+#define DMA_MAX_PAGES       1024                /* Largest buddy block (4 MiB) */
+#define DMA_PROC_MAX_PAGES  4096                /* Per process (16 MiB) */
+
+/* Result of DMA_CTL_ALLOC, copied to the memory server */
+struct dma_region {
+    u64 virt;                       /* Address in the driver */
+    u64 phys;                       /* Bus address for the device */
+    u64 pages;
+    u32 pid;                        /* Driver the buffer belongs to */
+    u32 cache;
+};
+
+struct dma_buffer {
+    u64 virt;
+    u64 phys;
+    u64 pages;                      /* Mapped; the block is 1 << order */
+    u32 order;
+    u32 cache;
+    struct list_head link;          /* In proc->dma_buffers */
+};
+
+/* Allocate and map a buffer of pages pages into proc */
+int dma_alloc(struct process *proc, u64 pages, u32 cache, struct dma_region *out);
+
+/* Unmap and free proc's buffer at physical address phys; returns its pages */
+int dma_free(struct process *proc, u64 phys);
+
+/* Free every buffer of proc once its address space is gone (exit, exec) */
+void dma_release_all(struct process *proc);
+
+#endif /* _OCEAN_DMA_H */
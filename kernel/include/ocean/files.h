@@ -15,6 +15,7 @@ struct process;
 enum process_file_kind {
     PROCESS_FILE_NONE = 0,
     PROCESS_FILE_BOOT_MODULE = 1,
+    PROCESS_FILE_CONSOLE = 2,       /* Serial console; fds 0-2 to start */
 };
 
 struct process_file {
@@ -0,0 +1,29 @@
+/*
+ * Ocean Kernel - Futex
+ *
+ * Fast userspace mutex support: sleep while a user word holds an expected
+ * value, and wake sleepers on a word. Waiters are hashed by (address space,
+ * virtual address), or by physical address for VMA_SHARED mappings so
+ * processes sharing memory meet in the same queue.
+ */
+
+#ifndef _OCEAN_FUTEX_H
+#define _OCEAN_FUTEX_H
+
+#include <ocean/types.h>
+#include <ocean/syscall.h>
+
+/* Initialize the waiter hash table */
+void futex_init(void);
+
+/*
+ * Sleep if *uaddr == val. Returns 0 when woken by futex_wake, -EAGAIN if
+ * the value differed, -EINTR if woken for another reason (group exit),
+ * or -EFAULT/-EINVAL for a bad address.
+ */
+int futex_wait(u32 *uaddr, u32 val, u32 flags);
+
+/* Wake up to nr waiters on uaddr. Returns the number woken or -errno. */
+int futex_wake(u32 *uaddr, int nr, u32 flags);
+
+#endif /* _OCEAN_FUTEX_H */
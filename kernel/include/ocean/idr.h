@@ -0,0 +1,62 @@
+/*
+ * Ocean Kernel - ID Allocator
+ *
+ * Maps small integer IDs (PIDs, TIDs) to kernel objects with a radix tree
+ * of 64-way layers. Every layer keeps a bitmap of slots that still have a
+ * free ID beneath them, so allocation is a count-trailing-zeros per level
+ * and lookup is one pointer chase per level.
+ *
+ * Updates serialise on idr->lock; idr_find() takes no lock. A pointer it
+ * returns stays valid only as long as the owner's lifetime rules allow,
+ * which for RCU-freed objects means inside rcu_read_lock().
+ */
+
+#ifndef _OCEAN_IDR_H
+#define _OCEAN_IDR_H
+
+#include <ocean/types.h>
+#include <ocean/spinlock.h>
+
+#define IDR_BITS        6
+#define IDR_SIZE        (1 << IDR_BITS)
+#define IDR_MASK        (IDR_SIZE - 1)
+#define IDR_MAX_LEVELS  4           /* Up to 2^24 IDs */
+
+struct idr_layer {
+    u64 free;                       /* Bit set: slot (or subtree) has a free ID */
+    void *slots[IDR_SIZE];          /* Child layers, or objects at the leaf */
+};
+
+struct idr {
+    struct idr_layer *top;          /* Root layer (allocated on first use) */
+    int levels;                     /* Tree height */
+    int max_id;                     /* IDs are in [0, max_id) */
+    int next;                       /* Cyclic allocation hint */
+    spinlock_t lock;
+};
+
+/* Initialize an empty map for IDs in [0, max_id) */
+void idr_init(struct idr *idr, int max_id);
+
+/* Allocate the lowest free ID >= start. Returns the ID or negative errno. */
+int idr_alloc(struct idr *idr, void *ptr, int start);
+
+/*
+ * Allocate the next free ID after the previous allocation, wrapping to
+ * min. Avoids immediately reusing a just-freed ID.
+ */
+int idr_alloc_cyclic(struct idr *idr, void *ptr, int min);
+
+/* Claim a specific ID. Returns 0, -EEXIST if taken, or -EINVAL/-ENOMEM. */
+int idr_insert(struct idr *idr, int id, void *ptr);
+
+/* Look up the object for an ID (NULL if free or not yet published). Lockless. */
+void *idr_find(struct idr *idr, int id);
+
+/* Replace the object for an allocated ID, returning the old one */
+void *idr_replace(struct idr *idr, int id, void *ptr);
+
+/* Free an ID, returning its object */
+void *idr_remove(struct idr *idr, int id);
+
+#endif /* _OCEAN_IDR_H */
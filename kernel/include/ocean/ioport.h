@@ -0,0 +1,43 @@
+/*
+ * Ocean Kernel - I/O Port Access
+ *
+ * Userspace drivers do port I/O directly. A port range the driver has
+ * claimed is opened in its process's I/O permission bitmap, which the
+ * TSS carries while the process runs, so in/out instructions need no
+ * syscall. Only privileged processes (see SPAWN_PRIVILEGED) claim ports;
+ * claims are exclusive and end when the process exits. Ports behind a
+ * PCI I/O BAR need the device's claim first. The ports the
+ * kernel drives itself (PIC, PIT, COM1, PCI configuration) and those
+ * that reset the machine or gate NMIs (keyboard controller, CMOS, port
+ * 0x92) are never handed out.
+ */
+
+#ifndef _OCEAN_IOPORT_H
+#define _OCEAN_IOPORT_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+struct process;
+
+#define IOPORT_MAX_CLAIMS   64
+
+/* Open ports base..base+count-1 to proc */
+int ioport_claim(struct process *proc, u32 base, u32 count);
+
+/* Close a range claimed with exactly this base and count */
+int ioport_release(struct process *proc, u32 base, u32 count);
+
+/* Drop every claim of proc and its bitmap (process teardown) */
+void ioport_release_all(struct process *proc);
+
+/* Make the TSS match next; called on context switch with interrupts off */
+void ioport_switch(struct process *next);
+
+/*
+ * A #GP from user mode may come from a bitmap changed after this CPU
+ * loaded it. Reload it and return true if so; the access is retried.
+ */
+bool ioport_fault_fixup(void);
+
+#endif /* _OCEAN_IOPORT_H */
@@ -16,6 +16,9 @@
 #include <ocean/types.h>
 #include <ocean/list.h>
 #include <ocean/spinlock.h>
+#include <ocean/rcu.h>
+#include <ocean/wait.h>
+#include <ocean/percpu_counter.h>
 
 /* Forward declarations */
 struct thread;
@@ -57,6 +60,12 @@ typedef u64 msg_tag_t;
  * rendezvous. len == 0 is a no-op; the flag signals intent to copy.
  */
 #define MSG_FLAG_SLICE          (1 << 4)
+/*
+ * MSG_FLAG_REPLAYED: set by the kernel on a call it delivers a second time
+ * because the server thread that received it died without replying (see
+ * supervised endpoints below). That server may have acted on it already.
+ */
+#define MSG_FLAG_REPLAYED       (1 << 5)
 
 /* Helper macros for message tags */
 #define MSG_TAG(label, len, caps, flags) \
@@ -133,13 +142,19 @@ struct ipc_endpoint {
     /* Bound thread (for reply endpoints) */
     struct thread *bound_thread;        /* Thread bound to this endpoint */
 
+    /* Heirs if the owner exits, when EP_FLAG_SUPERVISED (0 = none) */
+    pid_t supervisor;                   /* Process that set up supervision */
+    pid_t standby;                      /* Takes over first, once */
+
     /* Statistics */
-    u64 msgs_sent;                      /* Messages sent through */
-    u64 msgs_received;                  /* Messages received */
+    struct percpu_counter msgs_sent;    /* Messages sent through */
+    struct percpu_counter msgs_received; /* Messages received */
 
     /* List linkage */
     struct list_head list;              /* Global endpoint list */
     struct list_head owner_link;        /* Link in owner->owned_endpoints */
+
+    struct rcu_head rcu;                /* Deferred free after last put */
 };
 
 /* Endpoint flags */
@@ -148,6 +163,7 @@ struct ipc_endpoint {
 #define EP_FLAG_NOTIFICATION (1 << 2)   /* Notification endpoint */
 #define EP_FLAG_DEAD        (1 << 3)    /* Endpoint destroyed */
 #define EP_FLAG_LISTED      (1 << 4)    /* Present in global endpoint list */
+#define EP_FLAG_SUPERVISED  (1 << 5)    /* Outlives its owner (SYS_RS) */
 
 /*
  * IPC Wait state - saved when thread blocks on IPC
@@ -167,6 +183,7 @@ struct ipc_wait {
 #define IPC_OP_CALL         3           /* Send + receive (RPC) */
 #define IPC_OP_REPLY        4
 #define IPC_OP_REPLY_RECV   5           /* Reply + receive (server loop) */
+#define IPC_OP_REPLAY       6           /* Journalled call, queued by the kernel */
 
 /*
  * Thread IPC state - embedded in struct thread
@@ -226,15 +243,28 @@ struct cspace {
 
 /*
  * Notification object - async signaling
+ *
+ * A word of pending bits. Signals OR bits in and never block, so they are
+ * safe from interrupt context; a wait returns the accumulated word and
+ * clears it. Only the owning process may wait or poll.
  */
+#define NTFN_MAX_ID         4096
+#define NTFN_BITS           63          /* Bit 63 stays clear: waits return the word */
+
 struct notification {
     u32 id;
+    u32 flags;                          /* NTFN_FLAG_* */
     spinlock_t lock;
     u64 word;                           /* Notification bits */
-    struct list_head wait_queue;        /* Threads waiting */
+    struct wait_queue wait;             /* Threads waiting */
     int refcount;
+    struct process *owner;
+    struct list_head owner_link;        /* Link in owner->owned_notifications */
+    struct rcu_head rcu;                /* Deferred free after last put */
 };
 
+#define NTFN_FLAG_DEAD      (1 << 0)
+
 /*
  * IPC API
  */
@@ -250,8 +280,10 @@ void endpoint_destroy(struct ipc_endpoint *ep);
 struct ipc_endpoint *endpoint_get(u32 id);
 void endpoint_put(struct ipc_endpoint *ep);
 
-/* Tear down every endpoint owned by proc. Called during process teardown. */
+/* Tear down every endpoint and notification owned by proc. Called during
+ * process teardown. */
 void ipc_destroy_owned_by_process(struct process *proc);
+void notification_destroy_owned_by_process(struct process *proc);
 
 /* Break call/reply links anchored on the given thread. Called from thread
  * teardown before the struct is freed. Wakes any caller blocked on this
@@ -260,6 +292,32 @@ void ipc_destroy_owned_by_process(struct process *proc);
  * call/reply state. */
 void ipc_thread_cleanup(struct thread *t);
 
+/*
+ * Supervised endpoints (SYS_RS)
+ *
+ * A supervised endpoint is not destroyed with its owner. It passes to the
+ * standby process, or if there is none (or it is gone) to the supervisor,
+ * keeping its id and its queued senders; a thread parked on it wakes when
+ * its process becomes the owner. A call received through a supervised
+ * endpoint is journalled in the caller: if the server thread exits before
+ * replying, the call goes back to the head of the send queue, tagged
+ * MSG_FLAG_REPLAYED, instead of failing with IPC_ERR_DEAD. The caller
+ * stays blocked throughout; delivery is at least once.
+ *
+ * endpoint_supervise sets the heirs (a NULL supervisor ends supervision;
+ * a process stops being heir when it exits), endpoint_handover moves an
+ * endpoint from its owner to another process, and endpoint_park sleeps
+ * until the current process owns ep. All return 0 or negative errno.
+ */
+int endpoint_supervise(struct ipc_endpoint *ep, struct process *supervisor,
+                       struct process *standby);
+int endpoint_handover(struct ipc_endpoint *ep, struct process *from,
+                      struct process *to);
+int endpoint_park(struct ipc_endpoint *ep);
+
+/* Fail a replayed call still queued on an endpoint being destroyed */
+void ipc_replay_cancel(struct ipc_wait *wait);
+
 /*
  * Per-process IPC window management.
  *
@@ -284,6 +342,9 @@ int ipc_call(struct ipc_endpoint *ep, struct ipc_message *msg);
 int ipc_reply(struct ipc_message *msg);
 int ipc_reply_recv(struct ipc_endpoint *ep, struct ipc_message *msg);
 
+/* Process of the caller the current thread owes a reply, or NULL */
+struct process *ipc_caller_process(void);
+
 /* Fast path (register-only, direct switch) */
 int ipc_send_fast(u32 ep_cap, u64 tag, u64 *regs);
 int ipc_recv_fast(u32 ep_cap, u64 *tag, u64 *regs);
@@ -301,8 +362,11 @@ int cap_mint(struct cspace *dst, u32 dst_slot,
              u32 new_rights, u64 badge);
 
 /* Notification operations */
-struct notification *notification_create(void);
+void notification_init(void);
+struct notification *notification_create(struct process *owner);
 void notification_destroy(struct notification *ntfn);
+struct notification *notification_get(u32 id);
+void notification_put(struct notification *ntfn);
 int notification_signal(struct notification *ntfn, u64 bits);
 int notification_wait(struct notification *ntfn, u64 *bits);
 int notification_poll(struct notification *ntfn, u64 *bits);
@@ -321,6 +385,8 @@ i64 sys_endpoint_create_well_known(u32 id, u32 flags);
 i64 sys_cap_copy(u32 dst_slot, u32 src_slot);
 i64 sys_cap_delete(u32 slot);
 
+i64 sys_notify_create(u32 flags);
+i64 sys_notify_destroy(u32 ntfn_cap);
 i64 sys_notify_signal(u32 ntfn_cap, u64 bits);
 i64 sys_notify_wait(u32 ntfn_cap);
 i64 sys_notify_poll(u32 ntfn_cap);
@@ -328,6 +394,9 @@ i64 sys_notify_poll(u32 ntfn_cap);
 /*
  * Debug
  */
+extern struct percpu_counter ipc_total_messages;   /* All transfers */
+extern struct percpu_counter ipc_fast_path_count;  /* Sends to a waiting receiver */
+
 void ipc_dump_endpoint(struct ipc_endpoint *ep);
 void ipc_dump_stats(void);
 
@@ -0,0 +1,138 @@
+/*
+ * Ocean Kernel - Interrupt Routing
+ *
+ * Vectors 32-47 stay reserved for the 16 ISA IRQs (irq_register()).
+ * Everything else a device needs comes from a dynamic vector pool and is
+ * delivered to a chosen CPU: a global system interrupt (GSI) is routed
+ * through its IOAPIC redirection entry, an MSI by programming the vector
+ * and destination into the device.
+ *
+ * CPUs are numbered 0..irq_nr_cpus()-1 with the boot CPU as 0; only CPUs
+ * that have brought up their local APIC can be interrupt targets.
+ */
+
+#ifndef _OCEAN_IRQ_H
+#define _OCEAN_IRQ_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* Dynamic vector range (0x80 inside it stays the int 0x80 gate) */
+#define IRQ_VECTOR_DYN_FIRST    48
+#define IRQ_VECTOR_DYN_LAST     0xEF
+#define IRQ_NR_DYN_VECTORS      (IRQ_VECTOR_DYN_LAST - IRQ_VECTOR_DYN_FIRST + 1)
+
+/* Called in interrupt context; the EOI is sent after it returns */
+typedef void (*irq_vector_fn_t)(u8 vector, void *data);
+
+/*
+ * Allocate a vector and attach fn to it. Returns the vector or
+ * -ENOSPC when the pool is exhausted.
+ */
+int irq_alloc_vector(irq_vector_fn_t fn, void *data);
+void irq_free_vector(int vector);
+
+/* GSI routing flags */
+#define IRQ_TRIGGER_LEVEL       (1 << 0)    /* Default: edge */
+#define IRQ_POLARITY_LOW        (1 << 1)    /* Default: active high */
+
+/*
+ * Route gsi to vector on cpu, masked. Fails with -ENODEV when no IOAPIC
+ * serves gsi (or the kernel is still on the 8259 PIC).
+ */
+int irq_route_gsi(u32 gsi, int vector, u32 cpu, u32 flags);
+int irq_mask_gsi(u32 gsi);
+int irq_unmask_gsi(u32 gsi);
+
+/* Move an already routed gsi to another CPU */
+int irq_set_affinity(u32 gsi, u32 cpu);
+
+/* ISA IRQ 0-15 on whichever controller is in charge */
+void irq_unmask_legacy(int irq);
+void irq_mask_legacy(int irq);
+
+/*
+ * Lines the kernel keeps to itself: a GSI behind an ISA IRQ or unmasked
+ * by the kernel, and ISA IRQs whose GSI another ISA IRQ also uses
+ */
+bool irq_gsi_reserved(u32 gsi);
+bool irq_isa_shared(int irq);
+
+/* CPUs known from the MADT and the APIC ID interrupts use to reach them */
+u32 irq_nr_cpus(void);
+bool irq_cpu_online(u32 cpu);
+u32 irq_cpu_apic_id(u32 cpu);
+
+/* The CPU running the caller */
+u32 irq_this_cpu(void);
+
+/* Send a dynamic vector to the calling CPU; -ENODEV without a local APIC */
+int irq_raise_vector(int vector);
+
+/*
+ * IRQ objects
+ *
+ * An IRQ object hands an interrupt source to a userspace driver by
+ * signalling a bit of one of its notifications. The kernel masks the
+ * source before signalling, so a level-triggered line cannot storm while
+ * the driver runs; the driver services the device and acknowledges,
+ * which unmasks. An MSI/MSI-X object has one queue per vector: queue i
+ * signals bit + i and is masked and acknowledged on its own.
+ *
+ * Objects are named by small IDs, belong to the process that bound them
+ * and go away with the notification they signal.
+ */
+
+/* Interrupt sources */
+#define IRQ_SRC_ISA         0       /* arg: ISA IRQ 0-15 */
+#define IRQ_SRC_GSI         1       /* arg: GSI; flags: IRQ_TRIGGER_*, IRQ_POLARITY_* */
+#define IRQ_SRC_MSI         2       /* arg: PCI BDF of a claimed device; nvec queues */
+#define IRQ_SRC_SOFT        3       /* No device; fired by irq_object_trigger() */
+
+#define IRQ_OBJ_MAX         64
+#define IRQ_OBJ_MAX_QUEUES  32
+
+/*
+ * IRQ_CTL_INFO record. Keep in sync with lib/libocean/include/ocean/irq.h.
+ */
+struct irq_object_info {
+    u32 source;                 /* IRQ_SRC_* */
+    u32 nr_queues;
+    u32 notification;           /* Notification ID signalled */
+    u32 bit;                    /* Bit of queue 0 */
+    u64 arg;                    /* IRQ, GSI or BDF as bound */
+    u64 masked;                 /* Queues fired and not yet acknowledged */
+    u64 count;                  /* Interrupts delivered */
+    u64 last_tsc;               /* rdtsc() in the handler of the latest one */
+};
+
+struct notification;
+
+/*
+ * Bind a source to bits bit..bit+nvec-1 of ntfn for process pid, unmasked.
+ * nvec only matters for IRQ_SRC_MSI; flags only for IRQ_SRC_GSI. An ISA
+ * or GSI line needs a privileged caller or a claimed PCI device wired to
+ * it (-EPERM); lines the kernel uses are -EBUSY, and an ISA IRQ's GSI
+ * can only be bound as IRQ_SRC_ISA. Returns the object ID or negative
+ * errno.
+ */
+int irq_object_bind(pid_t pid, bool privileged, u32 source, u64 arg,
+                    struct notification *ntfn, u32 bit, u32 flags, u32 nvec);
+int irq_object_unbind(pid_t pid, u32 id);
+
+/* Unmask the fired queues in queue_mask */
+int irq_object_ack(pid_t pid, u32 id, u64 queue_mask);
+
+/* Raise queue on the calling CPU as if the device had (not ISA sources) */
+int irq_object_trigger(pid_t pid, u32 id, u32 queue);
+
+int irq_object_info(pid_t pid, u32 id, struct irq_object_info *info);
+
+/* Unbind everything signalling ntfn (notification teardown) */
+void irq_unbind_notification(struct notification *ntfn);
+
+/* Unbind the MSI/MSI-X objects of dev, freeing its vectors (claim release) */
+struct pci_dev;
+void irq_unbind_pci(struct pci_dev *dev);
+
+#endif /* _OCEAN_IRQ_H */
@@ -0,0 +1,15 @@
+/*
+ * Ocean Kernel - In-kernel microbenchmarks
+ *
+ * Allocator paths that user space cannot time directly. Run through
+ * kstat(KSTAT_BENCH); results are printed to the console in the same
+ * "BENCH <name> <value> <unit>" form as bin/bench.
+ */
+
+#ifndef _OCEAN_KBENCH_H
+#define _OCEAN_KBENCH_H
+
+/* Run every benchmark; returns 0 or negative errno */
+int kbench_run(void);
+
+#endif /* _OCEAN_KBENCH_H */
@@ -0,0 +1,76 @@
+/*
+ * Ocean Kernel - Sleeping Locks
+ *
+ * Mutexes and counting semaphores for process context. Unlike spinlocks
+ * they may be held across long operations (page copies, console output)
+ * and their waiters sleep on a wait queue instead of burning the CPU with
+ * interrupts off. Never take one from interrupt context or with a
+ * spinlock held.
+ */
+
+#ifndef _OCEAN_MUTEX_H
+#define _OCEAN_MUTEX_H
+
+#include <ocean/types.h>
+#include <ocean/wait.h>
+
+struct thread;
+
+/*
+ * Mutex
+ *
+ * Uncontended lock and unlock are a single atomic each. A contended
+ * locker spins while the owner is running on another CPU (it will likely
+ * release soon) and sleeps otherwise.
+ */
+struct mutex {
+    struct thread *owner;       /* NULL when unlocked */
+    u32 nr_waiters;             /* Threads in the sleep path */
+    struct wait_queue wait;
+};
+
+#define MUTEX_INIT(name) { \
+        .owner = NULL, \
+        .nr_waiters = 0, \
+        .wait = WAIT_QUEUE_INIT((name).wait) \
+    }
+
+#define DEFINE_MUTEX(name) struct mutex name = MUTEX_INIT(name)
+
+void mutex_init(struct mutex *m);
+void mutex_lock(struct mutex *m);
+bool mutex_trylock(struct mutex *m);
+void mutex_unlock(struct mutex *m);
+
+static inline bool mutex_is_locked(struct mutex *m)
+{
+    return __atomic_load_n(&m->owner, __ATOMIC_RELAXED) != NULL;
+}
+
+/*
+ * Counting semaphore
+ */
+struct semaphore {
+    i32 count;                  /* Available units */
+    u32 nr_waiters;
+    struct wait_queue wait;
+};
+
+#define SEMAPHORE_INIT(name, n) { \
+        .count = (n), \
+        .nr_waiters = 0, \
+        .wait = WAIT_QUEUE_INIT((name).wait) \
+    }
+
+void sema_init(struct semaphore *sem, int count);
+
+/* Take a unit, sleeping until one is available */
+void down(struct semaphore *sem);
+
+/* Take a unit if one is available; returns true on success */
+bool down_trylock(struct semaphore *sem);
+
+/* Return a unit and wake a waiter */
+void up(struct semaphore *sem);
+
+#endif /* _OCEAN_MUTEX_H */
@@ -0,0 +1,71 @@
+/*
+ * Ocean Kernel - External Pagers
+ *
+ * A pager-backed region is a range of a client's address space whose
+ * pages come from a userspace server instead of the zero-fill path. A
+ * not-present fault in it becomes a PAGER_FAULT call on the pager's
+ * endpoint (see ocean/ipc_proto.h for the words) made by the faulting
+ * thread itself, which sleeps until the reply. While answering, the
+ * pager hands over frames with pager_supply(): up to PAGER_MAX_CLUSTER
+ * pages per call, so one fault can fill a run for sequential access.
+ * The fault is retried once the reply arrives.
+ *
+ * Regions belong to address spaces. The pager creates one in the client
+ * it is answering; the client may unmap it, and it goes with the address
+ * space otherwise. Fork does not copy regions.
+ */
+
+#ifndef _OCEAN_PAGER_H
+#define _OCEAN_PAGER_H
+
+#include <ocean/types.h>
+#include <ocean/list.h>
+
+struct process;
+struct address_space;
+
+#define PAGER_MAX_ID            4096
+#define PAGER_MAX_PAGES         (1ULL << 18)    /* 1 GiB per region */
+#define PAGER_AS_MAX_REGIONS    64
+
+struct pager_region {
+    u32 id;
+    u32 endpoint;                       /* Pager endpoint faults go to */
+    u64 cookie;                         /* Pager's tag, echoed in faults */
+    struct address_space *as;
+    u64 start;
+    u64 pages;
+    struct list_head link;              /* In the global region list */
+};
+
+void pager_init(void);
+
+/*
+ * Map a region of pages pages served by endpoint (owned by pager) into
+ * client. prot is VMA_READ/WRITE/EXEC. Returns the address or negative
+ * errno.
+ */
+i64 pager_map(struct process *pager, struct process *client, u32 endpoint,
+              u64 pages, u32 prot, u64 cookie);
+
+/* Remove the region client mapped at start */
+int pager_unmap(struct process *client, u64 start);
+
+/*
+ * Give client's region id the pages at offset, taken from pager's
+ * memory at src. Private frames move; pinned or shared ones are copied.
+ * Pages client already has are left alone. Returns the pages mapped.
+ */
+int pager_supply(struct process *pager, struct process *client, u32 id,
+                 u64 offset, u64 src, u64 pages);
+
+/* Resolve a not-present fault at addr in as; 0 once the page is mapped */
+int pager_fault(struct address_space *as, u64 addr, u32 access);
+
+/* Fault in the not-present pages of [addr, addr + len) ahead of a kernel copy */
+int pager_prefault(struct address_space *as, u64 addr, u64 len, bool write);
+
+/* The address space is going away */
+void pager_release_as(struct address_space *as);
+
+#endif /* _OCEAN_PAGER_H */
@@ -0,0 +1,197 @@
+/*
+ * Ocean Kernel - PCI Bus
+ *
+ * The bus is enumerated once at boot, through ECAM when ACPI has an MCFG
+ * table and through the legacy 0xCF8/0xCFC ports otherwise. Every
+ * function found is recorded with its sized BARs and the offsets of its
+ * MSI and MSI-X capabilities.
+ *
+ * Userspace drivers see the same records through SYS_PCI: a driver
+ * manager lists them, and a driver claims its device before it may
+ * write the device's configuration space.
+ *
+ * The record layout is ABI: keep it in sync with
+ * lib/libocean/include/ocean/pci.h.
+ */
+
+#ifndef _OCEAN_PCI_H
+#define _OCEAN_PCI_H
+
+#include <ocean/irq.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+#define PCI_MAX_DEVICES     64
+#define PCI_MAX_BARS        6
+
+/* Encoded device address used by SYS_PCI */
+#define PCI_BDF(seg, bus, slot, func) \
+    (((u32)(seg) << 16) | ((u32)(bus) << 8) | ((u32)(slot) << 3) | (u32)(func))
+
+/* Configuration space header */
+#define PCI_VENDOR_ID       0x00
+#define PCI_DEVICE_ID       0x02
+#define PCI_COMMAND         0x04
+#define PCI_STATUS          0x06
+#define PCI_REVISION        0x08
+#define PCI_PROG_IF         0x09
+#define PCI_SUBCLASS        0x0A
+#define PCI_CLASS           0x0B
+#define PCI_HEADER_TYPE     0x0E
+#define PCI_BAR0            0x10
+#define PCI_SECONDARY_BUS   0x19    /* Type 1 (bridge) header */
+#define PCI_ROM_ADDRESS     0x30    /* Type 0 */
+#define PCI_CAP_PTR         0x34
+#define PCI_BRIDGE_ROM_ADDRESS 0x38 /* Type 1 */
+#define PCI_IRQ_LINE        0x3C
+#define PCI_IRQ_PIN         0x3D
+
+#define PCI_COMMAND_IO          (1 << 0)
+#define PCI_COMMAND_MEMORY      (1 << 1)
+#define PCI_COMMAND_MASTER      (1 << 2)
+#define PCI_COMMAND_INTX_OFF    (1 << 10)
+
+#define PCI_STATUS_CAP_LIST     (1 << 4)
+
+#define PCI_HEADER_TYPE_MASK    0x7F
+#define PCI_HEADER_BRIDGE       0x01
+#define PCI_HEADER_MULTIFUNC    0x80
+
+/* Capability IDs */
+#define PCI_CAP_ID_MSI      0x05
+#define PCI_CAP_ID_MSIX     0x11
+
+/* MSI capability */
+#define PCI_MSI_FLAGS           0x02
+#define PCI_MSI_FLAGS_ENABLE    (1 << 0)
+#define PCI_MSI_FLAGS_QSIZE     (7 << 4)    /* Vectors enabled, log2 */
+#define PCI_MSI_FLAGS_64BIT     (1 << 7)
+#define PCI_MSI_FLAGS_MASKBIT   (1 << 8)    /* Per-vector masking */
+#define PCI_MSI_ADDRESS_LO      0x04
+#define PCI_MSI_ADDRESS_HI      0x08
+#define PCI_MSI_DATA_32         0x08
+#define PCI_MSI_DATA_64         0x0C
+#define PCI_MSI_MASK_32         0x0C
+#define PCI_MSI_MASK_64         0x10
+
+/* MSI-X capability and table */
+#define PCI_MSIX_FLAGS          0x02
+#define PCI_MSIX_FLAGS_QSIZE    0x07FF      /* Table size - 1 */
+#define PCI_MSIX_FLAGS_MASKALL  (1 << 14)
+#define PCI_MSIX_FLAGS_ENABLE   (1 << 15)
+#define PCI_MSIX_TABLE          0x04        /* Offset | BIR */
+#define PCI_MSIX_BIR_MASK       0x7
+
+#define PCI_MSIX_ENTRY_SIZE     16
+#define PCI_MSIX_ENTRY_ADDR_LO  0x0
+#define PCI_MSIX_ENTRY_ADDR_HI  0x4
+#define PCI_MSIX_ENTRY_DATA     0x8
+#define PCI_MSIX_ENTRY_CTRL     0xC
+#define PCI_MSIX_ENTRY_MASKED   (1 << 0)
+
+/* Message address: fixed delivery, physical destination */
+#define PCI_MSI_ADDR_BASE       0xFEE00000U
+#define PCI_MSI_ADDR_DEST_SHIFT 12
+
+/* struct pci_bar flags */
+#define PCI_BAR_IO          (1 << 0)
+#define PCI_BAR_MEM64       (1 << 1)
+#define PCI_BAR_PREFETCH    (1 << 2)
+
+struct pci_bar {
+    u64 base;                   /* Port or physical address; 0 if unused */
+    u64 size;
+    u32 flags;                  /* PCI_BAR_* */
+    u32 reserved;
+};
+
+/* One function (168 bytes) */
+struct pci_device_info {
+    u16 segment;
+    u8 bus;
+    u8 slot;
+    u8 func;
+    u8 header_type;
+    u16 vendor_id;
+    u16 device_id;
+    u8 class_code;
+    u8 subclass;
+    u8 prog_if;
+    u8 revision;
+    u8 irq_line;                /* Legacy INTx as the firmware routed it */
+    u8 irq_pin;                 /* 1-4 = INTA-INTD, 0 = none */
+    u8 msi_cap;                 /* Capability offsets, 0 if absent */
+    u8 msix_cap;
+    u16 msix_vectors;           /* MSI-X table size */
+    u32 owner;                  /* PID holding the claim, 0 if unclaimed */
+    struct pci_bar bars[PCI_MAX_BARS];
+};
+
+/* Message-signalled vectors one device may hold (one per queue) */
+#define PCI_MAX_DEV_IRQS    32
+
+struct pci_dev {
+    struct pci_device_info info;
+    volatile u8 *ecam;          /* Mapped config space, NULL for port I/O */
+
+    /* MSI/MSI-X state, guarded by the MSI lock */
+    bool msix;
+    u32 nr_irqs;
+    int irq_vectors[PCI_MAX_DEV_IRQS];
+    u32 irq_cpus[PCI_MAX_DEV_IRQS];
+    volatile u32 *msix_table;
+};
+
+/* Enumerate the bus; call after apic_init() */
+int pci_init(void);
+
+/* Devices in enumeration order; NULL past the end */
+u32 pci_device_count(void);
+struct pci_dev *pci_device(u32 index);
+struct pci_dev *pci_find_bdf(u32 bdf);
+
+/*
+ * Claim dev for a userspace driver. A claim whose owner has exited is
+ * taken over; -EBUSY while the owner lives. Releasing frees the device's
+ * MSI vectors and stops its bus mastering; exit releases every claim.
+ */
+struct process;
+int pci_claim(struct pci_dev *dev, pid_t pid);
+void pci_release(struct pci_dev *dev, pid_t pid);
+void pci_release_all(struct process *proc);
+
+/* Does pid hold a claim on a device whose INTx line is line? */
+bool pci_owns_irq_line(pid_t pid, u32 line);
+
+/*
+ * Configuration space access. Offsets past 0xFF need ECAM; reads of
+ * unreachable registers return all ones.
+ */
+u8 pci_read8(struct pci_dev *dev, u32 offset);
+u16 pci_read16(struct pci_dev *dev, u32 offset);
+u32 pci_read32(struct pci_dev *dev, u32 offset);
+void pci_write8(struct pci_dev *dev, u32 offset, u8 val);
+void pci_write16(struct pci_dev *dev, u32 offset, u16 val);
+void pci_write32(struct pci_dev *dev, u32 offset, u32 val);
+
+/*
+ * Allocate up to nvec message-signalled vectors, one per queue, spread
+ * round-robin over the online CPUs. MSI-X is preferred; plain MSI gives
+ * a single vector. fn runs for each of them with data. Bus mastering is
+ * turned on (the message is a memory write) and INTx off while vectors
+ * are held. Returns the number allocated or negative errno.
+ */
+int pci_alloc_irq_vectors(struct pci_dev *dev, u32 nvec,
+                          irq_vector_fn_t fn, void *data);
+void pci_free_irq_vectors(struct pci_dev *dev);
+
+/* IDT vector serving queue index, or -EINVAL */
+int pci_irq_vector(struct pci_dev *dev, u32 index);
+
+/* Steer queue index to cpu */
+int pci_set_irq_affinity(struct pci_dev *dev, u32 index, u32 cpu);
+
+/* Mask or unmask queue index; -ENODEV for MSI without per-vector masking */
+int pci_mask_irq(struct pci_dev *dev, u32 index, bool masked);
+
+#endif /* _OCEAN_PCI_H */
@@ -0,0 +1,73 @@
+/*
+ * Ocean Kernel - Per-CPU Counters
+ *
+ * Statistics counters for hot paths. Each CPU adds to its own cache line
+ * with a single non-locked instruction, so updates never bounce lines
+ * between CPUs and cannot be torn by a local interrupt. Readers sum the
+ * slots; a sum taken during updates is approximate, which is fine for
+ * statistics but not for anything that must be exact.
+ */
+
+#ifndef _OCEAN_PERCPU_COUNTER_H
+#define _OCEAN_PERCPU_COUNTER_H
+
+#include <ocean/smp.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+struct percpu_counter_slot {
+    i64 count;
+} __aligned(64);
+
+struct percpu_counter {
+    struct percpu_counter_slot cpu[NR_CPUS];
+};
+
+#define PERCPU_COUNTER_INIT         { }
+#define DEFINE_PERCPU_COUNTER(name) struct percpu_counter name = PERCPU_COUNTER_INIT
+
+static inline void percpu_counter_init(struct percpu_counter *c)
+{
+    for (int i = 0; i < NR_CPUS; i++) {
+        __atomic_store_n(&c->cpu[i].count, 0, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void percpu_counter_add(struct percpu_counter *c, i64 delta)
+{
+    /* One read-modify-write instruction: atomic against local interrupts */
+    __asm__ __volatile__("addq %1, %0"
+                         : "+m"(c->cpu[smp_processor_id()].count)
+                         : "er"(delta));
+}
+
+static inline void percpu_counter_inc(struct percpu_counter *c)
+{
+    percpu_counter_add(c, 1);
+}
+
+static inline void percpu_counter_dec(struct percpu_counter *c)
+{
+    percpu_counter_add(c, -1);
+}
+
+/* Sum of all CPUs' deltas */
+static inline i64 percpu_counter_sum(struct percpu_counter *c)
+{
+    i64 sum = 0;
+
+    for (int i = 0; i < NR_CPUS; i++) {
+        sum += __atomic_load_n(&c->cpu[i].count, __ATOMIC_RELAXED);
+    }
+
+    return sum;
+}
+
+/* Sum clamped at zero, for counts that a racing read could see negative */
+static inline u64 percpu_counter_sum_positive(struct percpu_counter *c)
+{
+    i64 sum = percpu_counter_sum(c);
+    return sum > 0 ? (u64)sum : 0;
+}
+
+#endif /* _OCEAN_PERCPU_COUNTER_H */
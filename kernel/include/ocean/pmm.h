@@ -16,6 +16,7 @@
 #include <ocean/types.h>
 #include <ocean/list.h>
 #include <ocean/spinlock.h>
+#include <ocean/percpu_counter.h>
 
 /*
  * Page size constants
@@ -173,8 +174,8 @@ struct zone {
     struct pcpu_cache *pcpu_caches;
 
     /* Statistics */
-    u64 alloc_count;                /* Total allocations */
-    u64 free_count;                 /* Total frees */
+    struct percpu_counter alloc_count;  /* Total allocations */
+    struct percpu_counter free_count;   /* Total frees */
 };
 
 /*
@@ -10,6 +10,7 @@
 #include <ocean/types.h>
 #include <ocean/list.h>
 #include <ocean/spinlock.h>
+#include <ocean/rcu.h>
 
 /* Number of register slots carried by a fast-path IPC message. Must stay
  * in sync with IPC_FAST_REGS in ocean/ipc.h. Declared here so the thread
@@ -19,6 +20,7 @@
 /* Forward declarations */
 struct address_space;
 struct vm_area;
+struct ipc_endpoint;
 
 /*
  * Process/Thread States
@@ -40,6 +42,7 @@ enum task_state {
 #define TF_NEED_RESCHED (1 << 2)    /* Needs rescheduling */
 #define TF_EXITING      (1 << 3)    /* Thread is exiting */
 #define TF_FORKING      (1 << 4)    /* In middle of fork */
+#define TF_GROUP_EXIT   (1 << 5)    /* Another thread is exiting the process */
 
 /*
  * CPU context saved during context switch
@@ -56,6 +59,46 @@ struct cpu_context {
     u64 rip;        /* Return address */
 };
 
+/*
+ * Why a thread is off the CPU. Blocking paths tag the thread with
+ * sched_block_reason_set() before they sleep. Keep the order in sync with
+ * lib/libocean/include/ocean/schedstat.h.
+ */
+enum sched_block_reason {
+    SCHED_BLOCK_OTHER = 0,      /* Untagged sleep */
+    SCHED_BLOCK_IPC,            /* Waiting for an IPC partner or reply */
+    SCHED_BLOCK_FUTEX,
+    SCHED_BLOCK_WAIT,           /* wait()/vfork() on a child */
+    SCHED_BLOCK_LOCK,           /* Sleeping mutex or semaphore */
+    SCHED_BLOCK_SLEEP,          /* Timed sleep */
+    SCHED_BLOCK_FAULT,          /* Resolving a page fault */
+    SCHED_BLOCK_NR
+};
+
+/* off_reason of a thread that is runnable but waiting for a CPU */
+#define SCHED_OFF_RUNNABLE  SCHED_BLOCK_NR
+
+/*
+ * Per-thread scheduler accounting, in TSC cycles. Written by the CPU the
+ * thread runs on and by whoever wakes it; read unlocked for statistics.
+ */
+struct thread_sched_stats {
+    u64 on_cpu_since;               /* Switched in at; 0 while off the CPU */
+    u64 off_since;                  /* Left the CPU or was woken at */
+    u64 user_since;                 /* Returned to user mode at; 0 in the kernel */
+    u8 off_reason;                  /* SCHED_OFF_RUNNABLE or a block reason */
+    u8 block_reason;                /* Set by the blocking path before it sleeps */
+
+    u64 cpu_cycles;                 /* On the CPU, user plus system */
+    u64 user_cycles;                /* Of which in user mode */
+    u64 run_delay;                  /* Runnable but waiting for a CPU */
+    u64 run_delay_max;
+    u64 nr_run_waits;               /* Times the thread queued for a CPU */
+    u64 blocked[SCHED_BLOCK_NR];    /* Time asleep, by reason */
+    u64 nvcsw;                      /* Switches out because it blocked */
+    u64 nivcsw;                     /* Switches out while still runnable */
+};
+
 /*
  * Full register state (saved on interrupt/syscall)
  */
@@ -118,11 +161,14 @@ struct thread {
     u64 kernel_stack_size;          /* Kernel stack size */
     void *user_stack;               /* User stack (in address space) */
 
+    /* User thread state */
+    u64 fs_base;                    /* FS base (TLS thread pointer) */
+    u64 clear_tid;                  /* User u32 zeroed on exit (0 = none) */
+
     /* Timing */
     u64 start_time;                 /* Thread creation time */
-    u64 user_time;                  /* Time in user mode (ns) */
-    u64 system_time;                /* Time in kernel mode (ns) */
     u64 last_run;                   /* Last time scheduled */
+    struct thread_sched_stats sched_stats;
 
     /* Scheduler linkage */
     struct list_head run_list;      /* Link in run queue */
@@ -160,6 +206,17 @@ struct thread {
     int            ipc_reply_result;
     u64            ipc_reply_tag;
     u64            ipc_reply_regs[PROCESS_IPC_FAST_REGS];
+
+    /*
+     * Journal of our in-flight call on a supervised endpoint (holding a
+     * reference to it), kept so the kernel can replay the request if the
+     * server dies without replying. NULL otherwise; under ipc_cc_lock.
+     */
+    struct ipc_endpoint *ipc_journal_ep;
+    u64            ipc_journal_tag;
+    u64            ipc_journal_regs[PROCESS_IPC_FAST_REGS];
+
+    struct rcu_head rcu;            /* Deferred free once unpublished */
 };
 
 /*
@@ -178,6 +235,7 @@ struct process {
     /* Credentials */
     uid_t uid, euid, suid;          /* User IDs */
     gid_t gid, egid, sgid;          /* Group IDs */
+    bool privileged;                /* Devices, ports, kernel stats; see SPAWN_PRIVILEGED */
 
     /* Memory */
     struct address_space *mm;       /* Address space (NULL for kernel) */
@@ -199,14 +257,35 @@ struct process {
     /* File descriptors (placeholder for future) */
     void *files;                    /* File descriptor table */
 
-    /* IPC endpoints owned by this process (destroyed on exit) */
+    /* IPC endpoints and notifications owned by this process (destroyed on exit) */
     struct list_head owned_endpoints;
+    struct list_head owned_notifications;
+    bool ipc_closed;                /* Torn down; nothing may be handed over */
 
     /* Physical address of this process's IPC window page, or 0 if none is
      * mapped. The kernel reaches the window through the HHDM region; user
      * code reaches it at OCEAN_IPC_WINDOW_VA. */
     u64 ipc_window_phys;
 
+    /* I/O permission bitmap (see ocean/ioport.h), NULL without port access.
+     * io_bitmap_len bytes cover every port ever claimed; io_bitmap_seq
+     * changes with each claim or release. */
+    u8 *io_bitmap;
+    u32 io_bitmap_len;
+    u64 io_bitmap_seq;
+
+    /* DMA buffers mapped into this process (see ocean/dma.h), freed on
+     * exit or exec, and the pages they hold. */
+    struct list_head dma_buffers;
+    u64 dma_pages;
+
+    /* Shared memory objects mapped here (see ocean/shm.h) */
+    struct list_head shm_mappings;
+
+    /* vfork parent thread, suspended until this process execs or exits
+     * and stops borrowing its address space. NULL otherwise. */
+    struct thread *vfork_waiter;
+
     /* Process name */
     char name[16];                  /* Process name (comm) */
 
@@ -215,6 +294,8 @@ struct process {
 
     /* Global process list */
     struct list_head proc_list;
+
+    struct rcu_head rcu;            /* Deferred free once unpublished */
 };
 
 /*
@@ -251,13 +332,25 @@ void process_destroy(struct process *proc);
 /* Fork current process */
 pid_t process_fork(void);
 
+/* Create a child sharing the current address space (vfork) */
+pid_t process_vfork(void);
+
+/* Resume the vfork parent once proc stops using its address space */
+void process_vfork_release(struct process *proc);
+
+/* Copy credentials from parent and link child into its children list */
+void process_link_child(struct process *parent, struct process *child);
+
 /* Exit process */
 void process_exit(int code) __noreturn;
 
+/* Exit code of a process killed by a fault it cannot survive (128 + SIGSEGV) */
+#define EXIT_FAULT      139
+
 /* Wait for child process */
 pid_t process_wait(int *status);
 
-/* Get process by PID */
+/* Get process by PID. Caller holds rcu_read_lock() while using the result. */
 struct process *process_find(pid_t pid);
 
 /* Kill a process */
@@ -270,8 +363,15 @@ int process_kill(pid_t pid, int sig);
 /* Create a kernel thread */
 struct thread *kthread_create(int (*fn)(void *), void *arg, const char *name);
 
-/* Create a user thread in process */
-struct thread *thread_create(struct process *proc, u64 entry, u64 stack);
+/*
+ * Create an extra user thread in proc, entering at entry with arg in RDI
+ * on the given user stack. The thread is not started.
+ */
+struct thread *thread_create(struct process *proc, u64 entry, u64 arg,
+                             u64 stack_top, u64 tls);
+
+/* Make every other thread of the current process exit, and wait for them */
+void process_stop_other_threads(void);
 
 /* Start a thread (add to scheduler) */
 void thread_start(struct thread *t);
@@ -288,7 +388,7 @@ void thread_wakeup(void *channel);
 /* Thread exits */
 void thread_exit(int code) __noreturn;
 
-/* Get thread by TID */
+/* Get thread by TID. Caller holds rcu_read_lock() while using the result. */
 struct thread *thread_find(tid_t tid);
 
 /*
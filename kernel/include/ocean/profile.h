@@ -0,0 +1,67 @@
+/*
+ * Ocean Kernel - Sampling Profiler
+ *
+ * While profiling is on, every timer interrupt records where the CPU was:
+ * the interrupted RIP, privilege level, pid/tid/comm and a frame-pointer
+ * walk of the interrupted stack. Samples go into a per-CPU buffer that
+ * user space drains through SYS_PROFILE; scripts/prof2folded.py turns the
+ * dump into folded stacks for flame graphs.
+ *
+ * The sample layout is ABI: keep it in sync with
+ * lib/libocean/include/ocean/profile.h.
+ */
+
+#ifndef _OCEAN_PROFILE_H
+#define _OCEAN_PROFILE_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+#define PROFILE_MAX_FRAMES      16      /* Return addresses kept per sample */
+#define PROFILE_DEFAULT_HZ      1000
+#define PROFILE_MAX_HZ          2000    /* Rates are rounded to a multiple of HZ */
+
+/* One sample (168 bytes) */
+struct profile_sample {
+    u64 rip;                    /* Interrupted instruction */
+    u32 pid;                    /* 0 for kernel threads and early boot */
+    u32 tid;
+    u16 cpu;
+    u8 cpl;                     /* 0 = kernel, 3 = user */
+    u8 depth;                   /* Valid entries in frames[] */
+    u32 reserved;
+    char comm[16];              /* Process name, to pick the ELF to symbolize */
+    u64 frames[PROFILE_MAX_FRAMES];     /* Return addresses, innermost first */
+};
+
+/* Nonzero while sampling */
+extern u32 profile_enabled;
+
+void __profile_tick(u64 rip, u64 rbp, u8 cpl);
+
+/* Called from the timer interrupt with the interrupted context */
+static __always_inline void profile_tick(u64 rip, u64 rbp, u8 cpl)
+{
+    if (__builtin_expect(__atomic_load_n(&profile_enabled, __ATOMIC_RELAXED), 0)) {
+        __profile_tick(rip, rbp, cpl);
+    }
+}
+
+/* Start sampling at hz (0 for the default); returns the rate in use */
+i64 profile_start(u32 hz);
+
+void profile_stop(void);
+
+/* Drop everything buffered */
+void profile_reset(void);
+
+/*
+ * Copy up to max samples buffered on cpu to user buffer ubuf, oldest
+ * first, and consume them. Returns the count or negative errno.
+ */
+i64 profile_read(int cpu, void *ubuf, u64 max);
+
+/* Samples on cpu dropped because the buffer was full */
+u64 profile_lost(int cpu);
+
+#endif /* _OCEAN_PROFILE_H */
@@ -0,0 +1,112 @@
+/*
+ * Ocean Kernel - Read-Copy-Update
+ *
+ * Quiescent-state-based RCU. Readers only disable preemption, so a CPU
+ * that context-switches, or takes a tick outside any read-side section,
+ * can no longer hold a reference from before. Once every CPU has passed
+ * such a quiescent state after an object was unpublished, it is safe to
+ * free; call_rcu() queues the free until then.
+ *
+ * Read-side sections must not sleep. Spinlocks do not count as disabling
+ * preemption here, so rcu_read_unlock() never reschedules: a section may
+ * end with a lock still held. A reschedule that came due meanwhile is
+ * taken at the next preemption point (syscall exit, the idle loop).
+ */
+
+#ifndef _OCEAN_RCU_H
+#define _OCEAN_RCU_H
+
+#include <ocean/types.h>
+#include <ocean/list.h>
+
+/* From sched/core.c; not pulled in via sched.h to keep this header leaf */
+void preempt_disable(void);
+void preempt_enable_no_resched(void);
+
+struct rcu_head {
+    struct rcu_head *next;
+    void (*func)(struct rcu_head *head);
+};
+
+static inline void rcu_read_lock(void)
+{
+    preempt_disable();
+    barrier();
+}
+
+static inline void rcu_read_unlock(void)
+{
+    barrier();
+    preempt_enable_no_resched();
+}
+
+/* Read an RCU-protected pointer (pairs with rcu_assign_pointer) */
+#define rcu_dereference(p)          __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+
+/* Publish a pointer after the object it points to is initialised */
+#define rcu_assign_pointer(p, v)    __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/*
+ * RCU list helpers. Writers still serialise among themselves with a lock;
+ * readers walk the list under rcu_read_lock() only.
+ */
+static __always_inline void list_add_rcu(struct list_head *new,
+                                         struct list_head *head)
+{
+    struct list_head *next = head->next;
+
+    new->next = next;
+    new->prev = head;
+    rcu_assign_pointer(head->next, new);
+    next->prev = new;
+}
+
+static __always_inline void list_add_tail_rcu(struct list_head *new,
+                                              struct list_head *head)
+{
+    struct list_head *prev = head->prev;
+
+    new->next = head;
+    new->prev = prev;
+    rcu_assign_pointer(prev->next, new);
+    head->prev = new;
+}
+
+/*
+ * Unlink entry. Its next pointer is left intact so readers standing on it
+ * can still walk off; the entry must not be reused or freed until a grace
+ * period has passed. prev is cleared so list_unlinked_rcu() can tell.
+ */
+static __always_inline void list_del_rcu(struct list_head *entry)
+{
+    __list_del(entry->prev, entry->next);
+    entry->prev = NULL;
+}
+
+/* True if entry was removed with list_del_rcu() or never added */
+static __always_inline bool list_unlinked_rcu(const struct list_head *entry)
+{
+    return entry->prev == NULL || entry->next == entry;
+}
+
+#define list_for_each_entry_rcu(pos, head, member) \
+    for (pos = list_entry(rcu_dereference((head)->next), typeof(*pos), member); \
+         &pos->member != (head); \
+         pos = list_entry(rcu_dereference(pos->member.next), typeof(*pos), member))
+
+/* Initialise grace-period tracking */
+void rcu_init(void);
+
+/* Run func(head) once every reader that might see the object is done */
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *head));
+
+/* Sleep until a full grace period has elapsed */
+void synchronize_rcu(void);
+
+/* Quiescent-state hooks for the scheduler and the timer tick */
+void rcu_note_context_switch(void);
+void rcu_check_callbacks(bool user);
+
+void rcu_dump_stats(void);
+
+#endif /* _OCEAN_RCU_H */
@@ -11,6 +11,7 @@
 #include <ocean/list.h>
 #include <ocean/spinlock.h>
 #include <ocean/process.h>
+#include <ocean/wait.h>
 
 /*
  * Per-CPU run queue
@@ -36,15 +37,17 @@ struct run_queue {
     /* Idle thread for this CPU */
     struct thread *idle;
 
-    /* Statistics */
-    u64 switches;           /* Context switches */
-    u64 total_time;         /* Total running time */
-    u64 idle_time;          /* Time spent idle */
-
     /* CPU identification */
     int cpu_id;
 
-    /* Timer state */
+    /*
+     * Statistics and timer state, written only by the owning CPU. They
+     * start a fresh cache line so those writes do not bounce the line
+     * holding the lock and queues that remote wakers touch.
+     */
+    u64 switches __aligned(64); /* Context switches */
+    u64 total_time;         /* Total running time */
+    u64 idle_time;          /* Time spent idle */
     u64 tick_count;         /* Timer ticks */
     u64 last_tick;          /* Last tick timestamp */
 };
@@ -93,6 +96,56 @@ void sched_set_nice(struct thread *t, int nice);
 /* Wake up a thread */
 void sched_wakeup(struct thread *t);
 
+/*
+ * Scheduler accounting
+ */
+
+/*
+ * Tag the current thread with why it is about to block. An outer reason
+ * wins, so a fault that sleeps on the address-space mutex stays a fault.
+ * Returns the previous tag for sched_block_reason_restore().
+ */
+static inline int sched_block_reason_set(int reason)
+{
+    struct thread *t = current_thread;
+    int old;
+
+    if (!t) {
+        return SCHED_BLOCK_OTHER;
+    }
+    old = t->sched_stats.block_reason;
+    if (old == SCHED_BLOCK_OTHER) {
+        t->sched_stats.block_reason = (u8)reason;
+    }
+    return old;
+}
+
+static inline void sched_block_reason_restore(int old)
+{
+    if (current_thread) {
+        current_thread->sched_stats.block_reason = (u8)old;
+    }
+}
+
+/* Kernel entered from user mode: close the current user-time interval */
+static inline void sched_account_kernel_enter(void)
+{
+    struct thread *t = current_thread;
+
+    if (t && t->sched_stats.user_since) {
+        t->sched_stats.user_cycles += rdtsc() - t->sched_stats.user_since;
+        t->sched_stats.user_since = 0;
+    }
+}
+
+/* About to return to user mode */
+static inline void sched_account_kernel_exit(void)
+{
+    if (current_thread) {
+        current_thread->sched_stats.user_since = rdtsc();
+    }
+}
+
 /*
  * Context switch
  */
@@ -113,27 +166,14 @@ void preempt_disable(void);
 /* Enable preemption */
 void preempt_enable(void);
 
-/* Check if preemption is disabled */
-int preempt_count(void);
+/* Enable preemption, leaving a pending reschedule for later */
+void preempt_enable_no_resched(void);
 
-/*
- * Wait queues
- */
-struct wait_queue {
-    spinlock_t lock;
-    struct list_head head;
-};
+/* Reschedule now if one is pending; no locks may be held */
+void preempt_check_resched(void);
 
-#define DECLARE_WAIT_QUEUE(name) \
-    struct wait_queue name = { \
-        .lock = SPINLOCK_UNLOCKED, \
-        .head = LIST_HEAD_INIT(name.head) \
-    }
-
-void wait_queue_init(struct wait_queue *wq);
-void wait_event(struct wait_queue *wq);
-void wake_up(struct wait_queue *wq);
-void wake_up_all(struct wait_queue *wq);
+/* Check if preemption is disabled */
+int preempt_count(void);
 
 /*
  * Timer and time management
@@ -0,0 +1,40 @@
+/*
+ * Ocean Kernel - Per-Thread Scheduler Statistics
+ *
+ * SYS_SCHEDSTAT reports, for each thread of a process, how long it ran in
+ * user and kernel mode, how long it sat runnable waiting for a CPU, how
+ * long it slept and why, and how often it switched out voluntarily or
+ * was preempted. Times are converted from TSC cycles to nanoseconds.
+ *
+ * The record layout is ABI: keep it in sync with
+ * lib/libocean/include/ocean/schedstat.h.
+ */
+
+#ifndef _OCEAN_SCHEDSTAT_H
+#define _OCEAN_SCHEDSTAT_H
+
+#include <ocean/process.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* One thread (120 bytes) */
+struct sched_thread_info {
+    u32 tid;
+    u32 state;                      /* enum task_state */
+    u64 nvcsw;                      /* Switched out because it blocked */
+    u64 nivcsw;                     /* Switched out while runnable */
+    u64 nr_run_waits;               /* Times queued for a CPU */
+    u64 run_delay_ns;               /* Runnable but not running */
+    u64 run_delay_max_ns;
+    u64 user_ns;
+    u64 system_ns;
+    u64 blocked_ns[SCHED_BLOCK_NR]; /* Asleep, by enum sched_block_reason */
+};
+
+/*
+ * Fill user buffer ubuf with up to max records for the threads of
+ * process pid (0 for the caller's). Returns the count or negative errno.
+ */
+i64 sched_process_stats(pid_t pid, void *ubuf, u64 max);
+
+#endif /* _OCEAN_SCHEDSTAT_H */
@@ -0,0 +1,66 @@
+/*
+ * Ocean Kernel - Syscall Statistics
+ *
+ * When enabled, syscall_dispatch counts every call per syscall number and
+ * per CPU, and files the TSC cycles spent in the handler into a log2
+ * histogram. Disabled, the cost is one load and a predicted branch.
+ * SYS_SCSTAT sums the per-CPU tables for user space.
+ *
+ * The record layout is ABI: keep it in sync with
+ * lib/libocean/include/ocean/scstat.h.
+ */
+
+#ifndef _OCEAN_SCSTAT_H
+#define _OCEAN_SCSTAT_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+#define SCSTAT_HIST_BUCKETS     32
+
+/* Totals for one syscall number (288 bytes) */
+struct scstat_record {
+    u64 count;                  /* Calls entered */
+    u64 errors;                 /* Calls that returned a negative errno */
+    u64 cycles;                 /* TSC cycles across completed calls */
+    u64 max_cycles;
+    /* hist[i]: calls taking [2^i, 2^(i+1)) cycles; the last is open-ended */
+    u64 hist[SCSTAT_HIST_BUCKETS];
+};
+
+/* Nonzero while syscalls are being accounted */
+extern u32 scstat_enabled;
+
+void __scstat_enter(u64 nr);
+void __scstat_exit(u64 nr, u64 cycles, i64 ret);
+
+/* Returns the start timestamp, or 0 if accounting is off */
+static __always_inline u64 scstat_enter(u64 nr)
+{
+    if (__builtin_expect(__atomic_load_n(&scstat_enabled, __ATOMIC_RELAXED), 0)) {
+        __scstat_enter(nr);
+        return rdtsc();
+    }
+    return 0;
+}
+
+static __always_inline void scstat_exit(u64 nr, u64 start, i64 ret)
+{
+    /* start is 0 if accounting was switched on during the call */
+    if (start) {
+        __scstat_exit(nr, rdtsc() - start, ret);
+    }
+}
+
+void scstat_set_enabled(bool on);
+
+/* Zero every counter and histogram */
+void scstat_reset(void);
+
+/*
+ * Sum the per-CPU tables for syscalls first.. and copy up to max records
+ * to user buffer ubuf. Returns the count or negative errno.
+ */
+i64 scstat_read(u64 first, void *ubuf, u64 max);
+
+#endif /* _OCEAN_SCSTAT_H */
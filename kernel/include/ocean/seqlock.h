@@ -0,0 +1,102 @@
+/*
+ * Ocean Kernel - Sequence Counters and Seqlocks
+ *
+ * For small multi-word state that is read far more often than written
+ * (clock values, counters read as a set). Readers never write shared
+ * memory: they sample the sequence, copy the data and retry if a writer
+ * was active meanwhile. The sequence is odd while a write is in progress.
+ *
+ * A bare seqcount_t needs writers serialised by some other means (a single
+ * writer, or a lock the caller already holds); seqlock_t bundles a
+ * spinlock for that. Readers must copy data out, not follow pointers in
+ * it, since what they read may be torn until the retry check passes.
+ * A reader must never run in an interrupt that can land inside a write
+ * section on the same CPU, or it spins forever.
+ */
+
+#ifndef _OCEAN_SEQLOCK_H
+#define _OCEAN_SEQLOCK_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+#include <ocean/spinlock.h>
+
+typedef struct {
+    u32 sequence;
+} seqcount_t;
+
+#define SEQCNT_ZERO         { .sequence = 0 }
+
+static inline void seqcount_init(seqcount_t *s)
+{
+    s->sequence = 0;
+}
+
+/* Start a read section; waits out a write in progress */
+static inline u32 read_seqcount_begin(const seqcount_t *s)
+{
+    u32 seq;
+
+    while ((seq = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE)) & 1) {
+        cpu_pause();
+    }
+
+    return seq;
+}
+
+/* True if the data read since read_seqcount_begin() may be torn */
+static inline bool read_seqcount_retry(const seqcount_t *s, u32 start)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&s->sequence, __ATOMIC_RELAXED) != start;
+}
+
+static inline void write_seqcount_begin(seqcount_t *s)
+{
+    __atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_seqcount_end(seqcount_t *s)
+{
+    __atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Seqlock: seqcount plus a spinlock serialising writers
+ */
+typedef struct {
+    seqcount_t seqcount;
+    spinlock_t lock;
+} seqlock_t;
+
+#define SEQLOCK_INIT        { .seqcount = SEQCNT_ZERO, .lock = SPINLOCK_INIT }
+
+#define seqlock_init(sl) do { \
+        seqcount_init(&(sl)->seqcount); \
+        spin_init(&(sl)->lock); \
+    } while (0)
+
+static inline u32 read_seqbegin(const seqlock_t *sl)
+{
+    return read_seqcount_begin(&sl->seqcount);
+}
+
+static inline bool read_seqretry(const seqlock_t *sl, u32 start)
+{
+    return read_seqcount_retry(&sl->seqcount, start);
+}
+
+static inline void write_seqlock_irqsave(seqlock_t *sl, u64 *flags)
+{
+    spin_lock_irqsave(&sl->lock, flags);
+    write_seqcount_begin(&sl->seqcount);
+}
+
+static inline void write_sequnlock_irqrestore(seqlock_t *sl, u64 flags)
+{
+    write_seqcount_end(&sl->seqcount);
+    spin_unlock_irqrestore(&sl->lock, flags);
+}
+
+#endif /* _OCEAN_SEQLOCK_H */
@@ -0,0 +1,87 @@
+/*
+ * Ocean Kernel - Shared Memory Objects
+ *
+ * A shared memory object is a zeroed block of frames that any number of
+ * processes can map at once, so a server and its clients can pass bulk
+ * data or run ring buffers without copying. Objects are named by IDs;
+ * access is by grant. The creator holds every right and may grant a
+ * subset to other processes by PID, and a process holding SHM_RIGHT_GRANT
+ * may pass on what it has.
+ *
+ * An object lives while it is published or mapped: shm_destroy() (or the
+ * owner's exit) removes the ID, and the frames go once the last mapping
+ * does. Mappings are per address space; exit and exec drop them, and fork
+ * does not copy them. Grants held by an exiting process are revoked so a
+ * recycled PID inherits nothing.
+ */
+
+#ifndef _OCEAN_SHM_H
+#define _OCEAN_SHM_H
+
+#include <ocean/types.h>
+#include <ocean/list.h>
+
+struct process;
+
+#define SHM_MAX_ID          4096
+#define SHM_MAX_PAGES       1024        /* One buddy block (4 MiB) */
+#define SHM_MAX_GRANTS      16          /* Processes besides the owner */
+#define SHM_PROC_MAX_MAPS   64
+
+/* Rights */
+#define SHM_RIGHT_READ      (1 << 0)
+#define SHM_RIGHT_WRITE     (1 << 1)
+#define SHM_RIGHT_GRANT     (1 << 2)    /* Pass on own rights */
+#define SHM_RIGHTS_ALL      (SHM_RIGHT_READ | SHM_RIGHT_WRITE | SHM_RIGHT_GRANT)
+
+#define SHM_FLAG_DEAD       (1 << 0)    /* ID removed; no new lookups or maps */
+
+struct shm_grant {
+    pid_t pid;                          /* 0 = free slot */
+    u32 rights;
+};
+
+struct shm_object {
+    u32 id;
+    u32 flags;                          /* SHM_FLAG_* */
+    int refcount;                       /* The ID plus one per mapping */
+    u32 order;
+    u64 pages;
+    phys_addr_t phys;
+    struct process *owner;              /* NULL once destroyed */
+    struct shm_grant grants[SHM_MAX_GRANTS];
+    struct list_head link;              /* In the global object list */
+};
+
+struct shm_mapping {
+    struct shm_object *obj;
+    u64 virt;
+    struct list_head link;              /* In proc->shm_mappings */
+};
+
+void shm_init(void);
+
+/* Create an object of pages pages owned by proc; returns its ID */
+int shm_create(struct process *proc, u64 pages);
+
+/* Remove the ID; only the owner. Existing mappings stay valid. */
+int shm_destroy(struct process *proc, u32 id);
+
+/* Give target (a subset of) proc's rights, replacing any earlier grant */
+int shm_grant(struct process *proc, u32 id, struct process *target, u32 rights);
+
+/* Map with rights (READ, optionally WRITE); returns the address or negative errno */
+i64 shm_map(struct process *proc, u32 id, u32 rights);
+
+int shm_unmap(struct process *proc, u64 virt);
+
+/* Size in pages of an object proc may map */
+i64 shm_size(struct process *proc, u32 id);
+
+/* Drop proc's mappings once its address space is gone (exec, exit) */
+void shm_unmap_all(struct process *proc);
+
+/* Exit: drop mappings, destroy owned objects, revoke grants to proc */
+void shm_release_all(struct process *proc);
+
+#endif /* _OCEAN_SHM_H */
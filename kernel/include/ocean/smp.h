@@ -0,0 +1,36 @@
+/*
+ * Ocean Kernel - CPU Numbering
+ *
+ * Per-CPU data is an array of NR_CPUS entries indexed by
+ * smp_processor_id(). Only the boot CPU runs until SMP bring-up, so
+ * NR_CPUS is 1 and the index is the constant 0; raising it, up to the
+ * MAX_CPUS that the GDT and MADT parser are sized for, resizes every
+ * per-CPU array at once and makes the index come from this CPU's run
+ * queue.
+ */
+
+#ifndef _OCEAN_SMP_H
+#define _OCEAN_SMP_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* Maximum CPUs supported (as many as the MADT parser records) */
+#define MAX_CPUS            64
+
+/* CPUs the per-CPU arrays are sized for */
+#define NR_CPUS             1       /* Single CPU until SMP bring-up */
+
+static_assert(NR_CPUS <= MAX_CPUS, "NR_CPUS above MAX_CPUS");
+
+#if NR_CPUS == 1
+static inline int smp_processor_id(void)
+{
+    return 0;
+}
+#else
+/* this_rq()->cpu_id, or 0 before the run queues exist (sched/core.c) */
+int smp_processor_id(void);
+#endif
+
+#endif /* _OCEAN_SMP_H */
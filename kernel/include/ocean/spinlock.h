@@ -1,7 +1,7 @@
 /*
  * Ocean Kernel - Spinlock Implementation
  *
- * Simple ticket-based spinlock for SMP synchronization.
+ * Queued (MCS-style) spinlock for SMP synchronization.
  */
 
 #ifndef _OCEAN_SPINLOCK_H
@@ -11,69 +11,157 @@
 #include <ocean/defs.h>
 
 /*
- * Ticket spinlock
+ * Lock classes and statistics (CONFIG_LOCK_STAT, build with LOCK_STAT=1)
  *
- * Fair spinlock using ticket system - threads acquire lock in FIFO order.
- * Prevents starvation that can occur with simple test-and-set locks.
+ * Every lock initialised at the same site shares one class. Classes are
+ * linked into a global list the first time one of their locks is taken.
+ */
+struct lock_class {
+    const char *name;
+    const char *file;
+    int line;
+    u32 registered;
+    struct lock_class *next;
+
+    u64 acquisitions;
+    u64 contended;              /* Acquisitions that had to wait */
+    u64 spin_cycles;            /* Total TSC cycles spent waiting */
+    u64 max_hold_cycles;
+};
+
+#ifdef CONFIG_LOCK_STAT
+#define LOCK_CLASS_HERE(n) ({                                           \
+    static struct lock_class __lock_class = {                           \
+        .name = (n), .file = __FILE__, .line = __LINE__                 \
+    };                                                                  \
+    &__lock_class;                                                      \
+})
+#else
+#define LOCK_CLASS_HERE(n) ((struct lock_class *)NULL)
+#endif
+
+/*
+ * Queued spinlock
+ *
+ * The lock word holds a locked byte and the tail of a queue of waiters.
+ * An uncontended acquire is a single cmpxchg. A contended one appends a
+ * per-CPU MCS node to the queue and spins only on that node, so each
+ * waiter polls its own cache line instead of all of them hammering the
+ * lock word; the lock is still handed over in FIFO order.
  */
 typedef struct spinlock {
-    volatile u32 next_ticket;   /* Next ticket to be issued */
-    volatile u32 now_serving;   /* Currently serving ticket */
+    union {
+        volatile u32 val;
+        struct {
+            volatile u8 locked;     /* Owner holds the lock */
+            u8 pending;             /* Unused, keeps tail 16-bit aligned */
+            volatile u16 tail;      /* (cpu + 1) << 2 | nesting index */
+        };
+    };
+#ifdef CONFIG_LOCK_STAT
+    struct lock_class *class;
+    u64 acquired_at;
+#endif
 } spinlock_t;
 
+#define _Q_LOCKED_VAL       1U
+#define _Q_LOCKED_MASK      0xffU
+#define _Q_TAIL_SHIFT       16
+#define _Q_TAIL_MASK        (0xffffU << _Q_TAIL_SHIFT)
+
 /* Static initializer */
-#define SPINLOCK_INIT { .next_ticket = 0, .now_serving = 0 }
+#ifdef CONFIG_LOCK_STAT
+#define __SPINLOCK_INIT(cls) { .val = 0, .class = (cls) }
+#else
+#define __SPINLOCK_INIT(cls) { .val = 0 }
+#endif
+
+#define SPINLOCK_INIT __SPINLOCK_INIT(NULL)
+
+/* Declare and initialize a spinlock with its own lock class */
+#define DEFINE_SPINLOCK(lock) \
+    spinlock_t lock = __SPINLOCK_INIT(&((struct lock_class){ .name = #lock }))
+
+/* Slow path and statistics hooks (kernel/lib/spinlock.c) */
+void queued_spin_lock_slowpath(spinlock_t *lock);
+void lock_stat_acquired(spinlock_t *lock, u64 wait_start, bool contended);
+void lock_stat_released(spinlock_t *lock);
+void lock_stat_dump(void);
+void lock_stat_reset(void);
+
+static __always_inline void __spin_init(spinlock_t *lock, struct lock_class *class)
+{
+    lock->val = 0;
+#ifdef CONFIG_LOCK_STAT
+    lock->class = class;
+    lock->acquired_at = 0;
+#else
+    (void)class;
+#endif
+}
 
-/* Declare and initialize a spinlock */
-#define DEFINE_SPINLOCK(name) spinlock_t name = SPINLOCK_INIT
+/* Initialize a spinlock at runtime; the call site names its class */
+#define spin_init(lock) __spin_init((lock), LOCK_CLASS_HERE(#lock))
 
-/* Initialize a spinlock at runtime */
-static __always_inline void spin_init(spinlock_t *lock)
+static __always_inline bool queued_spin_trylock(spinlock_t *lock)
 {
-    lock->next_ticket = 0;
-    lock->now_serving = 0;
+    u32 expected = 0;
+
+    if (__atomic_load_n(&lock->val, __ATOMIC_RELAXED) != 0) {
+        return false;
+    }
+    return __atomic_compare_exchange_n(&lock->val, &expected, _Q_LOCKED_VAL,
+                                       false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
 }
 
 /* Acquire spinlock */
 static __always_inline void spin_lock(spinlock_t *lock)
 {
-    /* Atomically get a ticket and increment next_ticket */
-    u32 my_ticket = __atomic_fetch_add(&lock->next_ticket, 1, __ATOMIC_RELAXED);
-
-    /* Spin until our ticket is called */
-    while (__atomic_load_n(&lock->now_serving, __ATOMIC_ACQUIRE) != my_ticket) {
-        cpu_pause();
+    u32 expected = 0;
+#ifdef CONFIG_LOCK_STAT
+    u64 wait_start = rdtsc();
+    bool contended = false;
+#endif
+
+    if (!__atomic_compare_exchange_n(&lock->val, &expected, _Q_LOCKED_VAL,
+                                     false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        queued_spin_lock_slowpath(lock);
+#ifdef CONFIG_LOCK_STAT
+        contended = true;
+#endif
     }
+
+#ifdef CONFIG_LOCK_STAT
+    lock_stat_acquired(lock, wait_start, contended);
+#endif
 }
 
 /* Release spinlock */
 static __always_inline void spin_unlock(spinlock_t *lock)
 {
-    /* Increment now_serving to let next waiter proceed */
-    __atomic_fetch_add(&lock->now_serving, 1, __ATOMIC_RELEASE);
+#ifdef CONFIG_LOCK_STAT
+    lock_stat_released(lock);
+#endif
+    /* Only the locked byte; queued waiters keep their tail */
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
 }
 
 /* Try to acquire spinlock (non-blocking) */
 static __always_inline bool spin_trylock(spinlock_t *lock)
 {
-    u32 ticket = __atomic_load_n(&lock->next_ticket, __ATOMIC_RELAXED);
-    u32 serving = __atomic_load_n(&lock->now_serving, __ATOMIC_RELAXED);
-
-    /* Lock is free if next_ticket == now_serving */
-    if (ticket != serving) {
+    if (!queued_spin_trylock(lock)) {
         return false;
     }
-
-    /* Try to acquire the ticket */
-    return __atomic_compare_exchange_n(&lock->next_ticket, &ticket, ticket + 1,
-                                       false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+#ifdef CONFIG_LOCK_STAT
+    lock_stat_acquired(lock, 0, false);
+#endif
+    return true;
 }
 
 /* Check if lock is held (for debugging) */
 static __always_inline bool spin_is_locked(spinlock_t *lock)
 {
-    return __atomic_load_n(&lock->next_ticket, __ATOMIC_RELAXED) !=
-           __atomic_load_n(&lock->now_serving, __ATOMIC_RELAXED);
+    return __atomic_load_n(&lock->val, __ATOMIC_RELAXED) != 0;
 }
 
 /*
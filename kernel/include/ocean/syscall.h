@@ -24,14 +24,23 @@
 #define SYS_WAIT            3
 #define SYS_GETPID          4
 #define SYS_GETPPID         5
+#define SYS_SPAWN           6
+#define SYS_VFORK           7
 
 /* Implemented thread control */
 #define SYS_YIELD           10
+#define SYS_THREAD_CREATE   12
+#define SYS_THREAD_EXIT     13
+#define SYS_SET_TLS         14
+#define SYS_FUTEX           15
 
 /* Reserved / unimplemented thread control */
 #define SYS_SLEEP           11
-#define SYS_THREAD_CREATE   12
-#define SYS_THREAD_EXIT     13
+
+/* SYS_FUTEX operations */
+#define FUTEX_WAIT          0       /* Sleep if *uaddr == val */
+#define FUTEX_WAKE          1       /* Wake up to val waiters */
+#define FUTEX_PRIVATE_FLAG  128     /* Word is not in shared memory */
 
 /* Reserved / unimplemented memory management */
 #define SYS_BRK             20
@@ -58,6 +67,28 @@
 #define SEEK_CUR            1
 #define SEEK_END            2
 
+/*
+ * SYS_SPAWN file actions, applied in order to the child's copy of the
+ * caller's file table before the child first runs. fds 0-2 start out as
+ * the console and may be closed or redirected like any other.
+ */
+#define SPAWN_FA_CLOSE          1   /* close(fd) */
+#define SPAWN_FA_DUP2           2   /* dup2(fd, newfd) */
+#define SPAWN_FA_OPEN           3   /* newfd = open(path, flags) */
+
+#define SPAWN_MAX_FILE_ACTIONS  16
+
+/* SYS_SPAWN flags */
+#define SPAWN_PRIVILEGED        (1 << 0)    /* Child is privileged; caller must be */
+
+struct spawn_file_action {
+    u32 op;                 /* SPAWN_FA_* */
+    i32 fd;                 /* Source fd (CLOSE, DUP2) */
+    i32 newfd;              /* Target fd (DUP2, OPEN) */
+    u32 flags;              /* O_* flags (OPEN) */
+    u64 path;               /* User pointer to path (OPEN) */
+};
+
 /* Implemented IPC */
 #define SYS_IPC_SEND        50
 #define SYS_IPC_RECV        51
@@ -67,6 +98,9 @@
 #define SYS_IPC_REPLY       53
 #define SYS_IPC_REPLY_RECV  54
 
+/* PID of the caller we owe a reply */
+#define SYS_IPC_CALLER      55
+
 /* Implemented endpoint management */
 #define SYS_ENDPOINT_CREATE 60
 #define SYS_ENDPOINT_DESTROY 61
@@ -80,14 +114,104 @@
 /* Explicit well-known endpoint claim (id in [EP_WKE_MIN, EP_WKE_MAX]) */
 #define SYS_ENDPOINT_CREATE_WKE 66
 
-/* Reserved / unimplemented notifications */
+/* Notifications */
 #define SYS_NOTIFY_SIGNAL   70
 #define SYS_NOTIFY_WAIT     71
 #define SYS_NOTIFY_POLL     72
+#define SYS_NOTIFY_CREATE   73
+#define SYS_NOTIFY_DESTROY  74
+
+/* Device access */
+#define SYS_PCI             80
+#define SYS_IRQ             81
+#define SYS_IOPORT          82
+#define SYS_DMA             83
+#define SYS_SHM             84
+#define SYS_PAGER           85
+#define SYS_RS              86
 
 /* Debugging/testing */
+#define SYS_SCHEDSTAT       94
+#define SYS_SCSTAT          95
+#define SYS_PROFILE         96
+#define SYS_TRACE           97
+#define SYS_KSTAT           98
 #define SYS_DEBUG_PRINT     99
 
+/* SYS_KSTAT selectors; the report goes to the kernel console */
+#define KSTAT_LOCKS         0       /* Spinlock class statistics */
+#define KSTAT_BENCH         1       /* Run the in-kernel allocator benchmarks; privileged */
+#define KSTAT_BOOT          2       /* Boot phase timings, as BENCH lines */
+
+/* SYS_KSTAT flags */
+#define KSTAT_RESET         (1 << 0)    /* Zero the counters after dumping */
+
+/* SYS_TRACE operations (see ocean/trace.h for the record format); all but
+ * CLOCK are privileged only */
+#define TRACE_CTL_START     0       /* arg: event mask, 0 for all events */
+#define TRACE_CTL_STOP      1
+#define TRACE_CTL_READ      2       /* arg: cpu; fills buf with up to count records */
+#define TRACE_CTL_RESET     3       /* Discard buffered records */
+#define TRACE_CTL_CLOCK     4       /* Returns TSC ticks per second */
+#define TRACE_CTL_LOST      5       /* arg: cpu; returns records overwritten unread */
+
+/* SYS_PROFILE operations (see ocean/profile.h for the sample format);
+ * privileged only */
+#define PROFILE_CTL_START   0       /* arg: sample rate in Hz, 0 for the default */
+#define PROFILE_CTL_STOP    1
+#define PROFILE_CTL_READ    2       /* arg: cpu; fills buf with up to count samples */
+#define PROFILE_CTL_RESET   3       /* Discard buffered samples */
+#define PROFILE_CTL_LOST    4       /* arg: cpu; returns samples dropped while full */
+
+/* SYS_SCSTAT operations (see ocean/scstat.h for the record format); all
+ * but CLOCK are privileged only */
+#define SCSTAT_CTL_START    0       /* Start counting syscalls and timing handlers */
+#define SCSTAT_CTL_STOP     1
+#define SCSTAT_CTL_READ     2       /* arg: first syscall; fills buf with up to count records */
+#define SCSTAT_CTL_RESET    3       /* Zero all counters and histograms */
+#define SCSTAT_CTL_CLOCK    4       /* Returns TSC ticks per second */
+
+/* SYS_PCI operations (see ocean/pci.h for the record format and BDF encoding) */
+#define PCI_CTL_LIST        0       /* Fill buf with up to count devices; returns the total */
+#define PCI_CTL_READ        1       /* Config read of width 1/2/4 at offset; returns the value */
+#define PCI_CTL_WRITE       2       /* Config write by the claim holder; not BARs, ROM, bridge windows */
+#define PCI_CTL_CLAIM       3       /* Take the device for the calling driver; privileged only */
+#define PCI_CTL_RELEASE     4
+
+/* SYS_IRQ operations (see ocean/irq.h for sources and the info record) */
+#define IRQ_CTL_BIND        0       /* source, arg, notification, bit, flags or nvec; returns the ID */
+#define IRQ_CTL_UNBIND      1       /* id */
+#define IRQ_CTL_ACK         2       /* id, queue mask: unmask the queues handled */
+#define IRQ_CTL_TRIGGER     3       /* id, queue: raise it on this CPU (not ISA sources) */
+#define IRQ_CTL_INFO        4       /* id, buf */
+
+/* SYS_IOPORT operations: direct in/out on port ranges */
+#define IOPORT_CTL_CLAIM    0       /* base, count: open the ports to a privileged caller */
+#define IOPORT_CTL_RELEASE  1       /* base, count as claimed */
+
+/* SYS_DMA operations: memory server only, acting on the client it is answering */
+#define DMA_CTL_ALLOC       0       /* pages, cache type, struct dma_region out */
+#define DMA_CTL_FREE        1       /* phys of a client buffer; returns its pages */
+
+/* SYS_SHM operations (see ocean/shm.h for rights) */
+#define SHM_CTL_CREATE      0       /* pages; returns the ID */
+#define SHM_CTL_DESTROY     1       /* id; owner only */
+#define SHM_CTL_GRANT       2       /* id, pid (0 = the IPC caller being served), rights */
+#define SHM_CTL_MAP         3       /* id, rights; returns the address */
+#define SHM_CTL_UNMAP       4       /* address */
+#define SHM_CTL_SIZE        5       /* id; returns the pages */
+
+/* SYS_PAGER operations (see ocean/pager.h; fault messages in ocean/ipc_proto.h) */
+#define PAGER_CTL_MAP       0       /* endpoint, pages, prot, cookie: region in the IPC caller */
+#define PAGER_CTL_SUPPLY    1       /* id, offset, src, pages: fill the faulting caller's region */
+#define PAGER_CTL_UNMAP     2       /* address: drop one of the caller's own regions */
+
+/* SYS_RS operations: supervised endpoints (see ocean/ipc.h) */
+#define RS_CTL_SUPERVISE    0       /* ep, standby pid (0 = none); owner or EP_RS owner */
+#define RS_CTL_RELEASE      1       /* ep; owner or EP_RS owner */
+#define RS_CTL_HANDOVER     2       /* ep, pid: give an endpoint we own away */
+#define RS_CTL_PARK         3       /* ep: sleep until we own it */
+
 /* Maximum syscall number */
 #define NR_SYSCALLS         128
 
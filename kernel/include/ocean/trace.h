@@ -0,0 +1,122 @@
+/*
+ * Ocean Kernel - Static Tracepoints
+ *
+ * Events are declared once in TRACE_EVENT_LIST and each gets a typed
+ * trace_<name>() helper. A disabled event costs one load and a predicted
+ * branch. Enabled events are written, with a TSC timestamp, into a per-CPU
+ * ring buffer that user space drains through SYS_TRACE.
+ *
+ * The record layout and event numbers are ABI: keep them in sync with
+ * lib/libocean/include/ocean/trace.h.
+ */
+
+#ifndef _OCEAN_TRACE_H
+#define _OCEAN_TRACE_H
+
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/*
+ * E(ID, name, arg0, arg1, arg2): argument names are for dumps; "" if unused
+ */
+#define TRACE_EVENT_LIST(E) \
+    E(SCHED_SWITCH,  sched_switch,  "prev",   "next",  "prev_state") \
+    E(SCHED_WAKEUP,  sched_wakeup,  "tid",    "cpu",   "") \
+    E(IPC_SEND,      ipc_send,      "ep",     "tag",   "op") \
+    E(IPC_RECV,      ipc_recv,      "ep",     "tag",   "result") \
+    E(IPC_REPLY,     ipc_reply,     "caller", "tag",   "result") \
+    E(PAGE_FAULT,    page_fault,    "addr",   "error", "rip") \
+    E(SYSCALL_ENTER, syscall_enter, "nr",     "arg1",  "arg2") \
+    E(SYSCALL_EXIT,  syscall_exit,  "nr",     "ret",   "") \
+    E(KMALLOC,       kmalloc,       "ptr",    "size",  "") \
+    E(KFREE,         kfree,         "ptr",    "",      "")
+
+#define __TRACE_ENUM(id, name, a0, a1, a2) TRACE_##id,
+enum trace_event {
+    TRACE_NONE = 0,             /* Marks a slot that is not yet written */
+    TRACE_EVENT_LIST(__TRACE_ENUM)
+    TRACE_NR_EVENTS
+};
+#undef __TRACE_ENUM
+
+/* One buffered event (40 bytes) */
+struct trace_record {
+    u64 tsc;                    /* rdtsc() when the event fired */
+    u16 event;                  /* enum trace_event */
+    u16 cpu;
+    u32 tid;                    /* Current thread, 0 before threads exist */
+    u64 args[3];
+};
+
+/* Bit (1 << event) set: event is recorded */
+extern u64 trace_event_mask;
+
+static __always_inline bool trace_event_enabled(int event)
+{
+    return __builtin_expect((__atomic_load_n(&trace_event_mask, __ATOMIC_RELAXED)
+                             >> event) & 1, 0);
+}
+
+void __trace_record(int event, u64 a0, u64 a1, u64 a2);
+
+#define DEFINE_TRACE_EVENT(name, id, proto, a0, a1, a2) \
+    static __always_inline void trace_##name proto \
+    { \
+        if (trace_event_enabled(TRACE_##id)) { \
+            __trace_record(TRACE_##id, (u64)(a0), (u64)(a1), (u64)(a2)); \
+        } \
+    }
+
+DEFINE_TRACE_EVENT(sched_switch, SCHED_SWITCH,
+                   (int prev_tid, int next_tid, int prev_state),
+                   prev_tid, next_tid, prev_state)
+DEFINE_TRACE_EVENT(sched_wakeup, SCHED_WAKEUP,
+                   (int tid, int cpu),
+                   tid, cpu, 0)
+DEFINE_TRACE_EVENT(ipc_send, IPC_SEND,
+                   (u32 ep_id, u64 tag, int op),
+                   ep_id, tag, op)
+DEFINE_TRACE_EVENT(ipc_recv, IPC_RECV,
+                   (u32 ep_id, u64 tag, int result),
+                   ep_id, tag, result)
+DEFINE_TRACE_EVENT(ipc_reply, IPC_REPLY,
+                   (int caller_tid, u64 tag, int result),
+                   caller_tid, tag, result)
+DEFINE_TRACE_EVENT(page_fault, PAGE_FAULT,
+                   (u64 addr, u64 error_code, u64 rip),
+                   addr, error_code, rip)
+DEFINE_TRACE_EVENT(syscall_enter, SYSCALL_ENTER,
+                   (u64 nr, u64 arg1, u64 arg2),
+                   nr, arg1, arg2)
+DEFINE_TRACE_EVENT(syscall_exit, SYSCALL_EXIT,
+                   (u64 nr, i64 ret),
+                   nr, ret, 0)
+DEFINE_TRACE_EVENT(kmalloc, KMALLOC,
+                   (void *ptr, size_t size),
+                   ptr, size, 0)
+DEFINE_TRACE_EVENT(kfree, KFREE,
+                   (void *ptr),
+                   ptr, 0, 0)
+
+/* Set the enabled-event mask (0 stops tracing) */
+void trace_set_mask(u64 mask);
+
+/* Drop everything buffered */
+void trace_reset(void);
+
+/*
+ * Copy up to max records buffered on cpu to user buffer ubuf, oldest
+ * first, and consume them. Returns the count or negative errno.
+ */
+i64 trace_read(int cpu, void *ubuf, u64 max);
+
+/* Records on cpu that were overwritten before being read */
+u64 trace_lost(int cpu);
+
+/* TSC ticks per second, measured against the timer tick (0 if unknown) */
+u64 trace_tsc_hz(void);
+
+/* Record the clock reference; call once the timer is running */
+void trace_init(void);
+
+#endif /* _OCEAN_TRACE_H */
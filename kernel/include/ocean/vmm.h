@@ -13,6 +13,8 @@
 #include <ocean/defs.h>
 #include <ocean/list.h>
 #include <ocean/spinlock.h>
+#include <ocean/mutex.h>
+#include <ocean/percpu_counter.h>
 
 /* Forward declaration */
 struct page;
@@ -28,6 +30,7 @@ struct page;
 #define PTE_ACCESSED    (1ULL << 5)   /* Page has been accessed */
 #define PTE_DIRTY       (1ULL << 6)   /* Page has been written */
 #define PTE_HUGE        (1ULL << 7)   /* Huge page (2MB/1GB) */
+#define PTE_PAT         (1ULL << 7)   /* PAT index bit 2 (4 KiB PTEs only) */
 #define PTE_GLOBAL      (1ULL << 8)   /* Global page (not flushed on CR3 switch) */
 #define PTE_NX          (1ULL << 63)  /* No-execute bit */
 
@@ -35,6 +38,13 @@ struct page;
 #define PTE_COW         (1ULL << 9)   /* Copy-on-write page */
 #define PTE_SWAP        (1ULL << 10)  /* Page is swapped out */
 
+/*
+ * Memory types of 4 KiB pages, selected through the PAT (see paging.c).
+ * A page with neither is write-back.
+ */
+#define PTE_CACHE_UC    (PTE_PCD | PTE_PWT)     /* PAT entry 3: uncached */
+#define PTE_CACHE_WC    (PTE_PAT | PTE_PWT)     /* PAT entry 5: write-combining */
+
 /* Page table address mask (bits 12-51 for physical address) */
 #define PTE_ADDR_MASK   0x000FFFFFFFFFF000ULL
 
@@ -93,6 +103,10 @@ typedef u64 pml4e_t;    /* PML4 entry */
 #define VMA_HEAP        (1 << 5)
 #define VMA_ANONYMOUS   (1 << 6)
 #define VMA_FILE        (1 << 7)
+#define VMA_PINNED      (1 << 8)    /* Frames owned elsewhere: never freed, not inherited */
+#define VMA_UNCACHED    (1 << 9)
+#define VMA_WC          (1 << 10)   /* Write-combining */
+#define VMA_PAGER       (1 << 11)   /* Filled by an external pager (ocean/pager.h) */
 
 struct vm_area {
     u64 start;                  /* Start virtual address */
@@ -124,7 +138,7 @@ struct address_space {
     u64 total_vm;               /* Total pages mapped */
     u64 shared_vm;              /* Shared pages */
 
-    spinlock_t lock;            /* Protects this structure */
+    struct mutex lock;          /* Protects VMAs and ref_count; sleeps */
     u32 ref_count;              /* Reference count */
 };
 
@@ -165,6 +179,9 @@ phys_addr_t paging_get_phys(pml4e_t *pml4, u64 virt);
 /* Get the PTE for a virtual address (returns NULL if not mapped) */
 pte_t *paging_get_pte(pml4e_t *pml4, u64 virt);
 
+/* Map device memory uncached into the HHDM; returns its virtual address */
+void *paging_map_mmio(phys_addr_t phys, u64 size);
+
 /* Switch to a different address space */
 void paging_switch(struct address_space *as);
 
@@ -199,7 +216,10 @@ struct address_space *vmm_create_address_space(void);
 /* Clone an address space (for fork) */
 struct address_space *vmm_clone_address_space(struct address_space *src);
 
-/* Destroy an address space */
+/* Take an extra reference on an address space (for vfork) */
+struct address_space *vmm_get_address_space(struct address_space *as);
+
+/* Drop a reference; the address space is freed with the last one */
 void vmm_destroy_address_space(struct address_space *as);
 
 /* Find VMA containing an address */
@@ -211,10 +231,16 @@ int vmm_map_region(struct address_space *as, u64 start, u64 size, u32 flags);
 /* Unmap a region */
 int vmm_unmap_region(struct address_space *as, u64 start, u64 size);
 
+/* Add a region with no frames; its pages come in on fault */
+int vmm_reserve_region(struct address_space *as, u64 start, u64 size, u32 flags);
+
 /* Map kernel memory into user space */
 int vmm_map_to_user(struct address_space *as, u64 virt, phys_addr_t phys,
                     u64 size, u32 flags);
 
+/* Find a free user range of size bytes; (u64)-1 if there is none */
+u64 vmm_get_unmapped_area(struct address_space *as, u64 size);
+
 /* Allocate virtual memory (mmap-like) */
 u64 vmm_mmap(struct address_space *as, u64 hint, u64 size, u32 prot, u32 flags);
 
@@ -224,6 +250,25 @@ int vmm_munmap(struct address_space *as, u64 addr, u64 size);
 /* Change page protection */
 int vmm_mprotect(struct address_space *as, u64 addr, u64 size, u32 prot);
 
+/*
+ * Kernel stacks (guarded, cached; see mm/kstack.c)
+ */
+
+/* Map the stack region and prefill the cache. Call before any process exists. */
+void kstack_cache_init(void);
+
+/* Allocate a KERNEL_STACK_SIZE stack; reused stacks are not re-zeroed */
+void *kstack_alloc(void);
+
+/* Return a stack to the per-CPU cache */
+void kstack_free(void *stack);
+
+/* Check whether an address is in a kernel stack guard region */
+bool kstack_is_guard(u64 addr);
+
+/* Print stack cache statistics */
+void kstack_dump_stats(void);
+
 /*
  * Page Fault Handler
  */
@@ -235,7 +280,10 @@ int vmm_mprotect(struct address_space *as, u64 addr, u64 size, u32 prot);
 #define PF_RESERVED     (1 << 3)  /* Reserved bit set in PTE */
 #define PF_INSTR        (1 << 4)  /* Instruction fetch */
 
-/* Handle a page fault */
+/*
+ * Handle a page fault. -EFAULT means a pager failed to supply a user
+ * page, which kills the faulting process; any other failure is fatal.
+ */
 int vmm_page_fault(u64 fault_addr, u64 error_code);
 
 /* Track current CPU's active address space for fault handling */
@@ -282,10 +330,10 @@ struct slab_cache {
     struct list_head slabs_partial; /* Partially full slabs */
     struct list_head slabs_free;    /* Empty slabs */
 
-    u64 total_allocs;           /* Total allocations */
-    u64 total_frees;            /* Total frees */
-    u64 active_objs;            /* Currently allocated objects */
-    u64 total_slabs;            /* Total slab count */
+    struct percpu_counter total_allocs; /* Total allocations */
+    struct percpu_counter total_frees;  /* Total frees */
+    struct percpu_counter active_objs;  /* Currently allocated objects */
+    struct percpu_counter total_slabs;  /* Total slab count */
 
     spinlock_t lock;
     struct list_head cache_list; /* Link in global cache list */
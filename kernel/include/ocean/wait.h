@@ -0,0 +1,42 @@
+/*
+ * Ocean Kernel - Wait Queues
+ *
+ * A list of sleeping threads. wait_event() sleeps unconditionally; code
+ * that must re-check a condition after queueing (to avoid a lost wakeup)
+ * brackets the check with prepare_to_wait()/finish_wait() instead.
+ */
+
+#ifndef _OCEAN_WAIT_H
+#define _OCEAN_WAIT_H
+
+#include <ocean/types.h>
+#include <ocean/list.h>
+#include <ocean/spinlock.h>
+
+struct wait_queue {
+    spinlock_t lock;
+    struct list_head head;
+};
+
+#define WAIT_QUEUE_INIT(name) { \
+        .lock = SPINLOCK_INIT, \
+        .head = LIST_HEAD_INIT(name.head) \
+    }
+
+#define DECLARE_WAIT_QUEUE(name) \
+    struct wait_queue name = WAIT_QUEUE_INIT(name)
+
+void wait_queue_init(struct wait_queue *wq);
+void wait_event(struct wait_queue *wq);
+void wake_up(struct wait_queue *wq);
+void wake_up_all(struct wait_queue *wq);
+
+/*
+ * Queue the current thread and set its state, but do not sleep yet. The
+ * caller re-checks its condition, calls schedule() if it still has to
+ * wait, and then finish_wait() either way.
+ */
+void prepare_to_wait(struct wait_queue *wq, int state);
+void finish_wait(struct wait_queue *wq);
+
+#endif /* _OCEAN_WAIT_H */
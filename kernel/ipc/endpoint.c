@@ -18,9 +18,12 @@ extern void *kmalloc(size_t size);
 extern void kfree(void *ptr);
 extern void *memset(void *s, int c, size_t n);
 
-/* Global endpoint list */
+/*
+ * Global endpoint list. endpoint_list_lock serialises writers; endpoint_get
+ * searches it under rcu_read_lock() and endpoints are freed via call_rcu.
+ */
 static struct list_head endpoint_list = LIST_HEAD_INIT(endpoint_list);
-static spinlock_t endpoint_list_lock = SPINLOCK_INIT;
+static DEFINE_SPINLOCK(endpoint_list_lock);
 
 /*
  * Endpoint ID counter. IDs in [EP_WKE_MIN, EP_WKE_MAX] are reserved for
@@ -129,7 +132,7 @@ struct ipc_endpoint *endpoint_create(struct process *owner, u32 flags)
     }
 
     spin_lock(&endpoint_list_lock);
-    list_add(&ep->list, &endpoint_list);
+    list_add_rcu(&ep->list, &endpoint_list);
     spin_unlock(&endpoint_list_lock);
 
     link_to_owner(ep);
@@ -165,7 +168,7 @@ struct ipc_endpoint *endpoint_create_well_known(struct process *owner,
         kfree(ep);
         return NULL;
     }
-    list_add(&ep->list, &endpoint_list);
+    list_add_rcu(&ep->list, &endpoint_list);
     spin_unlock(&endpoint_list_lock);
 
     link_to_owner(ep);
@@ -207,6 +210,11 @@ void endpoint_destroy(struct ipc_endpoint *ep)
         struct list_head *node = ep->send_queue.next;
         struct ipc_wait *wait = container_of(node, struct ipc_wait, wait_list);
         list_del_init(node);
+        if (wait->operation == IPC_OP_REPLAY) {
+            /* Nobody sleeps on it; its caller waits for a reply */
+            ipc_replay_cancel(wait);
+            continue;
+        }
         wait->result = IPC_ERR_DEAD;
         if (wait->partner) {
             sched_wakeup(wait->partner);
@@ -226,11 +234,13 @@ void endpoint_destroy(struct ipc_endpoint *ep)
 
     spin_unlock(&ep->lock);
 
+    /* And a standby parked on it */
+    thread_wakeup(ep);
+
     if (remove_from_list) {
+        /* EP_FLAG_LISTED guarantees we are the only one unlinking */
         spin_lock(&endpoint_list_lock);
-        if (!list_empty(&ep->list)) {
-            list_del_init(&ep->list);
-        }
+        list_del_rcu(&ep->list);
         spin_unlock(&endpoint_list_lock);
 
         unlink_from_owner(ep);
@@ -246,11 +256,118 @@ void endpoint_destroy(struct ipc_endpoint *ep)
 }
 
 /*
- * Destroy every endpoint whose owner is the given process.
+ * Make to the owner of ep, which is on no owner list. The endpoint keeps
+ * its id and both queues, and a thread of to parked on it wakes. Fails if
+ * ep is dead or to has torn down its endpoints already.
+ */
+static int endpoint_adopt(struct ipc_endpoint *ep, struct process *to)
+{
+    int err = 0;
+    u64 flags;
+
+    spin_lock(&ep->lock);
+    if (ep->flags & EP_FLAG_DEAD) {
+        spin_unlock(&ep->lock);
+        return -ENOENT;
+    }
+
+    spin_lock_irqsave(&to->lock, &flags);
+    if (to->ipc_closed) {
+        err = -ESRCH;
+    } else {
+        list_add_tail(&ep->owner_link, &to->owned_endpoints);
+        ep->owner = to;
+    }
+    spin_unlock_irqrestore(&to->lock, flags);
+    spin_unlock(&ep->lock);
+
+    if (!err) {
+        thread_wakeup(ep);
+    }
+
+    return err;
+}
+
+/*
+ * Hand a supervised endpoint whose owner is exiting to its standby, or
+ * failing that its supervisor. The standby is used up either way. Returns
+ * false if there is no heir to take it.
+ */
+static bool endpoint_pass_on(struct ipc_endpoint *ep, struct process *dying)
+{
+    pid_t heirs[2];
+
+    spin_lock(&ep->lock);
+    if (!(ep->flags & EP_FLAG_SUPERVISED)) {
+        spin_unlock(&ep->lock);
+        return false;
+    }
+    heirs[0] = ep->standby;
+    heirs[1] = ep->supervisor;
+    ep->standby = 0;
+    spin_unlock(&ep->lock);
+
+    for (int i = 0; i < 2; i++) {
+        struct process *heir;
+        bool adopted = false;
+
+        if (!heirs[i] || heirs[i] == dying->pid) {
+            continue;
+        }
+
+        rcu_read_lock();
+        heir = process_find(heirs[i]);
+        if (heir) {
+            adopted = endpoint_adopt(ep, heir) == 0;
+        }
+        rcu_read_unlock();
+
+        if (adopted) {
+            kprintf("[ipc] Endpoint %u passed from PID %d to %s PID %d\n",
+                    ep->id, dying->pid, i == 0 ? "standby" : "supervisor",
+                    heirs[i]);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Forget a torn-down process as heir of any supervised endpoint, so a
+ * process that later reuses its pid inherits nothing. Runs after
+ * ipc_closed is set: endpoint_supervise checks that flag under ep->lock,
+ * so it either sees it or its heir is cleared here.
+ */
+static void endpoint_forget_heir(struct process *proc)
+{
+    struct ipc_endpoint *ep;
+
+    rcu_read_lock();
+    list_for_each_entry_rcu(ep, &endpoint_list, list) {
+        spin_lock(&ep->lock);
+        if (ep->standby == proc->pid) {
+            ep->standby = 0;
+        }
+        if (ep->supervisor == proc->pid) {
+            ep->supervisor = 0;
+        }
+        if (!ep->standby && !ep->supervisor) {
+            ep->flags &= ~EP_FLAG_SUPERVISED;
+        }
+        spin_unlock(&ep->lock);
+    }
+    rcu_read_unlock();
+}
+
+/*
+ * Destroy every endpoint whose owner is the given process, then its
+ * notifications (which releases the IRQs bound to them).
  *
  * Used during process teardown so dead servers do not leak endpoint IDs
  * (especially well-known ones) and their waiters are woken with IPC_ERR_DEAD
- * instead of blocking forever.
+ * instead of blocking forever. Supervised endpoints are passed on instead,
+ * and the process stops being heir to anyone else's.
  */
 void ipc_destroy_owned_by_process(struct process *proc)
 {
@@ -263,6 +380,8 @@ void ipc_destroy_owned_by_process(struct process *proc)
 
         u64 flags;
         spin_lock_irqsave(&proc->lock, &flags);
+        /* No handover may land here once we start draining */
+        proc->ipc_closed = true;
         if (!list_empty(&proc->owned_endpoints)) {
             ep = list_first_entry(&proc->owned_endpoints,
                                   struct ipc_endpoint, owner_link);
@@ -277,35 +396,199 @@ void ipc_destroy_owned_by_process(struct process *proc)
             break;
         }
 
-        endpoint_destroy(ep);
+        if (!endpoint_pass_on(ep, proc)) {
+            endpoint_destroy(ep);
+        }
         endpoint_put(ep);
     }
+
+    endpoint_forget_heir(proc);
+    notification_destroy_owned_by_process(proc);
+}
+
+/* Heir's pid, or 0 if there is none or it has torn down its IPC */
+static pid_t endpoint_heir_pid(struct process *heir)
+{
+    pid_t pid = 0;
+    u64 flags;
+
+    if (!heir) {
+        return 0;
+    }
+
+    spin_lock_irqsave(&heir->lock, &flags);
+    if (!heir->ipc_closed) {
+        pid = heir->pid;
+    }
+    spin_unlock_irqrestore(&heir->lock, flags);
+    return pid;
+}
+
+/*
+ * Set who inherits ep if its owner exits: standby (if not NULL) once, and
+ * supervisor after that. A NULL supervisor ends supervision. Heirs are
+ * kept by pid and forgotten when they exit; one already exiting is
+ * refused.
+ */
+int endpoint_supervise(struct ipc_endpoint *ep, struct process *supervisor,
+                       struct process *standby)
+{
+    pid_t supervisor_pid;
+    pid_t standby_pid;
+
+    spin_lock(&ep->lock);
+    if (ep->flags & EP_FLAG_DEAD) {
+        spin_unlock(&ep->lock);
+        return -ENOENT;
+    }
+
+    supervisor_pid = endpoint_heir_pid(supervisor);
+    standby_pid = supervisor_pid ? endpoint_heir_pid(standby) : 0;
+    if ((supervisor && !supervisor_pid) || (standby && !standby_pid)) {
+        spin_unlock(&ep->lock);
+        return -ESRCH;
+    }
+
+    if (supervisor_pid) {
+        ep->flags |= EP_FLAG_SUPERVISED;
+    } else {
+        ep->flags &= ~EP_FLAG_SUPERVISED;
+    }
+    ep->supervisor = supervisor_pid;
+    ep->standby = standby_pid;
+    spin_unlock(&ep->lock);
+
+    kprintf("[ipc] Endpoint %u supervised by PID %d, standby PID %d\n",
+            ep->id, supervisor_pid, standby_pid);
+    return 0;
+}
+
+/*
+ * Move ep from its owner from to the process to
+ */
+int endpoint_handover(struct ipc_endpoint *ep, struct process *from,
+                      struct process *to)
+{
+    bool owned = false;
+    u64 flags;
+    int err;
+
+    if (from == to) {
+        return 0;
+    }
+
+    spin_lock_irqsave(&from->lock, &flags);
+    if (ep->owner == from && !list_empty(&ep->owner_link)) {
+        list_del_init(&ep->owner_link);
+        owned = true;
+    }
+    spin_unlock_irqrestore(&from->lock, flags);
+
+    if (!owned) {
+        return -EPERM;
+    }
+
+    err = endpoint_adopt(ep, to);
+    if (err < 0) {
+        /* Keep it, unless it died meanwhile */
+        endpoint_adopt(ep, from);
+        return err;
+    }
+
+    kprintf("[ipc] Endpoint %u handed from PID %d to PID %d\n",
+            ep->id, from->pid, to->pid);
+    return 0;
+}
+
+/*
+ * Sleep until the current process owns ep. The sleep is armed under
+ * ep->lock, under which endpoint_adopt and endpoint_destroy change what we
+ * check, so their wakeup after unlocking cannot slip in between the check
+ * and the sleep.
+ */
+int endpoint_park(struct ipc_endpoint *ep)
+{
+    struct thread *self = get_current();
+    int err = 0;
+
+    int reason = sched_block_reason_set(SCHED_BLOCK_IPC);
+    for (;;) {
+        spin_lock(&ep->lock);
+        if (ep->owner == self->process) {
+            break;
+        }
+        if (ep->flags & EP_FLAG_DEAD) {
+            err = -ENOENT;
+            break;
+        }
+        if (self->flags & TF_GROUP_EXIT) {
+            err = -EINTR;
+            break;
+        }
+        self->state = TASK_INTERRUPTIBLE;
+        self->wait_channel = ep;
+        spin_unlock(&ep->lock);
+
+        schedule();
+    }
+    self->state = TASK_RUNNING;
+    self->wait_channel = NULL;
+    spin_unlock(&ep->lock);
+    sched_block_reason_restore(reason);
+
+    return err;
+}
+
+/*
+ * Take a reference unless the count already hit zero, in which case the
+ * endpoint is on its way to call_rcu and must not be revived.
+ */
+static bool endpoint_get_unless_zero(struct ipc_endpoint *ep)
+{
+    int refs = __atomic_load_n(&ep->refcount, __ATOMIC_RELAXED);
+
+    while (refs > 0) {
+        if (__atomic_compare_exchange_n(&ep->refcount, &refs, refs + 1, true,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 /*
  * Get endpoint by ID
+ *
+ * Lockless: the list is walked under rcu_read_lock(), which keeps every
+ * endpoint we look at allocated even if it is concurrently destroyed.
  */
 struct ipc_endpoint *endpoint_get(u32 id)
 {
     struct ipc_endpoint *ep = NULL;
+    struct ipc_endpoint *e;
 
-    spin_lock(&endpoint_list_lock);
+    rcu_read_lock();
 
-    struct list_head *node;
-    list_for_each(node, &endpoint_list) {
-        struct ipc_endpoint *e = container_of(node, struct ipc_endpoint, list);
+    list_for_each_entry_rcu(e, &endpoint_list, list) {
         if (e->id == id && !(e->flags & EP_FLAG_DEAD)) {
-            __atomic_fetch_add(&e->refcount, 1, __ATOMIC_RELAXED);
-            ep = e;
+            if (endpoint_get_unless_zero(e)) {
+                ep = e;
+            }
             break;
         }
     }
 
-    spin_unlock(&endpoint_list_lock);
+    rcu_read_unlock();
 
     return ep;
 }
 
+static void endpoint_free_rcu(struct rcu_head *head)
+{
+    kfree(container_of(head, struct ipc_endpoint, rcu));
+}
+
 /*
  * Release endpoint reference
  */
@@ -318,7 +601,7 @@ void endpoint_put(struct ipc_endpoint *ep)
     int refs = __atomic_sub_fetch(&ep->refcount, 1, __ATOMIC_ACQ_REL);
     if (refs == 0) {
         kprintf("[ipc] Destroyed endpoint %u\n", ep->id);
-        kfree(ep);
+        call_rcu(&ep->rcu, endpoint_free_rcu);
     }
 }
 
@@ -412,6 +695,7 @@ void ipc_dump_endpoint(struct ipc_endpoint *ep)
     if (ep->flags & EP_FLAG_NOTIFICATION) kprintf(" NOTIFICATION");
     if (ep->flags & EP_FLAG_DEAD) kprintf(" DEAD");
     if (ep->flags & EP_FLAG_LISTED) kprintf(" LISTED");
+    if (ep->flags & EP_FLAG_SUPERVISED) kprintf(" SUPERVISED");
     kprintf("\n");
 
     kprintf("  Refcount: %d\n", ep->refcount);
@@ -422,6 +706,10 @@ void ipc_dump_endpoint(struct ipc_endpoint *ep)
     if (ep->bound_thread) {
         kprintf("  Bound to: TID %d\n", ep->bound_thread->tid);
     }
+    if (ep->flags & EP_FLAG_SUPERVISED) {
+        kprintf("  Supervisor: PID %d, standby PID %d\n",
+                ep->supervisor, ep->standby);
+    }
 
     /* Count waiters */
     int send_waiters = 0, recv_waiters = 0;
@@ -436,7 +724,8 @@ void ipc_dump_endpoint(struct ipc_endpoint *ep)
     kprintf("  Send queue: %d waiting\n", send_waiters);
     kprintf("  Recv queue: %d waiting\n", recv_waiters);
     kprintf("  Stats: %llu sent, %llu received\n",
-            ep->msgs_sent, ep->msgs_received);
+            percpu_counter_sum_positive(&ep->msgs_sent),
+            percpu_counter_sum_positive(&ep->msgs_received));
 
     spin_unlock(&ep->lock);
 }
@@ -455,8 +744,8 @@ void ipc_dump_stats(void)
     list_for_each(node, &endpoint_list) {
         struct ipc_endpoint *ep = container_of(node, struct ipc_endpoint, list);
         count++;
-        total_sent += ep->msgs_sent;
-        total_recv += ep->msgs_received;
+        total_sent += percpu_counter_sum_positive(&ep->msgs_sent);
+        total_recv += percpu_counter_sum_positive(&ep->msgs_received);
     }
 
     spin_unlock(&endpoint_list_lock);
@@ -465,4 +754,7 @@ void ipc_dump_stats(void)
     kprintf("  Endpoints: %d\n", count);
     kprintf("  Total messages sent: %llu\n", total_sent);
     kprintf("  Total messages received: %llu\n", total_recv);
+    kprintf("  Transfers: %llu (%llu to a waiting receiver)\n",
+            percpu_counter_sum_positive(&ipc_total_messages),
+            percpu_counter_sum_positive(&ipc_fast_path_count));
 }
@@ -9,6 +9,7 @@
 #include <ocean/ipc_proto.h>
 #include <ocean/process.h>
 #include <ocean/sched.h>
+#include <ocean/trace.h>
 #include <ocean/types.h>
 #include <ocean/defs.h>
 
@@ -19,16 +20,16 @@ extern void *memset(void *s, int c, size_t n);
 extern void *kmalloc(size_t size);
 extern void kfree(void *ptr);
 
-/* Global IPC state */
-static u64 ipc_total_messages = 0;
-static u64 ipc_fast_path_count = 0;
+/* Global IPC statistics */
+DEFINE_PERCPU_COUNTER(ipc_total_messages);
+DEFINE_PERCPU_COUNTER(ipc_fast_path_count);
 
 /*
  * Lock protecting call/reply linkage: a thread's ipc_caller, its peer's
  * ipc_reply_server, and the reply slots. Single coarse lock keeps the
  * teardown paths in thread_exit simple.
  */
-spinlock_t ipc_cc_lock = SPINLOCK_INIT;
+DEFINE_SPINLOCK(ipc_cc_lock);
 
 /*
  * Copy a slice from one process's IPC window into another's at the same
@@ -79,8 +80,9 @@ static int maybe_copy_window(struct process *sender_proc,
 void ipc_init(void)
 {
     kprintf("Initializing IPC subsystem...\n");
-    ipc_total_messages = 0;
-    ipc_fast_path_count = 0;
+    percpu_counter_init(&ipc_total_messages);
+    percpu_counter_init(&ipc_fast_path_count);
+    notification_init();
     kprintf("IPC subsystem initialized\n");
 }
 
@@ -123,21 +125,177 @@ static struct ipc_wait *peek_waiter(struct list_head *queue)
     return wait;
 }
 
+/*
+ * A call the kernel re-queues after its server died: the wait entry and a
+ * copy of the journalled message, freed by whoever dequeues it.
+ */
+struct ipc_replay {
+    struct ipc_wait wait;
+    struct ipc_message msg;
+};
+
 /*
  * Record the client/server pointers for a call so either peer's teardown
  * can break the link. Must be called while the caller-side wake is
- * pending (i.e. before the caller actually returns from ipc_send).
+ * pending (i.e. before the caller actually returns from ipc_send). On a
+ * supervised endpoint the request is journalled in the caller too, so it
+ * can be replayed if the server dies. Called with ep->lock held.
  */
-static void link_call(struct thread *caller, struct thread *server)
+static void link_call(struct thread *caller, struct thread *server,
+                      struct ipc_endpoint *ep, const struct ipc_message *msg)
 {
     spin_lock(&ipc_cc_lock);
     caller->ipc_reply_pending = 1;
     caller->ipc_reply_result = IPC_ERR_DEAD;
     caller->ipc_reply_server = server;
     server->ipc_caller = caller;
+
+    /* A replay is journalled already, and ipc_call drops the journal on
+     * every return, so there is never another endpoint's here */
+    if ((ep->flags & EP_FLAG_SUPERVISED) && !caller->ipc_journal_ep) {
+        __atomic_fetch_add(&ep->refcount, 1, __ATOMIC_RELAXED);
+        caller->ipc_journal_ep = ep;
+        caller->ipc_journal_tag = msg->tag;
+        for (int i = 0; i < IPC_FAST_REGS; i++) {
+            caller->ipc_journal_regs[i] = msg->regs[i];
+        }
+    }
+    spin_unlock(&ipc_cc_lock);
+}
+
+/*
+ * Hand msg from sender to a receiver blocked on ep, linking a call. Called
+ * with ep->lock held; the caller wakes the receiver. If the window slice
+ * cannot be copied the message is not delivered and the receiver stays
+ * queued.
+ */
+static int deliver_to_receiver(struct ipc_endpoint *ep, struct ipc_wait *recv_wait,
+                               struct thread *sender, struct ipc_message *msg,
+                               int op)
+{
+    struct thread *receiver = recv_wait->partner;
+
+    /* Copy any window slice before handing the message over. If the
+     * copy fails the message does not cross the boundary. */
+    int slice_err = IPC_OK;
+    if (sender->process && receiver->process) {
+        slice_err = maybe_copy_window(sender->process, receiver->process, msg);
+    } else if (MSG_FLAGS(msg->tag) & MSG_FLAG_SLICE) {
+        /* One side has no address space (kernel thread). Reject to avoid
+         * silent data loss. */
+        slice_err = IPC_ERR_INVALID;
+    }
+
+    if (slice_err != IPC_OK) {
+        return slice_err;
+    }
+
+    /* Remove receiver from wait queue */
+    list_del_init(&recv_wait->wait_list);
+
+    /* Copy message to receiver's buffer */
+    if (recv_wait->msg) {
+        copy_message(recv_wait->msg, msg);
+    }
+
+    /* Tell the receiver's ipc_recv whether this was a call. */
+    recv_wait->operation = op;
+    recv_wait->result = IPC_OK;
+    recv_wait->partner = sender;
+
+    percpu_counter_inc(&ep->msgs_sent);
+    percpu_counter_inc(&ipc_total_messages);
+    percpu_counter_inc(&ipc_fast_path_count);
+
+    if (op == IPC_OP_CALL) {
+        link_call(sender, receiver, ep, msg);
+    }
+
+    return IPC_OK;
+}
+
+/*
+ * End a journalled call that cannot be replayed: the caller, still
+ * blocked in ipc_call, wakes with result.
+ */
+static void replay_fail(struct thread *caller, int result)
+{
+    spin_lock(&ipc_cc_lock);
+    caller->ipc_reply_result = result;
+    caller->ipc_reply_pending = 0;
+    sched_wakeup(caller);
     spin_unlock(&ipc_cc_lock);
 }
 
+void ipc_replay_cancel(struct ipc_wait *wait)
+{
+    replay_fail(wait->partner, IPC_ERR_DEAD);
+    kfree(container_of(wait, struct ipc_replay, wait));
+}
+
+/*
+ * Deliver caller's journalled call again, its server having died without
+ * replying: straight to a waiting receiver, or else at the head of the
+ * send queue, since it was taken off there first.
+ */
+static void ipc_replay(struct thread *caller)
+{
+    struct ipc_endpoint *ep = caller->ipc_journal_ep;
+    struct ipc_replay *replay = kmalloc(sizeof(*replay));
+
+    /* Before the call is back on the endpoint: a reply may end it, and
+     * drop the journal's reference, at any moment after */
+    kprintf("[ipc] Replaying call from TID %d on endpoint %u\n",
+            caller->tid, ep->id);
+
+    if (!replay) {
+        replay_fail(caller, IPC_ERR_DEAD);
+        return;
+    }
+
+    memset(&replay->msg, 0, sizeof(replay->msg));
+    replay->msg.tag = caller->ipc_journal_tag |
+                      ((u64)MSG_FLAG_REPLAYED << MSG_TAG_FLAGS_SHIFT);
+    for (int i = 0; i < IPC_FAST_REGS; i++) {
+        replay->msg.regs[i] = caller->ipc_journal_regs[i];
+    }
+
+    replay->wait.endpoint = ep;
+    replay->wait.msg = &replay->msg;
+    replay->wait.partner = caller;
+    replay->wait.operation = IPC_OP_REPLAY;
+    replay->wait.result = IPC_ERR_NOPARTNER;
+    INIT_LIST_HEAD(&replay->wait.wait_list);
+
+    spin_lock(&ep->lock);
+
+    if (ep->flags & EP_FLAG_DEAD) {
+        spin_unlock(&ep->lock);
+        kfree(replay);
+        replay_fail(caller, IPC_ERR_DEAD);
+        return;
+    }
+
+    struct ipc_wait *recv_wait = peek_waiter(&ep->recv_queue);
+    if (recv_wait) {
+        struct thread *receiver = recv_wait->partner;
+        int err = deliver_to_receiver(ep, recv_wait, caller, &replay->msg,
+                                      IPC_OP_CALL);
+
+        spin_unlock(&ep->lock);
+        kfree(replay);
+
+        if (err != IPC_OK) {
+            replay_fail(caller, err);
+            return;
+        }
+        sched_wakeup(receiver);
+    } else {
+        list_add(&replay->wait.wait_list, &ep->send_queue);
+        spin_unlock(&ep->lock);
+    }
+}
+
 /*
  * Shared core of ipc_send and ipc_call.
  *
@@ -160,6 +318,8 @@ static int ipc_send_op(struct ipc_endpoint *ep, struct ipc_message *msg, int op)
         return IPC_ERR_INVALID;
     }
 
+    trace_ipc_send(ep->id, msg->tag, op);
+
     spin_lock(&ep->lock);
 
     /* Check if endpoint is dead */
@@ -175,45 +335,13 @@ static int ipc_send_op(struct ipc_endpoint *ep, struct ipc_message *msg, int op)
         /* Direct transfer - receiver is waiting */
         struct thread *receiver = recv_wait->partner;
 
-        /* Copy any window slice before handing the message over. If the
-         * copy fails the message does not cross the boundary. */
-        int slice_err = IPC_OK;
-        if (self->process && receiver->process) {
-            slice_err = maybe_copy_window(self->process, receiver->process, msg);
-        } else if (MSG_FLAGS(msg->tag) & MSG_FLAG_SLICE) {
-            /* One side has no address space (kernel thread). Reject to avoid
-             * silent data loss. */
-            slice_err = IPC_ERR_INVALID;
-        }
-
-        if (slice_err != IPC_OK) {
-            spin_unlock(&ep->lock);
-            return slice_err;
-        }
-
-        /* Remove receiver from wait queue */
-        list_del_init(&recv_wait->wait_list);
-
-        /* Copy message to receiver's buffer */
-        if (recv_wait->msg) {
-            copy_message(recv_wait->msg, msg);
-        }
-
-        /* Tell the receiver's ipc_recv whether this was a call. */
-        recv_wait->operation = op;
-        recv_wait->result = IPC_OK;
-        recv_wait->partner = self;
-
-        ep->msgs_sent++;
-        ipc_total_messages++;
-        ipc_fast_path_count++;
+        int err = deliver_to_receiver(ep, recv_wait, self, msg, op);
+        spin_unlock(&ep->lock);
 
-        if (op == IPC_OP_CALL) {
-            link_call(self, receiver);
+        if (err != IPC_OK) {
+            return err;
         }
 
-        spin_unlock(&ep->lock);
-
         /* Wake up receiver */
         sched_wakeup(receiver);
 
@@ -245,7 +373,9 @@ static int ipc_send_op(struct ipc_endpoint *ep, struct ipc_message *msg, int op)
 
         /* Sleep until a receiver arrives */
         kprintf("[ipc] Send: blocking TID %d (op=%d)\n", self->tid, op);
+        int reason = sched_block_reason_set(SCHED_BLOCK_IPC);
         thread_sleep(wait);
+        sched_block_reason_restore(reason);
 
         /*
          * Defensive cleanup for spurious wakeups: remove from queue if still linked.
@@ -310,10 +440,18 @@ int ipc_recv(struct ipc_endpoint *ep, struct ipc_message *msg)
             slice_err = IPC_ERR_INVALID;
         }
 
+        int op = send_wait->operation;
+
         if (slice_err != IPC_OK) {
             /* Wake the sender with the failure; do not deliver the message. */
-            send_wait->result = slice_err;
             list_del_init(&send_wait->wait_list);
+            if (op == IPC_OP_REPLAY) {
+                spin_unlock(&ep->lock);
+                replay_fail(sender, slice_err);
+                kfree(container_of(send_wait, struct ipc_replay, wait));
+                return slice_err;
+            }
+            send_wait->result = slice_err;
             spin_unlock(&ep->lock);
             sched_wakeup(sender);
             return slice_err;
@@ -330,22 +468,27 @@ int ipc_recv(struct ipc_endpoint *ep, struct ipc_message *msg)
         send_wait->result = IPC_OK;
         send_wait->partner = self;
 
-        ep->msgs_received++;
-        ipc_total_messages++;
+        percpu_counter_inc(&ep->msgs_received);
+        percpu_counter_inc(&ipc_total_messages);
 
         /* If the sender was making a call, link the reply pointers before we
          * wake them so the subsequent reply path can find both sides. */
-        if (send_wait->operation == IPC_OP_CALL) {
-            link_call(sender, self);
+        if (op == IPC_OP_CALL || op == IPC_OP_REPLAY) {
+            link_call(sender, self, ep, send_wait->msg);
         }
 
         spin_unlock(&ep->lock);
 
-        /* Wake up sender */
-        sched_wakeup(sender);
+        if (op == IPC_OP_REPLAY) {
+            /* The caller sleeps in ipc_call until we reply */
+            kfree(container_of(send_wait, struct ipc_replay, wait));
+        } else {
+            /* Wake up sender */
+            sched_wakeup(sender);
+        }
 
         kprintf("[ipc] Recv: direct transfer from TID %d (op=%d)\n",
-                sender->tid, send_wait->operation);
+                sender->tid, op);
     } else if (MSG_FLAGS(msg->tag) & MSG_FLAG_NONBLOCK) {
         /* Non-blocking and no sender */
         spin_unlock(&ep->lock);
@@ -372,7 +515,9 @@ int ipc_recv(struct ipc_endpoint *ep, struct ipc_message *msg)
 
         /* Sleep until a sender arrives */
         kprintf("[ipc] Recv: blocking TID %d\n", self->tid);
+        int reason = sched_block_reason_set(SCHED_BLOCK_IPC);
         thread_sleep(wait);
+        sched_block_reason_restore(reason);
 
         /* Defensive cleanup for spurious wakeups. */
         spin_lock(&ep->lock);
@@ -387,6 +532,7 @@ int ipc_recv(struct ipc_endpoint *ep, struct ipc_message *msg)
         kfree(wait);
     }
 
+    trace_ipc_recv(ep->id, msg->tag, result);
     return result;
 }
 
@@ -444,6 +590,7 @@ int ipc_call(struct ipc_endpoint *ep, struct ipc_message *msg)
      * we will see pending==0 on the next iteration or ipc_reply has not
      * yet run and will see state==INTERRUPTIBLE when it wakes us.
      */
+    int reason = sched_block_reason_set(SCHED_BLOCK_IPC);
     for (;;) {
         spin_lock(&ipc_cc_lock);
         if (!self->ipc_reply_pending) {
@@ -452,12 +599,30 @@ int ipc_call(struct ipc_endpoint *ep, struct ipc_message *msg)
             spin_unlock(&ipc_cc_lock);
             break;
         }
+        /*
+         * Our process is exiting: cut the server's link to us so its reply
+         * finds no caller. A replay not yet taken by a server is only
+         * reachable from the endpoint, so that wait runs its course.
+         */
+        if ((self->flags & TF_GROUP_EXIT) && self->ipc_reply_server) {
+            if (self->ipc_reply_server->ipc_caller == self) {
+                self->ipc_reply_server->ipc_caller = NULL;
+            }
+            self->ipc_reply_server = NULL;
+            self->ipc_reply_pending = 0;
+            self->ipc_reply_result = IPC_ERR_CANCELED;
+            self->state = TASK_RUNNING;
+            self->wait_channel = NULL;
+            spin_unlock(&ipc_cc_lock);
+            break;
+        }
         self->state = TASK_INTERRUPTIBLE;
         self->wait_channel = (void *)(uintptr_t)&self->ipc_reply_pending;
         spin_unlock(&ipc_cc_lock);
 
         schedule();
     }
+    sched_block_reason_restore(reason);
 
     int result;
     spin_lock(&ipc_cc_lock);
@@ -469,8 +634,12 @@ int ipc_call(struct ipc_endpoint *ep, struct ipc_message *msg)
         }
     }
     self->ipc_reply_server = NULL;
+    struct ipc_endpoint *journal = self->ipc_journal_ep;
+    self->ipc_journal_ep = NULL;
     spin_unlock(&ipc_cc_lock);
 
+    endpoint_put(journal);
+
     kprintf("[ipc] Call: TID %d got reply, result=%d\n", self->tid, result);
     return result;
 }
@@ -535,6 +704,7 @@ int ipc_reply(struct ipc_message *msg)
      * caller is still waiting to take the lock (sees pending==0 on the
      * next loop iteration) or already asleep (sched_wakeup flips the
      * INTERRUPTIBLE state before we release). */
+    trace_ipc_reply(caller->tid, msg->tag, slice_err);
     sched_wakeup(caller);
     spin_unlock(&ipc_cc_lock);
 
@@ -543,6 +713,25 @@ int ipc_reply(struct ipc_message *msg)
     return IPC_OK;
 }
 
+/*
+ * The process whose call we are serving. The caller stays blocked in
+ * ipc_call until we reply, so its process outlives the request; servers
+ * use this to act on the client's behalf.
+ */
+struct process *ipc_caller_process(void)
+{
+    struct thread *self = get_current();
+    struct process *proc = NULL;
+
+    spin_lock(&ipc_cc_lock);
+    if (self->ipc_caller) {
+        proc = self->ipc_caller->process;
+    }
+    spin_unlock(&ipc_cc_lock);
+
+    return proc;
+}
+
 /*
  * IPC Reply + Receive - reply to the current caller, then block for the
  * next message. The typical top of a server loop.
@@ -559,7 +748,8 @@ int ipc_reply_recv(struct ipc_endpoint *ep, struct ipc_message *msg)
  * Two directions to handle:
  *
  *   1. We owe a reply (ipc_caller != NULL). That caller is blocked on their
- *      ipc_reply_pending. Wake them with IPC_ERR_DEAD so they don't stall.
+ *      ipc_reply_pending. Wake them with IPC_ERR_DEAD so they don't stall,
+ *      or if the call is journalled, replay it to the next server.
  *
  *   2. We are blocked on a reply (ipc_reply_server != NULL). The server is
  *      still running but holds a pointer back to us. Clear their ipc_caller
@@ -570,6 +760,8 @@ int ipc_reply_recv(struct ipc_endpoint *ep, struct ipc_message *msg)
  */
 void ipc_thread_cleanup(struct thread *t)
 {
+    struct thread *replay = NULL;
+
     if (!t) {
         return;
     }
@@ -578,16 +770,22 @@ void ipc_thread_cleanup(struct thread *t)
 
     /* Case 1: we owe a reply. Wake the caller with IPC_ERR_DEAD while
      * holding the lock so an interleaving ipc_call wait cannot race
-     * pending=0 against our wake. */
+     * pending=0 against our wake. A journalled call is replayed once the
+     * lock is dropped (the endpoint lock nests outside it); its caller
+     * stays pending meanwhile, and no reply can reach it. */
     if (t->ipc_caller) {
         struct thread *caller = t->ipc_caller;
         t->ipc_caller = NULL;
         if (caller->ipc_reply_server == t) {
             caller->ipc_reply_server = NULL;
         }
-        caller->ipc_reply_result = IPC_ERR_DEAD;
-        caller->ipc_reply_pending = 0;
-        sched_wakeup(caller);
+        if (caller->ipc_journal_ep) {
+            replay = caller;
+        } else {
+            caller->ipc_reply_result = IPC_ERR_DEAD;
+            caller->ipc_reply_pending = 0;
+            sched_wakeup(caller);
+        }
     }
 
     /* Case 2: we are waiting on a server. Null out the server's back
@@ -602,7 +800,15 @@ void ipc_thread_cleanup(struct thread *t)
     }
 
     t->ipc_reply_pending = 0;
+    struct ipc_endpoint *journal = t->ipc_journal_ep;
+    t->ipc_journal_ep = NULL;
     spin_unlock(&ipc_cc_lock);
+
+    endpoint_put(journal);
+
+    if (replay) {
+        ipc_replay(replay);
+    }
 }
 
 /*
@@ -0,0 +1,237 @@
+/*
+ * Ocean Kernel - Notifications
+ *
+ * Asynchronous signalling: a notification is a word of pending bits.
+ * notification_signal() ORs bits in and wakes a waiter; it never blocks,
+ * so interrupt handlers use it to hand device interrupts to userspace
+ * drivers (see the IRQ objects in <ocean/irq.h>). A waiter takes the
+ * whole word at once, so signals that arrive before it runs coalesce.
+ *
+ * Notifications are named by IDs from their own map. Like endpoints they
+ * belong to the creating process and die with it; lookups are lockless
+ * under RCU with a reference count, and the memory is freed through
+ * call_rcu after the last reference goes.
+ */
+
+#include <ocean/ipc.h>
+#include <ocean/idr.h>
+#include <ocean/irq.h>
+#include <ocean/process.h>
+#include <ocean/sched.h>
+#include <ocean/wait.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern void *kmalloc(size_t size);
+extern void kfree(void *ptr);
+extern void *memset(void *s, int c, size_t n);
+
+static struct idr notification_idr;
+
+void notification_init(void)
+{
+    idr_init(&notification_idr, NTFN_MAX_ID);
+
+    /* ID 0 means "no notification" in the syscall ABI */
+    idr_insert(&notification_idr, 0, NULL);
+}
+
+struct notification *notification_create(struct process *owner)
+{
+    struct notification *ntfn;
+    int id;
+
+    ntfn = kmalloc(sizeof(*ntfn));
+    if (!ntfn) {
+        return NULL;
+    }
+    memset(ntfn, 0, sizeof(*ntfn));
+
+    id = idr_alloc_cyclic(&notification_idr, NULL, 1);
+    if (id < 0) {
+        kfree(ntfn);
+        return NULL;
+    }
+
+    ntfn->id = (u32)id;
+    ntfn->owner = owner;
+    ntfn->refcount = 1;             /* Dropped by notification_destroy() */
+    spin_init(&ntfn->lock);
+    wait_queue_init(&ntfn->wait);
+    INIT_LIST_HEAD(&ntfn->owner_link);
+
+    if (owner) {
+        u64 flags;
+
+        spin_lock_irqsave(&owner->lock, &flags);
+        list_add_tail(&ntfn->owner_link, &owner->owned_notifications);
+        spin_unlock_irqrestore(&owner->lock, flags);
+    }
+
+    /* Publish only once fully built */
+    idr_replace(&notification_idr, id, ntfn);
+    return ntfn;
+}
+
+static bool notification_get_unless_zero(struct notification *ntfn)
+{
+    int refs = __atomic_load_n(&ntfn->refcount, __ATOMIC_RELAXED);
+
+    while (refs > 0) {
+        if (__atomic_compare_exchange_n(&ntfn->refcount, &refs, refs + 1, true,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct notification *notification_get(u32 id)
+{
+    struct notification *ntfn;
+
+    rcu_read_lock();
+    ntfn = idr_find(&notification_idr, (int)id);
+    if (ntfn && ((__atomic_load_n(&ntfn->flags, __ATOMIC_ACQUIRE) & NTFN_FLAG_DEAD) ||
+                 !notification_get_unless_zero(ntfn))) {
+        ntfn = NULL;
+    }
+    rcu_read_unlock();
+
+    return ntfn;
+}
+
+static void notification_free_rcu(struct rcu_head *head)
+{
+    kfree(container_of(head, struct notification, rcu));
+}
+
+void notification_put(struct notification *ntfn)
+{
+    if (!ntfn) {
+        return;
+    }
+    if (__atomic_sub_fetch(&ntfn->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        call_rcu(&ntfn->rcu, notification_free_rcu);
+    }
+}
+
+/*
+ * Unpublish a notification, detach the IRQs bound to it and wake its
+ * waiters, who return -ENOENT.
+ */
+void notification_destroy(struct notification *ntfn)
+{
+    struct process *owner = ntfn->owner;
+    u64 flags;
+
+    spin_lock_irqsave(&ntfn->lock, &flags);
+    if (ntfn->flags & NTFN_FLAG_DEAD) {
+        spin_unlock_irqrestore(&ntfn->lock, flags);
+        return;
+    }
+    __atomic_store_n(&ntfn->flags, ntfn->flags | NTFN_FLAG_DEAD, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&ntfn->lock, flags);
+
+    idr_remove(&notification_idr, (int)ntfn->id);
+    irq_unbind_notification(ntfn);
+    wake_up_all(&ntfn->wait);
+
+    if (owner) {
+        spin_lock_irqsave(&owner->lock, &flags);
+        if (!list_empty(&ntfn->owner_link)) {
+            list_del_init(&ntfn->owner_link);
+        }
+        spin_unlock_irqrestore(&owner->lock, flags);
+    }
+
+    notification_put(ntfn);
+}
+
+/*
+ * Destroy every notification owned by proc (process teardown)
+ */
+void notification_destroy_owned_by_process(struct process *proc)
+{
+    for (;;) {
+        struct notification *ntfn = NULL;
+        u64 flags;
+
+        spin_lock_irqsave(&proc->lock, &flags);
+        if (!list_empty(&proc->owned_notifications)) {
+            ntfn = list_first_entry(&proc->owned_notifications,
+                                    struct notification, owner_link);
+            __atomic_fetch_add(&ntfn->refcount, 1, __ATOMIC_RELAXED);
+            list_del_init(&ntfn->owner_link);
+        }
+        spin_unlock_irqrestore(&proc->lock, flags);
+
+        if (!ntfn) {
+            break;
+        }
+
+        notification_destroy(ntfn);
+        notification_put(ntfn);
+    }
+}
+
+/* Safe from interrupt context */
+int notification_signal(struct notification *ntfn, u64 bits)
+{
+    u64 flags;
+
+    if (bits == 0 || (bits >> NTFN_BITS)) {
+        return -EINVAL;
+    }
+
+    spin_lock_irqsave(&ntfn->lock, &flags);
+    ntfn->word |= bits;
+    spin_unlock_irqrestore(&ntfn->lock, flags);
+
+    wake_up(&ntfn->wait);
+    return 0;
+}
+
+/* Take the pending bits; 0 if none. -ENOENT once destroyed. */
+static int notification_take(struct notification *ntfn, u64 *bits)
+{
+    u64 flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&ntfn->lock, &flags);
+    *bits = ntfn->word;
+    ntfn->word = 0;
+    if (*bits == 0 && (ntfn->flags & NTFN_FLAG_DEAD)) {
+        ret = -ENOENT;
+    }
+    spin_unlock_irqrestore(&ntfn->lock, flags);
+
+    return ret;
+}
+
+int notification_wait(struct notification *ntfn, u64 *bits)
+{
+    int ret;
+
+    for (;;) {
+        prepare_to_wait(&ntfn->wait, TASK_INTERRUPTIBLE);
+
+        ret = notification_take(ntfn, bits);
+        if (ret < 0 || *bits) {
+            break;
+        }
+
+        int reason = sched_block_reason_set(SCHED_BLOCK_IPC);
+        schedule();
+        sched_block_reason_restore(reason);
+    }
+    finish_wait(&ntfn->wait);
+
+    return ret;
+}
+
+int notification_poll(struct notification *ntfn, u64 *bits)
+{
+    return notification_take(ntfn, bits);
+}
@@ -375,13 +375,16 @@ void ipc_test_call_reply(void)
  */
 void ipc_log_window_status(pid_t pid)
 {
+    rcu_read_lock();
     struct process *proc = process_find(pid);
     if (!proc) {
+        rcu_read_unlock();
         kprintf("[ipc] window status: no process with PID %d\n", pid);
         return;
     }
 
     if (!proc->ipc_window_phys) {
+        rcu_read_unlock();
         kprintf("[ipc] window status: PID %d has NO IPC window\n", pid);
         return;
     }
@@ -392,4 +395,5 @@ void ipc_log_window_status(pid_t pid)
             (unsigned long long)OCEAN_IPC_WINDOW_VA,
             (unsigned long long)proc->ipc_window_phys,
             (unsigned)OCEAN_IPC_WINDOW_SIZE);
+    rcu_read_unlock();
 }
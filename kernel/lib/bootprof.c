@@ -0,0 +1,115 @@
+/*
+ * Ocean Kernel - Boot Phase Profiler
+ *
+ * Phases are recorded as start stamps only; the end of one is the start
+ * of the next, and boot_phase_done() stamps the end of the last. Boot is
+ * single-threaded on the BSP, so the table needs no lock until it is
+ * complete, and after that it is only read.
+ */
+
+#include <ocean/bootprof.h>
+#include <ocean/trace.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+struct boot_phase_rec {
+    const char *name;
+    u64 start;                  /* TSC */
+};
+
+static struct boot_phase_rec boot_phases[BOOT_PHASE_MAX];
+static int boot_phase_count;
+static u64 boot_entry_tsc;
+static u64 boot_end_tsc;        /* 0 until boot_phase_done() */
+static bool boot_phase_overflow;
+
+void boot_phase_init(u64 entry_tsc)
+{
+    boot_entry_tsc = entry_tsc;
+    boot_phases[0].name = "early";
+    boot_phases[0].start = entry_tsc;
+    boot_phase_count = 1;
+}
+
+void boot_phase(const char *name)
+{
+    if (boot_end_tsc || boot_phase_count == 0) {
+        return;
+    }
+    if (boot_phase_count == BOOT_PHASE_MAX) {
+        boot_phase_overflow = true;
+        return;
+    }
+
+    boot_phases[boot_phase_count].name = name;
+    boot_phases[boot_phase_count].start = rdtsc();
+    boot_phase_count++;
+}
+
+static u64 phase_end(int i)
+{
+    return i + 1 < boot_phase_count ? boot_phases[i + 1].start : boot_end_tsc;
+}
+
+/* Cycles to microseconds; 0 while the TSC rate is not known yet */
+static u64 cycles_to_us(u64 cycles, u64 hz)
+{
+    u64 mhz = hz / 1000000;
+
+    return mhz ? cycles / mhz : 0;
+}
+
+static void boot_phase_print(void)
+{
+    u64 total = boot_end_tsc - boot_entry_tsc;
+    u64 hz = trace_tsc_hz();
+
+    kprintf("\nBoot phases (kernel entry to init, %llu cycles, %llu us):\n",
+            total, cycles_to_us(total, hz));
+    kprintf("  PHASE               START us     DUR us       CYCLES    PCT\n");
+
+    for (int i = 0; i < boot_phase_count; i++) {
+        u64 start = boot_phases[i].start - boot_entry_tsc;
+        u64 cycles = phase_end(i) - boot_phases[i].start;
+        u64 permille = total ? cycles * 1000 / total : 0;
+
+        kprintf("  %-18s %9llu  %9llu  %11llu  %3llu.%llu\n",
+                boot_phases[i].name, cycles_to_us(start, hz),
+                cycles_to_us(cycles, hz), cycles, permille / 10, permille % 10);
+    }
+
+    if (boot_phase_overflow) {
+        kprintf("  (more than %d phases; the rest are in the last one)\n",
+                BOOT_PHASE_MAX);
+    }
+    kprintf("  TSC at kernel entry: %llu (firmware and bootloader)\n",
+            boot_entry_tsc);
+}
+
+void boot_phase_done(void)
+{
+    if (boot_end_tsc || boot_phase_count == 0) {
+        return;
+    }
+
+    boot_end_tsc = rdtsc();
+    boot_phase_print();
+}
+
+int boot_phase_report(void)
+{
+    if (!boot_end_tsc) {
+        return -EAGAIN;
+    }
+
+    boot_phase_print();
+    for (int i = 0; i < boot_phase_count; i++) {
+        kprintf("BENCH boot.%s %llu cycles\n", boot_phases[i].name,
+                phase_end(i) - boot_phases[i].start);
+    }
+    kprintf("BENCH boot.total %llu cycles\n", boot_end_tsc - boot_entry_tsc);
+    return 0;
+}
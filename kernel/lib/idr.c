@@ -0,0 +1,305 @@
+/*
+ * Ocean Kernel - ID Allocator
+ *
+ * Radix tree mapping IDs to pointers. Leaf bit i in layer->free means
+ * slot i is unallocated; an interior bit means the child subtree still
+ * has at least one free ID (or has not been allocated yet). Layers are
+ * created on demand and kept once created, bounding memory by max_id.
+ *
+ * Because layers are never freed, lookups can walk the tree without the
+ * lock: writers publish new layers and slot values with release stores
+ * and idr_find() reads them with acquire loads.
+ */
+
+#include <ocean/idr.h>
+#include <ocean/rcu.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern void *kmalloc(size_t size);
+extern void *memset(void *s, int c, size_t n);
+
+static inline int idr_shift(int level)
+{
+    return IDR_BITS * level;
+}
+
+/*
+ * Allocate a layer covering IDs starting at base. Slots that would only
+ * hold IDs >= max_id start out full so they are never handed out.
+ */
+static struct idr_layer *idr_layer_alloc(struct idr *idr, int level, int base)
+{
+    struct idr_layer *layer = kmalloc(sizeof(*layer));
+    if (!layer) {
+        return NULL;
+    }
+
+    memset(layer, 0, sizeof(*layer));
+
+    for (int slot = 0; slot < IDR_SIZE; slot++) {
+        if ((i64)base + ((i64)slot << idr_shift(level)) < idr->max_id) {
+            layer->free |= 1ULL << slot;
+        }
+    }
+
+    return layer;
+}
+
+/*
+ * Walk to the leaf layer holding id, recording the interior layers in
+ * path[level]. Missing layers are created when create is set.
+ */
+static struct idr_layer *idr_walk(struct idr *idr, int id, bool create,
+                                  struct idr_layer **path)
+{
+    struct idr_layer **layerp = &idr->top;
+    int base = 0;
+
+    for (int level = idr->levels - 1; level >= 0; level--) {
+        if (!*layerp) {
+            struct idr_layer *layer;
+
+            if (!create) {
+                return NULL;
+            }
+            layer = idr_layer_alloc(idr, level, base);
+            if (!layer) {
+                return NULL;
+            }
+            rcu_assign_pointer(*layerp, layer);
+        }
+
+        if (level == 0) {
+            return *layerp;
+        }
+
+        int slot = (id >> idr_shift(level)) & IDR_MASK;
+        path[level] = *layerp;
+        base += slot << idr_shift(level);
+        layerp = (struct idr_layer **)&(*layerp)->slots[slot];
+    }
+
+    return NULL;
+}
+
+/*
+ * Find the lowest free ID >= start below *layerp. At most two children
+ * are visited per level: the one containing start, which may be free only
+ * below start, and the next non-full one, which always succeeds.
+ */
+static int idr_find_free(struct idr *idr, struct idr_layer **layerp,
+                         int level, int base, int start)
+{
+    struct idr_layer *layer = *layerp;
+    int shift = idr_shift(level);
+    int first;
+    u64 candidates;
+
+    if (!layer) {
+        layer = idr_layer_alloc(idr, level, base);
+        if (!layer) {
+            return -ENOMEM;
+        }
+        rcu_assign_pointer(*layerp, layer);
+    }
+
+    first = start > base ? (start - base) >> shift : 0;
+    candidates = layer->free & (~0ULL << first);
+
+    while (candidates) {
+        int slot = __builtin_ctzll(candidates);
+        int slot_base = base + (slot << shift);
+        int id;
+
+        if (level == 0) {
+            return slot_base;
+        }
+
+        id = idr_find_free(idr, (struct idr_layer **)&layer->slots[slot],
+                           level - 1, slot_base,
+                           slot == first ? start : slot_base);
+        if (id != -ENOSPC) {
+            return id;
+        }
+
+        candidates &= candidates - 1;
+    }
+
+    return -ENOSPC;
+}
+
+/* Mark id allocated in its leaf and clear full subtrees in the parents */
+static void idr_mark_used(struct idr *idr, struct idr_layer *leaf,
+                          struct idr_layer **path, int id, void *ptr)
+{
+    struct idr_layer *layer = leaf;
+    int slot = id & IDR_MASK;
+
+    rcu_assign_pointer(layer->slots[slot], ptr);
+    layer->free &= ~(1ULL << slot);
+
+    for (int level = 1; level < idr->levels && layer->free == 0; level++) {
+        layer = path[level];
+        layer->free &= ~(1ULL << ((id >> idr_shift(level)) & IDR_MASK));
+    }
+}
+
+/* Allocate the lowest free ID >= start with idr->lock held */
+static int idr_alloc_locked(struct idr *idr, void *ptr, int start)
+{
+    struct idr_layer *path[IDR_MAX_LEVELS];
+    struct idr_layer *leaf;
+    int id;
+
+    if (start < 0 || start >= idr->max_id) {
+        return -ENOSPC;
+    }
+
+    id = idr_find_free(idr, &idr->top, idr->levels - 1, 0, start);
+    if (id < 0) {
+        return id;
+    }
+
+    leaf = idr_walk(idr, id, false, path);
+    idr_mark_used(idr, leaf, path, id, ptr);
+    return id;
+}
+
+void idr_init(struct idr *idr, int max_id)
+{
+    idr->top = NULL;
+    idr->max_id = max_id;
+    idr->next = 0;
+    idr->levels = 1;
+    while (idr->levels < IDR_MAX_LEVELS &&
+           ((i64)1 << idr_shift(idr->levels)) < max_id) {
+        idr->levels++;
+    }
+    spin_init(&idr->lock);
+}
+
+int idr_alloc(struct idr *idr, void *ptr, int start)
+{
+    u64 flags;
+    int id;
+
+    spin_lock_irqsave(&idr->lock, &flags);
+    id = idr_alloc_locked(idr, ptr, start);
+    spin_unlock_irqrestore(&idr->lock, flags);
+
+    return id;
+}
+
+int idr_alloc_cyclic(struct idr *idr, void *ptr, int min)
+{
+    u64 flags;
+    int id;
+
+    spin_lock_irqsave(&idr->lock, &flags);
+
+    int start = idr->next > min ? idr->next : min;
+    id = idr_alloc_locked(idr, ptr, start);
+    if (id == -ENOSPC && start > min) {
+        id = idr_alloc_locked(idr, ptr, min);
+    }
+    if (id >= 0) {
+        idr->next = id + 1 < idr->max_id ? id + 1 : min;
+    }
+
+    spin_unlock_irqrestore(&idr->lock, flags);
+    return id;
+}
+
+int idr_insert(struct idr *idr, int id, void *ptr)
+{
+    struct idr_layer *path[IDR_MAX_LEVELS];
+    struct idr_layer *leaf;
+    u64 flags;
+    int ret = 0;
+
+    if (id < 0 || id >= idr->max_id) {
+        return -EINVAL;
+    }
+
+    spin_lock_irqsave(&idr->lock, &flags);
+
+    leaf = idr_walk(idr, id, true, path);
+    if (!leaf) {
+        ret = -ENOMEM;
+    } else if (!(leaf->free & (1ULL << (id & IDR_MASK)))) {
+        ret = -EEXIST;
+    } else {
+        idr_mark_used(idr, leaf, path, id, ptr);
+    }
+
+    spin_unlock_irqrestore(&idr->lock, flags);
+    return ret;
+}
+
+void *idr_find(struct idr *idr, int id)
+{
+    struct idr_layer *layer;
+
+    if (id < 0 || id >= idr->max_id) {
+        return NULL;
+    }
+
+    layer = rcu_dereference(idr->top);
+    for (int level = idr->levels - 1; layer && level > 0; level--) {
+        int slot = (id >> idr_shift(level)) & IDR_MASK;
+        layer = rcu_dereference(layer->slots[slot]);
+    }
+
+    return layer ? rcu_dereference(layer->slots[id & IDR_MASK]) : NULL;
+}
+
+void *idr_replace(struct idr *idr, int id, void *ptr)
+{
+    struct idr_layer *path[IDR_MAX_LEVELS];
+    struct idr_layer *leaf;
+    void *old = NULL;
+    u64 flags;
+
+    if (id < 0 || id >= idr->max_id) {
+        return NULL;
+    }
+
+    spin_lock_irqsave(&idr->lock, &flags);
+    leaf = idr_walk(idr, id, false, path);
+    if (leaf && !(leaf->free & (1ULL << (id & IDR_MASK)))) {
+        old = leaf->slots[id & IDR_MASK];
+        rcu_assign_pointer(leaf->slots[id & IDR_MASK], ptr);
+    }
+    spin_unlock_irqrestore(&idr->lock, flags);
+
+    return old;
+}
+
+void *idr_remove(struct idr *idr, int id)
+{
+    struct idr_layer *path[IDR_MAX_LEVELS];
+    struct idr_layer *leaf;
+    void *old = NULL;
+    u64 flags;
+
+    if (id < 0 || id >= idr->max_id) {
+        return NULL;
+    }
+
+    spin_lock_irqsave(&idr->lock, &flags);
+
+    leaf = idr_walk(idr, id, false, path);
+    if (leaf && !(leaf->free & (1ULL << (id & IDR_MASK)))) {
+        old = leaf->slots[id & IDR_MASK];
+        rcu_assign_pointer(leaf->slots[id & IDR_MASK], NULL);
+        leaf->free |= 1ULL << (id & IDR_MASK);
+
+        for (int level = 1; level < idr->levels; level++) {
+            path[level]->free |= 1ULL << ((id >> idr_shift(level)) & IDR_MASK);
+        }
+    }
+
+    spin_unlock_irqrestore(&idr->lock, flags);
+    return old;
+}
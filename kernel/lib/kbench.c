@@ -0,0 +1,112 @@
+/*
+ * Ocean Kernel - In-kernel microbenchmarks
+ *
+ * Each benchmark times a fixed number of rounds with the TSC and reports
+ * the mean per operation. Rounds run with interrupts enabled, like real
+ * callers, so a timer tick can land inside one; the harness compares
+ * medians across boots to smooth that out.
+ */
+
+#include <ocean/kbench.h>
+#include <ocean/vmm.h>
+#include <ocean/pmm.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+#define KBENCH_ROUNDS   4096
+#define KBENCH_BATCH    64      /* Live objects in the batched slab test */
+
+static const size_t kbench_sizes[] = { 32, 256, 2048 };
+
+static void kbench_report(const char *name, u64 size, u64 value, const char *unit)
+{
+    if (size) {
+        kprintf("BENCH kernel.%s_%llu %llu %s\n", name, size, value, unit);
+    } else {
+        kprintf("BENCH kernel.%s %llu %s\n", name, value, unit);
+    }
+}
+
+/* Alloc+free of one object: the per-cache fast path */
+static int kbench_kmalloc_pair(size_t size)
+{
+    u64 start = rdtsc();
+
+    for (int i = 0; i < KBENCH_ROUNDS; i++) {
+        void *p = kmalloc(size);
+        if (!p) {
+            return -ENOMEM;
+        }
+        kfree(p);
+    }
+
+    kbench_report("kmalloc", size, (rdtsc() - start) / KBENCH_ROUNDS, "cycles/op");
+    return 0;
+}
+
+/* Allocate a batch, then free it: crosses slab boundaries */
+static int kbench_kmalloc_batch(size_t size)
+{
+    void *objs[KBENCH_BATCH];
+    int rounds = KBENCH_ROUNDS / KBENCH_BATCH;
+    u64 start = rdtsc();
+
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < KBENCH_BATCH; i++) {
+            objs[i] = kmalloc(size);
+            if (!objs[i]) {
+                while (--i >= 0) {
+                    kfree(objs[i]);
+                }
+                return -ENOMEM;
+            }
+        }
+        for (int i = 0; i < KBENCH_BATCH; i++) {
+            kfree(objs[i]);
+        }
+    }
+
+    kbench_report("kmalloc_batch", size,
+                  (rdtsc() - start) / (u64)(rounds * KBENCH_BATCH), "cycles/op");
+    return 0;
+}
+
+/* Single-page alloc+free through the buddy allocator */
+static int kbench_page_pair(void)
+{
+    u64 start = rdtsc();
+
+    for (int i = 0; i < KBENCH_ROUNDS; i++) {
+        struct page *page = alloc_page(GFP_KERNEL);
+        if (!page) {
+            return -ENOMEM;
+        }
+        free_page(page);
+    }
+
+    kbench_report("page_alloc", 0, (rdtsc() - start) / KBENCH_ROUNDS, "cycles/op");
+    return 0;
+}
+
+int kbench_run(void)
+{
+    int ret = 0;
+
+    for (u64 i = 0; i < ARRAY_SIZE(kbench_sizes) && ret == 0; i++) {
+        ret = kbench_kmalloc_pair(kbench_sizes[i]);
+        if (ret == 0) {
+            ret = kbench_kmalloc_batch(kbench_sizes[i]);
+        }
+    }
+    if (ret == 0) {
+        ret = kbench_page_pair();
+    }
+
+    if (ret < 0) {
+        kprintf("kbench: allocation failed (%d)\n", ret);
+    }
+    return ret;
+}
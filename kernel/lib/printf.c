@@ -14,7 +14,7 @@ extern void serial_putc(char c);
 extern size_t strlen(const char *s);
 
 /* Printf lock for SMP safety */
-static spinlock_t printf_lock = SPINLOCK_INIT;
+static DEFINE_SPINLOCK(printf_lock);
 
 /* Output function pointer (can be changed) */
 static void (*putc_fn)(char c) = serial_putc;
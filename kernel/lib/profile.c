@@ -0,0 +1,253 @@
+/*
+ * Ocean Kernel - Sampling Profiler
+ *
+ * The timer interrupt is the only writer of a CPU's sample buffer and it
+ * does not nest, so each buffer is a single-producer ring: the writer
+ * fills the slot at head and then publishes head, the reader copies the
+ * slot at tail and then publishes tail. A full buffer drops new samples
+ * (and counts them) rather than overwriting ones a reader may be copying.
+ *
+ * Stacks are walked through saved frame pointers, so everything is built
+ * with -fno-omit-frame-pointer. Kernel frames must stay inside the current
+ * thread's kernel stack. User frames are read through the page tables and
+ * the HHDM, never by dereferencing the user address, so a bad frame
+ * pointer ends the walk instead of faulting in interrupt context.
+ */
+
+#include <ocean/profile.h>
+#include <ocean/process.h>
+#include <ocean/sched.h>
+#include <ocean/mutex.h>
+#include <ocean/vmm.h>
+#include <ocean/pmm.h>
+#include <ocean/uaccess.h>
+#include <ocean/smp.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern void *memcpy(void *dest, const void *src, size_t n);
+extern void timer_set_sample_rate(u32 hz);
+
+#define PROFILE_BUFFER_SAMPLES  2048    /* Per CPU; power of two */
+#define PROFILE_BUFFER_MASK     (PROFILE_BUFFER_SAMPLES - 1)
+
+struct profile_buffer {
+    u64 head;                   /* Next slot to write (free-running) */
+    u64 tail;                   /* Next slot to read */
+    u64 lost;                   /* Dropped because the buffer was full */
+    struct profile_sample samples[PROFILE_BUFFER_SAMPLES];
+};
+
+u32 profile_enabled;
+
+static struct profile_buffer profile_buffers[NR_CPUS];
+
+/* Serialises readers and start/stop; copy_to_user may fault and sleep */
+static DEFINE_MUTEX(profile_lock);
+
+/*
+ * Read one word of the current user address space, or fail if the page
+ * is not mapped and user-accessible. Never faults.
+ */
+static bool profile_peek_user(pml4e_t *pml4, u64 addr, u64 *val)
+{
+    pte_t *pte;
+
+    if (addr > USER_SPACE_END - sizeof(u64) || (addr & 7)) {
+        return false;
+    }
+
+    pte = paging_get_pte(pml4, addr);
+    if (!pte || (*pte & (PTE_PRESENT | PTE_USER)) != (PTE_PRESENT | PTE_USER)) {
+        return false;
+    }
+
+    *val = *(u64 *)phys_to_virt((*pte & PTE_ADDR_MASK) | (addr & (PAGE_SIZE - 1)));
+    return true;
+}
+
+static int profile_walk_user(struct thread *t, u64 rbp, u64 *frames)
+{
+    pml4e_t *pml4;
+    int depth = 0;
+
+    if (!t || !t->process || !t->process->mm) {
+        return 0;
+    }
+    pml4 = t->process->mm->pml4;
+
+    while (depth < PROFILE_MAX_FRAMES && rbp) {
+        u64 next, ret;
+
+        if (!profile_peek_user(pml4, rbp, &next) ||
+            !profile_peek_user(pml4, rbp + 8, &ret) || ret == 0) {
+            break;
+        }
+        frames[depth++] = ret;
+
+        /* Stacks grow down, so callers' frames are strictly higher */
+        if (next <= rbp) {
+            break;
+        }
+        rbp = next;
+    }
+
+    return depth;
+}
+
+static int profile_walk_kernel(struct thread *t, u64 rbp, u64 *frames)
+{
+    u64 lo, hi;
+    int depth = 0;
+
+    /* Without known stack bounds there is nothing safe to read */
+    if (!t || !t->kernel_stack) {
+        return 0;
+    }
+    lo = (u64)t->kernel_stack;
+    hi = lo + t->kernel_stack_size;
+
+    while (depth < PROFILE_MAX_FRAMES && rbp >= lo && rbp + 16 <= hi &&
+           !(rbp & 7)) {
+        u64 next = ((u64 *)rbp)[0];
+        u64 ret = ((u64 *)rbp)[1];
+
+        if (ret == 0) {
+            break;
+        }
+        frames[depth++] = ret;
+
+        if (next <= rbp) {
+            break;
+        }
+        rbp = next;
+    }
+
+    return depth;
+}
+
+void __profile_tick(u64 rip, u64 rbp, u8 cpl)
+{
+    int cpu = smp_processor_id();
+    struct profile_buffer *buf = &profile_buffers[cpu];
+    struct thread *t = current_thread;
+    struct profile_sample *s;
+    u64 head = buf->head;
+
+    if (head - __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE) >=
+        PROFILE_BUFFER_SAMPLES) {
+        buf->lost++;
+        return;
+    }
+    s = &buf->samples[head & PROFILE_BUFFER_MASK];
+
+    s->rip = rip;
+    s->cpu = (u16)cpu;
+    s->cpl = cpl;
+    s->reserved = 0;
+    s->tid = t ? (u32)t->tid : 0;
+    if (t && t->process) {
+        s->pid = (u32)t->process->pid;
+        memcpy(s->comm, t->process->name, sizeof(s->comm));
+        s->comm[sizeof(s->comm) - 1] = '\0';
+    } else {
+        s->pid = 0;
+        memcpy(s->comm, "kernel", sizeof("kernel"));
+    }
+
+    if (cpl == 3) {
+        s->depth = (u8)profile_walk_user(t, rbp, s->frames);
+    } else {
+        s->depth = (u8)profile_walk_kernel(t, rbp, s->frames);
+    }
+
+    __atomic_store_n(&buf->head, head + 1, __ATOMIC_RELEASE);
+}
+
+i64 profile_start(u32 hz)
+{
+    u32 mult;
+
+    if (hz == 0) {
+        hz = PROFILE_DEFAULT_HZ;
+    }
+    if (hz > PROFILE_MAX_HZ) {
+        return -EINVAL;
+    }
+
+    /* The timer runs at a multiple of HZ and still ticks the scheduler at HZ */
+    mult = hz / HZ;
+    if (mult == 0) {
+        mult = 1;
+    }
+
+    mutex_lock(&profile_lock);
+    timer_set_sample_rate(mult * HZ);
+    __atomic_store_n(&profile_enabled, 1, __ATOMIC_RELEASE);
+    mutex_unlock(&profile_lock);
+
+    return (i64)(mult * HZ);
+}
+
+void profile_stop(void)
+{
+    mutex_lock(&profile_lock);
+    __atomic_store_n(&profile_enabled, 0, __ATOMIC_RELAXED);
+    timer_set_sample_rate(HZ);
+    mutex_unlock(&profile_lock);
+}
+
+void profile_reset(void)
+{
+    mutex_lock(&profile_lock);
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct profile_buffer *buf = &profile_buffers[cpu];
+
+        __atomic_store_n(&buf->tail, __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE),
+                         __ATOMIC_RELEASE);
+        buf->lost = 0;
+    }
+    mutex_unlock(&profile_lock);
+}
+
+i64 profile_read(int cpu, void *ubuf, u64 max)
+{
+    struct profile_sample *out = ubuf;
+    struct profile_buffer *buf;
+    u64 head, tail, copied = 0;
+    i64 ret = 0;
+
+    if (cpu < 0 || cpu >= NR_CPUS) {
+        return -EINVAL;
+    }
+    buf = &profile_buffers[cpu];
+
+    mutex_lock(&profile_lock);
+
+    head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+    tail = buf->tail;
+
+    while (copied < max && tail != head) {
+        ret = copy_to_user(&out[copied], &buf->samples[tail & PROFILE_BUFFER_MASK],
+                           sizeof(struct profile_sample));
+        if (ret < 0) {
+            break;
+        }
+        copied++;
+        tail++;
+        __atomic_store_n(&buf->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    mutex_unlock(&profile_lock);
+
+    return copied ? (i64)copied : ret;
+}
+
+u64 profile_lost(int cpu)
+{
+    if (cpu < 0 || cpu >= NR_CPUS) {
+        return 0;
+    }
+    return profile_buffers[cpu].lost;
+}
@@ -0,0 +1,239 @@
+/*
+ * Ocean Kernel - Queued Spinlock Slow Path and Lock Statistics
+ *
+ * Each CPU owns a few MCS nodes, one per context that can be spinning at
+ * once (thread, IRQ, NMI, exception). A waiter publishes its node as the
+ * lock's tail, links itself behind the previous tail and spins on its own
+ * node's flag. The head of the queue spins on the lock word itself and,
+ * once it owns the lock, passes headship to the next node.
+ */
+
+#include <ocean/spinlock.h>
+#include <ocean/smp.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+#define MCS_NODES_PER_CPU   4       /* Max nesting of spinning contexts */
+
+struct mcs_spinlock {
+    struct mcs_spinlock *next;
+    volatile u32 locked;            /* Set when we become queue head */
+    u32 count;                      /* Nodes in use (node 0 only, atomic) */
+} __aligned(64);
+
+static struct mcs_spinlock mcs_nodes[NR_CPUS][MCS_NODES_PER_CPU];
+
+static inline u16 encode_tail(int cpu, int idx)
+{
+    return (u16)(((cpu + 1) << 2) | idx);
+}
+
+static inline struct mcs_spinlock *decode_tail(u16 tail)
+{
+    return &mcs_nodes[(tail >> 2) - 1][tail & 3];
+}
+
+void queued_spin_lock_slowpath(spinlock_t *lock)
+{
+    int cpu = smp_processor_id();
+    struct mcs_spinlock *node;
+    struct mcs_spinlock *next;
+    u16 tail, old_tail;
+    u32 val;
+    int idx;
+
+    /*
+     * An interrupt between a plain load and store of count would take the
+     * same node as us. A locked add is one instruction, so a nested
+     * context always gets the next node and gives it back before we resume.
+     */
+    idx = (int)__atomic_fetch_add(&mcs_nodes[cpu][0].count, 1, __ATOMIC_ACQUIRE);
+
+    /* Nested deeper than we have nodes for: fall back to plain spinning */
+    if (idx >= MCS_NODES_PER_CPU) {
+        while (!queued_spin_trylock(lock)) {
+            cpu_pause();
+        }
+        goto release;
+    }
+
+    node = &mcs_nodes[cpu][idx];
+    node->next = NULL;
+    node->locked = 0;
+    tail = encode_tail(cpu, idx);
+    barrier();
+
+    /* The owner may have let go while we were setting up */
+    if (queued_spin_trylock(lock)) {
+        goto release;
+    }
+
+    /* Join the queue; node must be initialised before it is visible */
+    old_tail = __atomic_exchange_n(&lock->tail, tail, __ATOMIC_ACQ_REL);
+    if (old_tail) {
+        struct mcs_spinlock *prev = decode_tail(old_tail);
+
+        __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+        while (!__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) {
+            cpu_pause();
+        }
+    }
+
+    /* Queue head: wait for the owner to drop the locked byte */
+    while ((val = __atomic_load_n(&lock->val, __ATOMIC_ACQUIRE)) & _Q_LOCKED_MASK) {
+        cpu_pause();
+    }
+
+    /* Last in the queue: take the lock and clear the tail in one go */
+    if ((val & _Q_TAIL_MASK) == ((u32)tail << _Q_TAIL_SHIFT) &&
+        __atomic_compare_exchange_n(&lock->val, &val, _Q_LOCKED_VAL, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        goto release;
+    }
+
+    /* Someone queued behind us: take the lock, then make them head */
+    __atomic_store_n(&lock->locked, 1, __ATOMIC_RELAXED);
+    while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))) {
+        cpu_pause();
+    }
+    __atomic_store_n(&next->locked, 1, __ATOMIC_RELEASE);
+
+release:
+    __atomic_fetch_sub(&mcs_nodes[cpu][0].count, 1, __ATOMIC_RELEASE);
+}
+
+#ifdef CONFIG_LOCK_STAT
+
+/* Locks from SPINLOCK_INIT carry no class; they are counted together */
+static struct lock_class unnamed_class = { .name = "(unnamed)" };
+
+static struct lock_class *lock_classes;
+static u32 nr_lock_classes;
+
+static struct lock_class *lock_class_of(spinlock_t *lock)
+{
+    struct lock_class *class = lock->class ? lock->class : &unnamed_class;
+    u32 expected = 0;
+
+    /* Lock-free push: the list lock would itself be a spinlock */
+    if (!__atomic_load_n(&class->registered, __ATOMIC_ACQUIRE) &&
+        __atomic_compare_exchange_n(&class->registered, &expected, 1, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        struct lock_class *head = __atomic_load_n(&lock_classes, __ATOMIC_RELAXED);
+        do {
+            class->next = head;
+        } while (!__atomic_compare_exchange_n(&lock_classes, &head, class, true,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        __atomic_fetch_add(&nr_lock_classes, 1, __ATOMIC_RELAXED);
+    }
+
+    return class;
+}
+
+void lock_stat_acquired(spinlock_t *lock, u64 wait_start, bool contended)
+{
+    struct lock_class *class = lock_class_of(lock);
+    u64 now = rdtsc();
+
+    lock->acquired_at = now;
+    __atomic_fetch_add(&class->acquisitions, 1, __ATOMIC_RELAXED);
+    if (contended) {
+        __atomic_fetch_add(&class->contended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&class->spin_cycles, now - wait_start, __ATOMIC_RELAXED);
+    }
+}
+
+void lock_stat_released(spinlock_t *lock)
+{
+    struct lock_class *class = lock->class ? lock->class : &unnamed_class;
+    u64 held = rdtsc() - lock->acquired_at;
+    u64 max = __atomic_load_n(&class->max_hold_cycles, __ATOMIC_RELAXED);
+
+    while (held > max &&
+           !__atomic_compare_exchange_n(&class->max_hold_cycles, &max, held, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+#define LOCK_STAT_DUMP_MAX  64
+
+/*
+ * Print every class that has been used, worst total spin time first
+ */
+void lock_stat_dump(void)
+{
+    struct lock_class *sorted[LOCK_STAT_DUMP_MAX];
+    struct lock_class *class;
+    int n = 0;
+
+    for (class = __atomic_load_n(&lock_classes, __ATOMIC_ACQUIRE);
+         class && n < LOCK_STAT_DUMP_MAX; class = class->next) {
+        int i = n++;
+
+        while (i > 0 && sorted[i - 1]->spin_cycles < class->spin_cycles) {
+            sorted[i] = sorted[i - 1];
+            i--;
+        }
+        sorted[i] = class;
+    }
+
+    kprintf("\nLock statistics (%u classes, cycles are TSC):\n", nr_lock_classes);
+    kprintf("  %-24s %10s %10s %14s %12s  %s\n",
+            "CLASS", "ACQUIRED", "CONTENDED", "SPIN", "MAX-HOLD", "SITE");
+
+    for (int i = 0; i < n; i++) {
+        class = sorted[i];
+        const char *name = class->name[0] == '&' ? class->name + 1 : class->name;
+
+        if (class->file) {
+            kprintf("  %-24s %10llu %10llu %14llu %12llu  %s:%d\n", name,
+                    class->acquisitions, class->contended, class->spin_cycles,
+                    class->max_hold_cycles, class->file, class->line);
+        } else {
+            kprintf("  %-24s %10llu %10llu %14llu %12llu  -\n", name,
+                    class->acquisitions, class->contended, class->spin_cycles,
+                    class->max_hold_cycles);
+        }
+    }
+}
+
+void lock_stat_reset(void)
+{
+    struct lock_class *class;
+
+    for (class = __atomic_load_n(&lock_classes, __ATOMIC_ACQUIRE);
+         class; class = class->next) {
+        __atomic_store_n(&class->acquisitions, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&class->contended, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&class->spin_cycles, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&class->max_hold_cycles, 0, __ATOMIC_RELAXED);
+    }
+}
+
+#else /* !CONFIG_LOCK_STAT */
+
+void lock_stat_acquired(spinlock_t *lock, u64 wait_start, bool contended)
+{
+    (void)lock;
+    (void)wait_start;
+    (void)contended;
+}
+
+void lock_stat_released(spinlock_t *lock)
+{
+    (void)lock;
+}
+
+void lock_stat_dump(void)
+{
+    kprintf("Lock statistics not built in (rebuild with LOCK_STAT=1)\n");
+}
+
+void lock_stat_reset(void)
+{
+}
+
+#endif /* CONFIG_LOCK_STAT */
@@ -0,0 +1,164 @@
+/*
+ * Ocean Kernel - Trace Buffers
+ *
+ * Each CPU owns a ring of trace_records. Writers on that CPU reserve a
+ * slot with one atomic add on the head, so a tracepoint hit in an
+ * interrupt that lands mid-record simply takes the next slot. A slot's
+ * event field is cleared while it is being filled and set last, so a
+ * reader can tell finished records from ones still being written. When
+ * the ring is full the oldest records are overwritten and counted lost.
+ */
+
+#include <ocean/trace.h>
+#include <ocean/mutex.h>
+#include <ocean/sched.h>
+#include <ocean/uaccess.h>
+#include <ocean/smp.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+#define TRACE_BUFFER_RECORDS    4096    /* Per CPU; power of two */
+#define TRACE_BUFFER_MASK       (TRACE_BUFFER_RECORDS - 1)
+
+struct trace_buffer {
+    u64 head;                   /* Next slot to write (free-running) */
+    u64 tail;                   /* Next slot to read */
+    u64 lost;                   /* Overwritten before they were read */
+    struct trace_record records[TRACE_BUFFER_RECORDS];
+};
+
+u64 trace_event_mask;
+
+static struct trace_buffer trace_buffers[NR_CPUS];
+
+/* Serialises readers; copy_to_user may fault and sleep */
+static DEFINE_MUTEX(trace_read_lock);
+
+/* Clock reference for converting TSC deltas to time */
+static u64 trace_tsc_base;
+static u64 trace_tick_base;
+
+void __trace_record(int event, u64 a0, u64 a1, u64 a2)
+{
+    int cpu = smp_processor_id();
+    struct trace_buffer *buf = &trace_buffers[cpu];
+    u64 pos = __atomic_fetch_add(&buf->head, 1, __ATOMIC_RELAXED);
+    struct trace_record *rec = &buf->records[pos & TRACE_BUFFER_MASK];
+
+    __atomic_store_n(&rec->event, TRACE_NONE, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    rec->tsc = rdtsc();
+    rec->cpu = (u16)cpu;
+    rec->tid = current_thread ? (u32)current_thread->tid : 0;
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+
+    __atomic_store_n(&rec->event, (u16)event, __ATOMIC_RELEASE);
+}
+
+void trace_set_mask(u64 mask)
+{
+    /* Bit 0 is TRACE_NONE and never recorded */
+    __atomic_store_n(&trace_event_mask, mask & ~1ULL, __ATOMIC_RELAXED);
+}
+
+void trace_reset(void)
+{
+    mutex_lock(&trace_read_lock);
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct trace_buffer *buf = &trace_buffers[cpu];
+
+        buf->tail = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+        buf->lost = 0;
+    }
+    mutex_unlock(&trace_read_lock);
+}
+
+i64 trace_read(int cpu, void *ubuf, u64 max)
+{
+    struct trace_record *out = ubuf;
+    struct trace_buffer *buf;
+    u64 head, copied = 0;
+    i64 ret = 0;
+
+    if (cpu < 0 || cpu >= NR_CPUS) {
+        return -EINVAL;
+    }
+    buf = &trace_buffers[cpu];
+
+    mutex_lock(&trace_read_lock);
+
+    head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+    if (head - buf->tail > TRACE_BUFFER_RECORDS) {
+        buf->lost += head - buf->tail - TRACE_BUFFER_RECORDS;
+        buf->tail = head - TRACE_BUFFER_RECORDS;
+    }
+
+    while (copied < max && buf->tail != head) {
+        struct trace_record *rec = &buf->records[buf->tail & TRACE_BUFFER_MASK];
+        struct trace_record snap;
+
+        snap.event = __atomic_load_n(&rec->event, __ATOMIC_ACQUIRE);
+        if (snap.event == TRACE_NONE) {
+            break;              /* Still being written */
+        }
+        snap.tsc = rec->tsc;
+        snap.cpu = rec->cpu;
+        snap.tid = rec->tid;
+        snap.args[0] = rec->args[0];
+        snap.args[1] = rec->args[1];
+        snap.args[2] = rec->args[2];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        /* Lapped by writers while we copied: the snapshot may be torn */
+        if (__atomic_load_n(&buf->head, __ATOMIC_RELAXED) - buf->tail >
+            TRACE_BUFFER_RECORDS) {
+            buf->lost++;
+            buf->tail++;
+            continue;
+        }
+
+        ret = copy_to_user(&out[copied], &snap, sizeof(snap));
+        if (ret < 0) {
+            break;
+        }
+        copied++;
+        buf->tail++;
+    }
+
+    mutex_unlock(&trace_read_lock);
+
+    return copied ? (i64)copied : ret;
+}
+
+u64 trace_lost(int cpu)
+{
+    if (cpu < 0 || cpu >= NR_CPUS) {
+        return 0;
+    }
+    return trace_buffers[cpu].lost;
+}
+
+u64 trace_tsc_hz(void)
+{
+    u64 ticks = get_ticks() - trace_tick_base;
+
+    if (ticks == 0) {
+        return 0;
+    }
+    return (rdtsc() - trace_tsc_base) * HZ / ticks;
+}
+
+void trace_init(void)
+{
+    trace_tsc_base = rdtsc();
+    trace_tick_base = get_ticks();
+
+    kprintf("Trace: %d events, %d records per CPU\n",
+            TRACE_NR_EVENTS - 1, TRACE_BUFFER_RECORDS);
+}
@@ -147,7 +147,7 @@ struct page *buddy_alloc_pages(struct zone *zone, unsigned int order)
 
         /* Update statistics */
         zone->free_pages -= (1UL << order);
-        zone->alloc_count++;
+        percpu_counter_inc(&zone->alloc_count);
 
         break;
     }
@@ -198,7 +198,7 @@ void buddy_free_pages(struct zone *zone, struct page *page, unsigned int order)
 
     /* Update statistics */
     zone->free_pages += (1UL << order);
-    zone->free_count++;
+    percpu_counter_inc(&zone->free_count);
 
     spin_unlock_irqrestore(&zone->lock, flags);
 }
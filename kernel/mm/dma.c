@@ -0,0 +1,199 @@
+/*
+ * Ocean Kernel - DMA Buffers
+ *
+ * Contiguous, pinned buffers for userspace drivers (see ocean/dma.h).
+ * Each buffer is one buddy block from ZONE_DMA32, falling back to
+ * ZONE_DMA, mapped into the driver as a VMA_PINNED region so the VM
+ * code leaves the frames alone; this file frees them.
+ *
+ * The kernel's own HHDM alias of a buffer stays write-back. The kernel
+ * does not touch a buffer after zeroing it, and an uncached or
+ * write-combining buffer is flushed from the cache before the driver
+ * sees it, so no dirty line can later land on top of device writes.
+ */
+
+#include <ocean/dma.h>
+#include <ocean/pmm.h>
+#include <ocean/vmm.h>
+#include <ocean/process.h>
+#include <ocean/mutex.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern void *kmalloc(size_t size);
+extern void kfree(void *ptr);
+
+#define DMA_CACHE_LINE      64
+
+static_assert(DMA_MAX_PAGES <= MAX_ORDER_PAGES, "DMA buffer larger than a buddy block");
+
+static unsigned int dma_order(u64 pages)
+{
+    unsigned int order = 0;
+
+    while ((1UL << order) < pages) {
+        order++;
+    }
+    return order;
+}
+
+static void dma_flush_cache(void *addr, u64 size)
+{
+    for (u64 off = 0; off < size; off += DMA_CACHE_LINE) {
+        __asm__ __volatile__("clflush (%0)" : : "r"((u8 *)addr + off) : "memory");
+    }
+    __asm__ __volatile__("mfence" : : : "memory");
+}
+
+static u32 dma_vma_flags(u32 cache)
+{
+    u32 flags = VMA_READ | VMA_WRITE | VMA_SHARED | VMA_PINNED;
+
+    if (cache == DMA_CACHE_UC) {
+        flags |= VMA_UNCACHED;
+    } else if (cache == DMA_CACHE_WC) {
+        flags |= VMA_WC;
+    }
+    return flags;
+}
+
+int dma_alloc(struct process *proc, u64 pages, u32 cache, struct dma_region *out)
+{
+    struct address_space *as = proc->mm;
+    struct dma_buffer *buf;
+    struct page *block;
+    u64 size, flags;
+    int err;
+
+    if (pages == 0 || pages > DMA_MAX_PAGES || cache > DMA_CACHE_WC) {
+        return -EINVAL;
+    }
+    if (!as) {
+        return -EINVAL;
+    }
+
+    spin_lock_irqsave(&proc->lock, &flags);
+    if (proc->dma_pages + pages > DMA_PROC_MAX_PAGES) {
+        spin_unlock_irqrestore(&proc->lock, flags);
+        return -ENOSPC;
+    }
+    proc->dma_pages += pages;
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    err = -ENOMEM;
+    buf = kmalloc(sizeof(*buf));
+    if (!buf) {
+        goto unaccount;
+    }
+
+    buf->pages = pages;
+    buf->order = dma_order(pages);
+    buf->cache = cache;
+    INIT_LIST_HEAD(&buf->link);
+
+    block = alloc_pages_zone(ZONE_DMA32, buf->order, GFP_USER | GFP_ZERO);
+    if (!block) {
+        block = alloc_pages_zone(ZONE_DMA, buf->order, GFP_USER | GFP_ZERO);
+    }
+    if (!block) {
+        goto free_buf;
+    }
+    buf->phys = page_to_phys(block);
+
+    size = pages * PAGE_SIZE;
+    if (cache != DMA_CACHE_WB) {
+        dma_flush_cache(phys_to_virt(buf->phys), size);
+    }
+
+    mutex_lock(&as->lock);
+    /* A vfork child would leave the mapping behind in its parent */
+    if (as->ref_count > 1) {
+        mutex_unlock(&as->lock);
+        err = -EBUSY;
+        goto free_block;
+    }
+    buf->virt = vmm_get_unmapped_area(as, size);
+    if (buf->virt == (u64)-1 ||
+        vmm_map_to_user(as, buf->virt, buf->phys, size, dma_vma_flags(cache)) != 0) {
+        mutex_unlock(&as->lock);
+        goto free_block;
+    }
+    mutex_unlock(&as->lock);
+
+    spin_lock_irqsave(&proc->lock, &flags);
+    list_add_tail(&buf->link, &proc->dma_buffers);
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    out->virt = buf->virt;
+    out->phys = buf->phys;
+    out->pages = pages;
+    out->pid = (u32)proc->pid;
+    out->cache = cache;
+    return 0;
+
+free_block:
+    free_pages(block, buf->order);
+free_buf:
+    kfree(buf);
+unaccount:
+    spin_lock_irqsave(&proc->lock, &flags);
+    proc->dma_pages -= pages;
+    spin_unlock_irqrestore(&proc->lock, flags);
+    return err;
+}
+
+int dma_free(struct process *proc, u64 phys)
+{
+    struct dma_buffer *buf = NULL, *pos;
+    u64 flags, pages;
+
+    spin_lock_irqsave(&proc->lock, &flags);
+    list_for_each_entry(pos, &proc->dma_buffers, link) {
+        if (pos->phys == phys) {
+            buf = pos;
+            list_del_init(&buf->link);
+            proc->dma_pages -= buf->pages;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    if (!buf) {
+        return -ENOENT;
+    }
+
+    if (proc->mm) {
+        mutex_lock(&proc->mm->lock);
+        vmm_unmap_region(proc->mm, buf->virt, buf->pages * PAGE_SIZE);
+        mutex_unlock(&proc->mm->lock);
+    }
+
+    pages = buf->pages;
+    free_pages(phys_to_page(buf->phys), buf->order);
+    kfree(buf);
+    return (int)pages;
+}
+
+void dma_release_all(struct process *proc)
+{
+    for (;;) {
+        struct dma_buffer *buf = NULL;
+        u64 flags;
+
+        spin_lock_irqsave(&proc->lock, &flags);
+        if (!list_empty(&proc->dma_buffers)) {
+            buf = list_first_entry(&proc->dma_buffers, struct dma_buffer, link);
+            list_del_init(&buf->link);
+            proc->dma_pages -= buf->pages;
+        }
+        spin_unlock_irqrestore(&proc->lock, flags);
+
+        if (!buf) {
+            break;
+        }
+
+        free_pages(phys_to_page(buf->phys), buf->order);
+        kfree(buf);
+    }
+}
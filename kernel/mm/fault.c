@@ -2,12 +2,17 @@
  * Ocean Kernel - Page Fault Handler
  *
  * Handles page faults for demand paging, copy-on-write,
- * and stack growth.
+ * stack growth and pager-backed regions.
  */
 
 #include <ocean/vmm.h>
 #include <ocean/pmm.h>
+#include <ocean/pager.h>
+#include <ocean/process.h>
+#include <ocean/ipc_proto.h>
 #include <ocean/boot.h>
+#include <ocean/sched.h>
+#include <ocean/trace.h>
 #include <ocean/types.h>
 #include <ocean/defs.h>
 
@@ -165,6 +170,9 @@ int vmm_page_fault(u64 fault_addr, u64 error_code)
 
     /* Kernel faults are always fatal for now */
     if (!is_user && fault_addr >= KERNEL_SPACE_START) {
+        if (kstack_is_guard(fault_addr)) {
+            kprintf("Kernel stack overflow at 0x%llx\n", fault_addr);
+        }
         kprintf("Kernel page fault at 0x%llx (error 0x%llx)\n",
                 fault_addr, error_code);
         return -1;
@@ -207,6 +215,22 @@ int vmm_page_fault(u64 fault_addr, u64 error_code)
 
     /* Check if page is present */
     if (!is_present) {
+        if (vma->flags & VMA_PAGER) {
+            /* The uaccess helpers fault pager pages in before the kernel copies */
+            if (!is_user) {
+                kprintf("Page fault: kernel access to pager page 0x%llx\n", fault_addr);
+                return -1;
+            }
+            u32 access = PAGER_ACCESS_READ;
+            if (is_write) {
+                access |= PAGER_ACCESS_WRITE;
+            }
+            if (error_code & PF_INSTR) {
+                access |= PAGER_ACCESS_EXEC;
+            }
+            return pager_fault(as, fault_addr, access) == 0 ? 0 : -EFAULT;
+        }
+
         /* Demand paging - allocate page on first access */
         return handle_demand_fault(as, fault_addr, vma);
     }
@@ -228,14 +252,26 @@ int vmm_page_fault(u64 fault_addr, u64 error_code)
 /*
  * Called from IDT exception handler for #PF
  */
-void page_fault_handler(u64 error_code)
+void page_fault_handler(u64 error_code, u64 rip)
 {
     u64 fault_addr = read_cr2();
 
-    if (vmm_page_fault(fault_addr, error_code) != 0) {
+    trace_page_fault(fault_addr, error_code, rip);
+
+    int reason = sched_block_reason_set(SCHED_BLOCK_FAULT);
+    int ret = vmm_page_fault(fault_addr, error_code);
+    sched_block_reason_restore(reason);
+
+    if (ret == -EFAULT) {
+        /* The pager is just another process; only its client pays */
+        kprintf("Page fault: killing pid %d at 0x%llx (rip 0x%llx)\n",
+                get_current_process()->pid, fault_addr, rip);
+        process_exit(EXIT_FAULT);
+    }
+    if (ret != 0) {
         /* Fault could not be handled - this is a fatal error */
         extern void panic(const char *fmt, ...) __noreturn;
-        panic("Unhandled page fault at 0x%lx (error 0x%lx)",
-              fault_addr, error_code);
+        panic("Unhandled page fault at 0x%lx (error 0x%lx, rip 0x%lx)",
+              fault_addr, error_code, rip);
     }
 }
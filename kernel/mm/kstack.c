@@ -0,0 +1,212 @@
+/*
+ * Ocean Kernel - Kernel Stack Cache
+ *
+ * Thread kernel stacks live in the KERNEL_STACK_BASE region. Each stack
+ * occupies the top half of a slot whose bottom half is never mapped, so
+ * running off the end of a stack faults instead of silently corrupting
+ * whatever heap object happened to sit below it.
+ *
+ * Freed stacks are parked in a small per-CPU cache and handed out again
+ * as-is: the stack stays mapped and is not re-zeroed, since thread setup
+ * writes the initial frame explicitly. Only cache overflow goes back to
+ * the page allocator.
+ */
+
+#include <ocean/vmm.h>
+#include <ocean/pmm.h>
+#include <ocean/idr.h>
+#include <ocean/process.h>
+#include <ocean/smp.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+extern void tss_set_ist(int ist, u64 stack);
+
+/* PMM functions */
+extern void *simple_get_free_page(void);
+extern void simple_free_page(void *addr);
+
+#define KSTACK_SLOT_SIZE    (2 * KERNEL_STACK_SIZE)     /* Guard + stack */
+#define KSTACK_PAGES        (KERNEL_STACK_SIZE / PAGE_SIZE)
+#define KSTACK_MAX_SLOTS    (PID_MAX + NR_CPUS * KSTACK_CACHE_SIZE + 1)
+#define KSTACK_CACHE_SIZE   16      /* Stacks kept per CPU */
+#define KSTACK_PREFILL      4       /* Stacks mapped at boot */
+#define KSTACK_DF_IST       1       /* IST slot used by the #DF gate */
+
+struct kstack_cache {
+    void *stacks[KSTACK_CACHE_SIZE];
+    int count;
+};
+
+static struct kstack_cache kstack_caches[NR_CPUS];
+static struct idr kstack_slots;
+
+/* Statistics */
+static DEFINE_PERCPU_COUNTER(kstack_mapped);
+static DEFINE_PERCPU_COUNTER(kstack_cache_hits);
+
+static inline u64 kstack_slot_base(int slot)
+{
+    return KERNEL_STACK_BASE + (u64)slot * KSTACK_SLOT_SIZE;
+}
+
+static inline int kstack_slot_of(void *stack)
+{
+    return (int)(((u64)stack - KERNEL_STACK_BASE) / KSTACK_SLOT_SIZE);
+}
+
+/* Unmap a stack and return its pages and slot */
+static void kstack_unmap(void *stack)
+{
+    u64 base = (u64)stack;
+
+    for (u64 i = 0; i < KSTACK_PAGES; i++) {
+        u64 va = base + i * PAGE_SIZE;
+        phys_addr_t phys = paging_get_phys(kernel_space.pml4, va);
+
+        if (phys != (phys_addr_t)-1) {
+            paging_unmap(kernel_space.pml4, va);
+            simple_free_page(phys_to_virt(phys));
+        }
+    }
+
+    idr_remove(&kstack_slots, kstack_slot_of(stack));
+    percpu_counter_dec(&kstack_mapped);
+}
+
+/* Map a fresh, zeroed stack into a new slot */
+static void *kstack_map(void)
+{
+    int slot = idr_alloc(&kstack_slots, NULL, 0);
+    if (slot < 0) {
+        return NULL;
+    }
+
+    /* Lower half of the slot stays unmapped as the guard */
+    void *stack = (void *)(kstack_slot_base(slot) + KERNEL_STACK_SIZE);
+    percpu_counter_inc(&kstack_mapped);
+
+    for (u64 i = 0; i < KSTACK_PAGES; i++) {
+        void *page = simple_get_free_page();
+        if (!page) {
+            kstack_unmap(stack);
+            return NULL;
+        }
+
+        memset(page, 0, PAGE_SIZE);
+        if (paging_map(kernel_space.pml4, (u64)stack + i * PAGE_SIZE,
+                       virt_to_phys(page),
+                       PTE_PRESENT | PTE_WRITABLE | PTE_NX) != 0) {
+            simple_free_page(page);
+            kstack_unmap(stack);
+            return NULL;
+        }
+    }
+
+    return stack;
+}
+
+/*
+ * Allocate a KERNEL_STACK_SIZE kernel stack. Cached stacks keep whatever
+ * their previous thread left in them.
+ */
+void *kstack_alloc(void)
+{
+    struct kstack_cache *cache = &kstack_caches[smp_processor_id()];
+    void *stack = NULL;
+    u64 flags;
+
+    flags = local_irq_save();
+    if (cache->count > 0) {
+        stack = cache->stacks[--cache->count];
+    }
+    local_irq_restore(flags);
+
+    if (stack) {
+        percpu_counter_inc(&kstack_cache_hits);
+        return stack;
+    }
+
+    return kstack_map();
+}
+
+/*
+ * Release a kernel stack. The caller must no longer be running on it.
+ */
+void kstack_free(void *stack)
+{
+    struct kstack_cache *cache = &kstack_caches[smp_processor_id()];
+    bool cached = false;
+    u64 flags;
+
+    if (!stack) {
+        return;
+    }
+
+    flags = local_irq_save();
+    if (cache->count < KSTACK_CACHE_SIZE) {
+        cache->stacks[cache->count++] = stack;
+        cached = true;
+    }
+    local_irq_restore(flags);
+
+    if (!cached) {
+        kstack_unmap(stack);
+    }
+}
+
+/*
+ * Set up the stack region. Must run before the first user address space
+ * is created: process page tables copy the kernel PML4 entries once, so
+ * the entry covering KERNEL_STACK_BASE has to exist by then.
+ */
+void kstack_cache_init(void)
+{
+    struct kstack_cache *cache = &kstack_caches[smp_processor_id()];
+
+    idr_init(&kstack_slots, KSTACK_MAX_SLOTS);
+
+    for (int i = 0; i < KSTACK_PREFILL; i++) {
+        void *stack = kstack_map();
+        if (!stack) {
+            break;
+        }
+        cache->stacks[cache->count++] = stack;
+    }
+
+    /*
+     * A guard-page hit faults with no usable stack, which escalates to a
+     * double fault; give #DF its own stack so that gets reported.
+     */
+    void *df_stack = kstack_map();
+    if (df_stack) {
+        tss_set_ist(KSTACK_DF_IST, (u64)df_stack + KERNEL_STACK_SIZE);
+    }
+
+    kprintf("Kernel stacks: %d KiB + %d KiB guard, %d cached\n",
+            KERNEL_STACK_SIZE / 1024, KERNEL_STACK_SIZE / 1024, cache->count);
+}
+
+/*
+ * Check whether a kernel fault address lands in a stack guard region
+ */
+bool kstack_is_guard(u64 addr)
+{
+    if (addr < KERNEL_STACK_BASE ||
+        addr >= KERNEL_STACK_BASE + (u64)KSTACK_MAX_SLOTS * KSTACK_SLOT_SIZE) {
+        return false;
+    }
+
+    return (addr - KERNEL_STACK_BASE) % KSTACK_SLOT_SIZE < KERNEL_STACK_SIZE;
+}
+
+void kstack_dump_stats(void)
+{
+    kprintf("Kernel stacks: %llu mapped, %d cached, %llu cache hits\n",
+            percpu_counter_sum_positive(&kstack_mapped),
+            kstack_caches[smp_processor_id()].count,
+            percpu_counter_sum_positive(&kstack_cache_hits));
+}
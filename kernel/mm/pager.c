@@ -0,0 +1,453 @@
+/*
+ * Ocean Kernel - External Pagers
+ *
+ * See ocean/pager.h. Regions sit on one global list under pager_lock,
+ * found by address space and address on a fault and by ID on a supply.
+ * A system has a handful of regions, and either lookup is cheap next to
+ * the round trip to the pager. Once mapped, supplied frames are ordinary
+ * anonymous memory of the client and go with its address space.
+ *
+ * Locking: pager_lock may be taken under an address-space mutex, never
+ * the other way round, and no two address-space mutexes are held at once.
+ */
+
+#include <ocean/pager.h>
+#include <ocean/ipc.h>
+#include <ocean/ipc_proto.h>
+#include <ocean/vmm.h>
+#include <ocean/boot.h>
+#include <ocean/idr.h>
+#include <ocean/process.h>
+#include <ocean/mutex.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+extern void *kmalloc(size_t size);
+extern void kfree(void *ptr);
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/* PMM functions */
+extern void *simple_get_free_page(void);
+extern void simple_free_page(void *addr);
+
+/* Boot info */
+extern const struct boot_info *get_boot_info(void);
+
+static_assert(PAGER_ACCESS_MASK < PAGE_SIZE, "access bits overlap the page offset");
+
+static DEFINE_SPINLOCK(pager_lock);
+static LIST_HEAD(pager_list);
+static struct idr pager_idr;
+
+void pager_init(void)
+{
+    idr_init(&pager_idr, PAGER_MAX_ID);
+}
+
+static void *frame_kva(phys_addr_t phys)
+{
+    return (void *)(phys + get_boot_info()->hhdm_offset);
+}
+
+static void frame_free(phys_addr_t phys)
+{
+    simple_free_page(frame_kva(phys));
+}
+
+/* Take a region off the list and out of the idr; pager_lock held */
+static void region_unlink(struct pager_region *region)
+{
+    list_del_init(&region->link);
+    idr_remove(&pager_idr, (int)region->id);
+}
+
+/* The region of as covering addr; pager_lock held */
+static struct pager_region *region_at(struct address_space *as, u64 addr)
+{
+    struct pager_region *region;
+
+    list_for_each_entry(region, &pager_list, link) {
+        if (region->as == as && addr >= region->start &&
+            addr - region->start < region->pages * PAGE_SIZE) {
+            return region;
+        }
+    }
+    return NULL;
+}
+
+static bool page_present(struct address_space *as, u64 addr)
+{
+    pte_t *pte = paging_get_pte(as->pml4, addr);
+
+    return pte && (*pte & PTE_PRESENT);
+}
+
+/* Does proc own endpoint? */
+static bool pager_owns(struct process *proc, u32 endpoint)
+{
+    struct ipc_endpoint *ep = endpoint_get(endpoint);
+    bool owns = ep && ep->owner == proc;
+
+    endpoint_put(ep);
+    return owns;
+}
+
+i64 pager_map(struct process *pager, struct process *client, u32 endpoint,
+              u64 pages, u32 prot, u64 cookie)
+{
+    struct address_space *as = client->mm;
+    struct pager_region *region, *pos;
+    int nr_regions = 0, id;
+    i64 err = 0;
+    u64 flags, size;
+
+    if (pages == 0 || pages > PAGER_MAX_PAGES || !(prot & VMA_READ) ||
+        (prot & ~(VMA_READ | VMA_WRITE | VMA_EXEC))) {
+        return -EINVAL;
+    }
+    /* A pager cannot wait on itself */
+    if (!as || client == pager) {
+        return -EINVAL;
+    }
+    if (!pager_owns(pager, endpoint)) {
+        return -EPERM;
+    }
+
+    region = kmalloc(sizeof(*region));
+    if (!region) {
+        return -ENOMEM;
+    }
+    memset(region, 0, sizeof(*region));
+
+    id = idr_alloc_cyclic(&pager_idr, NULL, 1);
+    if (id < 0) {
+        kfree(region);
+        return id;
+    }
+    region->id = (u32)id;
+    region->endpoint = endpoint;
+    region->cookie = cookie;
+    region->as = as;
+    region->pages = pages;
+    INIT_LIST_HEAD(&region->link);
+    size = pages * PAGE_SIZE;
+
+    mutex_lock(&as->lock);
+    region->start = vmm_get_unmapped_area(as, size);
+    if (region->start == (u64)-1) {
+        err = -ENOMEM;
+    } else {
+        /* Listed before the VMA exists, so no fault can miss it */
+        spin_lock_irqsave(&pager_lock, &flags);
+        list_for_each_entry(pos, &pager_list, link) {
+            if (pos->as == as) {
+                nr_regions++;
+            }
+        }
+        if (nr_regions >= PAGER_AS_MAX_REGIONS) {
+            err = -ENOSPC;
+        } else {
+            list_add_tail(&region->link, &pager_list);
+            idr_replace(&pager_idr, id, region);
+        }
+        spin_unlock_irqrestore(&pager_lock, flags);
+    }
+    if (!err && vmm_reserve_region(as, region->start, size, prot | VMA_PAGER) != 0) {
+        err = -ENOMEM;
+        spin_lock_irqsave(&pager_lock, &flags);
+        list_del_init(&region->link);
+        spin_unlock_irqrestore(&pager_lock, flags);
+    }
+    mutex_unlock(&as->lock);
+
+    if (err) {
+        idr_remove(&pager_idr, id);
+        kfree(region);
+        return err;
+    }
+    return (i64)region->start;
+}
+
+int pager_unmap(struct process *client, u64 start)
+{
+    struct address_space *as = client->mm;
+    struct pager_region *region;
+    u64 flags;
+
+    if (!as) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&as->lock);
+    spin_lock_irqsave(&pager_lock, &flags);
+    region = region_at(as, start);
+    if (region && region->start == start) {
+        region_unlink(region);
+    } else {
+        region = NULL;
+    }
+    spin_unlock_irqrestore(&pager_lock, flags);
+
+    if (region) {
+        vmm_unmap_region(as, region->start, region->pages * PAGE_SIZE);
+    }
+    mutex_unlock(&as->lock);
+
+    if (!region) {
+        return -ENOENT;
+    }
+    kfree(region);
+    return 0;
+}
+
+/*
+ * Pull pages pages at src out of the pager into frames[]. A private page
+ * is unmapped and handed over whole, leaving the pager a fresh zero page
+ * on its next touch; pinned and shared memory, and the IPC window, are
+ * copied; a page never touched becomes a zero page. The range is checked
+ * before anything moves.
+ */
+static int pager_take_frames(struct address_space *src_as, u64 src, u64 pages,
+                             phys_addr_t *frames)
+{
+    u64 taken = 0;
+    int err = 0;
+
+    mutex_lock(&src_as->lock);
+
+    for (u64 i = 0; i < pages; i++) {
+        struct vm_area *vma = vmm_find_vma(src_as, src + i * PAGE_SIZE);
+
+        if (!vma || !(vma->flags & VMA_READ)) {
+            err = -EFAULT;
+            goto out;
+        }
+    }
+
+    for (; taken < pages; taken++) {
+        u64 addr = src + taken * PAGE_SIZE;
+        struct vm_area *vma = vmm_find_vma(src_as, addr);
+        pte_t *pte = paging_get_pte(src_as->pml4, addr);
+        bool present = pte && (*pte & PTE_PRESENT);
+        bool movable = !(vma->flags & (VMA_PINNED | VMA_SHARED)) &&
+                       addr - OCEAN_IPC_WINDOW_VA >= OCEAN_IPC_WINDOW_SIZE;
+
+        if (present && movable) {
+            frames[taken] = *pte & PTE_ADDR_MASK;
+            paging_unmap(src_as->pml4, addr);
+            if (src_as->total_vm > 0) {
+                src_as->total_vm--;
+            }
+            continue;
+        }
+
+        void *page = simple_get_free_page();
+        if (!page) {
+            err = -ENOMEM;
+            break;
+        }
+        if (present) {
+            memcpy(page, frame_kva(*pte & PTE_ADDR_MASK), PAGE_SIZE);
+        } else {
+            memset(page, 0, PAGE_SIZE);
+        }
+        frames[taken] = (phys_addr_t)page - get_boot_info()->hhdm_offset;
+    }
+
+out:
+    mutex_unlock(&src_as->lock);
+
+    if (err) {
+        while (taken > 0) {
+            frame_free(frames[--taken]);
+        }
+    }
+    return err;
+}
+
+int pager_supply(struct process *pager, struct process *client, u32 id,
+                 u64 offset, u64 src, u64 pages)
+{
+    struct address_space *as = client->mm;
+    phys_addr_t frames[PAGER_MAX_CLUSTER];
+    struct pager_region *region;
+    u32 endpoint = 0;
+    u64 flags, start = 0;
+    int mapped = 0, err = 0;
+
+    if (!as || !pager->mm || pager->mm == as) {
+        return -EINVAL;
+    }
+    if (pages == 0 || pages > PAGER_MAX_CLUSTER ||
+        (offset & (PAGE_SIZE - 1)) || (src & (PAGE_SIZE - 1))) {
+        return -EINVAL;
+    }
+    if (src > USER_SPACE_END || pages * PAGE_SIZE > USER_SPACE_END - src) {
+        return -EFAULT;
+    }
+
+    spin_lock_irqsave(&pager_lock, &flags);
+    region = idr_find(&pager_idr, (int)id);
+    if (!region || region->as != as) {
+        err = -ENOENT;
+    } else if (offset / PAGE_SIZE >= region->pages ||
+               pages > region->pages - offset / PAGE_SIZE) {
+        err = -EINVAL;
+    } else {
+        endpoint = region->endpoint;
+        start = region->start + offset;
+    }
+    spin_unlock_irqrestore(&pager_lock, flags);
+
+    if (err) {
+        return err;
+    }
+    if (!pager_owns(pager, endpoint)) {
+        return -EPERM;
+    }
+
+    err = pager_take_frames(pager->mm, src, pages, frames);
+    if (err) {
+        return err;
+    }
+
+    mutex_lock(&as->lock);
+
+    /* The region may have been unmapped while we were in the pager */
+    spin_lock_irqsave(&pager_lock, &flags);
+    region = idr_find(&pager_idr, (int)id);
+    bool live = region && region->as == as && region_at(as, start) == region;
+    spin_unlock_irqrestore(&pager_lock, flags);
+
+    for (u64 i = 0; i < pages; i++) {
+        u64 addr = start + i * PAGE_SIZE;
+        struct vm_area *vma = live ? vmm_find_vma(as, addr) : NULL;
+
+        /* Lost a race with another fault on the same page: keep theirs */
+        if (!vma || !(vma->flags & VMA_PAGER) || page_present(as, addr) ||
+            paging_map(as->pml4, addr, frames[i], vma->page_prot) != 0) {
+            frame_free(frames[i]);
+            continue;
+        }
+        mapped++;
+    }
+    as->total_vm += (u64)mapped;
+
+    mutex_unlock(&as->lock);
+    return mapped;
+}
+
+/* Not-present pages from addr on, as far as the region and one supply reach */
+static u64 pager_cluster(struct address_space *as, u64 addr, u64 left)
+{
+    u64 n = 0;
+
+    while (n < left && n < PAGER_MAX_CLUSTER &&
+           !page_present(as, addr + n * PAGE_SIZE)) {
+        n++;
+    }
+    return n;
+}
+
+int pager_fault(struct address_space *as, u64 addr, u32 access)
+{
+    struct process *self = get_current_process();
+    u64 page_addr = addr & ~(u64)(PAGE_SIZE - 1);
+    struct pager_region *region;
+    struct ipc_endpoint *ep;
+    struct ipc_message msg;
+    u64 flags, offset = 0, left = 0, cookie = 0;
+    u32 id = 0, endpoint = 0;
+    bool found = false;
+
+    spin_lock_irqsave(&pager_lock, &flags);
+    region = region_at(as, page_addr);
+    if (region) {
+        id = region->id;
+        endpoint = region->endpoint;
+        cookie = region->cookie;
+        offset = page_addr - region->start;
+        left = region->pages - offset / PAGE_SIZE;
+        found = true;
+    }
+    spin_unlock_irqrestore(&pager_lock, flags);
+
+    if (!found) {
+        kprintf("Page fault: no pager region at 0x%llx\n", addr);
+        return -1;
+    }
+
+    ep = endpoint_get(endpoint);
+    if (!ep) {
+        kprintf("Page fault: pager of region %u is gone\n", id);
+        return -1;
+    }
+    if (ep->owner == self) {
+        endpoint_put(ep);
+        kprintf("Page fault: pager faulted on its own region %u\n", id);
+        return -1;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.tag = MSG_TAG(PAGER_FAULT, 4, 0, 0);
+    msg.regs[0] = id;
+    msg.regs[1] = offset | access;
+    msg.regs[2] = pager_cluster(as, page_addr, left);
+    msg.regs[3] = cookie;
+
+    int ret = ipc_call(ep, &msg);
+    endpoint_put(ep);
+
+    if (ret != IPC_OK || MSG_ERROR(msg.tag) != E_OK) {
+        kprintf("Page fault: pager refused 0x%llx (ipc %d, error %llu)\n",
+                addr, ret, MSG_ERROR(msg.tag));
+        return -1;
+    }
+    if (!page_present(as, page_addr)) {
+        kprintf("Page fault: pager did not supply 0x%llx\n", addr);
+        return -1;
+    }
+    return 0;
+}
+
+int pager_prefault(struct address_space *as, u64 addr, u64 len, bool write)
+{
+    u32 access = write ? PAGER_ACCESS_WRITE : PAGER_ACCESS_READ;
+    u64 end = addr + len;
+
+    for (u64 page = addr & ~(u64)(PAGE_SIZE - 1); page < end; page += PAGE_SIZE) {
+        mutex_lock(&as->lock);
+        struct vm_area *vma = vmm_find_vma(as, page);
+        bool missing = vma && (vma->flags & VMA_PAGER) && !page_present(as, page);
+        mutex_unlock(&as->lock);
+
+        if (missing && pager_fault(as, page, access) != 0) {
+            return -EFAULT;
+        }
+    }
+    return 0;
+}
+
+void pager_release_as(struct address_space *as)
+{
+    struct pager_region *region, *tmp;
+    LIST_HEAD(dead);
+    u64 flags;
+
+    spin_lock_irqsave(&pager_lock, &flags);
+    list_for_each_entry_safe(region, tmp, &pager_list, link) {
+        if (region->as == as) {
+            region_unlink(region);
+            list_add_tail(&region->link, &dead);
+        }
+    }
+    spin_unlock_irqrestore(&pager_lock, flags);
+
+    list_for_each_entry_safe(region, tmp, &dead, link) {
+        list_del(&region->link);
+        kfree(region);
+    }
+}
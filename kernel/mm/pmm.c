@@ -7,6 +7,7 @@
 
 #include <ocean/pmm.h>
 #include <ocean/boot.h>
+#include <ocean/bootprof.h>
 #include <ocean/types.h>
 #include <ocean/defs.h>
 
@@ -102,8 +103,8 @@ static void init_zones(void)
         zone->end_pfn = 0;
         zone->present_pages = 0;
         zone->free_pages = 0;
-        zone->alloc_count = 0;
-        zone->free_count = 0;
+        percpu_counter_init(&zone->alloc_count);
+        percpu_counter_init(&zone->free_count);
         zone->pcpu_caches = NULL;
 
         buddy_init_zone(zone);
@@ -310,6 +311,7 @@ void pmm_init(void)
     /*
      * Initialize the page array
      */
+    boot_phase("pmm.page_array");
     init_page_array(max_pfn);
 
     /*
@@ -335,6 +337,7 @@ void pmm_init(void)
     /*
      * Initialize memory zones
      */
+    boot_phase("pmm.buddy");
     init_zones();
 
     /*
@@ -568,8 +571,8 @@ void pmm_dump_stats(void)
             kprintf("\n  Zone %s:\n", zone->name);
             kprintf("    Present: %llu pages\n", zone->present_pages);
             kprintf("    Free:    %llu pages\n", zone->free_pages);
-            kprintf("    Allocs:  %llu\n", zone->alloc_count);
-            kprintf("    Frees:   %llu\n", zone->free_count);
+            kprintf("    Allocs:  %llu\n", percpu_counter_sum_positive(&zone->alloc_count));
+            kprintf("    Frees:   %llu\n", percpu_counter_sum_positive(&zone->free_count));
         }
     }
 }
@@ -0,0 +1,418 @@
+/*
+ * Ocean Kernel - Shared Memory Objects
+ *
+ * See ocean/shm.h. Each object is one buddy block, mapped into every
+ * user as a VMA_PINNED region so the VM code never frees or copies the
+ * frames; the last shm_put() does.
+ *
+ * One spinlock covers the object list, grants, reference counts and the
+ * per-process mapping lists. Creating, granting and mapping are setup
+ * operations, not data paths, so nothing here needs to be finer than
+ * that. Address-space updates happen outside it under the mm mutex.
+ */
+
+#include <ocean/shm.h>
+#include <ocean/pmm.h>
+#include <ocean/vmm.h>
+#include <ocean/idr.h>
+#include <ocean/process.h>
+#include <ocean/mutex.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern void *kmalloc(size_t size);
+extern void kfree(void *ptr);
+extern void *memset(void *s, int c, size_t n);
+
+static_assert(SHM_MAX_PAGES <= MAX_ORDER_PAGES, "shm object larger than a buddy block");
+
+static DEFINE_SPINLOCK(shm_lock);
+static LIST_HEAD(shm_list);
+static struct idr shm_idr;
+
+void shm_init(void)
+{
+    idr_init(&shm_idr, SHM_MAX_ID);
+
+    /* ID 0 means "no object" in the syscall ABI */
+    idr_insert(&shm_idr, 0, NULL);
+}
+
+static unsigned int shm_order(u64 pages)
+{
+    unsigned int order = 0;
+
+    while ((1UL << order) < pages) {
+        order++;
+    }
+    return order;
+}
+
+static void shm_free(struct shm_object *obj)
+{
+    free_pages(phys_to_page(obj->phys), obj->order);
+    kfree(obj);
+}
+
+/* Drop a reference; true if it was the last and obj is off the list. shm_lock held. */
+static bool shm_put_locked(struct shm_object *obj)
+{
+    if (--obj->refcount > 0) {
+        return false;
+    }
+    list_del_init(&obj->link);
+    return true;
+}
+
+static void shm_put(struct shm_object *obj)
+{
+    u64 flags;
+    bool last;
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    last = shm_put_locked(obj);
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    if (last) {
+        shm_free(obj);
+    }
+}
+
+/* A live object by ID; shm_lock held */
+static struct shm_object *shm_lookup(u32 id)
+{
+    struct shm_object *obj = idr_find(&shm_idr, (int)id);
+
+    if (!obj || (obj->flags & SHM_FLAG_DEAD)) {
+        return NULL;
+    }
+    return obj;
+}
+
+static struct shm_grant *shm_find_grant(struct shm_object *obj, pid_t pid)
+{
+    for (int i = 0; i < SHM_MAX_GRANTS; i++) {
+        if (obj->grants[i].pid == pid) {
+            return &obj->grants[i];
+        }
+    }
+    return NULL;
+}
+
+/* Rights proc holds on obj; shm_lock held */
+static u32 shm_rights(struct shm_object *obj, struct process *proc)
+{
+    struct shm_grant *grant;
+
+    if (obj->owner == proc) {
+        return SHM_RIGHTS_ALL;
+    }
+    grant = shm_find_grant(obj, proc->pid);
+    return grant ? grant->rights : 0;
+}
+
+/* Unpublish obj and drop the ID's reference; shm_lock held */
+static bool shm_destroy_locked(struct shm_object *obj)
+{
+    obj->flags |= SHM_FLAG_DEAD;
+    obj->owner = NULL;
+    memset(obj->grants, 0, sizeof(obj->grants));
+    idr_remove(&shm_idr, (int)obj->id);
+    return shm_put_locked(obj);
+}
+
+int shm_create(struct process *proc, u64 pages)
+{
+    struct shm_object *obj;
+    struct page *block;
+    u64 flags;
+    int id;
+
+    if (pages == 0 || pages > SHM_MAX_PAGES) {
+        return -EINVAL;
+    }
+
+    obj = kmalloc(sizeof(*obj));
+    if (!obj) {
+        return -ENOMEM;
+    }
+    memset(obj, 0, sizeof(*obj));
+
+    obj->pages = pages;
+    obj->order = shm_order(pages);
+    block = alloc_pages(obj->order, GFP_USER | GFP_ZERO);
+    if (!block) {
+        kfree(obj);
+        return -ENOMEM;
+    }
+    obj->phys = page_to_phys(block);
+    obj->owner = proc;
+    obj->refcount = 1;
+    INIT_LIST_HEAD(&obj->link);
+
+    id = idr_alloc_cyclic(&shm_idr, NULL, 1);
+    if (id < 0) {
+        shm_free(obj);
+        return id;
+    }
+    obj->id = (u32)id;
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    list_add_tail(&obj->link, &shm_list);
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    /* Publish only once fully built */
+    idr_replace(&shm_idr, id, obj);
+    return id;
+}
+
+int shm_destroy(struct process *proc, u32 id)
+{
+    struct shm_object *obj;
+    bool last = false;
+    int err = 0;
+    u64 flags;
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    obj = shm_lookup(id);
+    if (!obj) {
+        err = -ENOENT;
+    } else if (obj->owner != proc) {
+        err = -EPERM;
+    } else {
+        last = shm_destroy_locked(obj);
+    }
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    if (last) {
+        shm_free(obj);
+    }
+    return err;
+}
+
+int shm_grant(struct process *proc, u32 id, struct process *target, u32 rights)
+{
+    struct shm_object *obj;
+    struct shm_grant *grant;
+    int err = 0;
+    u64 flags;
+
+    if (rights & ~SHM_RIGHTS_ALL) {
+        return -EINVAL;
+    }
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    obj = shm_lookup(id);
+    if (!obj) {
+        err = -ENOENT;
+        goto out;
+    }
+
+    u32 own = shm_rights(obj, proc);
+    if (!(own & SHM_RIGHT_GRANT) || (rights & ~own)) {
+        err = -EACCES;
+        goto out;
+    }
+    if (obj->owner == target) {
+        goto out;
+    }
+
+    /* Rights 0 revokes */
+    grant = shm_find_grant(obj, target->pid);
+    if (!grant && rights) {
+        grant = shm_find_grant(obj, 0);
+        if (!grant) {
+            err = -ENOSPC;
+            goto out;
+        }
+    }
+    if (grant) {
+        grant->pid = rights ? target->pid : 0;
+        grant->rights = rights;
+    }
+
+out:
+    spin_unlock_irqrestore(&shm_lock, flags);
+    return err;
+}
+
+i64 shm_map(struct process *proc, u32 id, u32 rights)
+{
+    struct address_space *as = proc->mm;
+    struct shm_mapping *map;
+    struct shm_object *obj;
+    struct shm_mapping *pos;
+    int nr_maps = 0;
+    i64 err = 0;
+    u64 flags, size;
+    u32 vma_flags;
+
+    if (!(rights & SHM_RIGHT_READ) || (rights & ~(SHM_RIGHT_READ | SHM_RIGHT_WRITE))) {
+        return -EINVAL;
+    }
+    if (!as) {
+        return -EINVAL;
+    }
+
+    map = kmalloc(sizeof(*map));
+    if (!map) {
+        return -ENOMEM;
+    }
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    obj = shm_lookup(id);
+    list_for_each_entry(pos, &proc->shm_mappings, link) {
+        nr_maps++;
+    }
+    if (!obj) {
+        err = -ENOENT;
+    } else if (rights & ~shm_rights(obj, proc)) {
+        err = -EACCES;
+    } else if (nr_maps >= SHM_PROC_MAX_MAPS) {
+        err = -ENOSPC;
+    } else {
+        obj->refcount++;
+    }
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    if (err) {
+        kfree(map);
+        return err;
+    }
+
+    size = obj->pages * PAGE_SIZE;
+    vma_flags = VMA_READ | VMA_SHARED | VMA_PINNED;
+    if (rights & SHM_RIGHT_WRITE) {
+        vma_flags |= VMA_WRITE;
+    }
+
+    mutex_lock(&as->lock);
+    /* A vfork child would leave the mapping behind in its parent */
+    if (as->ref_count > 1) {
+        err = -EBUSY;
+    } else {
+        map->virt = vmm_get_unmapped_area(as, size);
+        if (map->virt == (u64)-1 ||
+            vmm_map_to_user(as, map->virt, obj->phys, size, vma_flags) != 0) {
+            err = -ENOMEM;
+        }
+    }
+    mutex_unlock(&as->lock);
+
+    if (err) {
+        shm_put(obj);
+        kfree(map);
+        return err;
+    }
+
+    map->obj = obj;
+    spin_lock_irqsave(&shm_lock, &flags);
+    list_add_tail(&map->link, &proc->shm_mappings);
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    return (i64)map->virt;
+}
+
+int shm_unmap(struct process *proc, u64 virt)
+{
+    struct shm_mapping *map = NULL, *pos;
+    u64 flags;
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    list_for_each_entry(pos, &proc->shm_mappings, link) {
+        if (pos->virt == virt) {
+            map = pos;
+            list_del_init(&map->link);
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    if (!map) {
+        return -ENOENT;
+    }
+
+    if (proc->mm) {
+        mutex_lock(&proc->mm->lock);
+        vmm_unmap_region(proc->mm, map->virt, map->obj->pages * PAGE_SIZE);
+        mutex_unlock(&proc->mm->lock);
+    }
+
+    shm_put(map->obj);
+    kfree(map);
+    return 0;
+}
+
+i64 shm_size(struct process *proc, u32 id)
+{
+    struct shm_object *obj;
+    i64 ret;
+    u64 flags;
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    obj = shm_lookup(id);
+    if (!obj) {
+        ret = -ENOENT;
+    } else if (!(shm_rights(obj, proc) & SHM_RIGHT_READ)) {
+        ret = -EACCES;
+    } else {
+        ret = (i64)obj->pages;
+    }
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    return ret;
+}
+
+void shm_unmap_all(struct process *proc)
+{
+    for (;;) {
+        struct shm_mapping *map = NULL;
+        u64 flags;
+
+        spin_lock_irqsave(&shm_lock, &flags);
+        if (!list_empty(&proc->shm_mappings)) {
+            map = list_first_entry(&proc->shm_mappings, struct shm_mapping, link);
+            list_del_init(&map->link);
+        }
+        spin_unlock_irqrestore(&shm_lock, flags);
+
+        if (!map) {
+            break;
+        }
+
+        shm_put(map->obj);
+        kfree(map);
+    }
+}
+
+void shm_release_all(struct process *proc)
+{
+    struct shm_object *obj, *tmp;
+    LIST_HEAD(dead);
+    u64 flags;
+
+    shm_unmap_all(proc);
+
+    spin_lock_irqsave(&shm_lock, &flags);
+    list_for_each_entry_safe(obj, tmp, &shm_list, link) {
+        if (obj->owner == proc) {
+            if (shm_destroy_locked(obj)) {
+                list_add_tail(&obj->link, &dead);
+            }
+            continue;
+        }
+
+        struct shm_grant *grant = shm_find_grant(obj, proc->pid);
+        if (grant) {
+            grant->pid = 0;
+            grant->rights = 0;
+        }
+    }
+    spin_unlock_irqrestore(&shm_lock, flags);
+
+    list_for_each_entry_safe(obj, tmp, &dead, link) {
+        list_del(&obj->link);
+        shm_free(obj);
+    }
+}
@@ -11,6 +11,7 @@
 #include <ocean/types.h>
 #include <ocean/defs.h>
 #include <ocean/list.h>
+#include <ocean/trace.h>
 
 /* External functions */
 extern int kprintf(const char *fmt, ...);
@@ -132,7 +133,7 @@ static struct slab *slab_alloc_new(struct slab_cache *cache)
         page_set_flag(meta, PG_SLAB);
     }
 
-    cache->total_slabs++;
+    percpu_counter_inc(&cache->total_slabs);
 
     return slab;
 }
@@ -146,7 +147,7 @@ static void slab_free_slab(struct slab *slab)
     if (meta) {
         page_clear_flag(meta, PG_SLAB);
     }
-    slab->cache->total_slabs--;
+    percpu_counter_dec(&slab->cache->total_slabs);
     free_page(slab);
 }
 
@@ -264,11 +265,11 @@ void *slab_alloc(struct slab_cache *cache)
         list_add(&slab->list, &cache->slabs_full);
     }
 
-    cache->total_allocs++;
-    cache->active_objs++;
-
     spin_unlock_irqrestore(&cache->lock, flags);
 
+    percpu_counter_inc(&cache->total_allocs);
+    percpu_counter_inc(&cache->active_objs);
+
     return obj;
 }
 
@@ -308,10 +309,10 @@ void slab_free(struct slab_cache *cache, void *obj)
         list_add(&slab->list, &cache->slabs_partial);
     }
 
-    cache->total_frees++;
-    cache->active_objs--;
-
     spin_unlock_irqrestore(&cache->lock, flags);
+
+    percpu_counter_inc(&cache->total_frees);
+    percpu_counter_dec(&cache->active_objs);
 }
 
 /*
@@ -339,10 +340,11 @@ void slab_cache_dump(struct slab_cache *cache)
     kprintf("Slab cache '%s':\n", cache->name);
     kprintf("  Object size: %zu, Align: %zu\n", cache->obj_size, cache->align);
     kprintf("  Objects per slab: %u\n", cache->obj_per_slab);
-    kprintf("  Total slabs: %llu\n", cache->total_slabs);
-    kprintf("  Active objects: %llu\n", cache->active_objs);
+    kprintf("  Total slabs: %llu\n", percpu_counter_sum_positive(&cache->total_slabs));
+    kprintf("  Active objects: %llu\n", percpu_counter_sum_positive(&cache->active_objs));
     kprintf("  Total allocs: %llu, frees: %llu\n",
-            cache->total_allocs, cache->total_frees);
+            percpu_counter_sum_positive(&cache->total_allocs),
+            percpu_counter_sum_positive(&cache->total_frees));
 }
 
 /*
@@ -403,6 +405,8 @@ void kheap_init(void)
  */
 void *kmalloc(size_t size)
 {
+    void *ptr;
+
     if (size == 0) {
         return NULL;
     }
@@ -414,16 +418,18 @@ void *kmalloc(size_t size)
         while ((1U << order) < pages) {
             order++;
         }
-        return get_free_pages(order);
-    }
-
-    /* Use slab allocator */
-    struct slab_cache *cache = kmalloc_cache_for_size(size);
-    if (!cache) {
-        return NULL;
+        ptr = get_free_pages(order);
+    } else {
+        /* Use slab allocator */
+        struct slab_cache *cache = kmalloc_cache_for_size(size);
+        if (!cache) {
+            return NULL;
+        }
+        ptr = slab_alloc(cache);
     }
 
-    return slab_alloc(cache);
+    trace_kmalloc(ptr, size);
+    return ptr;
 }
 
 /*
@@ -445,6 +451,8 @@ void kfree(void *ptr)
 {
     if (!ptr) return;
 
+    trace_kfree(ptr);
+
     struct page *meta = virt_to_page_meta(ptr);
     if (!meta) {
         return;
@@ -517,10 +525,12 @@ void kheap_dump_stats(void)
     for (int i = 0; i < KMALLOC_NUM_CACHES; i++) {
         if (kmalloc_caches[i]) {
             struct slab_cache *cache = kmalloc_caches[i];
-            kprintf("  %s: %llu active, %llu slabs\n",
-                    cache->name, cache->active_objs, cache->total_slabs);
-            total_active += cache->active_objs;
-            total_slabs += cache->total_slabs;
+            u64 active = percpu_counter_sum_positive(&cache->active_objs);
+            u64 slabs = percpu_counter_sum_positive(&cache->total_slabs);
+
+            kprintf("  %s: %llu active, %llu slabs\n", cache->name, active, slabs);
+            total_active += active;
+            total_slabs += slabs;
         }
     }
 
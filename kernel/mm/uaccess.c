@@ -7,6 +7,7 @@
 #include <ocean/uaccess.h>
 #include <ocean/process.h>
 #include <ocean/vmm.h>
+#include <ocean/pager.h>
 #include <ocean/defs.h>
 
 /* External functions */
@@ -38,34 +39,37 @@ int validate_user_range(const void *ptr, size_t len, u32 required_vma_flags)
     }
 
     struct address_space *as = proc->mm;
-    u64 flags;
-    spin_lock_irqsave(&as->lock, &flags);
+    bool paged = false;
+    mutex_lock(&as->lock);
 
     u64 cursor = start;
     while (cursor < end) {
         struct vm_area *vma = vmm_find_vma(as, cursor);
         if (!vma || cursor < vma->start) {
-            spin_unlock_irqrestore(&as->lock, flags);
+            mutex_unlock(&as->lock);
             return -EFAULT;
         }
 
         if ((required_vma_flags & VMA_READ) && !(vma->flags & VMA_READ)) {
-            spin_unlock_irqrestore(&as->lock, flags);
+            mutex_unlock(&as->lock);
             return -EFAULT;
         }
         if ((required_vma_flags & VMA_WRITE) && !(vma->flags & VMA_WRITE)) {
-            spin_unlock_irqrestore(&as->lock, flags);
+            mutex_unlock(&as->lock);
             return -EFAULT;
         }
         if ((required_vma_flags & VMA_EXEC) && !(vma->flags & VMA_EXEC)) {
-            spin_unlock_irqrestore(&as->lock, flags);
+            mutex_unlock(&as->lock);
             return -EFAULT;
         }
 
         if (vma->end <= cursor) {
-            spin_unlock_irqrestore(&as->lock, flags);
+            mutex_unlock(&as->lock);
             return -EFAULT;
         }
+        if (vma->flags & VMA_PAGER) {
+            paged = true;
+        }
 
         if (vma->end >= end) {
             break;
@@ -74,7 +78,12 @@ int validate_user_range(const void *ptr, size_t len, u32 required_vma_flags)
         cursor = vma->end;
     }
 
-    spin_unlock_irqrestore(&as->lock, flags);
+    mutex_unlock(&as->lock);
+
+    /* The copy itself must not fault into a pager */
+    if (paged) {
+        return pager_prefault(as, start, len, required_vma_flags & VMA_WRITE);
+    }
     return 0;
 }
 
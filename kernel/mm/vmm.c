@@ -6,7 +6,9 @@
 
 #include <ocean/vmm.h>
 #include <ocean/pmm.h>
+#include <ocean/pager.h>
 #include <ocean/boot.h>
+#include <ocean/bootprof.h>
 #include <ocean/types.h>
 #include <ocean/defs.h>
 #include <ocean/list.h>
@@ -48,6 +50,7 @@ void vmm_init(void)
     kernel_space_init();
 
     /* Initialize kernel heap */
+    boot_phase("slab");
     kheap_init();
 
     kprintf("VMM initialized\n");
@@ -103,6 +106,12 @@ static u64 vma_to_pte_flags(u32 vma_flags)
     /* User-space VMAs get PTE_USER */
     pte_flags |= PTE_USER;
 
+    if (vma_flags & VMA_UNCACHED) {
+        pte_flags |= PTE_CACHE_UC;
+    } else if (vma_flags & VMA_WC) {
+        pte_flags |= PTE_CACHE_WC;
+    }
+
     return pte_flags;
 }
 
@@ -202,7 +211,24 @@ struct address_space *vmm_create_address_space(void)
     INIT_LIST_HEAD(&as->vma_list);
     as->vma_count = 0;
     as->ref_count = 1;
-    spin_init(&as->lock);
+    mutex_init(&as->lock);
+
+    return as;
+}
+
+/*
+ * Take an additional reference on an address space
+ *
+ * Used when a second process borrows the address space (vfork). Each
+ * reference is dropped with vmm_destroy_address_space.
+ */
+struct address_space *vmm_get_address_space(struct address_space *as)
+{
+    if (!as) return NULL;
+
+    mutex_lock(&as->lock);
+    as->ref_count++;
+    mutex_unlock(&as->lock);
 
     return as;
 }
@@ -212,20 +238,27 @@ struct address_space *vmm_create_address_space(void)
  */
 void vmm_destroy_address_space(struct address_space *as)
 {
+    u32 refs;
+
     if (!as) return;
 
-    as->ref_count--;
-    if (as->ref_count > 0) {
+    mutex_lock(&as->lock);
+    refs = --as->ref_count;
+    mutex_unlock(&as->lock);
+
+    if (refs > 0) {
         return;
     }
 
+    pager_release_as(as);
+
     /* Free all VMAs */
     struct vm_area *vma, *tmp;
     list_for_each_entry_safe(vma, tmp, &as->vma_list, list) {
-        /* Free the physical pages in this VMA */
+        /* Free the physical pages in this VMA, unless someone else owns them */
         for (u64 addr = vma->start; addr < vma->end; addr += PAGE_SIZE) {
             pte_t *pte = paging_get_pte(as->pml4, addr);
-            if (pte && (*pte & PTE_PRESENT)) {
+            if (pte && (*pte & PTE_PRESENT) && !(vma->flags & VMA_PINNED)) {
                 phys_addr_t phys = *pte & PTE_ADDR_MASK;
                 const struct boot_info *boot = get_boot_info();
                 free_page((void *)(phys + boot->hhdm_offset));
@@ -301,6 +334,29 @@ int vmm_map_region(struct address_space *as, u64 start, u64 size, u32 flags)
     return 0;
 }
 
+/*
+ * Add a region without backing it; the fault handler fills it
+ */
+int vmm_reserve_region(struct address_space *as, u64 start, u64 size, u32 flags)
+{
+    if (vma_find_intersect(as, start, start + size)) {
+        return -1;
+    }
+
+    struct vm_area *vma = vma_alloc();
+    if (!vma) {
+        return -1;
+    }
+
+    vma->start = start;
+    vma->end = start + size;
+    vma->flags = flags;
+    vma->page_prot = vma_to_pte_flags(flags);
+
+    vma_insert(as, vma);
+    return 0;
+}
+
 /*
  * Unmap a region
  */
@@ -328,9 +384,11 @@ int vmm_unmap_region(struct address_space *as, u64 start, u64 size)
         for (u64 addr = unmap_start; addr < unmap_end; addr += PAGE_SIZE) {
             pte_t *pte = paging_get_pte(as->pml4, addr);
             if (pte && (*pte & PTE_PRESENT)) {
-                phys_addr_t phys = *pte & PTE_ADDR_MASK;
-                const struct boot_info *boot = get_boot_info();
-                free_page((void *)(phys + boot->hhdm_offset));
+                if (!(vma->flags & VMA_PINNED)) {
+                    phys_addr_t phys = *pte & PTE_ADDR_MASK;
+                    const struct boot_info *boot = get_boot_info();
+                    free_page((void *)(phys + boot->hhdm_offset));
+                }
                 unmapped_pages++;
             }
             paging_unmap(as->pml4, addr);
@@ -412,6 +470,24 @@ int vmm_map_to_user(struct address_space *as, u64 virt, phys_addr_t phys,
     return 0;
 }
 
+/*
+ * Find free user space for a mapping of size bytes
+ */
+u64 vmm_get_unmapped_area(struct address_space *as, u64 size)
+{
+    u64 addr = 0x10000000; /* Start at 256MB */
+
+    size = PAGE_ALIGN(size);
+    while (addr + size < USER_SPACE_END) {
+        if (!vma_find_intersect(as, addr, addr + size)) {
+            return addr;
+        }
+        addr += PAGE_SIZE * 256; /* Skip in larger chunks */
+    }
+
+    return (u64)-1; /* No space found */
+}
+
 /*
  * Simple mmap implementation
  */
@@ -424,17 +500,9 @@ u64 vmm_mmap(struct address_space *as, u64 hint, u64 size, u32 prot, u32 flags)
 
     /* Find free region if no hint or hint conflicts */
     if (addr == 0 || vma_find_intersect(as, addr, addr + size)) {
-        /* Search for free space */
-        addr = 0x10000000; /* Start at 256MB */
-        while (addr + size < USER_SPACE_END) {
-            if (!vma_find_intersect(as, addr, addr + size)) {
-                break;
-            }
-            addr += PAGE_SIZE * 256; /* Skip in larger chunks */
-        }
-
-        if (addr + size >= USER_SPACE_END) {
-            return (u64)-1; /* No space found */
+        addr = vmm_get_unmapped_area(as, size);
+        if (addr == (u64)-1) {
+            return (u64)-1;
         }
     }
 
@@ -492,6 +560,9 @@ int vmm_mprotect(struct address_space *as, u64 addr, u64 size, u32 prot)
 /*
  * Clone an address space (for fork)
  * Uses copy-on-write for efficiency
+ *
+ * src->lock is held across the whole copy; it is a mutex, so other
+ * threads touching src sleep rather than spin while pages are copied.
  */
 struct address_space *vmm_clone_address_space(struct address_space *src)
 {
@@ -500,14 +571,19 @@ struct address_space *vmm_clone_address_space(struct address_space *src)
         return NULL;
     }
 
+    mutex_lock(&src->lock);
+
     /* Clone all VMAs */
     struct vm_area *vma;
     list_for_each_entry(vma, &src->vma_list, list) {
+        /* Pinned frames (DMA buffers) stay with the parent, as do pager regions */
+        if (vma->flags & (VMA_PINNED | VMA_PAGER)) {
+            continue;
+        }
 
         struct vm_area *new_vma = vma_alloc();
         if (!new_vma) {
-            vmm_destroy_address_space(dst);
-            return NULL;
+            goto fail;
         }
 
         *new_vma = *vma;
@@ -528,8 +604,7 @@ struct address_space *vmm_clone_address_space(struct address_space *src)
             if (!new_page) {
                 kprintf("[vmm] Failed to allocate page for fork\n");
                 vma_free(new_vma);
-                vmm_destroy_address_space(dst);
-                return NULL;
+                goto fail;
             }
 
             /* Convert to physical address */
@@ -546,8 +621,7 @@ struct address_space *vmm_clone_address_space(struct address_space *src)
                 kprintf("[vmm] Failed to map page at 0x%llx\n", addr);
                 free_page(new_page);
                 vma_free(new_vma);
-                vmm_destroy_address_space(dst);
-                return NULL;
+                goto fail;
             }
         }
 
@@ -559,5 +633,11 @@ struct address_space *vmm_clone_address_space(struct address_space *src)
     dst->start_stack = src->start_stack;
     dst->total_vm = src->total_vm;
 
+    mutex_unlock(&src->lock);
     return dst;
+
+fail:
+    mutex_unlock(&src->lock);
+    vmm_destroy_address_space(dst);
+    return NULL;
 }
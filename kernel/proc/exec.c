@@ -5,7 +5,10 @@
  */
 
 #include <ocean/process.h>
+#include <ocean/files.h>
 #include <ocean/ipc.h>
+#include <ocean/dma.h>
+#include <ocean/shm.h>
 #include <ocean/sched.h>
 #include <ocean/vmm.h>
 #include <ocean/elf.h>
@@ -27,7 +30,7 @@ extern void *get_free_page(unsigned int gfp_flags);
 #define GFP_USER   1
 
 /* From syscall entry */
-extern void enter_usermode(u64 entry, u64 stack, u64 flags);
+extern void enter_usermode(u64 entry, u64 stack, u64 flags, u64 arg);
 extern void enter_usermode_from_syscall(u64 entry, u64 stack, u64 flags);
 
 /* From process.c */
@@ -135,20 +138,20 @@ static int load_segment(struct address_space *as, const void *elf_data, size_t e
 
     if (memsz < filesz) {
         kprintf("    Invalid ELF segment: filesz > memsz\n");
-        return -1;
+        return -ENOEXEC;
     }
     if (offset > elf_size || filesz > elf_size - offset) {
         kprintf("    Invalid ELF segment: file range out of bounds\n");
-        return -1;
+        return -ENOEXEC;
     }
     if (vaddr_aligned >= USER_SPACE_END ||
         memsz_aligned > USER_SPACE_END - vaddr_aligned) {
         kprintf("    Invalid ELF segment: virtual address out of range\n");
-        return -1;
+        return -ENOEXEC;
     }
     if (segment_overlaps(as, vaddr_aligned, vaddr_aligned + memsz_aligned)) {
         kprintf("    Invalid ELF segment: overlapping PT_LOAD range\n");
-        return -1;
+        return -ENOEXEC;
     }
 
     /* Determine page flags */
@@ -171,7 +174,7 @@ static int load_segment(struct address_space *as, const void *elf_data, size_t e
         void *phys_page = get_free_page(GFP_USER);
         if (!phys_page) {
             kprintf("    Failed to allocate page!\n");
-            return -1;
+            return -ENOMEM;
         }
 
         u64 phys_addr = (u64)phys_page - hhdm;
@@ -221,7 +224,7 @@ static int load_segment(struct address_space *as, const void *elf_data, size_t e
     struct vm_area *vma = vma_alloc();
     if (!vma) {
         kprintf("    Failed to allocate VMA!\n");
-        return -1;
+        return -ENOMEM;
     }
 
     /* Convert ELF segment flags to VMA flags */
@@ -323,24 +326,26 @@ static u64 setup_user_stack(struct address_space *as, const char *const argv[])
 }
 
 /*
- * Execute an ELF binary from memory
+ * Build a process image from an ELF binary in memory
  *
- * elf_data: pointer to ELF file in kernel memory
- * elf_size: size of ELF file
- * name: process name
+ * Creates the process, its address space, user stack, IPC window and main
+ * thread. The thread is not started so callers can finish wiring up the
+ * process (parent linkage, file table) before it becomes runnable.
  *
- * Returns PID of new process or -1 on error
+ * Returns the new process or an ERR_PTR: -ENOEXEC for a bad image,
+ * -ENOMEM when memory ran out.
  */
-pid_t exec_elf(const void *elf_data, size_t elf_size, const char *name)
+static struct process *exec_build_process(const void *elf_data, size_t elf_size,
+                                          const char *name,
+                                          const char *const argv[])
 {
     struct process *proc;
     struct thread *main_thread;
-    const char *default_argv[] = { name ? name : "init", NULL };
 
     /* Validate ELF header */
     if (elf_size < sizeof(Elf64_Ehdr)) {
         kprintf("exec_elf: File too small\n");
-        return -1;
+        return ERR_PTR(-ENOEXEC);
     }
 
     const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)elf_data;
@@ -348,14 +353,14 @@ pid_t exec_elf(const void *elf_data, size_t elf_size, const char *name)
     int err = elf_validate(ehdr);
     if (err != ELF_OK) {
         kprintf("exec_elf: Invalid ELF (error %d)\n", err);
-        return -1;
+        return ERR_PTR(-ENOEXEC);
     }
 
     /* Create new process */
     proc = process_create(name);
     if (!proc) {
         kprintf("exec_elf: Failed to create process\n");
-        return -1;
+        return ERR_PTR(-ENOMEM);
     }
 
     /* Create address space */
@@ -363,7 +368,7 @@ pid_t exec_elf(const void *elf_data, size_t elf_size, const char *name)
     if (!proc->mm) {
         kprintf("exec_elf: Failed to create address space\n");
         process_destroy(proc);
-        return -1;
+        return ERR_PTR(-ENOMEM);
     }
 
     /* Load program segments */
@@ -371,15 +376,19 @@ pid_t exec_elf(const void *elf_data, size_t elf_size, const char *name)
 
     for (int i = 0; i < ehdr->e_phnum; i++) {
         if (phdrs[i].p_type == PT_LOAD) {
-            if (load_segment(proc->mm, elf_data, elf_size, &phdrs[i]) < 0) {
+            err = load_segment(proc->mm, elf_data, elf_size, &phdrs[i]);
+            if (err < 0) {
                 kprintf("exec_elf: Failed to load segment %d\n", i);
                 goto fail;
             }
         }
     }
 
+    /* Past the segments, only a lack of memory fails */
+    err = -ENOMEM;
+
     /* Set up user stack */
-    u64 user_sp = setup_user_stack(proc->mm, default_argv);
+    u64 user_sp = setup_user_stack(proc->mm, argv);
     if (user_sp == 0) {
         kprintf("exec_elf: Failed to set up stack\n");
         goto fail;
@@ -402,14 +411,99 @@ pid_t exec_elf(const void *elf_data, size_t elf_size, const char *name)
     /* Mark as user thread */
     main_thread->flags &= ~TF_KTHREAD;
 
+    return proc;
+
+fail:
+    process_destroy(proc);
+    return ERR_PTR(err);
+}
+
+/*
+ * Execute an ELF binary from memory
+ *
+ * elf_data: pointer to ELF file in kernel memory
+ * elf_size: size of ELF file
+ * name: process name
+ * argv: NULL-terminated argument vector for the new process
+ *
+ * Returns PID of new process or -1 on error
+ */
+pid_t exec_elf_argv(const void *elf_data, size_t elf_size, const char *name,
+                    const char *const argv[])
+{
+    struct process *proc;
+
+    proc = exec_build_process(elf_data, elf_size, name, argv);
+    if (IS_ERR(proc)) {
+        return -1;
+    }
+
+    /* What the kernel starts itself (init) is privileged */
+    proc->privileged = true;
+
     /* Add to scheduler */
-    thread_start(main_thread);
+    thread_start(proc->main_thread);
 
     return proc->pid;
+}
 
-fail:
-    process_destroy(proc);
-    return -1;
+/*
+ * Execute an ELF binary from memory with argv = { name }
+ */
+pid_t exec_elf(const void *elf_data, size_t elf_size, const char *name)
+{
+    const char *default_argv[] = { name ? name : "init", NULL };
+
+    return exec_elf_argv(elf_data, elf_size, name, default_argv);
+}
+
+/*
+ * Spawn a child of the current process from an ELF binary
+ *
+ * Unlike fork+exec, the parent's address space is never copied: the child
+ * is built directly from the ELF image. files becomes the child's file
+ * table and is always consumed, even on failure; when NULL the child gets
+ * a clone of the parent's table. The child is privileged only if asked;
+ * the caller checks that the parent may ask.
+ *
+ * Returns PID of the child or a negative errno.
+ */
+pid_t exec_spawn(const void *elf_data, size_t elf_size, const char *name,
+                 const char *const argv[], struct process_files *files,
+                 bool privileged)
+{
+    struct process *parent = get_current_process();
+    struct process *proc;
+
+    if (!parent) {
+        return -ESRCH;
+    }
+
+    if (!files && parent->files) {
+        files = process_files_clone((const struct process_files *)parent->files);
+        if (!files) {
+            return -ENOMEM;
+        }
+    }
+
+    proc = exec_build_process(elf_data, elf_size, name, argv);
+    if (IS_ERR(proc)) {
+        process_files_destroy(files);
+        return (pid_t)PTR_ERR(proc);
+    }
+
+    if (files) {
+        process_files_destroy((struct process_files *)proc->files);
+        proc->files = files;
+    }
+
+    /* Link before the child can run so its exit always finds the parent */
+    process_link_child(parent, proc);
+    proc->privileged = privileged;
+
+    thread_start(proc->main_thread);
+
+    return proc->pid;
 }
 
 /*
@@ -571,7 +665,7 @@ void exec_test_user_mode(void)
          * This won't return - the process will call sys_exit */
         kprintf("Entering user mode...\n\n");
 
-        enter_usermode(code_vaddr, user_sp, 0x202);
+        enter_usermode(code_vaddr, user_sp, 0x202, 0);
     }
 
     /* Should never reach here */
@@ -668,6 +762,9 @@ int exec_replace(const void *elf_data, size_t elf_size, const char *name,
      * traffic on this process. */
     u64 old_ipc_window_phys = proc->ipc_window_phys;
 
+    /* The new image starts single-threaded */
+    process_stop_other_threads();
+
     old_mm = proc->mm;
     proc->mm = new_mm;
     proc->ipc_window_phys = 0;
@@ -695,6 +792,16 @@ int exec_replace(const void *elf_data, size_t elf_size, const char *name,
     if (old_mm) {
         vmm_destroy_address_space(old_mm);
     }
+    dma_release_all(proc);
+    shm_unmap_all(proc);
+
+    /* Thread state from the old image no longer means anything */
+    t->fs_base = 0;
+    t->clear_tid = 0;
+    wrmsr(MSR_FS_BASE, 0);
+
+    /* If we were vforked, the parent may run again on its address space */
+    process_vfork_release(proc);
     enter_usermode_from_syscall(ehdr->e_entry, user_sp, 0x202);
 
     /* Should never reach here */
@@ -20,6 +20,9 @@ struct process_files *process_files_create(void)
     }
 
     memset(files, 0, sizeof(*files));
+    files->entries[PROCESS_FD_STDIN].kind = PROCESS_FILE_CONSOLE;
+    files->entries[PROCESS_FD_STDOUT].kind = PROCESS_FILE_CONSOLE;
+    files->entries[PROCESS_FD_STDERR].kind = PROCESS_FILE_CONSOLE;
     return files;
 }
 
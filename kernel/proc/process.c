@@ -7,11 +7,19 @@
 #include <ocean/process.h>
 #include <ocean/files.h>
 #include <ocean/ipc.h>
+#include <ocean/ioport.h>
+#include <ocean/pci.h>
+#include <ocean/dma.h>
+#include <ocean/shm.h>
 #include <ocean/sched.h>
 #include <ocean/vmm.h>
+#include <ocean/mutex.h>
 #include <ocean/types.h>
 #include <ocean/defs.h>
 #include <ocean/list.h>
+#include <ocean/idr.h>
+#include <ocean/uaccess.h>
+#include <ocean/futex.h>
 
 /* External functions */
 extern int kprintf(const char *fmt, ...);
@@ -26,41 +34,74 @@ extern void ret_from_fork(void);
 
 /* Global process list */
 static LIST_HEAD(process_list);
-static spinlock_t process_list_lock;
+static struct mutex process_list_lock;     /* Held across process_dump output */
 
-/* Global thread list for channel-based wakeups */
+/*
+ * Global thread list for channel-based wakeups. thread_list_lock
+ * serialises writers; thread_wakeup walks it under rcu_read_lock().
+ */
 struct list_head all_threads = LIST_HEAD_INIT(all_threads);
 spinlock_t thread_list_lock;
 
-/* PID allocation bitmap */
-static u64 pid_bitmap[PID_MAX / 64];
-static spinlock_t pid_lock;
-static pid_t next_pid = 1;
+/*
+ * ID maps: pid_idr allocates PIDs and maps them to processes, tid_idr maps
+ * TIDs to threads. Both give O(1) lockless lookup for process_find and
+ * thread_find; objects they map are freed through call_rcu.
+ */
+static struct idr pid_idr;
+static struct idr tid_idr;
 
 /* Init process (PID 1) */
 struct process *init_process = NULL;
 
+/*
+ * Exited non-main threads waiting to be freed. A thread cannot release the
+ * kernel stack it is running on, so thread_exit parks it here and a later
+ * thread_exit or thread_create frees it, or process_destroy when it was the
+ * last thread of its process. Linked through thread_list, since RCU readers
+ * may still be walking all_list. Protected by thread_list_lock.
+ */
+static LIST_HEAD(dead_threads);
+
 /* Forward declarations */
 static void free_kernel_stack(void *stack);
+static void thread_reap_dead(void);
 
 static void thread_global_add(struct thread *t)
 {
     u64 flags;
     spin_lock_irqsave(&thread_list_lock, &flags);
-    list_add_tail(&t->all_list, &all_threads);
+    list_add_tail_rcu(&t->all_list, &all_threads);
     spin_unlock_irqrestore(&thread_list_lock, flags);
+
+    if (idr_insert(&tid_idr, t->tid, t) < 0) {
+        kprintf("thread_global_add: tid %d already mapped\n", t->tid);
+    }
 }
 
 static void thread_global_remove(struct thread *t)
 {
     u64 flags;
     spin_lock_irqsave(&thread_list_lock, &flags);
-    if (!list_empty(&t->all_list)) {
-        list_del_init(&t->all_list);
+    if (!list_unlinked_rcu(&t->all_list)) {
+        list_del_rcu(&t->all_list);
+        if (idr_find(&tid_idr, t->tid) == t) {
+            idr_remove(&tid_idr, t->tid);
+        }
     }
     spin_unlock_irqrestore(&thread_list_lock, flags);
 }
 
+static void thread_free_rcu(struct rcu_head *head)
+{
+    kfree(container_of(head, struct thread, rcu));
+}
+
+static void process_free_rcu(struct rcu_head *head)
+{
+    kfree(container_of(head, struct process, rcu));
+}
+
 void process_destroy(struct process *child)
 {
     if (!child) {
@@ -71,6 +112,11 @@ void process_destroy(struct process *child)
      * peers blocked on those endpoints wake with IPC_ERR_DEAD rather than
      * stalling on a vanished server. */
     ipc_destroy_owned_by_process(child);
+    ioport_release_all(child);
+    pci_release_all(child);
+
+    /* A non-main thread that exited last is still parked on dead_threads */
+    thread_reap_dead();
 
     if (child->parent && !list_empty(&child->sibling)) {
         u64 parent_flags;
@@ -84,7 +130,7 @@ void process_destroy(struct process *child)
     if (child->main_thread) {
         thread_global_remove(child->main_thread);
         free_kernel_stack(child->main_thread->kernel_stack);
-        kfree(child->main_thread);
+        call_rcu(&child->main_thread->rcu, thread_free_rcu);
         child->main_thread = NULL;
     }
 
@@ -97,61 +143,29 @@ void process_destroy(struct process *child)
         vmm_destroy_address_space(child->mm);
         child->mm = NULL;
     }
+    dma_release_all(child);
+    shm_release_all(child);
 
-    u64 flags;
-    spin_lock_irqsave(&process_list_lock, &flags);
+    mutex_lock(&process_list_lock);
     if (!list_empty(&child->proc_list)) {
         list_del_init(&child->proc_list);
     }
-    spin_unlock_irqrestore(&process_list_lock, flags);
+    mutex_unlock(&process_list_lock);
 
     free_pid(child->pid);
-    kfree(child);
+    call_rcu(&child->rcu, process_free_rcu);
 }
 
 /*
  * Allocate a new PID
+ *
+ * The PID is reserved but maps to no process until process_create
+ * publishes it, so lookups never see a half-built process.
  */
 pid_t alloc_pid(void)
 {
-    u64 flags;
-    spin_lock_irqsave(&pid_lock, &flags);
-
-    pid_t pid = -1;
-
-    /* Search for free PID starting from next_pid */
-    for (pid_t i = next_pid; i < PID_MAX; i++) {
-        int word = i / 64;
-        int bit = i % 64;
-
-        if (!(pid_bitmap[word] & (1ULL << bit))) {
-            pid_bitmap[word] |= (1ULL << bit);
-            pid = i;
-            next_pid = i + 1;
-            if (next_pid >= PID_MAX) {
-                next_pid = 1;
-            }
-            break;
-        }
-    }
-
-    /* Wrap around if not found */
-    if (pid < 0) {
-        for (pid_t i = 1; i < next_pid; i++) {
-            int word = i / 64;
-            int bit = i % 64;
-
-            if (!(pid_bitmap[word] & (1ULL << bit))) {
-                pid_bitmap[word] |= (1ULL << bit);
-                pid = i;
-                next_pid = i + 1;
-                break;
-            }
-        }
-    }
-
-    spin_unlock_irqrestore(&pid_lock, flags);
-    return pid;
+    int pid = idr_alloc_cyclic(&pid_idr, NULL, 1);
+    return pid < 0 ? -1 : pid;
 }
 
 /*
@@ -163,14 +177,7 @@ void free_pid(pid_t pid)
         return;
     }
 
-    u64 flags;
-    spin_lock_irqsave(&pid_lock, &flags);
-
-    int word = pid / 64;
-    int bit = pid % 64;
-    pid_bitmap[word] &= ~(1ULL << bit);
-
-    spin_unlock_irqrestore(&pid_lock, flags);
+    idr_remove(&pid_idr, pid);
 }
 
 /*
@@ -178,12 +185,7 @@ void free_pid(pid_t pid)
  */
 static void *alloc_kernel_stack(void)
 {
-    /* Allocate 2 pages for kernel stack (8KB) */
-    void *stack = kmalloc(KERNEL_STACK_SIZE);
-    if (stack) {
-        memset(stack, 0, KERNEL_STACK_SIZE);
-    }
-    return stack;
+    return kstack_alloc();
 }
 
 /*
@@ -191,9 +193,7 @@ static void *alloc_kernel_stack(void)
  */
 static void free_kernel_stack(void *stack)
 {
-    if (stack) {
-        kfree(stack);
-    }
+    kstack_free(stack);
 }
 
 /*
@@ -203,14 +203,17 @@ void process_init(void)
 {
     kprintf("Initializing process subsystem...\n");
 
-    spin_init(&process_list_lock);
+    mutex_init(&process_list_lock);
     spin_init(&thread_list_lock);
-    spin_init(&pid_lock);
-    memset(pid_bitmap, 0, sizeof(pid_bitmap));
+    idr_init(&pid_idr, PID_MAX);
+    idr_init(&tid_idr, PID_MAX);
     INIT_LIST_HEAD(&all_threads);
 
     /* Reserve PID 0 for kernel/idle */
-    pid_bitmap[0] |= 1;
+    idr_insert(&pid_idr, 0, NULL);
+
+    /* Stack region must be in the kernel PML4 before any process exists */
+    kstack_cache_init();
 
     kprintf("Process subsystem initialized\n");
 }
@@ -257,6 +260,9 @@ struct process *process_create(const char *name)
     /* Initialize owned-endpoint list so IPC teardown is safe even if the
      * process never creates any endpoints. */
     INIT_LIST_HEAD(&proc->owned_endpoints);
+    INIT_LIST_HEAD(&proc->owned_notifications);
+    INIT_LIST_HEAD(&proc->dma_buffers);
+    INIT_LIST_HEAD(&proc->shm_mappings);
 
     /* Initialize process lock */
     spin_init(&proc->lock);
@@ -269,16 +275,18 @@ struct process *process_create(const char *name)
     }
 
     /* Add to global process list */
-    u64 flags;
-    spin_lock_irqsave(&process_list_lock, &flags);
+    mutex_lock(&process_list_lock);
     list_add_tail(&proc->proc_list, &process_list);
-    spin_unlock_irqrestore(&process_list_lock, flags);
+    mutex_unlock(&process_list_lock);
+
+    /* Publish for process_find */
+    idr_replace(&pid_idr, proc->pid, proc);
 
     return proc;
 }
 
 /* External assembly function to enter user mode */
-extern void enter_usermode(u64 rip, u64 rsp, u64 rflags);
+extern void enter_usermode(u64 rip, u64 rsp, u64 rflags, u64 arg);
 
 /*
  * User thread start trampoline
@@ -290,13 +298,14 @@ extern void enter_usermode(u64 rip, u64 rsp, u64 rflags);
  * The user entry point and stack are passed in callee-saved registers:
  *   r12 = user RIP (entry point)
  *   r13 = user RSP (stack pointer)
+ *   r14 = user RDI (thread argument)
  */
 static void user_thread_start(void)
 {
     struct thread *t = current_thread;
 
     /* Enter user mode - this never returns */
-    enter_usermode(t->context.r12, t->context.r13, 0);
+    enter_usermode(t->context.r12, t->context.r13, 0, t->context.r14);
 
     /* Should never reach here */
     for (;;) {
@@ -324,20 +333,20 @@ static void kthread_entry(void)
 }
 
 /*
- * Create the main thread for a process
+ * Allocate and initialize a user thread of proc that will enter user mode
+ * at entry on stack_top. The thread is not linked anywhere yet.
  */
-struct thread *process_create_main_thread(struct process *proc, u64 entry, u64 stack_top)
+static struct thread *user_thread_alloc(struct process *proc, tid_t tid,
+                                        u64 entry, u64 stack_top, u64 arg)
 {
     struct thread *t = kmalloc(sizeof(struct thread));
     if (!t) {
-        kprintf("process_create_main_thread: failed to allocate thread\n");
         return NULL;
     }
 
     memset(t, 0, sizeof(*t));
 
-    /* Thread IDs: main thread has tid == pid */
-    t->tid = proc->pid;
+    t->tid = tid;
     t->pid = proc->pid;
     t->process = proc;
 
@@ -352,7 +361,6 @@ struct thread *process_create_main_thread(struct process *proc, u64 entry, u64 s
     /* Allocate kernel stack */
     t->kernel_stack = alloc_kernel_stack();
     if (!t->kernel_stack) {
-        kprintf("process_create_main_thread: failed to allocate kernel stack\n");
         kfree(t);
         return NULL;
     }
@@ -374,6 +382,7 @@ struct thread *process_create_main_thread(struct process *proc, u64 entry, u64 s
     t->context.rip = (u64)user_thread_start;
     t->context.r12 = entry;      /* User entry point */
     t->context.r13 = stack_top;  /* User stack */
+    t->context.r14 = arg;        /* User RDI */
 
     /* User stack pointer (if user process) */
     t->user_stack = (void *)stack_top;
@@ -391,6 +400,21 @@ struct thread *process_create_main_thread(struct process *proc, u64 entry, u64 s
     /* Timing */
     t->start_time = get_ticks();
 
+    return t;
+}
+
+/*
+ * Create the main thread for a process
+ */
+struct thread *process_create_main_thread(struct process *proc, u64 entry, u64 stack_top)
+{
+    /* Thread IDs: main thread has tid == pid */
+    struct thread *t = user_thread_alloc(proc, proc->pid, entry, stack_top, 0);
+    if (!t) {
+        kprintf("process_create_main_thread: failed to allocate thread\n");
+        return NULL;
+    }
+
     /* Link to process */
     u64 flags;
     spin_lock_irqsave(&proc->lock, &flags);
@@ -404,6 +428,74 @@ struct thread *process_create_main_thread(struct process *proc, u64 entry, u64 s
     return t;
 }
 
+/*
+ * Free threads parked on dead_threads, except the caller itself
+ */
+static void thread_reap_dead(void)
+{
+    LIST_HEAD(reap);
+    struct thread *t, *tmp;
+    u64 flags;
+
+    spin_lock_irqsave(&thread_list_lock, &flags);
+    list_for_each_entry_safe(t, tmp, &dead_threads, thread_list) {
+        if (t != current_thread) {
+            list_move(&t->thread_list, &reap);
+        }
+    }
+    spin_unlock_irqrestore(&thread_list_lock, flags);
+
+    list_for_each_entry_safe(t, tmp, &reap, thread_list) {
+        list_del(&t->thread_list);
+        free_pid(t->tid);
+        free_kernel_stack(t->kernel_stack);
+        call_rcu(&t->rcu, thread_free_rcu);
+    }
+}
+
+/*
+ * Create an extra user thread in a process
+ *
+ * The thread shares the process's address space, file table and IPC
+ * endpoints. Its TID comes from the PID space so it can never collide
+ * with a later process's main thread.
+ */
+struct thread *thread_create(struct process *proc, u64 entry, u64 arg,
+                             u64 stack_top, u64 tls)
+{
+    struct thread *t;
+    pid_t tid;
+    u64 flags;
+
+    if (!proc || !proc->mm) {
+        return NULL;
+    }
+
+    thread_reap_dead();
+
+    tid = alloc_pid();
+    if (tid < 0) {
+        return NULL;
+    }
+
+    t = user_thread_alloc(proc, tid, entry, stack_top, arg);
+    if (!t) {
+        free_pid(tid);
+        return NULL;
+    }
+
+    t->fs_base = tls;
+
+    spin_lock_irqsave(&proc->lock, &flags);
+    list_add_tail(&t->thread_list, &proc->threads);
+    proc->nr_threads++;
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    thread_global_add(t);
+
+    return t;
+}
+
 /*
  * Create a kernel thread
  */
@@ -501,20 +593,7 @@ void thread_start(struct thread *t)
  */
 struct process *process_find(pid_t pid)
 {
-    struct process *proc;
-    u64 flags;
-
-    spin_lock_irqsave(&process_list_lock, &flags);
-
-    list_for_each_entry(proc, &process_list, proc_list) {
-        if (proc->pid == pid) {
-            spin_unlock_irqrestore(&process_list_lock, flags);
-            return proc;
-        }
-    }
-
-    spin_unlock_irqrestore(&process_list_lock, flags);
-    return NULL;
+    return idr_find(&pid_idr, pid);
 }
 
 /*
@@ -522,29 +601,7 @@ struct process *process_find(pid_t pid)
  */
 struct thread *thread_find(tid_t tid)
 {
-    struct process *proc;
-    struct thread *t;
-    u64 flags;
-
-    spin_lock_irqsave(&process_list_lock, &flags);
-
-    list_for_each_entry(proc, &process_list, proc_list) {
-        u64 pflags;
-        spin_lock_irqsave(&proc->lock, &pflags);
-
-        list_for_each_entry(t, &proc->threads, thread_list) {
-            if (t->tid == tid) {
-                spin_unlock_irqrestore(&proc->lock, pflags);
-                spin_unlock_irqrestore(&process_list_lock, flags);
-                return t;
-            }
-        }
-
-        spin_unlock_irqrestore(&proc->lock, pflags);
-    }
-
-    spin_unlock_irqrestore(&process_list_lock, flags);
-    return NULL;
+    return idr_find(&tid_idr, tid);
 }
 
 /*
@@ -566,31 +623,62 @@ void thread_exit(int code)
     /* Mark thread as exiting */
     t->flags |= TF_EXITING;
 
+    /* Free siblings that exited before us while we are still on the CPU */
+    thread_reap_dead();
+
     /* Break any in-flight call/reply links so a waiting caller wakes with
      * IPC_ERR_DEAD instead of stalling on a dead server. */
     ipc_thread_cleanup(t);
 
+    /* Tell a joiner that this thread is gone */
+    if (t->clear_tid && proc->mm) {
+        u32 zero = 0;
+        if (copy_to_user((void *)t->clear_tid, &zero, sizeof(zero)) == 0) {
+            futex_wake((u32 *)t->clear_tid, 1, FUTEX_PRIVATE_FLAG);
+        }
+    }
+
     /* Remove from process */
     u64 flags;
     spin_lock_irqsave(&proc->lock, &flags);
     list_del_init(&t->thread_list);
-    proc->nr_threads--;
+    bool last = --proc->nr_threads == 0;
     spin_unlock_irqrestore(&proc->lock, flags);
 
     thread_global_remove(t);
 
+    /*
+     * The main thread is freed with the process; others are reaped from
+     * dead_threads. Park before waking the parent so its reap finds us.
+     */
+    if (t != proc->main_thread) {
+        spin_lock_irqsave(&thread_list_lock, &flags);
+        list_add_tail(&t->thread_list, &dead_threads);
+        spin_unlock_irqrestore(&thread_list_lock, flags);
+    }
+
     /* If last thread, process exits too - become zombie and wake parent */
-    if (proc->nr_threads == 0) {
+    if (last) {
         proc->exit_code = code;
         t->state = TASK_ZOMBIE;  /* Become zombie for wait() */
 
-        /* Wake up parent if it's waiting */
+        /* wait() looks at the main thread, which may have exited first */
+        if (proc->main_thread && proc->main_thread != t) {
+            proc->main_thread->state = TASK_ZOMBIE;
+            t->state = TASK_DEAD;
+        }
+
+        /*
+         * Wake up parent if it's waiting. wait() arms its sleep under
+         * parent->lock, so taking the lock once orders our zombie state
+         * before its check; the wakeup itself runs unlocked.
+         */
         struct process *parent = proc->parent;
         if (parent) {
             u64 parent_flags;
             spin_lock_irqsave(&parent->lock, &parent_flags);
-            thread_wakeup(parent);
             spin_unlock_irqrestore(&parent->lock, parent_flags);
+            thread_wakeup(parent);
         }
     } else {
         t->state = TASK_DEAD;
@@ -605,6 +693,42 @@ void thread_exit(int code)
     }
 }
 
+/*
+ * Make every other thread of the current process exit
+ *
+ * Siblings are flagged TF_GROUP_EXIT and leave at their next return to
+ * user mode, from a syscall, interrupt or exception; sleeping ones are
+ * woken so they get there. A call waiting for its reply gives up with
+ * IPC_ERR_CANCELED. Returns once the caller is the only thread left, or
+ * exits the caller if another thread started a group exit first.
+ */
+void process_stop_other_threads(void)
+{
+    struct thread *self = current_thread;
+    struct process *proc = self->process;
+    struct thread *t;
+    u64 flags;
+
+    spin_lock_irqsave(&proc->lock, &flags);
+    list_for_each_entry(t, &proc->threads, thread_list) {
+        if (t == self) {
+            continue;
+        }
+        t->flags |= TF_GROUP_EXIT;
+        if (t->state == TASK_INTERRUPTIBLE) {
+            sched_wakeup(t);
+        }
+    }
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    while (proc->nr_threads > 1) {
+        if (self->flags & TF_GROUP_EXIT) {
+            thread_exit(0);
+        }
+        sched_yield();
+    }
+}
+
 /*
  * Process exits
  */
@@ -621,6 +745,11 @@ void process_exit(int code)
         }
     }
 
+    /* Another thread is already taking the process down */
+    if (current_thread->flags & TF_GROUP_EXIT) {
+        thread_exit(code);
+    }
+
     proc->exit_code = code;
 
     /* Tear down IPC endpoints first so any peer blocked in send/recv on our
@@ -628,6 +757,9 @@ void process_exit(int code)
      * process state. */
     ipc_destroy_owned_by_process(proc);
 
+    /* Other threads must be gone before the address space is */
+    process_stop_other_threads();
+
     /*
      * Reparent children to init so someone can always reap them.
      */
@@ -665,8 +797,16 @@ void process_exit(int code)
         vmm_destroy_address_space(old_mm);
     }
 
+    /* A vfork child is done with the parent's address space */
+    process_vfork_release(proc);
+
+    /* Free the process's devices, I/O ports and DMA buffers for the next driver */
+    pci_release_all(proc);
+    ioport_release_all(proc);
+    dma_release_all(proc);
+    shm_release_all(proc);
+
     /* TODO:
-     * - Terminate all threads
      * - Reparent children to init
      * - Notify parent
      * - Become zombie
@@ -676,20 +816,15 @@ void process_exit(int code)
 }
 
 /*
- * Fork current process
+ * Make child a child of parent
+ *
+ * Copies the parent's credentials and session identity and links the child
+ * into the parent's children list so wait() and exit-time reparenting see it.
  */
-pid_t process_fork(void)
+void process_link_child(struct process *parent, struct process *child)
 {
-    struct thread *parent_thread = current_thread;
-    struct process *parent = parent_thread->process;
-
-    /* Create child process */
-    struct process *child = process_create(parent->name);
-    if (!child) {
-        return -1;
-    }
+    u64 flags;
 
-    /* Copy credentials */
     child->ppid = parent->pid;
     child->uid = parent->uid;
     child->euid = parent->euid;
@@ -697,44 +832,35 @@ pid_t process_fork(void)
     child->gid = parent->gid;
     child->egid = parent->egid;
     child->sgid = parent->sgid;
+    child->privileged = parent->privileged;
     child->pgid = parent->pgid;
     child->sid = parent->sid;
 
-    if (parent->files) {
-        process_files_destroy((struct process_files *)child->files);
-        child->files = process_files_clone((const struct process_files *)parent->files);
-        if (!child->files) {
-            process_destroy(child);
-            return -1;
-        }
-    }
-
-    /* Set parent/child relationship */
     child->parent = parent;
-    u64 flags;
     spin_lock_irqsave(&parent->lock, &flags);
     list_add_tail(&child->sibling, &parent->children);
     spin_unlock_irqrestore(&parent->lock, flags);
+}
 
-    /* Clone address space (COW) */
-    if (parent->mm) {
-        child->mm = vmm_clone_address_space(parent->mm);
-        if (!child->mm) {
-            process_destroy(child);
-            return -1;
-        }
-
-        /* vmm_clone_address_space allocated a fresh backing page for the IPC
-         * window VMA, so the child already has its own private window. We
-         * just need to learn the new phys so the kernel can reach it. */
-        process_adopt_ipc_window(child);
-    }
+/*
+ * Duplicate the calling thread into child as its main thread
+ *
+ * The child resumes in ret_from_fork with the caller's syscall frame and
+ * returns 0 to userspace. Only the 176-byte frame is needed on the new
+ * kernel stack; copy_stack additionally copies the rest of the parent's
+ * kernel stack for the classic fork path.
+ *
+ * The thread is linked into child but not started.
+ */
+static struct thread *fork_copy_thread(struct process *child,
+                                       struct thread *parent_thread,
+                                       bool copy_stack)
+{
+    u64 flags;
 
-    /* Create child's main thread as copy of parent thread */
     struct thread *child_thread = kmalloc(sizeof(struct thread));
     if (!child_thread) {
-        process_destroy(child);
-        return -1;
+        return NULL;
     }
 
     /* Copy thread state */
@@ -744,13 +870,14 @@ pid_t process_fork(void)
     child_thread->kernel_stack = alloc_kernel_stack();
     if (!child_thread->kernel_stack) {
         kfree(child_thread);
-        process_destroy(child);
-        return -1;
+        return NULL;
     }
 
     /* Copy kernel stack contents */
-    memcpy(child_thread->kernel_stack, parent_thread->kernel_stack,
-           parent_thread->kernel_stack_size);
+    if (copy_stack) {
+        memcpy(child_thread->kernel_stack, parent_thread->kernel_stack,
+               parent_thread->kernel_stack_size);
+    }
 
     /* Update child thread fields */
     child_thread->tid = child->pid;
@@ -760,9 +887,11 @@ pid_t process_fork(void)
     child_thread->time_slice = DEFAULT_TIME_SLICE;
     child_thread->start_time = get_ticks();
 
+    /* The child is its process's only thread; nobody joins on it */
+    child_thread->clear_tid = 0;
+
     /* Reset timing stats */
-    child_thread->user_time = 0;
-    child_thread->system_time = 0;
+    memset(&child_thread->sched_stats, 0, sizeof(child_thread->sched_stats));
 
     /* Initialize list heads (don't copy parent's links) */
     INIT_LIST_HEAD(&child_thread->run_list);
@@ -822,14 +951,161 @@ pid_t process_fork(void)
 
     thread_global_add(child_thread);
 
-    /* Add child thread to scheduler */
     child_thread->flags &= ~TF_FORKING;
+    return child_thread;
+}
+
+/*
+ * Fork current process
+ */
+pid_t process_fork(void)
+{
+    struct thread *parent_thread = current_thread;
+    struct process *parent = parent_thread->process;
+
+    /* Create child process */
+    struct process *child = process_create(parent->name);
+    if (!child) {
+        return -1;
+    }
+
+    if (parent->files) {
+        process_files_destroy((struct process_files *)child->files);
+        child->files = process_files_clone((const struct process_files *)parent->files);
+        if (!child->files) {
+            process_destroy(child);
+            return -1;
+        }
+    }
+
+    /* Copy credentials and set parent/child relationship */
+    process_link_child(parent, child);
+
+    /* Clone address space (COW) */
+    if (parent->mm) {
+        child->mm = vmm_clone_address_space(parent->mm);
+        if (!child->mm) {
+            process_destroy(child);
+            return -1;
+        }
+
+        /* vmm_clone_address_space allocated a fresh backing page for the IPC
+         * window VMA, so the child already has its own private window. We
+         * just need to learn the new phys so the kernel can reach it. */
+        process_adopt_ipc_window(child);
+    }
+
+    /* Create child's main thread as copy of parent thread */
+    struct thread *child_thread = fork_copy_thread(child, parent_thread, true);
+    if (!child_thread) {
+        process_destroy(child);
+        return -1;
+    }
+
+    /* Add child thread to scheduler */
     sched_add(child_thread);
 
     /* Parent returns child's PID */
     return child->pid;
 }
 
+/*
+ * vfork current process
+ *
+ * The child borrows the parent's address space (an extra reference, no
+ * page copies) and runs on the parent's user stack, so the calling thread
+ * is suspended until the child execs or exits. Cost is independent of the
+ * parent's size.
+ */
+pid_t process_vfork(void)
+{
+    struct thread *parent_thread = current_thread;
+    struct process *parent = parent_thread->process;
+    u64 flags;
+
+    if (!parent->mm) {
+        return -1;
+    }
+
+    struct process *child = process_create(parent->name);
+    if (!child) {
+        return -1;
+    }
+
+    if (parent->files) {
+        process_files_destroy((struct process_files *)child->files);
+        child->files = process_files_clone((const struct process_files *)parent->files);
+        if (!child->files) {
+            process_destroy(child);
+            return -1;
+        }
+    }
+
+    process_link_child(parent, child);
+
+    /* Share the address space and with it the parent's IPC window */
+    child->mm = vmm_get_address_space(parent->mm);
+    child->ipc_window_phys = parent->ipc_window_phys;
+    child->vfork_waiter = parent_thread;
+
+    struct thread *child_thread = fork_copy_thread(child, parent_thread, false);
+    if (!child_thread) {
+        child->vfork_waiter = NULL;
+        child->ipc_window_phys = 0;
+        process_destroy(child);
+        return -1;
+    }
+
+    pid_t pid = child->pid;
+    sched_add(child_thread);
+
+    /*
+     * Sleep until process_vfork_release() clears vfork_waiter. The child
+     * stays a zombie until we reap it, so it cannot be freed under us.
+     */
+    spin_lock_irqsave(&child->lock, &flags);
+    while (child->vfork_waiter == parent_thread) {
+        parent_thread->wait_channel = child;
+        parent_thread->state = TASK_UNINTERRUPTIBLE;
+        spin_unlock_irqrestore(&child->lock, flags);
+
+        int reason = sched_block_reason_set(SCHED_BLOCK_WAIT);
+        schedule();
+        sched_block_reason_restore(reason);
+
+        parent_thread->wait_channel = NULL;
+        spin_lock_irqsave(&child->lock, &flags);
+    }
+    spin_unlock_irqrestore(&child->lock, flags);
+
+    return pid;
+}
+
+/*
+ * Hand the address space back to a suspended vfork parent
+ *
+ * Called once proc runs on its own address space (exec) or has dropped
+ * its reference (exit). No-op for processes not created by vfork.
+ */
+void process_vfork_release(struct process *proc)
+{
+    struct thread *waiter;
+    u64 flags;
+
+    if (!proc) {
+        return;
+    }
+
+    spin_lock_irqsave(&proc->lock, &flags);
+    waiter = proc->vfork_waiter;
+    proc->vfork_waiter = NULL;
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    if (waiter) {
+        thread_wakeup(proc);
+    }
+}
+
 /*
  * Wait for child process
  */
@@ -890,9 +1166,16 @@ retry:
         spin_unlock_irqrestore(&proc->lock, flags);
     }
 
+    int reason = sched_block_reason_set(SCHED_BLOCK_WAIT);
     schedule();
+    sched_block_reason_restore(reason);
     self->wait_channel = NULL;
 
+    /* Another thread is exiting the process; give up the wait */
+    if (self->flags & TF_GROUP_EXIT) {
+        return -1;
+    }
+
     /* We were woken up - check again for zombies */
     goto retry;
 }
@@ -902,8 +1185,10 @@ retry:
  */
 int process_kill(pid_t pid, int sig)
 {
+    rcu_read_lock();
     struct process *proc = process_find(pid);
     if (!proc) {
+        rcu_read_unlock();
         return -1;
     }
 
@@ -915,6 +1200,7 @@ int process_kill(pid_t pid, int sig)
         proc->main_thread->flags |= TF_EXITING;
     }
 
+    rcu_read_unlock();
     return 0;
 }
 
@@ -928,9 +1214,8 @@ void process_dump(void)
     kprintf("  ---  ----  --------------  -------  -----\n");
 
     struct process *proc;
-    u64 flags;
 
-    spin_lock_irqsave(&process_list_lock, &flags);
+    mutex_lock(&process_list_lock);
 
     list_for_each_entry(proc, &process_list, proc_list) {
         const char *state = "?";
@@ -950,5 +1235,5 @@ void process_dump(void)
                 proc->nr_threads, state);
     }
 
-    spin_unlock_irqrestore(&process_list_lock, flags);
+    mutex_unlock(&process_list_lock);
 }
@@ -6,6 +6,11 @@
 
 #include <ocean/sched.h>
 #include <ocean/process.h>
+#include <ocean/ioport.h>
+#include <ocean/rcu.h>
+#include <ocean/seqlock.h>
+#include <ocean/smp.h>
+#include <ocean/trace.h>
 #include <ocean/types.h>
 #include <ocean/defs.h>
 #include <ocean/list.h>
@@ -29,11 +34,15 @@ struct thread *current_thread = NULL;
 /* Preemption count (per-CPU) */
 static int _preempt_count = 0;
 
-/* Global tick counter */
-static u64 global_ticks = 0;
-
-/* Time tracking (simple monotonic counter based on ticks) */
-static u64 boot_time_ns = 0;
+/*
+ * Tick-based clock, advanced by sched_tick(). The timer interrupt is the
+ * only writer; get_time_ns() readers retry if they race with it.
+ */
+static struct {
+    seqcount_t seq;
+    u64 ticks;                  /* Ticks since boot */
+    u64 ns;                     /* Monotonic nanoseconds since boot */
+} sched_clock = { .seq = SEQCNT_ZERO };
 
 /*
  * Bitmap operations for fast priority queue lookup
@@ -69,6 +78,13 @@ struct run_queue *this_rq(void)
     return &runqueues[0];
 }
 
+#if NR_CPUS > 1
+int smp_processor_id(void)
+{
+    return runqueues ? this_rq()->cpu_id : 0;
+}
+#endif
+
 /*
  * Get run queue for specific CPU
  */
@@ -101,6 +117,32 @@ void preempt_enable(void)
     }
 }
 
+/*
+ * Drop a preemption count without acting on TF_NEED_RESCHED. For callers
+ * that may still hold a spinlock, which does not count; a reschedule they
+ * leave pending is taken at the next preempt_check_resched().
+ */
+void preempt_enable_no_resched(void)
+{
+    if (_preempt_count > 0) {
+        _preempt_count--;
+    }
+}
+
+/*
+ * Preemption point: switch away if a tick or wakeup asked for it. Only
+ * call where the caller holds no locks.
+ */
+void preempt_check_resched(void)
+{
+    struct thread *t = current_thread;
+
+    if (_preempt_count == 0 && t && (t->flags & TF_NEED_RESCHED)) {
+        t->flags &= ~TF_NEED_RESCHED;
+        schedule();
+    }
+}
+
 int preempt_count(void)
 {
     return _preempt_count;
@@ -158,6 +200,12 @@ void sched_add(struct thread *t)
 
     spin_lock_irqsave(&rq->lock, &flags);
 
+    /* A new thread starts its first run-queue wait now */
+    if (!t->sched_stats.off_since && !t->sched_stats.on_cpu_since) {
+        t->sched_stats.off_since = rdtsc();
+        t->sched_stats.off_reason = SCHED_OFF_RUNNABLE;
+    }
+
     t->state = TASK_RUNNING;
     enqueue_thread_locked(rq, t);
 
@@ -219,6 +267,50 @@ static struct thread *pick_next_thread(struct run_queue *rq)
     return next;
 }
 
+/*
+ * Charge the interval that ends at a context switch: prev's time on the
+ * CPU, and next's time off it, to run delay or to the reason it blocked.
+ * A switch is voluntary if prev blocked or is only yielding in a sleep.
+ */
+static void sched_account_switch(struct thread *prev, struct thread *next)
+{
+    struct thread_sched_stats *ps = &prev->sched_stats;
+    struct thread_sched_stats *ns = &next->sched_stats;
+    u64 now = rdtsc();
+
+    if (ps->on_cpu_since) {
+        ps->cpu_cycles += now - ps->on_cpu_since;
+        ps->on_cpu_since = 0;
+    }
+    ps->off_since = now;
+    if (prev->state != TASK_RUNNING) {
+        ps->off_reason = ps->block_reason;
+        ps->nvcsw++;
+    } else if (ps->block_reason == SCHED_BLOCK_SLEEP) {
+        ps->off_reason = SCHED_BLOCK_SLEEP;
+        ps->nvcsw++;
+    } else {
+        ps->off_reason = SCHED_OFF_RUNNABLE;
+        ps->nivcsw++;
+    }
+
+    if (ns->off_since) {
+        u64 delta = now - ns->off_since;
+
+        if (ns->off_reason == SCHED_OFF_RUNNABLE) {
+            ns->run_delay += delta;
+            ns->nr_run_waits++;
+            if (delta > ns->run_delay_max) {
+                ns->run_delay_max = delta;
+            }
+        } else {
+            ns->blocked[ns->off_reason] += delta;
+        }
+        ns->off_since = 0;
+    }
+    ns->on_cpu_since = now;
+}
+
 /*
  * Perform context switch
  */
@@ -226,6 +318,9 @@ void switch_to(struct thread *prev, struct thread *next)
 {
     struct run_queue *rq = this_rq();
 
+    trace_sched_switch(prev->tid, next->tid, prev->state);
+    sched_account_switch(prev, next);
+
     /* Update run queue curr */
     rq->curr = next;
     current_thread = next;
@@ -251,9 +346,17 @@ void switch_to(struct thread *prev, struct thread *next)
         tss_set_rsp0((u64)next->kernel_stack + next->kernel_stack_size);
     }
 
+    /* Port access follows the process; the bitmap is copied only if it changed */
+    ioport_switch(next->process);
+
+    /* User TLS thread pointer */
+    if (prev->fs_base != next->fs_base) {
+        wrmsr(MSR_FS_BASE, next->fs_base);
+    }
+
     /* Update statistics */
     rq->switches++;
-    next->last_run = global_ticks;
+    next->last_run = get_ticks();
 
     /* Clear need_resched flag */
     next->flags &= ~TF_NEED_RESCHED;
@@ -278,6 +381,9 @@ void schedule(void)
         rq->curr = prev;
     }
 
+    /* Not inside any RCU read-side section: a quiescent state */
+    rcu_note_context_switch();
+
     preempt_disable();
     spin_lock_irqsave(&rq->lock, &flags);
 
@@ -317,7 +423,11 @@ void sched_tick(void)
     struct thread *curr = current_thread;
 
     rq->tick_count++;
-    global_ticks++;
+
+    write_seqcount_begin(&sched_clock.seq);
+    sched_clock.ticks++;
+    sched_clock.ns += TICK_NS;
+    write_seqcount_end(&sched_clock.seq);
 
     if (!curr || curr == rq->idle) {
         rq->idle_time += TICK_NS;
@@ -341,8 +451,7 @@ void sched_tick(void)
         curr->flags |= TF_NEED_RESCHED;
     }
 
-    /* Update time accounting */
-    curr->system_time += TICK_NS;  /* Assume kernel time for now */
+    /* Per-thread user/system time is measured with the TSC instead */
     rq->total_time += TICK_NS;
 }
 
@@ -355,8 +464,20 @@ void sched_wakeup(struct thread *t)
         return;  /* Already runnable */
     }
 
+    /* The sleep ends here; any further wait is for a CPU */
+    if (t->sched_stats.off_since &&
+        t->sched_stats.off_reason != SCHED_OFF_RUNNABLE) {
+        u64 now = rdtsc();
+
+        t->sched_stats.blocked[t->sched_stats.off_reason] +=
+            now - t->sched_stats.off_since;
+        t->sched_stats.off_since = now;
+        t->sched_stats.off_reason = SCHED_OFF_RUNNABLE;
+    }
+
     t->state = TASK_RUNNING;
     t->time_slice = DEFAULT_TIME_SLICE;
+    trace_sched_wakeup(t->tid, t->cpu);
 
     /*
      * The current thread is already executing. If it gets woken before it
@@ -367,6 +488,15 @@ void sched_wakeup(struct thread *t)
     }
 
     sched_add(t);
+
+    /*
+     * A wakeup from an interrupt handler lands while the idle loop sits in
+     * hlt; have it switch as soon as the handler returns instead of at the
+     * next tick.
+     */
+    if (current_thread && current_thread == this_rq()->idle) {
+        current_thread->flags |= TF_NEED_RESCHED;
+    }
 }
 
 /*
@@ -421,29 +551,44 @@ void sched_set_nice(struct thread *t, int nice)
  */
 u64 get_ticks(void)
 {
-    return global_ticks;
+    /* A single aligned word: no sequence check needed */
+    return __atomic_load_n(&sched_clock.ticks, __ATOMIC_RELAXED);
 }
 
 u64 get_time_ns(void)
 {
-    return boot_time_ns + (global_ticks * TICK_NS);
+    u64 ns;
+    u32 seq;
+
+    do {
+        seq = read_seqcount_begin(&sched_clock.seq);
+        ns = sched_clock.ns;
+    } while (read_seqcount_retry(&sched_clock.seq, seq));
+
+    return ns;
 }
 
 void msleep(u64 ms)
 {
-    u64 end = global_ticks + (ms * HZ / 1000);
-    while (global_ticks < end) {
+    u64 end = get_ticks() + (ms * HZ / 1000);
+    int reason = sched_block_reason_set(SCHED_BLOCK_SLEEP);
+
+    while (get_ticks() < end) {
         sched_yield();
     }
+    sched_block_reason_restore(reason);
 }
 
 void nsleep(u64 ns)
 {
     u64 ticks = (ns + TICK_NS - 1) / TICK_NS;
-    u64 end = global_ticks + ticks;
-    while (global_ticks < end) {
+    u64 end = get_ticks() + ticks;
+    int reason = sched_block_reason_set(SCHED_BLOCK_SLEEP);
+
+    while (get_ticks() < end) {
         sched_yield();
     }
+    sched_block_reason_restore(reason);
 }
 
 /*
@@ -476,13 +621,11 @@ void thread_wakeup(void *channel)
 {
     /* Wake all threads sleeping on this channel. */
     extern struct list_head all_threads;
-    extern spinlock_t thread_list_lock;
 
-    u64 flags;
-    spin_lock_irqsave(&thread_list_lock, &flags);
+    rcu_read_lock();
 
     struct thread *t;
-    list_for_each_entry(t, &all_threads, all_list) {
+    list_for_each_entry_rcu(t, &all_threads, all_list) {
         if (t->wait_channel == channel &&
             (t->state == TASK_INTERRUPTIBLE ||
              t->state == TASK_UNINTERRUPTIBLE)) {
@@ -490,7 +633,7 @@ void thread_wakeup(void *channel)
         }
     }
 
-    spin_unlock_irqrestore(&thread_list_lock, flags);
+    rcu_read_unlock();
 }
 
 /*
@@ -555,6 +698,31 @@ void wake_up_all(struct wait_queue *wq)
     spin_unlock_irqrestore(&wq->lock, flags);
 }
 
+void prepare_to_wait(struct wait_queue *wq, int state)
+{
+    struct thread *t = current_thread;
+    u64 flags;
+
+    spin_lock_irqsave(&wq->lock, &flags);
+    if (list_empty(&t->wait_list)) {
+        list_add_tail(&t->wait_list, &wq->head);
+    }
+    t->state = state;
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void finish_wait(struct wait_queue *wq)
+{
+    struct thread *t = current_thread;
+    u64 flags;
+
+    /* wake_up() dequeues us; a skipped or spurious sleep has to here */
+    spin_lock_irqsave(&wq->lock, &flags);
+    t->state = TASK_RUNNING;
+    list_del_init(&t->wait_list);
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
 /*
  * Debug functions
  */
@@ -583,7 +751,7 @@ void sched_dump_runqueue(int cpu)
 void sched_dump_stats(void)
 {
     kprintf("\nScheduler Statistics:\n");
-    kprintf("  Total ticks: %llu\n", global_ticks);
+    kprintf("  Total ticks: %llu\n", get_ticks());
     kprintf("  CPUs: %d\n", nr_cpus);
 
     for (int i = 0; i < nr_cpus; i++) {
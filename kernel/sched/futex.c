@@ -0,0 +1,207 @@
+/*
+ * Ocean Kernel - Futex
+ *
+ * Waiters live on their own kernel stacks, queued in a fixed hash table
+ * of buckets. The user word is re-read through its physical page with the
+ * bucket lock held, so a waker that changes the word and then calls
+ * futex_wake either makes the waiter see the new value or finds it queued.
+ */
+
+#include <ocean/futex.h>
+#include <ocean/process.h>
+#include <ocean/sched.h>
+#include <ocean/vmm.h>
+#include <ocean/pmm.h>
+#include <ocean/uaccess.h>
+#include <ocean/list.h>
+#include <ocean/spinlock.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+#define FUTEX_HASH_BITS     6
+#define FUTEX_HASH_SIZE     (1 << FUTEX_HASH_BITS)
+
+struct futex_key {
+    struct address_space *as;       /* NULL for shared mappings */
+    u64 addr;                       /* Virtual, or physical if shared */
+};
+
+struct futex_waiter {
+    struct list_head list;          /* Link in bucket; empty once woken */
+    struct futex_key key;
+    struct thread *thread;
+};
+
+struct futex_bucket {
+    spinlock_t lock;
+    struct list_head waiters;
+};
+
+static struct futex_bucket futex_table[FUTEX_HASH_SIZE];
+
+void futex_init(void)
+{
+    for (int i = 0; i < FUTEX_HASH_SIZE; i++) {
+        spin_init(&futex_table[i].lock);
+        INIT_LIST_HEAD(&futex_table[i].waiters);
+    }
+
+    kprintf("Futex: %d hash buckets\n", FUTEX_HASH_SIZE);
+}
+
+static struct futex_bucket *futex_hash(const struct futex_key *key)
+{
+    u64 h = ((u64)key->as ^ key->addr) * 0x9E3779B97F4A7C15ULL;
+    return &futex_table[h >> (64 - FUTEX_HASH_BITS)];
+}
+
+static inline bool futex_key_eq(const struct futex_key *a,
+                                const struct futex_key *b)
+{
+    return a->as == b->as && a->addr == b->addr;
+}
+
+/*
+ * Validate uaddr, fault its page in, and build its key. *val receives the
+ * current value of the word.
+ */
+static int futex_get_key(u32 *uaddr, u32 flags, struct futex_key *key, u32 *val)
+{
+    struct process *proc = get_current_process();
+    struct address_space *as;
+    int ret;
+
+    if (!proc || !proc->mm) {
+        return -EFAULT;
+    }
+    if ((u64)uaddr & (sizeof(u32) - 1)) {
+        return -EINVAL;
+    }
+
+    ret = copy_from_user(val, uaddr, sizeof(*val));
+    if (ret < 0) {
+        return ret;
+    }
+
+    as = proc->mm;
+    key->as = as;
+    key->addr = (u64)uaddr;
+
+    if (!(flags & FUTEX_PRIVATE_FLAG)) {
+        struct vm_area *vma;
+        bool shared;
+
+        mutex_lock(&as->lock);
+        vma = vmm_find_vma(as, (u64)uaddr);
+        shared = vma && (vma->flags & VMA_SHARED);
+        mutex_unlock(&as->lock);
+
+        if (shared) {
+            phys_addr_t phys = paging_get_phys(as->pml4, (u64)uaddr);
+            if (phys == (phys_addr_t)-1) {
+                return -EFAULT;
+            }
+            key->as = NULL;
+            key->addr = phys;
+        }
+    }
+
+    return 0;
+}
+
+int futex_wait(u32 *uaddr, u32 val, u32 flags)
+{
+    struct thread *self = current_thread;
+    struct futex_waiter waiter;
+    struct futex_bucket *bucket;
+    phys_addr_t phys;
+    u64 lock_flags;
+    u32 cur;
+    int ret, reason;
+
+retry:
+    ret = futex_get_key(uaddr, flags, &waiter.key, &cur);
+    if (ret < 0) {
+        return ret;
+    }
+
+    bucket = futex_hash(&waiter.key);
+    spin_lock_irqsave(&bucket->lock, &lock_flags);
+
+    /*
+     * Read the word again under the bucket lock, through the page that is
+     * mapped now (a copy-on-write fault may have replaced it). It cannot
+     * fault here; if the page went away, fault it back in and start over.
+     */
+    phys = paging_get_phys(self->process->mm->pml4, (u64)uaddr);
+    if (phys == (phys_addr_t)-1) {
+        spin_unlock_irqrestore(&bucket->lock, lock_flags);
+        goto retry;
+    }
+
+    cur = *(volatile u32 *)phys_to_virt(phys);
+    if (cur != val) {
+        spin_unlock_irqrestore(&bucket->lock, lock_flags);
+        return -EAGAIN;
+    }
+
+    waiter.thread = self;
+    list_add_tail(&waiter.list, &bucket->waiters);
+    self->wait_channel = &waiter;
+    self->state = TASK_INTERRUPTIBLE;
+    spin_unlock_irqrestore(&bucket->lock, lock_flags);
+
+    reason = sched_block_reason_set(SCHED_BLOCK_FUTEX);
+    schedule();
+    sched_block_reason_restore(reason);
+
+    /* futex_wake dequeues the waiters it wakes; anything else is spurious */
+    spin_lock_irqsave(&bucket->lock, &lock_flags);
+    if (!list_empty(&waiter.list)) {
+        list_del_init(&waiter.list);
+        ret = -EINTR;
+    }
+    spin_unlock_irqrestore(&bucket->lock, lock_flags);
+
+    self->wait_channel = NULL;
+    return ret;
+}
+
+int futex_wake(u32 *uaddr, int nr, u32 flags)
+{
+    struct futex_waiter *waiter, *tmp;
+    struct futex_bucket *bucket;
+    struct futex_key key;
+    u64 lock_flags;
+    u32 cur;
+    int woken = 0;
+    int ret;
+
+    if (nr <= 0) {
+        return 0;
+    }
+
+    ret = futex_get_key(uaddr, flags, &key, &cur);
+    if (ret < 0) {
+        return ret;
+    }
+
+    bucket = futex_hash(&key);
+    spin_lock_irqsave(&bucket->lock, &lock_flags);
+    list_for_each_entry_safe(waiter, tmp, &bucket->waiters, list) {
+        if (!futex_key_eq(&waiter->key, &key)) {
+            continue;
+        }
+        list_del_init(&waiter->list);
+        sched_wakeup(waiter->thread);
+        if (++woken >= nr) {
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&bucket->lock, lock_flags);
+
+    return woken;
+}
@@ -0,0 +1,198 @@
+/*
+ * Ocean Kernel - Sleeping Locks
+ *
+ * Both primitives use the same sleep protocol: bump nr_waiters, queue on
+ * the wait queue, then try once more before calling schedule(). The
+ * releaser publishes the release before it looks at nr_waiters, so either
+ * the last try succeeds or the releaser sees the waiter and wakes it.
+ */
+
+#include <ocean/mutex.h>
+#include <ocean/sched.h>
+#include <ocean/process.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* Owner recorded for locks taken before the first thread exists */
+#define MUTEX_OWNER_BOOT    ((struct thread *)1)
+
+static inline struct thread *mutex_self(void)
+{
+    return current_thread ? current_thread : MUTEX_OWNER_BOOT;
+}
+
+void mutex_init(struct mutex *m)
+{
+    m->owner = NULL;
+    m->nr_waiters = 0;
+    wait_queue_init(&m->wait);
+}
+
+static inline bool __mutex_trylock(struct mutex *m, int order)
+{
+    struct thread *expected = NULL;
+
+    return __atomic_compare_exchange_n(&m->owner, &expected, mutex_self(),
+                                       false, order, __ATOMIC_RELAXED);
+}
+
+bool mutex_trylock(struct mutex *m)
+{
+    return __mutex_trylock(m, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Is owner executing on some other CPU right now? If it is on ours (or
+ * not running at all), it cannot release the mutex while we spin.
+ */
+static bool mutex_owner_running(struct thread *owner)
+{
+    if (owner == MUTEX_OWNER_BOOT || owner == current_thread) {
+        return false;
+    }
+
+    struct run_queue *rq = cpu_rq(owner->cpu);
+    return rq && rq != this_rq() &&
+           __atomic_load_n(&rq->curr, __ATOMIC_RELAXED) == owner;
+}
+
+/*
+ * Spin while the mutex is held by a running owner. Returns true if it
+ * was seen unlocked, false if it is time to sleep instead.
+ */
+static bool mutex_spin_on_owner(struct mutex *m)
+{
+    struct thread *owner;
+
+    while ((owner = __atomic_load_n(&m->owner, __ATOMIC_RELAXED)) != NULL) {
+        if (!mutex_owner_running(owner) ||
+            (current_thread->flags & TF_NEED_RESCHED)) {
+            return false;
+        }
+        cpu_pause();
+    }
+
+    return true;
+}
+
+static void mutex_lock_slowpath(struct mutex *m)
+{
+    for (;;) {
+        bool acquired;
+
+        if (mutex_spin_on_owner(m) && mutex_trylock(m)) {
+            return;
+        }
+
+        __atomic_fetch_add(&m->nr_waiters, 1, __ATOMIC_SEQ_CST);
+        prepare_to_wait(&m->wait, TASK_UNINTERRUPTIBLE);
+
+        acquired = __mutex_trylock(m, __ATOMIC_SEQ_CST);
+        if (!acquired) {
+            int reason = sched_block_reason_set(SCHED_BLOCK_LOCK);
+            schedule();
+            sched_block_reason_restore(reason);
+        }
+
+        finish_wait(&m->wait);
+        __atomic_fetch_sub(&m->nr_waiters, 1, __ATOMIC_RELAXED);
+
+        if (acquired) {
+            return;
+        }
+    }
+}
+
+void mutex_lock(struct mutex *m)
+{
+    if (mutex_trylock(m)) {
+        return;
+    }
+
+    /* Before the scheduler starts there is no thread to put to sleep */
+    if (!current_thread) {
+        while (!mutex_trylock(m)) {
+            cpu_pause();
+        }
+        return;
+    }
+
+    mutex_lock_slowpath(m);
+}
+
+void mutex_unlock(struct mutex *m)
+{
+    __atomic_store_n(&m->owner, NULL, __ATOMIC_SEQ_CST);
+
+    /* A woken waiter competes for the lock again; it is not handed over */
+    if (__atomic_load_n(&m->nr_waiters, __ATOMIC_SEQ_CST) != 0) {
+        wake_up(&m->wait);
+    }
+}
+
+/*
+ * Semaphores
+ */
+
+void sema_init(struct semaphore *sem, int count)
+{
+    sem->count = count;
+    sem->nr_waiters = 0;
+    wait_queue_init(&sem->wait);
+}
+
+static inline bool __down_trylock(struct semaphore *sem, int order)
+{
+    i32 count = __atomic_load_n(&sem->count, __ATOMIC_RELAXED);
+
+    while (count > 0) {
+        if (__atomic_compare_exchange_n(&sem->count, &count, count - 1,
+                                        false, order, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool down_trylock(struct semaphore *sem)
+{
+    return __down_trylock(sem, __ATOMIC_ACQUIRE);
+}
+
+void down(struct semaphore *sem)
+{
+    for (;;) {
+        bool acquired;
+
+        if (down_trylock(sem)) {
+            return;
+        }
+
+        __atomic_fetch_add(&sem->nr_waiters, 1, __ATOMIC_SEQ_CST);
+        prepare_to_wait(&sem->wait, TASK_UNINTERRUPTIBLE);
+
+        acquired = __down_trylock(sem, __ATOMIC_SEQ_CST);
+        if (!acquired) {
+            int reason = sched_block_reason_set(SCHED_BLOCK_LOCK);
+            schedule();
+            sched_block_reason_restore(reason);
+        }
+
+        finish_wait(&sem->wait);
+        __atomic_fetch_sub(&sem->nr_waiters, 1, __ATOMIC_RELAXED);
+
+        if (acquired) {
+            return;
+        }
+    }
+}
+
+void up(struct semaphore *sem)
+{
+    __atomic_fetch_add(&sem->count, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&sem->nr_waiters, __ATOMIC_SEQ_CST) != 0) {
+        wake_up(&sem->wait);
+    }
+}
@@ -0,0 +1,216 @@
+/*
+ * Ocean Kernel - Read-Copy-Update
+ *
+ * Classic quiescent-state-based grace periods. Each CPU queues callbacks
+ * on a "next" batch; when a grace period can start, the batch moves to
+ * "wait" tagged with that period's number, and once the period completes
+ * it moves to "done" and runs. A grace period completes when every CPU
+ * has reported a quiescent state after noticing it started.
+ *
+ * Quiescent states are context switches (schedule() is never called from
+ * a read-side section) and timer ticks that interrupt user mode or kernel
+ * code running with preemption enabled.
+ */
+
+#include <ocean/rcu.h>
+#include <ocean/sched.h>
+#include <ocean/spinlock.h>
+#include <ocean/percpu_counter.h>
+#include <ocean/smp.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern int kprintf(const char *fmt, ...);
+
+static_assert(NR_CPUS < 64, "cpus_pending is a u64 mask");
+
+struct rcu_cpu {
+    u64 gp_seen;                /* Last grace period this CPU noticed */
+    bool qs_pending;            /* Still owes a quiescent state to gp_seen */
+
+    struct rcu_head *next;      /* Not yet assigned to a grace period */
+    struct rcu_head **next_tail;
+    struct rcu_head *wait;      /* Waiting for grace period wait_gp */
+    struct rcu_head **wait_tail;
+    u64 wait_gp;
+    struct rcu_head *done;      /* Safe to invoke */
+    struct rcu_head **done_tail;
+};
+
+static struct {
+    spinlock_t lock;
+    u64 cur;                    /* Most recently started grace period */
+    u64 completed;              /* Most recently completed grace period */
+    u64 cpus_pending;           /* CPUs that owe a quiescent state to cur */
+
+    /* Statistics */
+    struct percpu_counter nr_queued;
+    struct percpu_counter nr_invoked;
+} rcu_state;
+
+static struct rcu_cpu rcu_cpus[NR_CPUS];
+
+void rcu_init(void)
+{
+    spin_init(&rcu_state.lock);
+    rcu_state.cur = 0;
+    rcu_state.completed = 0;
+    rcu_state.cpus_pending = 0;
+
+    for (int i = 0; i < NR_CPUS; i++) {
+        struct rcu_cpu *rdp = &rcu_cpus[i];
+
+        rdp->next = NULL;
+        rdp->next_tail = &rdp->next;
+        rdp->wait = NULL;
+        rdp->wait_tail = &rdp->wait;
+        rdp->done = NULL;
+        rdp->done_tail = &rdp->done;
+    }
+
+    kprintf("RCU: quiescent-state based, %d CPU(s)\n", NR_CPUS);
+}
+
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *head))
+{
+    struct rcu_cpu *rdp = &rcu_cpus[smp_processor_id()];
+    u64 flags;
+
+    head->func = func;
+    head->next = NULL;
+
+    flags = local_irq_save();
+    *rdp->next_tail = head;
+    rdp->next_tail = &head->next;
+    percpu_counter_inc(&rcu_state.nr_queued);
+    local_irq_restore(flags);
+}
+
+/*
+ * Advance this CPU's view of the grace-period machinery. qs says whether
+ * the CPU is in a quiescent state right now. Interrupts must be off.
+ */
+static void rcu_process(struct rcu_cpu *rdp, bool qs)
+{
+    u64 cpu_bit = 1ULL << smp_processor_id();
+
+    spin_lock(&rcu_state.lock);
+
+    /* Give the next batch a grace period, starting one if none is running */
+    if (!rdp->wait && rdp->next) {
+        rdp->wait = rdp->next;
+        rdp->wait_tail = rdp->next_tail;
+        rdp->wait_gp = rcu_state.cur + 1;
+        rdp->next = NULL;
+        rdp->next_tail = &rdp->next;
+    }
+    if (rdp->wait && rdp->wait_gp > rcu_state.cur &&
+        rcu_state.cur == rcu_state.completed) {
+        rcu_state.cur++;
+        rcu_state.cpus_pending = (1ULL << NR_CPUS) - 1;
+    }
+
+    /* A quiescent state only counts for periods that started before it */
+    if (rdp->gp_seen != rcu_state.cur) {
+        rdp->gp_seen = rcu_state.cur;
+        rdp->qs_pending = (rcu_state.cpus_pending & cpu_bit) != 0;
+    }
+    if (rdp->qs_pending && qs) {
+        rdp->qs_pending = false;
+        rcu_state.cpus_pending &= ~cpu_bit;
+        if (rcu_state.cpus_pending == 0) {
+            rcu_state.completed = rcu_state.cur;
+        }
+    }
+
+    if (rdp->wait && rdp->wait_gp <= rcu_state.completed) {
+        *rdp->done_tail = rdp->wait;
+        rdp->done_tail = rdp->wait_tail;
+        rdp->wait = NULL;
+        rdp->wait_tail = &rdp->wait;
+    }
+
+    spin_unlock(&rcu_state.lock);
+}
+
+/* Run callbacks whose grace period has ended */
+static void rcu_invoke_done(struct rcu_cpu *rdp)
+{
+    struct rcu_head *list;
+    u64 flags;
+
+    flags = local_irq_save();
+    list = rdp->done;
+    rdp->done = NULL;
+    rdp->done_tail = &rdp->done;
+    local_irq_restore(flags);
+
+    while (list) {
+        struct rcu_head *next = list->next;
+        list->func(list);
+        percpu_counter_inc(&rcu_state.nr_invoked);
+        list = next;
+    }
+}
+
+/*
+ * Called at the top of schedule(): a context switch is a quiescent state
+ */
+void rcu_note_context_switch(void)
+{
+    struct rcu_cpu *rdp = &rcu_cpus[smp_processor_id()];
+    u64 flags;
+
+    flags = local_irq_save();
+    rcu_process(rdp, true);
+    local_irq_restore(flags);
+
+    if (rdp->done) {
+        rcu_invoke_done(rdp);
+    }
+}
+
+/*
+ * Called from the timer tick. Readers disable preemption, so a tick that
+ * finds preemption enabled did not interrupt a read-side section.
+ */
+void rcu_check_callbacks(bool user)
+{
+    struct rcu_cpu *rdp = &rcu_cpus[smp_processor_id()];
+
+    rcu_process(rdp, user || preempt_count() == 0);
+
+    /* Interrupted user mode holds no kernel locks; callbacks may run here */
+    if (user && rdp->done) {
+        rcu_invoke_done(rdp);
+    }
+}
+
+struct rcu_synchronize {
+    struct rcu_head head;
+    volatile bool done;
+};
+
+static void rcu_synchronize_done(struct rcu_head *head)
+{
+    container_of(head, struct rcu_synchronize, head)->done = true;
+}
+
+void synchronize_rcu(void)
+{
+    struct rcu_synchronize rs = { .done = false };
+
+    call_rcu(&rs.head, rcu_synchronize_done);
+    while (!rs.done) {
+        sched_yield();
+    }
+}
+
+void rcu_dump_stats(void)
+{
+    kprintf("RCU: %llu grace periods, %llu callbacks queued, %llu run\n",
+            rcu_state.completed,
+            percpu_counter_sum_positive(&rcu_state.nr_queued),
+            percpu_counter_sum_positive(&rcu_state.nr_invoked));
+}
@@ -0,0 +1,126 @@
+/*
+ * Ocean Kernel - Per-Thread Scheduler Statistics
+ *
+ * The counters themselves are kept by the scheduler in struct
+ * thread_sched_stats. This file snapshots them for a process, adding the
+ * interval each thread is currently in, and converts cycles to time.
+ */
+
+#include <ocean/schedstat.h>
+#include <ocean/sched.h>
+#include <ocean/process.h>
+#include <ocean/rcu.h>
+#include <ocean/trace.h>
+#include <ocean/uaccess.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern void *memset(void *s, int c, size_t n);
+extern void *kmalloc(size_t size);
+extern void kfree(void *ptr);
+
+/* Threads reported per call; a process with more is truncated */
+#define SCHEDSTAT_MAX_THREADS   64
+
+static u64 cycles_to_ns(u64 cycles, u64 hz)
+{
+    return cycles / hz * 1000000000ULL + cycles % hz * 1000000000ULL / hz;
+}
+
+static void sched_thread_snapshot(struct thread *t, struct sched_thread_info *out,
+                                  u64 now, u64 hz)
+{
+    const struct thread_sched_stats *st = &t->sched_stats;
+    u64 cpu = st->cpu_cycles;
+    u64 user = st->user_cycles;
+    u64 run_delay = st->run_delay;
+    u64 blocked[SCHED_BLOCK_NR];
+
+    for (int i = 0; i < SCHED_BLOCK_NR; i++) {
+        blocked[i] = st->blocked[i];
+    }
+
+    /* Fold in the interval the thread is in right now */
+    if (st->on_cpu_since && now > st->on_cpu_since) {
+        cpu += now - st->on_cpu_since;
+        if (st->user_since && now > st->user_since) {
+            user += now - st->user_since;
+        }
+    } else if (st->off_since && now > st->off_since) {
+        if (st->off_reason == SCHED_OFF_RUNNABLE) {
+            run_delay += now - st->off_since;
+        } else if (st->off_reason < SCHED_BLOCK_NR) {
+            blocked[st->off_reason] += now - st->off_since;
+        }
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->tid = (u32)t->tid;
+    out->state = (u32)t->state;
+    out->nvcsw = st->nvcsw;
+    out->nivcsw = st->nivcsw;
+    out->nr_run_waits = st->nr_run_waits;
+    out->run_delay_ns = cycles_to_ns(run_delay, hz);
+    out->run_delay_max_ns = cycles_to_ns(st->run_delay_max, hz);
+    out->user_ns = cycles_to_ns(user, hz);
+    out->system_ns = cycles_to_ns(cpu > user ? cpu - user : 0, hz);
+    for (int i = 0; i < SCHED_BLOCK_NR; i++) {
+        out->blocked_ns[i] = cycles_to_ns(blocked[i], hz);
+    }
+}
+
+i64 sched_process_stats(pid_t pid, void *ubuf, u64 max)
+{
+    struct sched_thread_info *snap;
+    struct process *proc;
+    struct thread *t;
+    u64 hz, now, flags;
+    i64 n = 0;
+
+    if (max == 0) {
+        return 0;
+    }
+    if (max > SCHEDSTAT_MAX_THREADS) {
+        max = SCHEDSTAT_MAX_THREADS;
+    }
+
+    hz = trace_tsc_hz();
+    if (hz == 0) {
+        return -EAGAIN;         /* TSC not calibrated yet */
+    }
+
+    snap = kmalloc(max * sizeof(*snap));
+    if (!snap) {
+        return -ENOMEM;
+    }
+
+    rcu_read_lock();
+
+    proc = pid ? process_find(pid) : get_current_process();
+    if (!proc) {
+        rcu_read_unlock();
+        kfree(snap);
+        return -ESRCH;
+    }
+
+    spin_lock_irqsave(&proc->lock, &flags);
+    now = rdtsc();
+    list_for_each_entry(t, &proc->threads, thread_list) {
+        if ((u64)n == max) {
+            break;
+        }
+        sched_thread_snapshot(t, &snap[n++], now, hz);
+    }
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    rcu_read_unlock();
+
+    /* Copy after dropping the locks: copy_to_user may fault and sleep */
+    if (copy_to_user(ubuf, snap, (u64)n * sizeof(*snap)) < 0) {
+        n = -EFAULT;
+    }
+
+    kfree(snap);
+    return n;
+}
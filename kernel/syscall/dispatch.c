@@ -8,9 +8,23 @@
 #include <ocean/files.h>
 #include <ocean/process.h>
 #include <ocean/sched.h>
+#include <ocean/vmm.h>
 #include <ocean/ipc.h>
+#include <ocean/futex.h>
 #include <ocean/ipc_proto.h>
 #include <ocean/uaccess.h>
+#include <ocean/trace.h>
+#include <ocean/profile.h>
+#include <ocean/scstat.h>
+#include <ocean/schedstat.h>
+#include <ocean/kbench.h>
+#include <ocean/bootprof.h>
+#include <ocean/pci.h>
+#include <ocean/irq.h>
+#include <ocean/ioport.h>
+#include <ocean/dma.h>
+#include <ocean/shm.h>
+#include <ocean/pager.h>
 #include <ocean/types.h>
 #include <ocean/defs.h>
 #include <ocean/boot.h>
@@ -94,7 +108,7 @@ static struct process_file *get_open_process_file(struct process *proc, int fd)
 {
     struct process_files *files = get_process_files(proc);
 
-    if (!files || fd < PROCESS_FD_FIRST_USER || fd >= PROCESS_MAX_OPEN_FILES) {
+    if (!files || fd < 0 || fd >= PROCESS_MAX_OPEN_FILES) {
         return NULL;
     }
 
@@ -155,6 +169,392 @@ static i64 sys_yield(void)
     return 0;
 }
 
+/*
+ * SYS_THREAD_CREATE - Start another thread in the current process
+ *
+ * The thread enters user mode at entry with arg in RDI, on stack_top, with
+ * FS base tls. If tid_addr is set the new TID is stored there, and zero is
+ * stored there when the thread exits.
+ */
+static i64 sys_thread_create(u64 entry, u64 arg, u64 stack_top, u64 tls,
+                             u32 *tid_addr)
+{
+    struct process *proc = get_current_process();
+    struct thread *t;
+
+    if (!proc || !proc->mm) {
+        return -EINVAL;
+    }
+    if (entry == 0 || entry >= USER_SPACE_END ||
+        stack_top == 0 || stack_top >= USER_SPACE_END ||
+        tls >= USER_SPACE_END) {
+        return -EINVAL;
+    }
+    if (tid_addr && validate_user_range(tid_addr, sizeof(*tid_addr),
+                                        VMA_WRITE) < 0) {
+        return -EFAULT;
+    }
+
+    t = thread_create(proc, entry, arg, stack_top, tls);
+    if (!t) {
+        return -ENOMEM;
+    }
+
+    if (tid_addr) {
+        u32 tid = (u32)t->tid;
+        copy_to_user(tid_addr, &tid, sizeof(tid));
+        t->clear_tid = (u64)tid_addr;
+    }
+
+    thread_start(t);
+    return t->tid;
+}
+
+/* SYS_THREAD_EXIT - Terminate the calling thread */
+static i64 sys_thread_exit(i64 code)
+{
+    struct process *proc = get_current_process();
+    struct thread *self = current_thread;
+    struct thread *t;
+    bool last = true;
+    u64 flags;
+
+    if (!proc) {
+        process_exit((int)code);
+    }
+
+    /*
+     * The last thread takes the whole process down. Marking ourselves and
+     * looking at the others under the lock means that of two threads
+     * leaving at once, exactly one sees the other exiting and is last.
+     */
+    spin_lock_irqsave(&proc->lock, &flags);
+    self->flags |= TF_EXITING;
+    list_for_each_entry(t, &proc->threads, thread_list) {
+        if (!(t->flags & TF_EXITING)) {
+            last = false;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&proc->lock, flags);
+
+    if (last) {
+        process_exit((int)code);
+    }
+
+    thread_exit((int)code);
+    return 0;
+}
+
+/* SYS_FUTEX - Wait on or wake a user word */
+static i64 sys_futex(u32 *uaddr, u32 op, u32 val)
+{
+    u32 flags = op & FUTEX_PRIVATE_FLAG;
+
+    switch (op & ~FUTEX_PRIVATE_FLAG) {
+        case FUTEX_WAIT:
+            return futex_wait(uaddr, val, flags);
+        case FUTEX_WAKE:
+            return futex_wake(uaddr, (int)val, flags);
+        default:
+            return -ENOSYS;
+    }
+}
+
+/* SYS_SET_TLS - Set the calling thread's FS base */
+static i64 sys_set_tls(u64 base)
+{
+    if (base >= USER_SPACE_END) {
+        return -EINVAL;
+    }
+
+    current_thread->fs_base = base;
+    wrmsr(MSR_FS_BASE, base);
+    return 0;
+}
+
+/*
+ * Init, and what it or another privileged process spawned with
+ * SPAWN_PRIVILEGED: the services, drivers and shell
+ */
+static bool is_privileged(struct process *proc)
+{
+    return proc->privileged;
+}
+
+/* SYS_KSTAT - Dump a kernel statistics report to the console */
+static i64 sys_kstat(u32 what, u32 flags)
+{
+    if (flags & ~KSTAT_RESET) {
+        return -EINVAL;
+    }
+
+    switch (what) {
+    case KSTAT_LOCKS:
+        lock_stat_dump();
+        if (flags & KSTAT_RESET) {
+            lock_stat_reset();
+        }
+        return 0;
+    case KSTAT_BENCH:
+        /* Holds the CPU in the kernel and churns the shared allocators */
+        if (!is_privileged(get_current_process())) {
+            return -EPERM;
+        }
+        return kbench_run();
+    case KSTAT_BOOT:
+        return boot_phase_report();
+    default:
+        return -EINVAL;
+    }
+}
+
+/* SYS_TRACE - Control tracepoints and drain the trace buffers */
+static i64 sys_trace(u32 op, u64 arg, void *buf, u64 count)
+{
+    /* Records expose every thread's events and kernel addresses */
+    if (op != TRACE_CTL_CLOCK && !is_privileged(get_current_process())) {
+        return -EPERM;
+    }
+
+    switch (op) {
+    case TRACE_CTL_START:
+        trace_set_mask(arg ? arg : ~0ULL);
+        return 0;
+    case TRACE_CTL_STOP:
+        trace_set_mask(0);
+        return 0;
+    case TRACE_CTL_READ:
+        if (count == 0) {
+            return 0;
+        }
+        if (count > (u64)-1 / sizeof(struct trace_record) ||
+            validate_user_range(buf, count * sizeof(struct trace_record),
+                                VMA_WRITE) < 0) {
+            return -EFAULT;
+        }
+        return trace_read((int)arg, buf, count);
+    case TRACE_CTL_RESET:
+        trace_reset();
+        return 0;
+    case TRACE_CTL_CLOCK:
+        return (i64)trace_tsc_hz();
+    case TRACE_CTL_LOST:
+        return (i64)trace_lost((int)arg);
+    default:
+        return -EINVAL;
+    }
+}
+
+/* SYS_PROFILE - Control the sampling profiler and drain its buffers */
+static i64 sys_profile(u32 op, u64 arg, void *buf, u64 count)
+{
+    /* Samples expose every process's code addresses and the kernel's */
+    if (!is_privileged(get_current_process())) {
+        return -EPERM;
+    }
+
+    switch (op) {
+    case PROFILE_CTL_START:
+        if (arg > PROFILE_MAX_HZ) {
+            return -EINVAL;
+        }
+        return profile_start((u32)arg);
+    case PROFILE_CTL_STOP:
+        profile_stop();
+        return 0;
+    case PROFILE_CTL_READ:
+        if (count == 0) {
+            return 0;
+        }
+        if (count > (u64)-1 / sizeof(struct profile_sample) ||
+            validate_user_range(buf, count * sizeof(struct profile_sample),
+                                VMA_WRITE) < 0) {
+            return -EFAULT;
+        }
+        return profile_read((int)arg, buf, count);
+    case PROFILE_CTL_RESET:
+        profile_reset();
+        return 0;
+    case PROFILE_CTL_LOST:
+        return (i64)profile_lost((int)arg);
+    default:
+        return -EINVAL;
+    }
+}
+
+/* SYS_SCHEDSTAT - Per-thread scheduler statistics of a process */
+static i64 sys_schedstat(pid_t pid, void *buf, u64 count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    if (count > (u64)-1 / sizeof(struct sched_thread_info) ||
+        validate_user_range(buf, count * sizeof(struct sched_thread_info),
+                            VMA_WRITE) < 0) {
+        return -EFAULT;
+    }
+    return sched_process_stats(pid, buf, count);
+}
+
+/* SYS_SCSTAT - Control per-syscall counters and read them back */
+static i64 sys_scstat(u32 op, u64 arg, void *buf, u64 count)
+{
+    /* Counters are system-wide; the clock query reveals nothing */
+    if (op != SCSTAT_CTL_CLOCK && !is_privileged(get_current_process())) {
+        return -EPERM;
+    }
+
+    switch (op) {
+    case SCSTAT_CTL_START:
+        scstat_set_enabled(true);
+        return 0;
+    case SCSTAT_CTL_STOP:
+        scstat_set_enabled(false);
+        return 0;
+    case SCSTAT_CTL_READ:
+        if (count == 0) {
+            return 0;
+        }
+        if (count > (u64)-1 / sizeof(struct scstat_record) ||
+            validate_user_range(buf, count * sizeof(struct scstat_record),
+                                VMA_WRITE) < 0) {
+            return -EFAULT;
+        }
+        return scstat_read(arg, buf, count);
+    case SCSTAT_CTL_RESET:
+        scstat_reset();
+        return 0;
+    case SCSTAT_CTL_CLOCK:
+        return (i64)trace_tsc_hz();
+    default:
+        return -EINVAL;
+    }
+}
+
+/* MSI and MSI-X capabilities belong to the kernel's vector allocator */
+#define PCI_MSI_CAP_SIZE    24
+#define PCI_MSIX_CAP_SIZE   12
+
+static bool pci_range_overlaps(u32 offset, u32 width, u32 start, u32 size)
+{
+    return start && offset < start + size && start < offset + width;
+}
+
+/*
+ * Registers even the owner may not write: the BARs and expansion ROM,
+ * which place the device in the physical address space, and on a bridge
+ * also the bus numbers and forwarding windows up to the capability pointer
+ */
+static bool pci_config_protected(struct pci_dev *dev, u32 offset, u32 width)
+{
+    if ((dev->info.header_type & PCI_HEADER_TYPE_MASK) == PCI_HEADER_BRIDGE) {
+        return pci_range_overlaps(offset, width, PCI_BAR0, PCI_CAP_PTR - PCI_BAR0) ||
+               pci_range_overlaps(offset, width, PCI_BRIDGE_ROM_ADDRESS, 4);
+    }
+    return pci_range_overlaps(offset, width, PCI_BAR0, PCI_MAX_BARS * 4) ||
+           pci_range_overlaps(offset, width, PCI_ROM_ADDRESS, 4);
+}
+
+static i64 sys_pci_list(void *buf, u64 count)
+{
+    u32 total = pci_device_count();
+
+    if (count > total) {
+        count = total;
+    }
+    if (count == 0) {
+        return total;
+    }
+    if (validate_user_range(buf, count * sizeof(struct pci_device_info),
+                            VMA_WRITE) < 0) {
+        return -EFAULT;
+    }
+    for (u64 i = 0; i < count; i++) {
+        struct pci_device_info info = pci_device((u32)i)->info;
+
+        if (copy_to_user((struct pci_device_info *)buf + i, &info, sizeof(info)) < 0) {
+            return -EFAULT;
+        }
+    }
+    return total;
+}
+
+/* SYS_PCI - Enumerate PCI devices and access their configuration space */
+static i64 sys_pci(u32 op, u32 bdf, u64 arg1, u64 arg2, u64 arg3)
+{
+    struct process *proc = get_current_process();
+    struct pci_dev *dev;
+    u32 offset, width;
+
+    if (!proc) {
+        return -EINVAL;
+    }
+    if (op == PCI_CTL_LIST) {
+        return sys_pci_list((void *)arg1, arg2);
+    }
+
+    dev = pci_find_bdf(bdf);
+    if (!dev) {
+        return -ENODEV;
+    }
+
+    switch (op) {
+    case PCI_CTL_CLAIM:
+        if (!is_privileged(proc)) {
+            return -EPERM;
+        }
+        return pci_claim(dev, proc->pid);
+    case PCI_CTL_RELEASE:
+        pci_release(dev, proc->pid);
+        return 0;
+    case PCI_CTL_READ:
+    case PCI_CTL_WRITE:
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    offset = (u32)arg1;
+    width = (u32)arg2;
+    if ((width != 1 && width != 2 && width != 4) || arg1 % width ||
+        arg1 + width > (dev->ecam ? PAGE_SIZE : 0x100)) {
+        return -EINVAL;
+    }
+
+    if (op == PCI_CTL_READ) {
+        switch (width) {
+        case 1:
+            return pci_read8(dev, offset);
+        case 2:
+            return pci_read16(dev, offset);
+        default:
+            return pci_read32(dev, offset);
+        }
+    }
+
+    if ((pid_t)dev->info.owner != proc->pid) {
+        return -EACCES;
+    }
+    if (pci_range_overlaps(offset, width, dev->info.msi_cap, PCI_MSI_CAP_SIZE) ||
+        pci_range_overlaps(offset, width, dev->info.msix_cap, PCI_MSIX_CAP_SIZE) ||
+        pci_config_protected(dev, offset, width)) {
+        return -EPERM;
+    }
+    switch (width) {
+    case 1:
+        pci_write8(dev, offset, (u8)arg3);
+        break;
+    case 2:
+        pci_write16(dev, offset, (u16)arg3);
+        break;
+    default:
+        pci_write32(dev, offset, (u32)arg3);
+        break;
+    }
+    return 0;
+}
+
 /* SYS_DEBUG_PRINT - Debug print (for testing) */
 static i64 sys_debug_print(const char *msg, u64 len)
 {
@@ -186,78 +586,88 @@ static i64 sys_debug_print(const char *msg, u64 len)
     return (i64)total;
 }
 
-/* SYS_READ - Read from file descriptor (minimal implementation) */
-static i64 sys_read(int fd, char *buf, u64 count)
+/* Read a line from the serial console, echoing it */
+static i64 console_read(char *buf, u64 count)
 {
-    struct process *proc = get_current_process();
+    extern int serial_getc(void);
+    extern void serial_putc(char c);
+    extern bool serial_data_available(void);
 
-    if (!buf) {
-        return -EFAULT;
-    }
-    if (count == 0) {
-        return 0;
-    }
+    u64 i = 0;
+    while (i < count) {
+        /* Wait for data with interrupts enabled so timer can tick */
+        while (!serial_data_available()) {
+            __asm__ volatile("sti; hlt; cli");  /* Enable, halt, disable */
+        }
 
-    /* For now, only support stdin (fd 0) */
-    if (fd == PROCESS_FD_STDIN) {
-        extern int serial_getc(void);
-        extern void serial_putc(char c);
-        extern bool serial_data_available(void);
+        /* Read with interrupts disabled */
+        __asm__ volatile("cli");
+        int c = serial_getc();
+        __asm__ volatile("sti");
 
-        u64 i = 0;
-        while (i < count) {
-            /* Wait for data with interrupts enabled so timer can tick */
-            while (!serial_data_available()) {
-                __asm__ volatile("sti; hlt; cli");  /* Enable, halt, disable */
-            }
+        if (c < 0) {
+            break;
+        }
 
-            /* Read with interrupts disabled */
-            __asm__ volatile("cli");
-            int c = serial_getc();
-            __asm__ volatile("sti");
+        char out = (char)c;
 
-            if (c < 0) {
-                break;
-            }
+        /* Echo the character */
+        serial_putc(out);
 
-            char out = (char)c;
-
-            /* Echo the character */
-            serial_putc(out);
-
-            /* Stop at newline */
-            if (c == '\n' || c == '\r') {
-                if (c == '\r') {
-                    out = '\n';
-                    serial_putc('\n');
-                }
-                int ret = copy_to_user(buf + i, &out, 1);
-                if (ret < 0) {
-                    return (i > 0) ? (i64)i : ret;
-                }
-                i++;
-                break;
+        /* Stop at newline */
+        if (c == '\n' || c == '\r') {
+            if (c == '\r') {
+                out = '\n';
+                serial_putc('\n');
             }
-
             int ret = copy_to_user(buf + i, &out, 1);
             if (ret < 0) {
                 return (i > 0) ? (i64)i : ret;
             }
             i++;
+            break;
+        }
+
+        int ret = copy_to_user(buf + i, &out, 1);
+        if (ret < 0) {
+            return (i > 0) ? (i64)i : ret;
         }
+        i++;
+    }
+
+    return (i64)i;
+}
+
+/* SYS_READ - Read from file descriptor (minimal implementation) */
+static i64 sys_read(int fd, char *buf, u64 count)
+{
+    struct process *proc = get_current_process();
+    struct process_file *file;
+    u64 irq_flags;
+    u32 kind;
+
+    if (!buf) {
+        return -EFAULT;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (!proc) {
+        return -EBADF;
+    }
+
+    spin_lock_irqsave(&proc->lock, &irq_flags);
+    file = get_open_process_file(proc, fd);
+    kind = file ? file->kind : PROCESS_FILE_NONE;
+    spin_unlock_irqrestore(&proc->lock, irq_flags);
 
-        return (i64)i;
+    if (kind == PROCESS_FILE_CONSOLE) {
+        return console_read(buf, count);
     }
 
     {
-        u64 irq_flags;
         const void *src = NULL;
         u64 available = 0;
-        struct process_file *file;
-
-        if (!proc) {
-            return -EBADF;
-        }
 
         spin_lock_irqsave(&proc->lock, &irq_flags);
         file = get_open_process_file(proc, fd);
@@ -299,8 +709,22 @@ static i64 sys_read(int fd, char *buf, u64 count)
 /* SYS_WRITE - Write to file descriptor (minimal implementation) */
 static i64 sys_write(int fd, const char *buf, u64 count)
 {
-    /* For now, only support stdout (fd 1) and stderr (fd 2) */
-    if (fd != 1 && fd != 2) {
+    struct process *proc = get_current_process();
+    struct process_file *file;
+    u64 irq_flags;
+    bool console;
+
+    if (!proc) {
+        return -EBADF;
+    }
+
+    /* Only the console is writable; boot modules are read-only */
+    spin_lock_irqsave(&proc->lock, &irq_flags);
+    file = get_open_process_file(proc, fd);
+    console = file && file->kind == PROCESS_FILE_CONSOLE;
+    spin_unlock_irqrestore(&proc->lock, irq_flags);
+
+    if (!console) {
         return -EBADF;
     }
     if (count == 0) {
@@ -365,7 +789,7 @@ static i64 sys_open(const char *path, u64 flags, u64 mode)
     }
 
     spin_lock_irqsave(&proc->lock, &irq_flags);
-    for (int fd = PROCESS_FD_FIRST_USER; fd < PROCESS_MAX_OPEN_FILES; fd++) {
+    for (int fd = 0; fd < PROCESS_MAX_OPEN_FILES; fd++) {
         if (files->entries[fd].kind == PROCESS_FILE_NONE) {
             files->entries[fd].kind = PROCESS_FILE_BOOT_MODULE;
             files->entries[fd].flags = (u32)flags;
@@ -386,9 +810,6 @@ static i64 sys_close(int fd)
     u64 irq_flags;
     struct process_file *file;
 
-    if (fd >= 0 && fd <= PROCESS_FD_STDERR) {
-        return 0;
-    }
     if (!proc) {
         return -EBADF;
     }
@@ -419,6 +840,10 @@ static i64 sys_lseek(int fd, i64 offset, int whence)
 
     spin_lock_irqsave(&proc->lock, &irq_flags);
     file = get_open_process_file(proc, fd);
+    if (file && file->kind == PROCESS_FILE_CONSOLE) {
+        spin_unlock_irqrestore(&proc->lock, irq_flags);
+        return -ESPIPE;
+    }
     if (!file || file->kind != PROCESS_FILE_BOOT_MODULE || !file->module) {
         spin_unlock_irqrestore(&proc->lock, irq_flags);
         return -EBADF;
@@ -460,6 +885,12 @@ static i64 sys_fork(void)
     return (i64)process_fork();
 }
 
+/* SYS_VFORK - Create child sharing our address space until it execs */
+static i64 sys_vfork(void)
+{
+    return (i64)process_vfork();
+}
+
 /* Find a boot module by name (searches cmdline for the name) */
 static struct cached_module *find_boot_module(const char *name)
 {
@@ -474,58 +905,35 @@ static struct cached_module *find_boot_module(const char *name)
     return NULL;
 }
 
-/* SYS_EXEC - Execute a program (replaces current process) */
-static i64 sys_exec(const char *path, char *const argv[], char *const envp[])
+/*
+ * Copy a NULL-terminated user argv into kernel storage
+ *
+ * kargv must have room for EXEC_MAX_ARGS + 2 entries. When argv is empty
+ * the program name is used as argv[0]. Returns argc or a negative errno.
+ */
+static int copy_exec_argv(char *const argv[], const char *name,
+                          const char **kargv, char *arg_storage,
+                          size_t storage_size)
 {
-    (void)envp;
-    const char *kargv[EXEC_MAX_ARGS + 2];
-    char arg_storage[EXEC_MAX_ARG_BYTES];
     size_t used = 0;
     int argc = 0;
 
-    if (!path) {
-        return -EINVAL;
-    }
-
-    char kpath[256];
-    int path_len = copy_string_from_user(kpath, sizeof(kpath), path);
-    if (path_len < 0) {
-        return path_len;
-    }
-
-    /* Find the module in boot modules */
-    struct cached_module *mod = find_boot_module(kpath);
-    if (!mod) {
-        kprintf("exec: '%s' not found\n", kpath);
-        return -ENOENT;
-    }
-
-    /* Extract just the filename from path */
-    const char *name = kpath;
-    const char *p = kpath;
-    while (*p) {
-        if (*p == '/') {
-            name = p + 1;
-        }
-        p++;
-    }
-
-    if (argv) {
-        for (; argc < EXEC_MAX_ARGS; argc++) {
-            char *user_arg = NULL;
-            int ret = copy_from_user(&user_arg, argv + argc, sizeof(user_arg));
-            if (ret < 0) {
-                return ret;
-            }
-            if (!user_arg) {
-                break;
-            }
-            if (used >= sizeof(arg_storage)) {
-                return -E2BIG;
-            }
+    if (argv) {
+        for (; argc < EXEC_MAX_ARGS; argc++) {
+            char *user_arg = NULL;
+            int ret = copy_from_user(&user_arg, argv + argc, sizeof(user_arg));
+            if (ret < 0) {
+                return ret;
+            }
+            if (!user_arg) {
+                break;
+            }
+            if (used >= storage_size) {
+                return -E2BIG;
+            }
 
             ret = copy_string_from_user(&arg_storage[used],
-                                        sizeof(arg_storage) - used,
+                                        storage_size - used,
                                         user_arg);
             if (ret < 0) {
                 return ret;
@@ -552,6 +960,41 @@ static i64 sys_exec(const char *path, char *const argv[], char *const envp[])
     }
     kargv[argc] = NULL;
 
+    return argc;
+}
+
+/* SYS_EXEC - Execute a program (replaces current process) */
+static i64 sys_exec(const char *path, char *const argv[], char *const envp[])
+{
+    (void)envp;
+    const char *kargv[EXEC_MAX_ARGS + 2];
+    char arg_storage[EXEC_MAX_ARG_BYTES];
+
+    if (!path) {
+        return -EINVAL;
+    }
+
+    char kpath[256];
+    int path_len = copy_string_from_user(kpath, sizeof(kpath), path);
+    if (path_len < 0) {
+        return path_len;
+    }
+
+    /* Find the module in boot modules */
+    struct cached_module *mod = find_boot_module(kpath);
+    if (!mod) {
+        kprintf("exec: '%s' not found\n", kpath);
+        return -ENOENT;
+    }
+
+    /* Extract just the filename from path */
+    const char *name = path_basename(kpath);
+
+    int argc = copy_exec_argv(argv, name, kargv, arg_storage, sizeof(arg_storage));
+    if (argc < 0) {
+        return argc;
+    }
+
     /* Load ELF and replace current process */
     extern int exec_replace(const void *elf_data, size_t elf_size,
                             const char *name, const char *const argv[]);
@@ -561,6 +1004,145 @@ static i64 sys_exec(const char *path, char *const argv[], char *const envp[])
     return rc < 0 ? rc : -EIO;
 }
 
+/*
+ * Apply one spawn file action to the child's (not yet running) file table
+ */
+static int apply_spawn_file_action(struct process_files *files,
+                                   const struct spawn_file_action *action)
+{
+    char kpath[256];
+    struct cached_module *mod;
+    int ret;
+
+    switch (action->op) {
+        case SPAWN_FA_CLOSE:
+            if (action->fd < 0 ||
+                action->fd >= PROCESS_MAX_OPEN_FILES) {
+                return -EBADF;
+            }
+            memset(&files->entries[action->fd], 0, sizeof(files->entries[0]));
+            return 0;
+
+        case SPAWN_FA_DUP2:
+            if (action->fd < 0 ||
+                action->fd >= PROCESS_MAX_OPEN_FILES ||
+                action->newfd < 0 ||
+                action->newfd >= PROCESS_MAX_OPEN_FILES ||
+                files->entries[action->fd].kind == PROCESS_FILE_NONE) {
+                return -EBADF;
+            }
+            files->entries[action->newfd] = files->entries[action->fd];
+            return 0;
+
+        case SPAWN_FA_OPEN:
+            if (action->newfd < 0 ||
+                action->newfd >= PROCESS_MAX_OPEN_FILES) {
+                return -EBADF;
+            }
+            if ((action->flags & (O_WRONLY | O_RDWR | O_CREAT |
+                                  O_TRUNC | O_APPEND)) != 0) {
+                return -EROFS;
+            }
+            ret = copy_string_from_user(kpath, sizeof(kpath),
+                                        (const char *)action->path);
+            if (ret < 0) {
+                return ret;
+            }
+            mod = find_boot_module(kpath);
+            if (!mod) {
+                return -ENOENT;
+            }
+            files->entries[action->newfd].kind = PROCESS_FILE_BOOT_MODULE;
+            files->entries[action->newfd].flags = action->flags;
+            files->entries[action->newfd].module = mod;
+            files->entries[action->newfd].offset = 0;
+            return 0;
+
+        default:
+            return -EINVAL;
+    }
+}
+
+/*
+ * SYS_SPAWN - Create a child process directly from a program path
+ *
+ * The child starts from a fresh image of path with the given argv and a
+ * copy of the caller's file table, edited by the file actions in order.
+ */
+static i64 sys_spawn(const char *path, char *const argv[],
+                     const struct spawn_file_action *actions, u64 nactions,
+                     u64 flags)
+{
+    struct process *proc = get_current_process();
+    const char *kargv[EXEC_MAX_ARGS + 2];
+    char arg_storage[EXEC_MAX_ARG_BYTES];
+    struct process_files *files;
+    char kpath[256];
+    u64 irq_flags;
+    int ret;
+
+    if (!proc || !path) {
+        return -EINVAL;
+    }
+    if (nactions > SPAWN_MAX_FILE_ACTIONS || (nactions && !actions)) {
+        return -EINVAL;
+    }
+    if (flags & ~(u64)SPAWN_PRIVILEGED) {
+        return -EINVAL;
+    }
+    if ((flags & SPAWN_PRIVILEGED) && !is_privileged(proc)) {
+        return -EPERM;
+    }
+
+    ret = copy_string_from_user(kpath, sizeof(kpath), path);
+    if (ret < 0) {
+        return ret;
+    }
+
+    struct cached_module *mod = find_boot_module(kpath);
+    if (!mod) {
+        kprintf("spawn: '%s' not found\n", kpath);
+        return -ENOENT;
+    }
+
+    const char *name = path_basename(kpath);
+
+    ret = copy_exec_argv(argv, name, kargv, arg_storage, sizeof(arg_storage));
+    if (ret < 0) {
+        return ret;
+    }
+
+    files = process_files_create();
+    if (!files) {
+        return -ENOMEM;
+    }
+
+    spin_lock_irqsave(&proc->lock, &irq_flags);
+    if (proc->files) {
+        *files = *get_process_files(proc);
+    }
+    spin_unlock_irqrestore(&proc->lock, irq_flags);
+
+    for (u64 i = 0; i < nactions; i++) {
+        struct spawn_file_action action;
+
+        ret = copy_from_user(&action, &actions[i], sizeof(action));
+        if (ret >= 0) {
+            ret = apply_spawn_file_action(files, &action);
+        }
+        if (ret < 0) {
+            process_files_destroy(files);
+            return ret;
+        }
+    }
+
+    extern pid_t exec_spawn(const void *elf_data, size_t elf_size,
+                            const char *name, const char *const argv[],
+                            struct process_files *files, bool privileged);
+    return (i64)exec_spawn(mod->address, mod->size, name, kargv, files,
+                           flags & SPAWN_PRIVILEGED);
+}
+
 /* SYS_WAIT - Wait for child process */
 static i64 sys_wait(int *status)
 {
@@ -673,94 +1255,446 @@ static i64 sys_ipc_reply_impl(u64 tag, u64 r1, u64 r2, u64 r3, u64 r4)
     return (i64)result;
 }
 
-/* SYS_IPC_RECV - Receive a message from an endpoint */
-static i64 sys_ipc_recv_impl(u32 ep_cap, u64 tag_ptr, u64 r1_ptr, u64 r2_ptr, u64 r3_ptr, u64 r4_ptr)
+/* SYS_IPC_CALLER - PID of the caller we owe a reply, -IPC_ERR_INVALID if none */
+static i64 sys_ipc_caller_impl(void)
+{
+    struct process *caller;
+    i64 ret = -IPC_ERR_INVALID;
+
+    rcu_read_lock();
+    caller = ipc_caller_process();
+    if (caller) {
+        ret = caller->pid;
+    }
+    rcu_read_unlock();
+    return ret;
+}
+
+/* SYS_IPC_RECV - Receive a message from an endpoint */
+static i64 sys_ipc_recv_impl(u32 ep_cap, u64 tag_ptr, u64 r1_ptr, u64 r2_ptr, u64 r3_ptr, u64 r4_ptr)
+{
+    u64 tag = 0;
+    u64 regs[IPC_FAST_REGS] = {0};
+
+    int result = ipc_recv_fast(ep_cap, &tag, regs);
+
+    /* Copy results back to whichever user pointers were provided. */
+    if (result == IPC_OK) {
+        int ret;
+
+        if (tag_ptr) {
+            ret = copy_to_user((void *)tag_ptr, &tag, sizeof(tag));
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        if (r1_ptr) {
+            ret = copy_to_user((void *)r1_ptr, &regs[0], sizeof(regs[0]));
+            if (ret < 0) return ret;
+        }
+        if (r2_ptr) {
+            ret = copy_to_user((void *)r2_ptr, &regs[1], sizeof(regs[1]));
+            if (ret < 0) return ret;
+        }
+        if (r3_ptr) {
+            ret = copy_to_user((void *)r3_ptr, &regs[2], sizeof(regs[2]));
+            if (ret < 0) return ret;
+        }
+        if (r4_ptr) {
+            ret = copy_to_user((void *)r4_ptr, &regs[3], sizeof(regs[3]));
+            if (ret < 0) return ret;
+        }
+    }
+
+    return (i64)result;
+}
+
+/* SYS_ENDPOINT_CREATE - Create a new endpoint */
+static i64 sys_endpoint_create_impl(u32 flags)
+{
+    struct process *proc = get_current_process();
+    if (!proc) {
+        return -IPC_ERR_INVALID;
+    }
+
+    struct ipc_endpoint *ep = endpoint_create(proc, flags);
+    if (!ep) {
+        return -IPC_ERR_INVALID;
+    }
+
+    return (i64)ep->id;
+}
+
+/* SYS_ENDPOINT_CREATE_WKE - Claim a reserved well-known endpoint ID */
+static i64 sys_endpoint_create_wke_impl(u32 id, u32 flags)
+{
+    struct process *proc = get_current_process();
+    if (!proc) {
+        return -IPC_ERR_INVALID;
+    }
+
+    if (id < EP_WKE_MIN || id > EP_WKE_MAX) {
+        return -IPC_ERR_INVALID;
+    }
+
+    struct ipc_endpoint *ep = endpoint_create_well_known(proc, id, flags);
+    if (!ep) {
+        /* Either OOM or id already taken; the userspace convention is that
+         * -IPC_ERR_BUSY signals a contested well-known slot. */
+        return -IPC_ERR_BUSY;
+    }
+
+    return (i64)ep->id;
+}
+
+/* SYS_ENDPOINT_DESTROY - Destroy an endpoint */
+static i64 sys_endpoint_destroy_impl(u32 ep_id)
+{
+    struct ipc_endpoint *ep = endpoint_get(ep_id);
+    if (!ep) {
+        return -IPC_ERR_INVALID;
+    }
+
+    endpoint_destroy(ep);
+    endpoint_put(ep);
+    return 0;
+}
+
+/* SYS_NOTIFY_CREATE - Create a notification owned by the caller */
+static i64 sys_notify_create_impl(u32 flags)
+{
+    struct process *proc = get_current_process();
+    struct notification *ntfn;
+
+    if (!proc || flags != 0) {
+        return -EINVAL;
+    }
+
+    ntfn = notification_create(proc);
+    if (!ntfn) {
+        return -ENOMEM;
+    }
+    return (i64)ntfn->id;
+}
+
+/*
+ * Look up a notification; only its owner may wait on, poll or destroy
+ * it, while anyone may signal it. The caller puts the reference.
+ */
+static struct notification *notify_lookup(u32 id, bool owner_only, i64 *err)
+{
+    struct process *proc = get_current_process();
+    struct notification *ntfn = notification_get(id);
+
+    if (!ntfn) {
+        *err = -ENOENT;
+        return NULL;
+    }
+    if (owner_only && (!proc || ntfn->owner != proc)) {
+        notification_put(ntfn);
+        *err = -EPERM;
+        return NULL;
+    }
+    return ntfn;
+}
+
+/* SYS_NOTIFY_DESTROY - Destroy a notification, unbinding its IRQs */
+static i64 sys_notify_destroy_impl(u32 id)
+{
+    i64 ret = 0;
+    struct notification *ntfn = notify_lookup(id, true, &ret);
+
+    if (!ntfn) {
+        return ret;
+    }
+    notification_destroy(ntfn);
+    notification_put(ntfn);
+    return 0;
+}
+
+/* SYS_NOTIFY_SIGNAL - OR bits into a notification */
+static i64 sys_notify_signal_impl(u32 id, u64 bits)
+{
+    i64 ret = 0;
+    struct notification *ntfn = notify_lookup(id, false, &ret);
+
+    if (!ntfn) {
+        return ret;
+    }
+    ret = notification_signal(ntfn, bits);
+    notification_put(ntfn);
+    return ret;
+}
+
+/* SYS_NOTIFY_WAIT/POLL - Take the pending bits; WAIT blocks until some arrive */
+static i64 sys_notify_take_impl(u32 id, bool block)
+{
+    i64 ret = 0;
+    u64 bits = 0;
+    struct notification *ntfn = notify_lookup(id, true, &ret);
+
+    if (!ntfn) {
+        return ret;
+    }
+    ret = block ? notification_wait(ntfn, &bits) : notification_poll(ntfn, &bits);
+    notification_put(ntfn);
+
+    return ret < 0 ? ret : (i64)bits;
+}
+
+/* Does proc own endpoint id (EP_MEM: is it the memory server)? */
+static bool owns_endpoint(struct process *proc, u32 id)
+{
+    struct ipc_endpoint *ep = endpoint_get(id);
+    bool owner;
+
+    if (!ep) {
+        return false;
+    }
+    owner = ep->owner == proc;
+    endpoint_put(ep);
+    return owner;
+}
+
+/* SYS_IRQ - Bind interrupt sources to notifications and acknowledge them */
+static i64 sys_irq(u32 op, u64 arg1, u64 arg2, u64 arg3, u64 arg4, u64 arg5)
+{
+    struct process *proc = get_current_process();
+    struct irq_object_info info;
+    i64 ret = 0;
+
+    if (!proc) {
+        return -EINVAL;
+    }
+
+    switch (op) {
+    case IRQ_CTL_BIND: {
+        /* arg1 source, arg2 IRQ/GSI/BDF, arg3 notification, arg4 bit,
+         * arg5 GSI flags or MSI queue count */
+        struct notification *ntfn = notify_lookup((u32)arg3, true, &ret);
+
+        if (!ntfn) {
+            return ret;
+        }
+        if (arg4 >= NTFN_BITS) {
+            ret = -EINVAL;
+        } else {
+            ret = irq_object_bind(proc->pid, is_privileged(proc), (u32)arg1, arg2,
+                                  ntfn, (u32)arg4, (u32)arg5, (u32)arg5);
+        }
+        notification_put(ntfn);
+        return ret;
+    }
+    case IRQ_CTL_UNBIND:
+        return irq_object_unbind(proc->pid, (u32)arg1);
+    case IRQ_CTL_ACK:
+        return irq_object_ack(proc->pid, (u32)arg1, arg2);
+    case IRQ_CTL_TRIGGER:
+        return irq_object_trigger(proc->pid, (u32)arg1, (u32)arg2);
+    case IRQ_CTL_INFO:
+        ret = irq_object_info(proc->pid, (u32)arg1, &info);
+        if (ret < 0) {
+            return ret;
+        }
+        if (copy_to_user((void *)arg2, &info, sizeof(info)) < 0) {
+            return -EFAULT;
+        }
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/* SYS_IOPORT - Open port ranges for direct in/out */
+static i64 sys_ioport(u32 op, u64 base, u64 count)
+{
+    struct process *proc = get_current_process();
+
+    if (!proc || base > 0xFFFF || count > 0x10000) {
+        return -EINVAL;
+    }
+
+    switch (op) {
+    case IOPORT_CTL_CLAIM:
+        if (!is_privileged(proc)) {
+            return -EPERM;
+        }
+        return ioport_claim(proc, (u32)base, (u32)count);
+    case IOPORT_CTL_RELEASE:
+        return ioport_release(proc, (u32)base, (u32)count);
+    default:
+        return -EINVAL;
+    }
+}
+
+/* SYS_DMA - Pinned DMA buffers, handed out by the memory server */
+static i64 sys_dma(u32 op, u64 arg1, u64 arg2, u64 arg3)
 {
-    u64 tag = 0;
-    u64 regs[IPC_FAST_REGS] = {0};
+    struct process *proc = get_current_process();
+    struct process *client;
 
-    int result = ipc_recv_fast(ep_cap, &tag, regs);
+    if (!proc || !owns_endpoint(proc, EP_MEM)) {
+        return -EPERM;
+    }
 
-    /* Copy results back to whichever user pointers were provided. */
-    if (result == IPC_OK) {
-        int ret;
+    /* Only the client being served: the server cannot pick a victim */
+    client = ipc_caller_process();
+    if (!client) {
+        return -ENOENT;
+    }
 
-        if (tag_ptr) {
-            ret = copy_to_user((void *)tag_ptr, &tag, sizeof(tag));
-            if (ret < 0) {
-                return ret;
-            }
-        }
-        if (r1_ptr) {
-            ret = copy_to_user((void *)r1_ptr, &regs[0], sizeof(regs[0]));
-            if (ret < 0) return ret;
-        }
-        if (r2_ptr) {
-            ret = copy_to_user((void *)r2_ptr, &regs[1], sizeof(regs[1]));
-            if (ret < 0) return ret;
+    switch (op) {
+    case DMA_CTL_ALLOC: {
+        struct dma_region region;
+        int err;
+
+        if (arg2 > DMA_CACHE_WC) {
+            return -EINVAL;
         }
-        if (r3_ptr) {
-            ret = copy_to_user((void *)r3_ptr, &regs[2], sizeof(regs[2]));
-            if (ret < 0) return ret;
+        err = dma_alloc(client, arg1, (u32)arg2, &region);
+        if (err < 0) {
+            return err;
         }
-        if (r4_ptr) {
-            ret = copy_to_user((void *)r4_ptr, &regs[3], sizeof(regs[3]));
-            if (ret < 0) return ret;
+        if (copy_to_user((void *)arg3, &region, sizeof(region)) < 0) {
+            dma_free(client, region.phys);
+            return -EFAULT;
         }
+        return 0;
+    }
+    case DMA_CTL_FREE:
+        return dma_free(client, arg1);
+    default:
+        return -EINVAL;
     }
-
-    return (i64)result;
 }
 
-/* SYS_ENDPOINT_CREATE - Create a new endpoint */
-static i64 sys_endpoint_create_impl(u32 flags)
+/* SYS_SHM - Shared memory objects */
+static i64 sys_shm(u32 op, u64 arg1, u64 arg2, u64 arg3)
 {
     struct process *proc = get_current_process();
+    struct process *target;
+    int ret;
+
     if (!proc) {
-        return -IPC_ERR_INVALID;
+        return -EINVAL;
     }
-
-    struct ipc_endpoint *ep = endpoint_create(proc, flags);
-    if (!ep) {
-        return -IPC_ERR_INVALID;
+    /* arg1 is an ID for everything but CREATE and UNMAP */
+    if (op != SHM_CTL_CREATE && op != SHM_CTL_UNMAP && (u32)arg1 != arg1) {
+        return -ENOENT;
     }
 
-    return (i64)ep->id;
+    switch (op) {
+    case SHM_CTL_CREATE:
+        return shm_create(proc, arg1);
+    case SHM_CTL_DESTROY:
+        return shm_destroy(proc, (u32)arg1);
+    case SHM_CTL_GRANT:
+        /* Servers grant to the client they are answering */
+        rcu_read_lock();
+        target = arg2 ? process_find((pid_t)arg2) : ipc_caller_process();
+        ret = target ? shm_grant(proc, (u32)arg1, target, (u32)arg3) : -ENOENT;
+        rcu_read_unlock();
+        return ret;
+    case SHM_CTL_MAP:
+        return shm_map(proc, (u32)arg1, (u32)arg2);
+    case SHM_CTL_UNMAP:
+        return shm_unmap(proc, arg1);
+    case SHM_CTL_SIZE:
+        return shm_size(proc, (u32)arg1);
+    default:
+        return -EINVAL;
+    }
 }
 
-/* SYS_ENDPOINT_CREATE_WKE - Claim a reserved well-known endpoint ID */
-static i64 sys_endpoint_create_wke_impl(u32 id, u32 flags)
+/* SYS_PAGER - Pager-backed regions */
+static i64 sys_pager(u32 op, u64 arg1, u64 arg2, u64 arg3, u64 arg4)
 {
     struct process *proc = get_current_process();
+    struct process *client;
+
     if (!proc) {
-        return -IPC_ERR_INVALID;
+        return -EINVAL;
     }
-
-    if (id < EP_WKE_MIN || id > EP_WKE_MAX) {
-        return -IPC_ERR_INVALID;
+    if (op == PAGER_CTL_UNMAP) {
+        return pager_unmap(proc, arg1);
+    }
+    if (op != PAGER_CTL_MAP && op != PAGER_CTL_SUPPLY) {
+        return -EINVAL;
+    }
+    if ((u32)arg1 != arg1) {
+        return -ENOENT;
     }
 
-    struct ipc_endpoint *ep = endpoint_create_well_known(proc, id, flags);
-    if (!ep) {
-        /* Either OOM or id already taken; the userspace convention is that
-         * -IPC_ERR_BUSY signals a contested well-known slot. */
-        return -IPC_ERR_BUSY;
+    /* A pager acts only on the client whose request or fault it is answering */
+    client = ipc_caller_process();
+    if (!client) {
+        return -ENOENT;
     }
 
-    return (i64)ep->id;
+    if (op == PAGER_CTL_MAP) {
+        if ((u32)arg3 != arg3) {
+            return -EINVAL;
+        }
+        return pager_map(proc, client, (u32)arg1, arg2, (u32)arg3, arg4);
+    }
+    return pager_supply(proc, client, (u32)arg1, arg2, arg3, arg4);
 }
 
-/* SYS_ENDPOINT_DESTROY - Destroy an endpoint */
-static i64 sys_endpoint_destroy_impl(u32 ep_id)
+/* SYS_RS - Supervised endpoints */
+static i64 sys_rs(u32 op, u64 arg1, u64 arg2)
 {
-    struct ipc_endpoint *ep = endpoint_get(ep_id);
+    struct process *proc = get_current_process();
+    struct process *target;
+    struct ipc_endpoint *ep;
+    i64 ret;
+
+    if (!proc) {
+        return -EINVAL;
+    }
+    if ((u32)arg1 != arg1) {
+        return -ENOENT;
+    }
+    ep = endpoint_get((u32)arg1);
     if (!ep) {
-        return -IPC_ERR_INVALID;
+        return -ENOENT;
+    }
+
+    switch (op) {
+    case RS_CTL_SUPERVISE:
+    case RS_CTL_RELEASE:
+        /* A server may pick its own standby; the reincarnation server any */
+        if (ep->owner != proc && !owns_endpoint(proc, EP_RS)) {
+            ret = -EPERM;
+        } else if (op == RS_CTL_RELEASE) {
+            ret = endpoint_supervise(ep, NULL, NULL);
+        } else {
+            rcu_read_lock();
+            target = arg2 ? process_find((pid_t)arg2) : NULL;
+            if (arg2 && !target) {
+                ret = -ESRCH;
+            } else {
+                ret = endpoint_supervise(ep, proc, target);
+            }
+            rcu_read_unlock();
+        }
+        break;
+    case RS_CTL_HANDOVER:
+        /* target stays valid until the handover has linked ep to it */
+        rcu_read_lock();
+        target = process_find((pid_t)arg2);
+        ret = target ? endpoint_handover(ep, proc, target) : -ESRCH;
+        rcu_read_unlock();
+        break;
+    case RS_CTL_PARK:
+        ret = endpoint_park(ep);
+        break;
+    default:
+        ret = -EINVAL;
+        break;
     }
 
-    endpoint_destroy(ep);
     endpoint_put(ep);
-    return 0;
+    return ret;
 }
 
 static i64 sys_exit_dispatch(u64 code, u64 arg2, u64 arg3,
@@ -786,6 +1720,18 @@ static i64 sys_fork_dispatch(u64 arg1, u64 arg2, u64 arg3,
     return sys_fork();
 }
 
+static i64 sys_vfork_dispatch(u64 arg1, u64 arg2, u64 arg3,
+                              u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_vfork();
+}
+
 static i64 sys_exec_dispatch(u64 path, u64 argv, u64 envp,
                              u64 arg4, u64 arg5, u64 arg6)
 {
@@ -797,6 +1743,16 @@ static i64 sys_exec_dispatch(u64 path, u64 argv, u64 envp,
                     (char *const *)envp);
 }
 
+static i64 sys_spawn_dispatch(u64 path, u64 argv, u64 actions,
+                              u64 nactions, u64 flags, u64 arg6)
+{
+    (void)arg6;
+    return sys_spawn((const char *)path,
+                     (char *const *)argv,
+                     (const struct spawn_file_action *)actions,
+                     nactions, flags);
+}
+
 static i64 sys_wait_dispatch(u64 status, u64 arg2, u64 arg3,
                              u64 arg4, u64 arg5, u64 arg6)
 {
@@ -844,6 +1800,44 @@ static i64 sys_yield_dispatch(u64 arg1, u64 arg2, u64 arg3,
     return sys_yield();
 }
 
+static i64 sys_thread_create_dispatch(u64 entry, u64 arg, u64 stack_top,
+                                      u64 tls, u64 tid_addr, u64 arg6)
+{
+    (void)arg6;
+    return sys_thread_create(entry, arg, stack_top, tls, (u32 *)tid_addr);
+}
+
+static i64 sys_thread_exit_dispatch(u64 code, u64 arg2, u64 arg3,
+                                    u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_thread_exit((i64)code);
+}
+
+static i64 sys_futex_dispatch(u64 uaddr, u64 op, u64 val,
+                              u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_futex((u32 *)uaddr, (u32)op, (u32)val);
+}
+
+static i64 sys_set_tls_dispatch(u64 base, u64 arg2, u64 arg3,
+                                u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_set_tls(base);
+}
+
 static i64 sys_read_dispatch(u64 fd, u64 buf, u64 count,
                              u64 arg4, u64 arg5, u64 arg6)
 {
@@ -917,6 +1911,13 @@ static i64 sys_ipc_reply_dispatch(u64 tag, u64 r1, u64 r2,
     return sys_ipc_reply_impl(tag, r1, r2, r3, r4);
 }
 
+static i64 sys_ipc_caller_dispatch(u64 arg1, u64 arg2, u64 arg3,
+                                   u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg1; (void)arg2; (void)arg3; (void)arg4; (void)arg5; (void)arg6;
+    return sys_ipc_caller_impl();
+}
+
 static i64 sys_endpoint_create_wke_dispatch(u64 id, u64 flags, u64 arg3,
                                             u64 arg4, u64 arg5, u64 arg6)
 {
@@ -949,6 +1950,157 @@ static i64 sys_endpoint_destroy_dispatch(u64 ep_id, u64 arg2, u64 arg3,
     return sys_endpoint_destroy_impl((u32)ep_id);
 }
 
+static i64 sys_kstat_dispatch(u64 what, u64 flags, u64 arg3,
+                              u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_kstat((u32)what, (u32)flags);
+}
+
+static i64 sys_trace_dispatch(u64 op, u64 arg, u64 buf,
+                              u64 count, u64 arg5, u64 arg6)
+{
+    (void)arg5;
+    (void)arg6;
+    return sys_trace((u32)op, arg, (void *)buf, count);
+}
+
+static i64 sys_profile_dispatch(u64 op, u64 arg, u64 buf,
+                                u64 count, u64 arg5, u64 arg6)
+{
+    (void)arg5;
+    (void)arg6;
+    return sys_profile((u32)op, arg, (void *)buf, count);
+}
+
+static i64 sys_schedstat_dispatch(u64 pid, u64 buf, u64 count,
+                                  u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_schedstat((pid_t)pid, (void *)buf, count);
+}
+
+static i64 sys_scstat_dispatch(u64 op, u64 arg, u64 buf,
+                               u64 count, u64 arg5, u64 arg6)
+{
+    (void)arg5;
+    (void)arg6;
+    return sys_scstat((u32)op, arg, (void *)buf, count);
+}
+
+static i64 sys_pci_dispatch(u64 op, u64 bdf, u64 arg1,
+                            u64 arg2, u64 arg3, u64 arg6)
+{
+    (void)arg6;
+    return sys_pci((u32)op, (u32)bdf, arg1, arg2, arg3);
+}
+
+static i64 sys_irq_dispatch(u64 op, u64 arg1, u64 arg2,
+                            u64 arg3, u64 arg4, u64 arg5)
+{
+    return sys_irq((u32)op, arg1, arg2, arg3, arg4, arg5);
+}
+
+static i64 sys_ioport_dispatch(u64 op, u64 base, u64 count,
+                               u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_ioport((u32)op, base, count);
+}
+
+static i64 sys_dma_dispatch(u64 op, u64 arg1, u64 arg2,
+                            u64 arg3, u64 arg5, u64 arg6)
+{
+    (void)arg5;
+    (void)arg6;
+    return sys_dma((u32)op, arg1, arg2, arg3);
+}
+
+static i64 sys_shm_dispatch(u64 op, u64 arg1, u64 arg2,
+                            u64 arg3, u64 arg5, u64 arg6)
+{
+    (void)arg5;
+    (void)arg6;
+    return sys_shm((u32)op, arg1, arg2, arg3);
+}
+
+static i64 sys_pager_dispatch(u64 op, u64 arg1, u64 arg2,
+                              u64 arg3, u64 arg4, u64 arg6)
+{
+    (void)arg6;
+    return sys_pager((u32)op, arg1, arg2, arg3, arg4);
+}
+
+static i64 sys_rs_dispatch(u64 op, u64 arg1, u64 arg2,
+                           u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_rs((u32)op, arg1, arg2);
+}
+
+static i64 sys_notify_create_dispatch(u64 flags, u64 arg2, u64 arg3,
+                                      u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_notify_create_impl((u32)flags);
+}
+
+static i64 sys_notify_destroy_dispatch(u64 id, u64 arg2, u64 arg3,
+                                       u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_notify_destroy_impl((u32)id);
+}
+
+static i64 sys_notify_signal_dispatch(u64 id, u64 bits, u64 arg3,
+                                      u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_notify_signal_impl((u32)id, bits);
+}
+
+static i64 sys_notify_wait_dispatch(u64 id, u64 arg2, u64 arg3,
+                                    u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_notify_take_impl((u32)id, true);
+}
+
+static i64 sys_notify_poll_dispatch(u64 id, u64 arg2, u64 arg3,
+                                    u64 arg4, u64 arg5, u64 arg6)
+{
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+    (void)arg6;
+    return sys_notify_take_impl((u32)id, false);
+}
+
 static i64 sys_debug_print_dispatch(u64 msg, u64 len, u64 arg3,
                                     u64 arg4, u64 arg5, u64 arg6)
 {
@@ -970,9 +2122,15 @@ static syscall_handler_t syscall_table[NR_SYSCALLS] = {
     [SYS_WAIT]          = sys_wait_dispatch,
     [SYS_GETPID]        = sys_getpid_dispatch,
     [SYS_GETPPID]       = sys_getppid_dispatch,
+    [SYS_SPAWN]         = sys_spawn_dispatch,
+    [SYS_VFORK]         = sys_vfork_dispatch,
 
     /* Thread control */
     [SYS_YIELD]         = sys_yield_dispatch,
+    [SYS_THREAD_CREATE] = sys_thread_create_dispatch,
+    [SYS_THREAD_EXIT]   = sys_thread_exit_dispatch,
+    [SYS_SET_TLS]       = sys_set_tls_dispatch,
+    [SYS_FUTEX]         = sys_futex_dispatch,
 
     /* File operations */
     [SYS_OPEN]          = sys_open_dispatch,
@@ -986,13 +2144,35 @@ static syscall_handler_t syscall_table[NR_SYSCALLS] = {
     [SYS_IPC_RECV]      = sys_ipc_recv_dispatch,
     [SYS_IPC_CALL]      = sys_ipc_call_dispatch,
     [SYS_IPC_REPLY]     = sys_ipc_reply_dispatch,
+    [SYS_IPC_CALLER]    = sys_ipc_caller_dispatch,
 
     /* IPC - Endpoints */
     [SYS_ENDPOINT_CREATE] = sys_endpoint_create_dispatch,
     [SYS_ENDPOINT_DESTROY] = sys_endpoint_destroy_dispatch,
     [SYS_ENDPOINT_CREATE_WKE] = sys_endpoint_create_wke_dispatch,
 
+    /* IPC - Notifications */
+    [SYS_NOTIFY_SIGNAL] = sys_notify_signal_dispatch,
+    [SYS_NOTIFY_WAIT]   = sys_notify_wait_dispatch,
+    [SYS_NOTIFY_POLL]   = sys_notify_poll_dispatch,
+    [SYS_NOTIFY_CREATE] = sys_notify_create_dispatch,
+    [SYS_NOTIFY_DESTROY] = sys_notify_destroy_dispatch,
+
+    /* Device access */
+    [SYS_PCI]           = sys_pci_dispatch,
+    [SYS_IRQ]           = sys_irq_dispatch,
+    [SYS_IOPORT]        = sys_ioport_dispatch,
+    [SYS_DMA]           = sys_dma_dispatch,
+    [SYS_SHM]           = sys_shm_dispatch,
+    [SYS_PAGER]         = sys_pager_dispatch,
+    [SYS_RS]            = sys_rs_dispatch,
+
     /* Debug */
+    [SYS_SCHEDSTAT]     = sys_schedstat_dispatch,
+    [SYS_SCSTAT]        = sys_scstat_dispatch,
+    [SYS_PROFILE]       = sys_profile_dispatch,
+    [SYS_TRACE]         = sys_trace_dispatch,
+    [SYS_KSTAT]         = sys_kstat_dispatch,
     [SYS_DEBUG_PRINT]   = sys_debug_print_dispatch,
 };
 
@@ -1029,9 +2209,12 @@ i64 syscall_dispatch_frame(u64 nr, u64 *frame)
 i64 syscall_dispatch(u64 nr, u64 arg1, u64 arg2, u64 arg3,
                      u64 arg4, u64 arg5, u64 arg6)
 {
+    sched_account_kernel_enter();
+
     /* Validate syscall number */
     if (nr >= NR_SYSCALLS) {
         kprintf("[syscall] Invalid syscall number: %llu\n", nr);
+        sched_account_kernel_exit();
         return -ENOSYS;
     }
 
@@ -1039,11 +2222,29 @@ i64 syscall_dispatch(u64 nr, u64 arg1, u64 arg2, u64 arg3,
     syscall_handler_t handler = syscall_table[nr];
     if (!handler) {
         kprintf("[syscall] Unimplemented syscall: %llu\n", nr);
+        sched_account_kernel_exit();
         return -ENOSYS;
     }
 
+    trace_syscall_enter(nr, arg1, arg2);
+    u64 start = scstat_enter(nr);
+
     /* Call handler */
-    return handler(arg1, arg2, arg3, arg4, arg5, arg6);
+    i64 ret = handler(arg1, arg2, arg3, arg4, arg5, arg6);
+
+    scstat_exit(nr, start, ret);
+    trace_syscall_exit(nr, ret);
+
+    /* Another thread is exiting the process; leave instead of returning */
+    if (current_thread && (current_thread->flags & TF_GROUP_EXIT)) {
+        thread_exit(0);
+    }
+
+    /* No locks are held here: take a reschedule the handler left pending */
+    preempt_check_resched();
+
+    sched_account_kernel_exit();
+    return ret;
 }
 
 /*
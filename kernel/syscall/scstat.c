@@ -0,0 +1,99 @@
+/*
+ * Ocean Kernel - Syscall Statistics
+ *
+ * Each CPU owns a table indexed by syscall number and only syscalls on
+ * that CPU write it, so updates are plain adds with no lock. A thread
+ * that blocks in a syscall is charged on the CPU it finishes on. Readers
+ * sum the tables; a total read while calls are in flight may be off by
+ * those calls, which is fine for statistics.
+ */
+
+#include <ocean/scstat.h>
+#include <ocean/syscall.h>
+#include <ocean/uaccess.h>
+#include <ocean/smp.h>
+#include <ocean/types.h>
+#include <ocean/defs.h>
+
+/* External functions */
+extern void *memset(void *s, int c, size_t n);
+
+struct scstat_cpu {
+    struct scstat_record records[NR_SYSCALLS];
+} __aligned(64);
+
+u32 scstat_enabled;
+
+static struct scstat_cpu scstat_cpus[NR_CPUS];
+
+static inline unsigned int scstat_bucket(u64 cycles)
+{
+    unsigned int log2 = cycles ? 63 - (unsigned int)__builtin_clzll(cycles) : 0;
+
+    return log2 < SCSTAT_HIST_BUCKETS ? log2 : SCSTAT_HIST_BUCKETS - 1;
+}
+
+void __scstat_enter(u64 nr)
+{
+    scstat_cpus[smp_processor_id()].records[nr].count++;
+}
+
+void __scstat_exit(u64 nr, u64 cycles, i64 ret)
+{
+    struct scstat_record *rec = &scstat_cpus[smp_processor_id()].records[nr];
+
+    if (ret < 0) {
+        rec->errors++;
+    }
+    rec->cycles += cycles;
+    if (cycles > rec->max_cycles) {
+        rec->max_cycles = cycles;
+    }
+    rec->hist[scstat_bucket(cycles)]++;
+}
+
+void scstat_set_enabled(bool on)
+{
+    __atomic_store_n(&scstat_enabled, on ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+void scstat_reset(void)
+{
+    memset(scstat_cpus, 0, sizeof(scstat_cpus));
+}
+
+i64 scstat_read(u64 first, void *ubuf, u64 max)
+{
+    struct scstat_record *out = ubuf;
+    u64 copied = 0;
+
+    if (first >= NR_SYSCALLS) {
+        return -EINVAL;
+    }
+
+    for (u64 nr = first; nr < NR_SYSCALLS && copied < max; nr++) {
+        struct scstat_record sum;
+
+        memset(&sum, 0, sizeof(sum));
+        for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+            const struct scstat_record *rec = &scstat_cpus[cpu].records[nr];
+
+            sum.count += rec->count;
+            sum.errors += rec->errors;
+            sum.cycles += rec->cycles;
+            if (rec->max_cycles > sum.max_cycles) {
+                sum.max_cycles = rec->max_cycles;
+            }
+            for (int i = 0; i < SCSTAT_HIST_BUCKETS; i++) {
+                sum.hist[i] += rec->hist[i];
+            }
+        }
+
+        if (copy_to_user(&out[copied], &sum, sizeof(sum)) < 0) {
+            return copied ? (i64)copied : -EFAULT;
+        }
+        copied++;
+    }
+
+    return (i64)copied;
+}
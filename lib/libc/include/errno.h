@@ -0,0 +1,32 @@
+/*
+ * Ocean libc - errno.h
+ *
+ * Error numbers. Values match the kernel's, which syscalls return negated.
+ * There is no errno variable yet; interfaces that need one (pthreads)
+ * return these codes directly.
+ */
+
+#ifndef _ERRNO_H
+#define _ERRNO_H
+
+#define EPERM           1       /* Operation not permitted */
+#define ENOENT          2       /* No such file or directory */
+#define ESRCH           3       /* No such process */
+#define EINTR           4       /* Interrupted system call */
+#define EIO             5       /* I/O error */
+#define EBADF           9       /* Bad file number */
+#define ECHILD          10      /* No child processes */
+#define EAGAIN          11      /* Try again */
+#define ENOMEM          12      /* Out of memory */
+#define EACCES          13      /* Permission denied */
+#define EFAULT          14      /* Bad address */
+#define EBUSY           16      /* Device or resource busy */
+#define EEXIST          17      /* File exists */
+#define EINVAL          22      /* Invalid argument */
+#define ENOSPC          28      /* No space left on device */
+#define EDEADLK         35      /* Resource deadlock would occur */
+#define ENOSYS          38      /* Function not implemented */
+#define ENOTSUP         95      /* Operation not supported */
+#define ETIMEDOUT       110     /* Connection timed out */
+
+#endif /* _ERRNO_H */
@@ -0,0 +1,100 @@
+/*
+ * Ocean libocean - DMA buffers
+ *
+ * Drivers get DMA memory from the memory server: dma_alloc() is one
+ * MEM_ALLOC_PHYS call returning a physically contiguous, pinned buffer
+ * and its bus address. Descriptors and other small structures come from
+ * a dma_pool instead, which takes a chunk from the server now and then
+ * and carves it into fixed-size, naturally aligned blocks, so a driver
+ * does not pay an IPC per descriptor.
+ *
+ * struct dma_region and dma_ctl() are the memory server's side and
+ * mirror kernel/include/ocean/dma.h.
+ */
+
+#ifndef _OCEAN_DMA_H
+#define _OCEAN_DMA_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+#include <ocean/sync.h>
+
+#define DMA_PAGE_SIZE           4096
+
+/* Memory types (MEM_CACHE_* in ocean/ipc_proto.h) */
+#define DMA_CACHE_WB            MEM_CACHE_WB
+#define DMA_CACHE_UC            MEM_CACHE_UC
+#define DMA_CACHE_WC            MEM_CACHE_WC
+
+struct dma_buf {
+    void *virt;
+    uint64_t phys;                  /* Bus address to program into the device */
+    uint64_t size;
+};
+
+/* Allocate pages pages of type cache; 0 or a negative E_* code */
+int dma_alloc(uint64_t pages, uint32_t cache, struct dma_buf *buf);
+
+/* Give a dma_alloc() buffer back */
+int dma_free(const struct dma_buf *buf);
+
+/*
+ * Block pool. Blocks are a power of two from DMA_POOL_MIN_BLOCK up to a
+ * page, aligned to their size; each chunk is DMA_POOL_CHUNK_PAGES pages.
+ */
+#define DMA_POOL_MIN_BLOCK      64
+#define DMA_POOL_CHUNK_PAGES    16
+#define DMA_POOL_MAX_CHUNKS     16
+#define DMA_POOL_CHUNK_BLOCKS   (DMA_POOL_CHUNK_PAGES * DMA_PAGE_SIZE / DMA_POOL_MIN_BLOCK)
+
+struct dma_pool_chunk {
+    struct dma_buf buf;
+    uint32_t nr_free;
+    uint64_t free_map[DMA_POOL_CHUNK_BLOCKS / 64];     /* Set bit = free block */
+};
+
+struct dma_pool {
+    ocean_mutex_t lock;
+    uint32_t block_size;
+    uint32_t blocks_per_chunk;
+    uint32_t cache;
+    uint32_t nr_chunks;
+    struct dma_pool_chunk chunks[DMA_POOL_MAX_CHUNKS];
+};
+
+/* block_size is rounded up to a power of two; 0 or a negative E_* code */
+int dma_pool_init(struct dma_pool *pool, uint32_t block_size, uint32_t cache);
+
+/* A zeroed block and its bus address in *phys, or NULL */
+void *dma_pool_alloc(struct dma_pool *pool, uint64_t *phys);
+
+void dma_pool_free(struct dma_pool *pool, void *block);
+
+/* Return every chunk to the memory server; outstanding blocks die with it */
+void dma_pool_destroy(struct dma_pool *pool);
+
+/*
+ * Memory server side of SYS_DMA
+ */
+struct dma_region {
+    uint64_t virt;                  /* Address in the client */
+    uint64_t phys;
+    uint64_t pages;
+    uint32_t pid;                   /* The client */
+    uint32_t cache;
+};
+
+/* Map a new buffer into the client whose call is being served */
+static inline int dma_region_alloc(uint64_t pages, uint32_t cache,
+                                   struct dma_region *region)
+{
+    return (int)dma_ctl(DMA_CTL_ALLOC, pages, cache, (uint64_t)region);
+}
+
+/* Pages freed, or a negative errno */
+static inline int dma_region_free(uint64_t phys)
+{
+    return (int)dma_ctl(DMA_CTL_FREE, phys, 0, 0);
+}
+
+#endif /* _OCEAN_DMA_H */
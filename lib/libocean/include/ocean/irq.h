@@ -0,0 +1,86 @@
+/*
+ * Ocean libocean - Device interrupts
+ *
+ * Helpers around SYS_IRQ for userspace drivers. A driver binds its
+ * interrupt to a bit of a notification it created, waits with
+ * notify_wait(), services the device and acknowledges; the kernel keeps
+ * the source masked in between. Mirrors kernel/include/ocean/irq.h.
+ */
+
+#ifndef _OCEAN_IRQ_H
+#define _OCEAN_IRQ_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+/* Interrupt sources */
+#define IRQ_SRC_ISA         0       /* arg: ISA IRQ 0-15 */
+#define IRQ_SRC_GSI         1       /* arg: GSI */
+#define IRQ_SRC_MSI         2       /* arg: BDF of a claimed PCI device */
+#define IRQ_SRC_SOFT        3       /* No device; raised with irq_trigger() */
+
+/* GSI flags */
+#define IRQ_TRIGGER_LEVEL   (1 << 0)
+#define IRQ_POLARITY_LOW    (1 << 1)
+
+#define IRQ_OBJ_MAX_QUEUES  32
+
+struct irq_object_info {
+    uint32_t source;
+    uint32_t nr_queues;
+    uint32_t notification;
+    uint32_t bit;                   /* Bit of queue 0; queue i signals bit + i */
+    uint64_t arg;
+    uint64_t masked;                /* Queues fired and not yet acknowledged */
+    uint64_t count;                 /* Interrupts delivered */
+    uint64_t last_tsc;              /* TSC in the kernel handler of the latest one */
+};
+
+/*
+ * ISA and GSI lines need a claimed PCI device wired to them, unless the
+ * caller is init or the reincarnation server. Lines the kernel uses are
+ * refused, and a GSI behind an ISA IRQ is bound with irq_bind_isa().
+ */
+static inline int irq_bind_isa(uint32_t irq, uint32_t ntfn, uint32_t bit)
+{
+    return (int)irq_ctl(IRQ_CTL_BIND, IRQ_SRC_ISA, irq, ntfn, bit, 0);
+}
+
+static inline int irq_bind_gsi(uint32_t gsi, uint32_t flags, uint32_t ntfn, uint32_t bit)
+{
+    return (int)irq_ctl(IRQ_CTL_BIND, IRQ_SRC_GSI, gsi, ntfn, bit, flags);
+}
+
+/* Up to nvec queues; returns the ID, irq_info() tells how many were given */
+static inline int irq_bind_msi(uint32_t bdf, uint32_t nvec, uint32_t ntfn, uint32_t bit)
+{
+    return (int)irq_ctl(IRQ_CTL_BIND, IRQ_SRC_MSI, bdf, ntfn, bit, nvec);
+}
+
+static inline int irq_bind_soft(uint32_t ntfn, uint32_t bit)
+{
+    return (int)irq_ctl(IRQ_CTL_BIND, IRQ_SRC_SOFT, 0, ntfn, bit, 0);
+}
+
+static inline int irq_unbind(int id)
+{
+    return (int)irq_ctl(IRQ_CTL_UNBIND, (uint64_t)id, 0, 0, 0, 0);
+}
+
+/* Unmask the queues in queue_mask once their device has been serviced */
+static inline int irq_ack(int id, uint64_t queue_mask)
+{
+    return (int)irq_ctl(IRQ_CTL_ACK, (uint64_t)id, queue_mask, 0, 0, 0);
+}
+
+static inline int irq_trigger(int id, uint32_t queue)
+{
+    return (int)irq_ctl(IRQ_CTL_TRIGGER, (uint64_t)id, queue, 0, 0, 0);
+}
+
+static inline int irq_info(int id, struct irq_object_info *info)
+{
+    return (int)irq_ctl(IRQ_CTL_INFO, (uint64_t)id, (uint64_t)info, 0, 0, 0);
+}
+
+#endif /* _OCEAN_IRQ_H */
@@ -0,0 +1,86 @@
+/*
+ * Ocean libocean - External pagers
+ *
+ * SYS_PAGER regions: memory whose pages a server provides on demand.
+ * While answering a client, the pager maps a region into it with
+ * pager_map(); the client's first touch of each page then arrives at the
+ * pager's endpoint as a PAGER_FAULT call. The pager fills a buffer of its
+ * own, hands the pages over with pager_supply() and replies E_OK:
+ *
+ *     struct pager_fault f;
+ *     pager_fault_decode(r1, r2, r3, r4, &f);
+ *     fill(buf, f.cookie, f.offset, f.cluster);
+ *     pager_supply(f.region, f.offset, buf, f.cluster);
+ *     ipc_reply(IPC_MAKE_REPLY(PAGER_FAULT, 0, E_OK), 0, 0, 0, 0);
+ *
+ * Supplying the whole cluster saves the client the faults a sequential
+ * walk would take next. Private pages of buf move to the client rather
+ * than being copied and read as zero in the pager afterwards. Mirrors
+ * kernel/include/ocean/pager.h.
+ */
+
+#ifndef _OCEAN_PAGER_H
+#define _OCEAN_PAGER_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+#include <ocean/ipc_proto.h>
+
+#define PAGER_MAX_PAGES     (1ULL << 18)
+
+/* Region protection */
+#define PAGER_PROT_READ     (1 << 0)
+#define PAGER_PROT_WRITE    (1 << 1)
+#define PAGER_PROT_EXEC     (1 << 2)
+
+/* A PAGER_FAULT message, unpacked */
+struct pager_fault {
+    uint32_t region;        /* Region ID, for pager_supply() */
+    uint32_t access;        /* PAGER_ACCESS_* */
+    uint64_t offset;        /* Byte offset of the faulting page */
+    uint64_t cluster;       /* Pages from there on still missing (>= 1) */
+    uint64_t cookie;        /* As given to pager_map() */
+};
+
+static inline void pager_fault_decode(uint64_t r1, uint64_t r2, uint64_t r3,
+                                      uint64_t r4, struct pager_fault *f)
+{
+    f->region = (uint32_t)r1;
+    f->access = PAGER_FAULT_ACCESS(r2);
+    f->offset = PAGER_FAULT_OFFSET(r2);
+    f->cluster = r3;
+    f->cookie = r4;
+}
+
+/*
+ * Map a region of pages pages, served by endpoint (ours), into the client
+ * whose call we are answering. Returns the address in the client, or NULL.
+ */
+static inline void *pager_map(uint32_t endpoint, uint64_t pages, uint32_t prot,
+                              uint64_t cookie)
+{
+    int64_t addr = syscall5(SYS_PAGER, PAGER_CTL_MAP, endpoint, (int64_t)pages,
+                            prot, (int64_t)cookie);
+
+    return addr < 0 ? (void *)0 : (void *)addr;
+}
+
+/*
+ * Give the faulting client pages pages (at most PAGER_MAX_CLUSTER) of
+ * region at offset, taken from buf (page-aligned). Returns the pages
+ * mapped; ones the client already has are skipped.
+ */
+static inline int pager_supply(uint32_t region, uint64_t offset, const void *buf,
+                               uint64_t pages)
+{
+    return (int)syscall5(SYS_PAGER, PAGER_CTL_SUPPLY, region, (int64_t)offset,
+                         (int64_t)buf, (int64_t)pages);
+}
+
+/* Client side: drop a region and the pages in it */
+static inline int pager_unmap(void *addr)
+{
+    return (int)syscall2(SYS_PAGER, PAGER_CTL_UNMAP, (int64_t)addr);
+}
+
+#endif /* _OCEAN_PAGER_H */
@@ -0,0 +1,88 @@
+/*
+ * Ocean libocean - PCI devices
+ *
+ * Layout of the records returned by pci_list() and helpers around
+ * SYS_PCI for driver managers and drivers. Mirrors
+ * kernel/include/ocean/pci.h.
+ */
+
+#ifndef _OCEAN_PCI_H
+#define _OCEAN_PCI_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+#define PCI_MAX_BARS        6
+
+/* Device address as SYS_PCI takes it */
+#define PCI_BDF(seg, bus, slot, func) \
+    (((uint32_t)(seg) << 16) | ((uint32_t)(bus) << 8) | \
+     ((uint32_t)(slot) << 3) | (uint32_t)(func))
+
+/* struct pci_bar flags */
+#define PCI_BAR_IO          (1 << 0)
+#define PCI_BAR_MEM64       (1 << 1)
+#define PCI_BAR_PREFETCH    (1 << 2)
+
+struct pci_bar {
+    uint64_t base;                  /* Port or physical address; 0 if unused */
+    uint64_t size;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct pci_device_info {
+    uint16_t segment;
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+    uint8_t header_type;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t revision;
+    uint8_t irq_line;
+    uint8_t irq_pin;                /* 1-4 = INTA-INTD, 0 = none */
+    uint8_t msi_cap;                /* Capability offsets, 0 if absent */
+    uint8_t msix_cap;
+    uint16_t msix_vectors;
+    uint32_t owner;                 /* PID holding the claim, 0 if unclaimed */
+    struct pci_bar bars[PCI_MAX_BARS];
+};
+
+static inline uint32_t pci_info_bdf(const struct pci_device_info *info)
+{
+    return PCI_BDF(info->segment, info->bus, info->slot, info->func);
+}
+
+/* Fill buf with up to count devices; returns how many exist */
+static inline int64_t pci_list(struct pci_device_info *buf, uint64_t count)
+{
+    return pci_ctl(PCI_CTL_LIST, 0, (uint64_t)buf, count, 0);
+}
+
+/* Configuration register of width 1, 2 or 4; negative errno on failure */
+static inline int64_t pci_config_read(uint32_t bdf, uint32_t offset, uint32_t width)
+{
+    return pci_ctl(PCI_CTL_READ, bdf, offset, width, 0);
+}
+
+static inline int pci_config_write(uint32_t bdf, uint32_t offset, uint32_t width,
+                                   uint32_t value)
+{
+    return (int)pci_ctl(PCI_CTL_WRITE, bdf, offset, width, value);
+}
+
+static inline int pci_claim(uint32_t bdf)
+{
+    return (int)pci_ctl(PCI_CTL_CLAIM, bdf, 0, 0, 0);
+}
+
+static inline int pci_release(uint32_t bdf)
+{
+    return (int)pci_ctl(PCI_CTL_RELEASE, bdf, 0, 0, 0);
+}
+
+#endif /* _OCEAN_PCI_H */
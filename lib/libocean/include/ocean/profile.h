@@ -0,0 +1,28 @@
+/*
+ * Ocean libocean - Profiler samples
+ *
+ * Layout of the samples returned by profile_ctl(PROFILE_CTL_READ, ...).
+ * Mirrors kernel/include/ocean/profile.h.
+ */
+
+#ifndef _OCEAN_PROFILE_H
+#define _OCEAN_PROFILE_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+#define PROFILE_MAX_FRAMES      16
+
+struct profile_sample {
+    uint64_t rip;
+    uint32_t pid;
+    uint32_t tid;
+    uint16_t cpu;
+    uint8_t cpl;
+    uint8_t depth;
+    uint32_t reserved;
+    char comm[16];
+    uint64_t frames[PROFILE_MAX_FRAMES];    /* Return addresses, innermost first */
+};
+
+#endif /* _OCEAN_PROFILE_H */
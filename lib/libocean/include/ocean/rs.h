@@ -0,0 +1,76 @@
+/*
+ * Ocean libocean - Supervised endpoints
+ *
+ * SYS_RS keeps a server's endpoint alive across the server's death. The
+ * owner (or the reincarnation server) names a standby process with
+ * rs_supervise(); when the owner exits, the kernel hands the endpoint to
+ * the standby, or else back to whoever set up supervision, with its
+ * queued callers. Calls the dead server had received but not answered
+ * are delivered again, with IPC_FLAG_REPLAYED in the tag, so a server
+ * whose requests are not idempotent should check for it.
+ *
+ * A standby starts like the primary, initializes, and then waits:
+ *
+ *     if (rs_standby(EP_MEM) < 0)
+ *         return 1;
+ *     serve(EP_MEM);
+ *
+ * Mirrors the SYS_RS part of kernel/include/ocean/ipc.h.
+ */
+
+#ifndef _OCEAN_RS_H
+#define _OCEAN_RS_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+#include <ocean/ipc_proto.h>
+
+/* Make standby (a PID, 0 for none) the next owner of ep if its owner exits */
+static inline int rs_supervise(uint32_t ep, int standby)
+{
+    return (int)syscall3(SYS_RS, RS_CTL_SUPERVISE, ep, standby);
+}
+
+/* Stop supervising ep; it dies with its owner again */
+static inline int rs_release(uint32_t ep)
+{
+    return (int)syscall2(SYS_RS, RS_CTL_RELEASE, ep);
+}
+
+/* Give an endpoint we own to pid */
+static inline int rs_handover(uint32_t ep, int pid)
+{
+    return (int)syscall3(SYS_RS, RS_CTL_HANDOVER, ep, pid);
+}
+
+/* Sleep until we own ep; at once if we do */
+static inline int rs_park(uint32_t ep)
+{
+    return (int)syscall2(SYS_RS, RS_CTL_PARK, ep);
+}
+
+/*
+ * Stand by for ep, which a running instance of this service holds: park
+ * until it is ours, then tell the reincarnation server, which reports us
+ * to init and starts our own standby. Returns 0 once we serve ep.
+ */
+static inline int rs_standby(uint32_t ep)
+{
+    int err = rs_park(ep);
+
+    if (err < 0) {
+        return err;
+    }
+
+    struct ipc_call_frame frame = {
+        .tag = IPC_MAKE_TAG(RS_TAKEOVER, 2, 0, 0),
+        .r1 = (uint64_t)getpid(),
+        .r2 = ep,
+    };
+
+    /* Serve regardless: rs being gone only costs the next standby */
+    ipc_call(EP_RS, &frame);
+    return 0;
+}
+
+#endif /* _OCEAN_RS_H */
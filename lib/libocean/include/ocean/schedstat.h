@@ -0,0 +1,49 @@
+/*
+ * Ocean libocean - Per-thread scheduler statistics
+ *
+ * Layout of the records returned by schedstat(pid, ...), one per thread.
+ * Mirrors kernel/include/ocean/schedstat.h.
+ */
+
+#ifndef _OCEAN_SCHEDSTAT_H
+#define _OCEAN_SCHEDSTAT_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+/* Why a thread slept; indexes blocked_ns */
+enum sched_block_reason {
+    SCHED_BLOCK_OTHER = 0,
+    SCHED_BLOCK_IPC,
+    SCHED_BLOCK_FUTEX,
+    SCHED_BLOCK_WAIT,
+    SCHED_BLOCK_LOCK,
+    SCHED_BLOCK_SLEEP,
+    SCHED_BLOCK_FAULT,
+    SCHED_BLOCK_NR
+};
+
+static const char *const sched_block_reason_names[SCHED_BLOCK_NR] = {
+    [SCHED_BLOCK_OTHER] = "other",
+    [SCHED_BLOCK_IPC]   = "ipc",
+    [SCHED_BLOCK_FUTEX] = "futex",
+    [SCHED_BLOCK_WAIT]  = "wait",
+    [SCHED_BLOCK_LOCK]  = "lock",
+    [SCHED_BLOCK_SLEEP] = "sleep",
+    [SCHED_BLOCK_FAULT] = "fault",
+};
+
+struct sched_thread_info {
+    uint32_t tid;
+    uint32_t state;                 /* 0 running/runnable, 1-2 asleep, 4 zombie */
+    uint64_t nvcsw;
+    uint64_t nivcsw;
+    uint64_t nr_run_waits;
+    uint64_t run_delay_ns;
+    uint64_t run_delay_max_ns;
+    uint64_t user_ns;
+    uint64_t system_ns;
+    uint64_t blocked_ns[SCHED_BLOCK_NR];
+};
+
+#endif /* _OCEAN_SCHEDSTAT_H */
@@ -0,0 +1,83 @@
+/*
+ * Ocean libocean - Syscall statistics
+ *
+ * Layout of the records returned by scstat_ctl(SCSTAT_CTL_READ, ...),
+ * indexed by syscall number, plus names for printing them. Mirrors
+ * kernel/include/ocean/scstat.h.
+ */
+
+#ifndef _OCEAN_SCSTAT_H
+#define _OCEAN_SCSTAT_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+#define SCSTAT_HIST_BUCKETS     32
+#define SCSTAT_NR_SYSCALLS      128     /* The kernel's NR_SYSCALLS */
+
+struct scstat_record {
+    uint64_t count;
+    uint64_t errors;
+    uint64_t cycles;
+    uint64_t max_cycles;
+    uint64_t hist[SCSTAT_HIST_BUCKETS];     /* [2^i, 2^(i+1)) TSC cycles */
+};
+
+static const char *const scstat_syscall_names[SCSTAT_NR_SYSCALLS] = {
+    [SYS_EXIT]              = "exit",
+    [SYS_FORK]              = "fork",
+    [SYS_EXEC]              = "exec",
+    [SYS_WAIT]              = "wait",
+    [SYS_GETPID]            = "getpid",
+    [SYS_GETPPID]           = "getppid",
+    [SYS_SPAWN]             = "spawn",
+    [SYS_VFORK]             = "vfork",
+    [SYS_YIELD]             = "yield",
+    [SYS_SLEEP]             = "sleep",
+    [SYS_THREAD_CREATE]     = "thread_create",
+    [SYS_THREAD_EXIT]       = "thread_exit",
+    [SYS_SET_TLS]           = "set_tls",
+    [SYS_FUTEX]             = "futex",
+    [SYS_BRK]               = "brk",
+    [SYS_MMAP]              = "mmap",
+    [SYS_MUNMAP]            = "munmap",
+    [SYS_MPROTECT]          = "mprotect",
+    [SYS_OPEN]              = "open",
+    [SYS_CLOSE]             = "close",
+    [SYS_READ]              = "read",
+    [SYS_WRITE]             = "write",
+    [SYS_LSEEK]             = "lseek",
+    [SYS_IPC_SEND]          = "ipc_send",
+    [SYS_IPC_RECV]          = "ipc_recv",
+    [SYS_IPC_CALL]          = "ipc_call",
+    [SYS_IPC_REPLY]         = "ipc_reply",
+    [SYS_IPC_REPLY_RECV]    = "ipc_reply_recv",
+    [SYS_IPC_CALLER]        = "ipc_caller",
+    [SYS_ENDPOINT_CREATE]   = "endpoint_create",
+    [SYS_ENDPOINT_DESTROY]  = "endpoint_destroy",
+    [SYS_CAP_COPY]          = "cap_copy",
+    [SYS_CAP_DELETE]        = "cap_delete",
+    [SYS_CAP_MINT]          = "cap_mint",
+    [SYS_CAP_REVOKE]        = "cap_revoke",
+    [SYS_ENDPOINT_CREATE_WKE] = "endpoint_create_wke",
+    [SYS_NOTIFY_SIGNAL]     = "notify_signal",
+    [SYS_NOTIFY_WAIT]       = "notify_wait",
+    [SYS_NOTIFY_POLL]       = "notify_poll",
+    [SYS_NOTIFY_CREATE]     = "notify_create",
+    [SYS_NOTIFY_DESTROY]    = "notify_destroy",
+    [SYS_PCI]               = "pci",
+    [SYS_IRQ]               = "irq",
+    [SYS_IOPORT]            = "ioport",
+    [SYS_DMA]               = "dma",
+    [SYS_SHM]               = "shm",
+    [SYS_PAGER]             = "pager",
+    [SYS_RS]                = "rs",
+    [SYS_SCHEDSTAT]         = "schedstat",
+    [SYS_SCSTAT]            = "scstat",
+    [SYS_PROFILE]           = "profile",
+    [SYS_TRACE]             = "trace",
+    [SYS_KSTAT]             = "kstat",
+    [SYS_DEBUG_PRINT]       = "debug_print",
+};
+
+#endif /* _OCEAN_SCSTAT_H */
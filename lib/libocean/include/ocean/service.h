@@ -0,0 +1,39 @@
+/*
+ * Ocean libocean - Core service readiness
+ *
+ * Init spawns a core service once the well-known endpoints it needs are
+ * up, and learns that a service is up from the service itself: after
+ * claiming its endpoint, and before serving, it calls
+ *
+ *     service_ready(EP_VFS);
+ *
+ * (0 for a service without a well-known endpoint). Services started by
+ * anything else get E_NOENT back, which they may ignore.
+ */
+
+#ifndef _OCEAN_SERVICE_H
+#define _OCEAN_SERVICE_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+#include <ocean/ipc_proto.h>
+
+/* Tell init we are serving; E_OK or an E_* code */
+static inline int service_ready(uint32_t well_known_ep)
+{
+    struct ipc_call_frame frame = {
+        .tag = IPC_MAKE_TAG(INIT_SVC_READY, 2, 0, 0),
+        .r1 = (uint64_t)getpid(),
+        .r2 = well_known_ep,
+    };
+
+    if (ipc_call(EP_INIT, &frame) < 0) {
+        return E_NOENT;
+    }
+    if (IPC_TAG_FLAGS(frame.tag) & IPC_FLAG_ERROR) {
+        return (int)IPC_TAG_ERROR(frame.tag);
+    }
+    return E_OK;
+}
+
+#endif /* _OCEAN_SERVICE_H */
@@ -0,0 +1,71 @@
+/*
+ * Ocean libocean - Shared memory
+ *
+ * SYS_SHM objects: blocks of memory several processes map at once.
+ * The creator holds every right and grants others READ, WRITE or GRANT
+ * by PID; a server passes 0 to grant the client it is answering. Fork
+ * does not copy mappings. Mirrors kernel/include/ocean/shm.h.
+ *
+ * shm_create_named() and friends go through the memory server, which
+ * keeps a namespace of objects that outlive their creators until
+ * unlinked.
+ */
+
+#ifndef _OCEAN_SHM_H
+#define _OCEAN_SHM_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+#define SHM_MAX_PAGES       1024
+
+#define SHM_RIGHT_READ      (1 << 0)
+#define SHM_RIGHT_WRITE     (1 << 1)
+#define SHM_RIGHT_GRANT     (1 << 2)
+#define SHM_RIGHTS_RW       (SHM_RIGHT_READ | SHM_RIGHT_WRITE)
+
+/* Returns the object ID or a negative errno */
+static inline int shm_create(uint64_t pages)
+{
+    return (int)syscall4(SYS_SHM, SHM_CTL_CREATE, pages, 0, 0);
+}
+
+static inline int shm_destroy(uint32_t id)
+{
+    return (int)syscall4(SYS_SHM, SHM_CTL_DESTROY, id, 0, 0);
+}
+
+/* rights 0 revokes; pid 0 is the caller of the message being served */
+static inline int shm_grant(uint32_t id, int pid, uint32_t rights)
+{
+    return (int)syscall4(SYS_SHM, SHM_CTL_GRANT, id, (uint64_t)pid, rights);
+}
+
+/* rights is SHM_RIGHT_READ, optionally with SHM_RIGHT_WRITE; NULL on failure */
+static inline void *shm_map(uint32_t id, uint32_t rights)
+{
+    int64_t addr = syscall4(SYS_SHM, SHM_CTL_MAP, id, rights, 0);
+
+    return addr < 0 ? (void *)0 : (void *)addr;
+}
+
+static inline int shm_unmap(void *addr)
+{
+    return (int)syscall4(SYS_SHM, SHM_CTL_UNMAP, (uint64_t)addr, 0, 0);
+}
+
+/* Pages in the object, or a negative errno */
+static inline int64_t shm_size(uint32_t id)
+{
+    return syscall4(SYS_SHM, SHM_CTL_SIZE, id, 0, 0);
+}
+
+/*
+ * Named objects (memory server). Names are shorter than MEM_SHM_NAME_MAX.
+ * Create and open return the ID, unlink 0; errors are negative E_* codes.
+ */
+int shm_create_named(const char *name, uint64_t pages);
+int shm_open_named(const char *name, uint32_t rights);
+int shm_unlink_named(const char *name);
+
+#endif /* _OCEAN_SHM_H */
@@ -0,0 +1,94 @@
+/*
+ * Ocean libocean - Mutexes and condition variables
+ *
+ * Futex-backed, with uncontended paths that stay in userspace: locking a
+ * free mutex is one compare-and-swap, unlocking one with no waiters is one
+ * atomic decrement, and signalling a condvar nobody waits on is two atomic
+ * operations. Both work between processes sharing memory.
+ */
+
+#ifndef _OCEAN_SYNC_H
+#define _OCEAN_SYNC_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+/*
+ * Mutex word: 0 = unlocked, 1 = locked, 2 = locked with (possible) waiters
+ */
+typedef struct {
+    volatile uint32_t state;
+} ocean_mutex_t;
+
+typedef struct {
+    volatile uint32_t seq;          /* Bumped by every signal */
+    volatile uint32_t waiters;      /* Threads in ocean_cond_wait */
+} ocean_cond_t;
+
+#define OCEAN_MUTEX_INIT    { 0 }
+#define OCEAN_COND_INIT     { 0, 0 }
+
+static inline int ocean_mutex_trylock(ocean_mutex_t *m)
+{
+    uint32_t expected = 0;
+
+    return __atomic_compare_exchange_n(&m->state, &expected, 1, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Slow path: mark the mutex contended and sleep until we take it */
+static inline void ocean_mutex_lock_slow(ocean_mutex_t *m)
+{
+    while (__atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE) != 0) {
+        futex(&m->state, FUTEX_WAIT, 2);
+    }
+}
+
+static inline void ocean_mutex_lock(ocean_mutex_t *m)
+{
+    if (!ocean_mutex_trylock(m)) {
+        ocean_mutex_lock_slow(m);
+    }
+}
+
+static inline void ocean_mutex_unlock(ocean_mutex_t *m)
+{
+    if (__atomic_fetch_sub(&m->state, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&m->state, 0, __ATOMIC_RELEASE);
+        futex(&m->state, FUTEX_WAKE, 1);
+    }
+}
+
+/*
+ * Wait for a signal with m held. May wake spuriously; callers re-check
+ * their predicate. m is re-taken in the contended state so the eventual
+ * unlock wakes anyone queued behind us.
+ */
+static inline void ocean_cond_wait(ocean_cond_t *c, ocean_mutex_t *m)
+{
+    uint32_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+
+    __atomic_fetch_add(&c->waiters, 1, __ATOMIC_ACQ_REL);
+    ocean_mutex_unlock(m);
+    futex(&c->seq, FUTEX_WAIT, seq);
+    __atomic_fetch_sub(&c->waiters, 1, __ATOMIC_ACQ_REL);
+    ocean_mutex_lock_slow(m);
+}
+
+static inline void ocean_cond_signal(ocean_cond_t *c)
+{
+    __atomic_fetch_add(&c->seq, 1, __ATOMIC_ACQ_REL);
+    if (__atomic_load_n(&c->waiters, __ATOMIC_ACQUIRE) != 0) {
+        futex(&c->seq, FUTEX_WAKE, 1);
+    }
+}
+
+static inline void ocean_cond_broadcast(ocean_cond_t *c)
+{
+    __atomic_fetch_add(&c->seq, 1, __ATOMIC_ACQ_REL);
+    if (__atomic_load_n(&c->waiters, __ATOMIC_ACQUIRE) != 0) {
+        futex(&c->seq, FUTEX_WAKE, INT32_MAX);
+    }
+}
+
+#endif /* _OCEAN_SYNC_H */
@@ -26,14 +26,23 @@
 #define SYS_WAIT            3
 #define SYS_GETPID          4
 #define SYS_GETPPID         5
+#define SYS_SPAWN           6
+#define SYS_VFORK           7
 
 /* Implemented thread control */
 #define SYS_YIELD           10
+#define SYS_THREAD_CREATE   12
+#define SYS_THREAD_EXIT     13
+#define SYS_SET_TLS         14
+#define SYS_FUTEX           15
 
 /* Reserved / unimplemented thread control */
 #define SYS_SLEEP           11
-#define SYS_THREAD_CREATE   12
-#define SYS_THREAD_EXIT     13
+
+/* SYS_FUTEX operations */
+#define FUTEX_WAIT          0       /* Sleep if *uaddr == val */
+#define FUTEX_WAKE          1       /* Wake up to val waiters */
+#define FUTEX_PRIVATE_FLAG  128     /* Word is not in shared memory */
 
 /* Reserved / unimplemented memory management */
 #define SYS_BRK             20
@@ -60,6 +69,28 @@
 #define SEEK_CUR            1
 #define SEEK_END            2
 
+/*
+ * SYS_SPAWN file actions, applied in order to the child's copy of the
+ * caller's file table before the child first runs. fds 0-2 start out as
+ * the console and may be closed or redirected like any other.
+ */
+#define SPAWN_FA_CLOSE          1   /* close(fd) */
+#define SPAWN_FA_DUP2           2   /* dup2(fd, newfd) */
+#define SPAWN_FA_OPEN           3   /* newfd = open(path, flags) */
+
+#define SPAWN_MAX_FILE_ACTIONS  16
+
+/* spawn() flags */
+#define SPAWN_PRIVILEGED        (1 << 0)    /* Child is privileged; caller must be */
+
+struct spawn_file_action {
+    uint32_t op;            /* SPAWN_FA_* */
+    int32_t fd;             /* Source fd (CLOSE, DUP2) */
+    int32_t newfd;          /* Target fd (DUP2, OPEN) */
+    uint32_t flags;         /* O_* flags (OPEN) */
+    const char *path;       /* Path to open (OPEN) */
+};
+
 /* Implemented IPC */
 #define SYS_IPC_SEND        50
 #define SYS_IPC_RECV        51
@@ -69,6 +100,9 @@
 #define SYS_IPC_REPLY       53
 #define SYS_IPC_REPLY_RECV  54
 
+/* PID of the caller we owe a reply */
+#define SYS_IPC_CALLER      55
+
 /* Implemented endpoint management */
 #define SYS_ENDPOINT_CREATE 60
 #define SYS_ENDPOINT_DESTROY 61
@@ -82,14 +116,104 @@
 /* Explicit well-known endpoint claim (id in [EP_WKE_MIN, EP_WKE_MAX]) */
 #define SYS_ENDPOINT_CREATE_WKE 66
 
-/* Reserved / unimplemented notifications */
+/* Notifications */
 #define SYS_NOTIFY_SIGNAL   70
 #define SYS_NOTIFY_WAIT     71
 #define SYS_NOTIFY_POLL     72
+#define SYS_NOTIFY_CREATE   73
+#define SYS_NOTIFY_DESTROY  74
+
+/* Device access */
+#define SYS_PCI             80
+#define SYS_IRQ             81
+#define SYS_IOPORT          82
+#define SYS_DMA             83
+#define SYS_SHM             84
+#define SYS_PAGER           85
+#define SYS_RS              86
 
 /* Debugging */
+#define SYS_SCHEDSTAT       94
+#define SYS_SCSTAT          95
+#define SYS_PROFILE         96
+#define SYS_TRACE           97
+#define SYS_KSTAT           98
 #define SYS_DEBUG_PRINT     99
 
+/* SYS_KSTAT selectors; the report goes to the kernel console */
+#define KSTAT_LOCKS         0       /* Spinlock class statistics */
+#define KSTAT_BENCH         1       /* Run the in-kernel allocator benchmarks; privileged */
+#define KSTAT_BOOT          2       /* Boot phase timings, as BENCH lines */
+
+/* SYS_KSTAT flags */
+#define KSTAT_RESET         (1 << 0)    /* Zero the counters after dumping */
+
+/* SYS_TRACE operations (see ocean/trace.h for the record format); all but
+ * CLOCK are privileged only */
+#define TRACE_CTL_START     0       /* arg: event mask, 0 for all events */
+#define TRACE_CTL_STOP      1
+#define TRACE_CTL_READ      2       /* arg: cpu; fills buf with up to count records */
+#define TRACE_CTL_RESET     3       /* Discard buffered records */
+#define TRACE_CTL_CLOCK     4       /* Returns TSC ticks per second */
+#define TRACE_CTL_LOST      5       /* arg: cpu; returns records overwritten unread */
+
+/* SYS_PROFILE operations (see ocean/profile.h for the sample format);
+ * privileged only */
+#define PROFILE_CTL_START   0       /* arg: sample rate in Hz, 0 for the default */
+#define PROFILE_CTL_STOP    1
+#define PROFILE_CTL_READ    2       /* arg: cpu; fills buf with up to count samples */
+#define PROFILE_CTL_RESET   3       /* Discard buffered samples */
+#define PROFILE_CTL_LOST    4       /* arg: cpu; returns samples dropped while full */
+
+/* SYS_SCSTAT operations (see ocean/scstat.h for the record format); all
+ * but CLOCK are privileged only */
+#define SCSTAT_CTL_START    0       /* Start counting syscalls and timing handlers */
+#define SCSTAT_CTL_STOP     1
+#define SCSTAT_CTL_READ     2       /* arg: first syscall; fills buf with up to count records */
+#define SCSTAT_CTL_RESET    3       /* Zero all counters and histograms */
+#define SCSTAT_CTL_CLOCK    4       /* Returns TSC ticks per second */
+
+/* SYS_PCI operations (see ocean/pci.h for the record format and BDF encoding) */
+#define PCI_CTL_LIST        0       /* Fill buf with up to count devices; returns the total */
+#define PCI_CTL_READ        1       /* Config read of width 1/2/4 at offset; returns the value */
+#define PCI_CTL_WRITE       2       /* Config write by the claim holder; not BARs, ROM, bridge windows */
+#define PCI_CTL_CLAIM       3       /* Take the device for the calling driver; privileged only */
+#define PCI_CTL_RELEASE     4
+
+/* SYS_IRQ operations (see ocean/irq.h for sources and the info record) */
+#define IRQ_CTL_BIND        0       /* source, arg, notification, bit, flags or nvec; returns the ID */
+#define IRQ_CTL_UNBIND      1       /* id */
+#define IRQ_CTL_ACK         2       /* id, queue mask: unmask the queues handled */
+#define IRQ_CTL_TRIGGER     3       /* id, queue: raise it on this CPU (not ISA sources) */
+#define IRQ_CTL_INFO        4       /* id, buf */
+
+/* SYS_IOPORT operations: direct in/out on port ranges */
+#define IOPORT_CTL_CLAIM    0       /* base, count: open the ports to a privileged caller */
+#define IOPORT_CTL_RELEASE  1       /* base, count as claimed */
+
+/* SYS_DMA operations: memory server only, acting on the client it is answering */
+#define DMA_CTL_ALLOC       0       /* pages, cache type, struct dma_region out */
+#define DMA_CTL_FREE        1       /* phys of a client buffer; returns its pages */
+
+/* SYS_SHM operations (see ocean/shm.h for rights) */
+#define SHM_CTL_CREATE      0       /* pages; returns the ID */
+#define SHM_CTL_DESTROY     1       /* id; owner only */
+#define SHM_CTL_GRANT       2       /* id, pid (0 = the IPC caller being served), rights */
+#define SHM_CTL_MAP         3       /* id, rights; returns the address */
+#define SHM_CTL_UNMAP       4       /* address */
+#define SHM_CTL_SIZE        5       /* id; returns the pages */
+
+/* SYS_PAGER operations (see ocean/pager.h; fault messages in ocean/ipc_proto.h) */
+#define PAGER_CTL_MAP       0       /* endpoint, pages, prot, cookie: region in the IPC caller */
+#define PAGER_CTL_SUPPLY    1       /* id, offset, src, pages: fill the faulting caller's region */
+#define PAGER_CTL_UNMAP     2       /* address: drop one of the caller's own regions */
+
+/* SYS_RS operations: supervised endpoints (see ocean/ipc.h) */
+#define RS_CTL_SUPERVISE    0       /* ep, standby pid (0 = none); owner or EP_RS owner */
+#define RS_CTL_RELEASE      1       /* ep; owner or EP_RS owner */
+#define RS_CTL_HANDOVER     2       /* ep, pid: give an endpoint we own away */
+#define RS_CTL_PARK         3       /* ep: sleep until we own it */
+
 /*
  * Raw syscall wrappers
  *
@@ -217,17 +341,79 @@ static inline int yield(void)
     return (int)syscall0(SYS_YIELD);
 }
 
+/*
+ * Start a thread in this process at entry(arg) on stack_top with FS base
+ * tls. If tid_addr is non-NULL the kernel stores the new TID there and
+ * clears it to zero once the thread has exited. Returns the TID or a
+ * negative errno. Most code wants pthread_create() instead.
+ */
+static inline int thread_create(void (*entry)(void *), void *arg,
+                                void *stack_top, void *tls,
+                                volatile uint32_t *tid_addr)
+{
+    return (int)syscall5(SYS_THREAD_CREATE, (int64_t)entry, (int64_t)arg,
+                         (int64_t)stack_top, (int64_t)tls, (int64_t)tid_addr);
+}
+
+/* Exit the calling thread; the last thread exits the process */
+static inline __attribute__((noreturn)) void thread_exit(int status)
+{
+    syscall1(SYS_THREAD_EXIT, status);
+    __builtin_unreachable();
+}
+
+/*
+ * FUTEX_WAIT: sleep while *uaddr == val (returns -EAGAIN if it differs).
+ * FUTEX_WAKE: wake up to val sleepers on uaddr, returning how many woke.
+ * Or in FUTEX_PRIVATE_FLAG when the word is not in shared memory.
+ */
+static inline int futex(volatile uint32_t *uaddr, uint32_t op, uint32_t val)
+{
+    return (int)syscall3(SYS_FUTEX, (int64_t)uaddr, op, val);
+}
+
+/* Set the calling thread's FS base (TLS thread pointer) */
+static inline int set_tls(void *base)
+{
+    return (int)syscall1(SYS_SET_TLS, (int64_t)base);
+}
+
 static inline int fork(void)
 {
     return (int)syscall0(SYS_FORK);
 }
 
+/*
+ * vfork: the child shares the caller's address space and user stack, and
+ * the caller is suspended until the child calls execv() or _exit(). The
+ * child must do nothing else. Always inlined so no call frame is shared.
+ */
+static inline __attribute__((always_inline)) int vfork(void)
+{
+    return (int)syscall0(SYS_VFORK);
+}
+
 /* exec currently supports argv only; envp is not wired up yet. */
 static inline int execv(const char *path, char *const argv[])
 {
     return (int)syscall3(SYS_EXEC, (int64_t)path, (int64_t)argv, 0);
 }
 
+/*
+ * Create a child running path with argv, without copying the caller's
+ * address space. actions (may be NULL) edit the child's inherited file
+ * table. A child is privileged (device claims, port I/O, kernel-wide
+ * statistics) only with SPAWN_PRIVILEGED from a privileged caller.
+ * Returns the child's PID or a negative errno.
+ */
+static inline int spawn(const char *path, char *const argv[],
+                        const struct spawn_file_action *actions,
+                        uint32_t nactions, uint32_t flags)
+{
+    return (int)syscall5(SYS_SPAWN, (int64_t)path, (int64_t)argv,
+                         (int64_t)actions, nactions, flags);
+}
+
 static inline int wait(int *status)
 {
     return (int)syscall1(SYS_WAIT, (int64_t)status);
@@ -263,6 +449,46 @@ static inline int debug_print(const char *msg, uint64_t len)
     return (int)syscall2(SYS_DEBUG_PRINT, (int64_t)msg, len);
 }
 
+static inline int kstat(uint32_t what, uint32_t flags)
+{
+    return (int)syscall2(SYS_KSTAT, what, flags);
+}
+
+static inline int64_t trace_ctl(uint32_t op, uint64_t arg, void *buf, uint64_t count)
+{
+    return syscall4(SYS_TRACE, op, arg, (int64_t)buf, count);
+}
+
+static inline int64_t profile_ctl(uint32_t op, uint64_t arg, void *buf, uint64_t count)
+{
+    return syscall4(SYS_PROFILE, op, arg, (int64_t)buf, count);
+}
+
+/* Per-thread scheduler statistics of process pid (0 = self); see ocean/schedstat.h */
+static inline int64_t schedstat(int pid, void *buf, uint64_t count)
+{
+    return syscall3(SYS_SCHEDSTAT, pid, (int64_t)buf, count);
+}
+
+static inline int64_t scstat_ctl(uint32_t op, uint64_t arg, void *buf, uint64_t count)
+{
+    return syscall4(SYS_SCSTAT, op, arg, (int64_t)buf, count);
+}
+
+/* PCI enumeration and config space; see ocean/pci.h for typed helpers */
+static inline int64_t pci_ctl(uint32_t op, uint32_t bdf, uint64_t arg1,
+                              uint64_t arg2, uint64_t arg3)
+{
+    return syscall5(SYS_PCI, op, bdf, arg1, arg2, arg3);
+}
+
+/* Interrupt delivery to drivers; see ocean/irq.h for typed helpers */
+static inline int64_t irq_ctl(uint32_t op, uint64_t arg1, uint64_t arg2,
+                              uint64_t arg3, uint64_t arg4, uint64_t arg5)
+{
+    return syscall6(SYS_IRQ, op, arg1, arg2, arg3, arg4, arg5);
+}
+
 /*
  * IPC syscalls
  */
@@ -287,6 +513,58 @@ static inline int endpoint_destroy(uint32_t ep_id)
     return (int)syscall1(SYS_ENDPOINT_DESTROY, ep_id);
 }
 
+/*
+ * Claim ports base..base+count-1 for direct in/out (see ocean/io.h).
+ * Exclusive; ports behind a PCI I/O BAR need the device's claim first.
+ */
+static inline int ioport_claim(uint32_t base, uint32_t count)
+{
+    return (int)syscall3(SYS_IOPORT, IOPORT_CTL_CLAIM, base, count);
+}
+
+static inline int ioport_release(uint32_t base, uint32_t count)
+{
+    return (int)syscall3(SYS_IOPORT, IOPORT_CTL_RELEASE, base, count);
+}
+
+/* Memory server only: DMA buffers for the client being served (ocean/dma.h) */
+static inline int64_t dma_ctl(uint32_t op, uint64_t arg1, uint64_t arg2, uint64_t arg3)
+{
+    return syscall4(SYS_DMA, op, arg1, arg2, arg3);
+}
+
+/*
+ * Notifications: a word of pending bits. Anyone may signal; the creating
+ * process waits, getting back (and clearing) every bit signalled since
+ * its last wait.
+ */
+static inline int notify_create(void)
+{
+    return (int)syscall1(SYS_NOTIFY_CREATE, 0);
+}
+
+static inline int notify_destroy(uint32_t ntfn)
+{
+    return (int)syscall1(SYS_NOTIFY_DESTROY, ntfn);
+}
+
+static inline int notify_signal(uint32_t ntfn, uint64_t bits)
+{
+    return (int)syscall2(SYS_NOTIFY_SIGNAL, ntfn, bits);
+}
+
+/* Pending bits, blocking until there are some; negative on error */
+static inline int64_t notify_wait(uint32_t ntfn)
+{
+    return syscall1(SYS_NOTIFY_WAIT, ntfn);
+}
+
+/* Pending bits or 0, without blocking */
+static inline int64_t notify_poll(uint32_t ntfn)
+{
+    return syscall1(SYS_NOTIFY_POLL, ntfn);
+}
+
 static inline int64_t ipc_send(uint32_t ep, uint64_t tag,
                                uint64_t r1, uint64_t r2, uint64_t r3, uint64_t r4)
 {
@@ -323,6 +601,16 @@ static inline int64_t ipc_reply(uint64_t tag, uint64_t r1, uint64_t r2,
     return syscall5(SYS_IPC_REPLY, tag, r1, r2, r3, r4);
 }
 
+/*
+ * PID of the process whose call we received and have not yet answered,
+ * as the kernel knows it. -IPC_ERR_INVALID when we owe no reply (the
+ * message was a send).
+ */
+static inline int ipc_caller_pid(void)
+{
+    return (int)syscall0(SYS_IPC_CALLER);
+}
+
 /*
  * Per-process IPC window helpers.
  *
@@ -0,0 +1,56 @@
+/*
+ * Ocean libocean - Kernel trace records
+ *
+ * Layout of the records returned by trace_ctl(TRACE_CTL_READ, ...), and
+ * the event numbers and argument names. Mirrors kernel/include/ocean/trace.h.
+ */
+
+#ifndef _OCEAN_TRACE_H
+#define _OCEAN_TRACE_H
+
+#include <stdint.h>
+#include <ocean/syscall.h>
+
+/*
+ * E(ID, name, arg0, arg1, arg2): argument names are for dumps; "" if unused
+ */
+#define TRACE_EVENT_LIST(E) \
+    E(SCHED_SWITCH,  sched_switch,  "prev",   "next",  "prev_state") \
+    E(SCHED_WAKEUP,  sched_wakeup,  "tid",    "cpu",   "") \
+    E(IPC_SEND,      ipc_send,      "ep",     "tag",   "op") \
+    E(IPC_RECV,      ipc_recv,      "ep",     "tag",   "result") \
+    E(IPC_REPLY,     ipc_reply,     "caller", "tag",   "result") \
+    E(PAGE_FAULT,    page_fault,    "addr",   "error", "rip") \
+    E(SYSCALL_ENTER, syscall_enter, "nr",     "arg1",  "arg2") \
+    E(SYSCALL_EXIT,  syscall_exit,  "nr",     "ret",   "") \
+    E(KMALLOC,       kmalloc,       "ptr",    "size",  "") \
+    E(KFREE,         kfree,         "ptr",    "",      "")
+
+#define __TRACE_ENUM(id, name, a0, a1, a2) TRACE_##id,
+enum trace_event {
+    TRACE_NONE = 0,
+    TRACE_EVENT_LIST(__TRACE_ENUM)
+    TRACE_NR_EVENTS
+};
+#undef __TRACE_ENUM
+
+struct trace_record {
+    uint64_t tsc;
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t tid;
+    uint64_t args[3];
+};
+
+struct trace_event_info {
+    const char *name;
+    const char *args[3];
+};
+
+#define __TRACE_INFO(id, n, a0, a1, a2) [TRACE_##id] = { #n, { a0, a1, a2 } },
+static const struct trace_event_info trace_event_info[TRACE_NR_EVENTS] = {
+    TRACE_EVENT_LIST(__TRACE_INFO)
+};
+#undef __TRACE_INFO
+
+#endif /* _OCEAN_TRACE_H */
@@ -0,0 +1,77 @@
+/*
+ * Ocean libocean - POSIX threads
+ *
+ * A small pthread-compatible layer over SYS_THREAD_CREATE and the futex
+ * primitives in <ocean/sync.h>. Threads share the process address space,
+ * file table and endpoints; each gets its own user stack from malloc() and
+ * a TLS block reached through FS base.
+ * Functions return 0 or a positive error number from <errno.h>.
+ */
+
+#ifndef _PTHREAD_H
+#define _PTHREAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ocean/sync.h>
+
+#define PTHREAD_CREATE_JOINABLE     0
+#define PTHREAD_CREATE_DETACHED     1
+
+#define PTHREAD_STACK_MIN           4096
+#define PTHREAD_STACK_DEFAULT       (16 * 1024)
+
+typedef struct pthread *pthread_t;
+
+typedef struct {
+    size_t stacksize;
+    int detachstate;
+} pthread_attr_t;
+
+typedef ocean_mutex_t pthread_mutex_t;
+
+typedef struct {
+    int unused;
+} pthread_mutexattr_t;
+
+typedef ocean_cond_t pthread_cond_t;
+
+typedef struct {
+    int unused;
+} pthread_condattr_t;
+
+#define PTHREAD_MUTEX_INITIALIZER   OCEAN_MUTEX_INIT
+#define PTHREAD_COND_INITIALIZER    OCEAN_COND_INIT
+
+/* Attributes */
+int pthread_attr_init(pthread_attr_t *attr);
+int pthread_attr_destroy(pthread_attr_t *attr);
+int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize);
+int pthread_attr_getstacksize(const pthread_attr_t *attr, size_t *stacksize);
+int pthread_attr_setdetachstate(pthread_attr_t *attr, int detachstate);
+int pthread_attr_getdetachstate(const pthread_attr_t *attr, int *detachstate);
+
+/* Thread lifecycle */
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                   void *(*start_routine)(void *), void *arg);
+int pthread_join(pthread_t thread, void **retval);
+int pthread_detach(pthread_t thread);
+void pthread_exit(void *retval) __attribute__((noreturn));
+pthread_t pthread_self(void);
+int pthread_equal(pthread_t t1, pthread_t t2);
+
+/* Mutexes */
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+int pthread_mutex_destroy(pthread_mutex_t *mutex);
+int pthread_mutex_lock(pthread_mutex_t *mutex);
+int pthread_mutex_trylock(pthread_mutex_t *mutex);
+int pthread_mutex_unlock(pthread_mutex_t *mutex);
+
+/* Condition variables */
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr);
+int pthread_cond_destroy(pthread_cond_t *cond);
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+int pthread_cond_signal(pthread_cond_t *cond);
+int pthread_cond_broadcast(pthread_cond_t *cond);
+
+#endif /* _PTHREAD_H */
@@ -0,0 +1,161 @@
+/*
+ * Ocean libocean - DMA buffers
+ *
+ * Buffers come from the memory server over EP_MEM. A pool keeps a free
+ * bitmap per chunk and only calls the server when every chunk is full,
+ * so steady-state descriptor allocation is a bit scan under a mutex.
+ * Chunks stay with the pool until dma_pool_destroy().
+ */
+
+#include <string.h>
+#include <ocean/dma.h>
+#include <ocean/ipc_proto.h>
+
+int dma_alloc(uint64_t pages, uint32_t cache, struct dma_buf *buf)
+{
+    struct ipc_call_frame frame = {
+        .tag = IPC_MAKE_TAG(MEM_ALLOC_PHYS, 2, 0, 0),
+        .r1 = pages,
+        .r2 = cache,
+    };
+
+    if (ipc_call(EP_MEM, &frame) < 0) {
+        return -E_NODEV;
+    }
+    if (IPC_TAG_FLAGS(frame.tag) & IPC_FLAG_ERROR) {
+        return -(int)IPC_TAG_ERROR(frame.tag);
+    }
+
+    buf->phys = frame.r1;
+    buf->size = frame.r2 * DMA_PAGE_SIZE;
+    buf->virt = (void *)frame.r3;
+    return 0;
+}
+
+int dma_free(const struct dma_buf *buf)
+{
+    struct ipc_call_frame frame = {
+        .tag = IPC_MAKE_TAG(MEM_FREE_PHYS, 1, 0, 0),
+        .r1 = buf->phys,
+    };
+
+    if (ipc_call(EP_MEM, &frame) < 0) {
+        return -E_NODEV;
+    }
+    if (IPC_TAG_FLAGS(frame.tag) & IPC_FLAG_ERROR) {
+        return -(int)IPC_TAG_ERROR(frame.tag);
+    }
+    return 0;
+}
+
+int dma_pool_init(struct dma_pool *pool, uint32_t block_size, uint32_t cache)
+{
+    uint32_t size = DMA_POOL_MIN_BLOCK;
+
+    if (block_size > DMA_PAGE_SIZE || cache > DMA_CACHE_WC) {
+        return -E_INVAL;
+    }
+    while (size < block_size) {
+        size <<= 1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->block_size = size;
+    pool->blocks_per_chunk = DMA_POOL_CHUNK_PAGES * DMA_PAGE_SIZE / size;
+    pool->cache = cache;
+    return 0;
+}
+
+/* Add a chunk with every block free; pool->lock held */
+static struct dma_pool_chunk *dma_pool_grow(struct dma_pool *pool)
+{
+    struct dma_pool_chunk *chunk;
+
+    if (pool->nr_chunks == DMA_POOL_MAX_CHUNKS) {
+        return NULL;
+    }
+
+    chunk = &pool->chunks[pool->nr_chunks];
+    if (dma_alloc(DMA_POOL_CHUNK_PAGES, pool->cache, &chunk->buf) < 0) {
+        return NULL;
+    }
+
+    memset(chunk->free_map, 0, sizeof(chunk->free_map));
+    for (uint32_t i = 0; i < pool->blocks_per_chunk; i++) {
+        chunk->free_map[i / 64] |= 1ULL << (i % 64);
+    }
+    chunk->nr_free = pool->blocks_per_chunk;
+    pool->nr_chunks++;
+    return chunk;
+}
+
+void *dma_pool_alloc(struct dma_pool *pool, uint64_t *phys)
+{
+    struct dma_pool_chunk *chunk = NULL;
+    void *block = NULL;
+
+    ocean_mutex_lock(&pool->lock);
+
+    for (uint32_t i = 0; i < pool->nr_chunks; i++) {
+        if (pool->chunks[i].nr_free) {
+            chunk = &pool->chunks[i];
+            break;
+        }
+    }
+    if (!chunk) {
+        chunk = dma_pool_grow(pool);
+    }
+
+    if (chunk) {
+        for (uint32_t w = 0; w < DMA_POOL_CHUNK_BLOCKS / 64; w++) {
+            if (chunk->free_map[w]) {
+                uint32_t bit = (uint32_t)__builtin_ctzll(chunk->free_map[w]);
+                uint64_t off = (uint64_t)(w * 64 + bit) * pool->block_size;
+
+                chunk->free_map[w] &= ~(1ULL << bit);
+                chunk->nr_free--;
+                block = (char *)chunk->buf.virt + off;
+                *phys = chunk->buf.phys + off;
+                break;
+            }
+        }
+    }
+
+    ocean_mutex_unlock(&pool->lock);
+
+    /* Blocks go back dirty; hand them out clean like fresh chunks */
+    if (block) {
+        memset(block, 0, pool->block_size);
+    }
+    return block;
+}
+
+void dma_pool_free(struct dma_pool *pool, void *block)
+{
+    ocean_mutex_lock(&pool->lock);
+
+    for (uint32_t i = 0; i < pool->nr_chunks; i++) {
+        struct dma_pool_chunk *chunk = &pool->chunks[i];
+        uintptr_t base = (uintptr_t)chunk->buf.virt;
+
+        if ((uintptr_t)block >= base && (uintptr_t)block < base + chunk->buf.size) {
+            uint32_t idx = (uint32_t)(((uintptr_t)block - base) / pool->block_size);
+
+            chunk->free_map[idx / 64] |= 1ULL << (idx % 64);
+            chunk->nr_free++;
+            break;
+        }
+    }
+
+    ocean_mutex_unlock(&pool->lock);
+}
+
+void dma_pool_destroy(struct dma_pool *pool)
+{
+    ocean_mutex_lock(&pool->lock);
+    for (uint32_t i = 0; i < pool->nr_chunks; i++) {
+        dma_free(&pool->chunks[i].buf);
+    }
+    pool->nr_chunks = 0;
+    ocean_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,330 @@
+/*
+ * Ocean libocean - POSIX threads
+ *
+ * Each thread's control block sits just above its stack in one malloc()
+ * block, and FS base points at the control block so pthread_self() is a
+ * single %fs-relative load. The kernel zeroes pt->tid once a thread has
+ * fully exited; join waits for that, and detached threads are freed by a
+ * later pthread call once they have.
+ */
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <ocean/syscall.h>
+
+/* Join state, decided by whichever of exit/detach gets there second */
+#define PT_JOINABLE     0
+#define PT_DETACHED     1
+#define PT_EXITED       2
+
+struct pthread {
+    struct pthread *self;           /* %fs:0 */
+    volatile uint32_t tid;          /* Cleared by the kernel on exit */
+    uint32_t state;                 /* PT_* */
+    void *(*start_routine)(void *);
+    void *arg;
+    void *result;
+    void *block;                    /* malloc() block (NULL for main) */
+    struct pthread *next;           /* Link in the dead list */
+};
+
+static struct pthread main_thread;
+static int main_thread_ready;
+
+/* malloc() is not thread-safe; thread blocks are allocated under this */
+static pthread_mutex_t block_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Exited detached threads whose blocks have not been freed yet */
+static struct pthread *dead_list;
+
+/* Give the main thread a control block the first time one is needed */
+static void pthread_init_main(void)
+{
+    if (main_thread_ready) {
+        return;
+    }
+
+    main_thread.self = &main_thread;
+    main_thread.tid = (uint32_t)getpid();
+    main_thread.state = PT_JOINABLE;
+    set_tls(&main_thread);
+    main_thread_ready = 1;
+}
+
+/* Free dead detached threads that the kernel has finished with */
+static void pthread_reap_dead(void)
+{
+    struct pthread **link;
+
+    pthread_mutex_lock(&block_lock);
+    link = &dead_list;
+    while (*link) {
+        struct pthread *pt = *link;
+
+        if (__atomic_load_n(&pt->tid, __ATOMIC_ACQUIRE) == 0) {
+            *link = pt->next;
+            free(pt->block);
+        } else {
+            link = &pt->next;
+        }
+    }
+    pthread_mutex_unlock(&block_lock);
+}
+
+static void pthread_bury(struct pthread *pt)
+{
+    pthread_mutex_lock(&block_lock);
+    pt->next = dead_list;
+    dead_list = pt;
+    pthread_mutex_unlock(&block_lock);
+}
+
+static void pthread_entry(void *arg)
+{
+    struct pthread *self = arg;
+
+    pthread_exit(self->start_routine(self->arg));
+}
+
+int pthread_attr_init(pthread_attr_t *attr)
+{
+    attr->stacksize = PTHREAD_STACK_DEFAULT;
+    attr->detachstate = PTHREAD_CREATE_JOINABLE;
+    return 0;
+}
+
+int pthread_attr_destroy(pthread_attr_t *attr)
+{
+    (void)attr;
+    return 0;
+}
+
+int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize)
+{
+    if (stacksize < PTHREAD_STACK_MIN) {
+        return EINVAL;
+    }
+    attr->stacksize = stacksize;
+    return 0;
+}
+
+int pthread_attr_getstacksize(const pthread_attr_t *attr, size_t *stacksize)
+{
+    *stacksize = attr->stacksize;
+    return 0;
+}
+
+int pthread_attr_setdetachstate(pthread_attr_t *attr, int detachstate)
+{
+    if (detachstate != PTHREAD_CREATE_JOINABLE &&
+        detachstate != PTHREAD_CREATE_DETACHED) {
+        return EINVAL;
+    }
+    attr->detachstate = detachstate;
+    return 0;
+}
+
+int pthread_attr_getdetachstate(const pthread_attr_t *attr, int *detachstate)
+{
+    *detachstate = attr->detachstate;
+    return 0;
+}
+
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                   void *(*start_routine)(void *), void *arg)
+{
+    pthread_attr_t defaults;
+    struct pthread *pt;
+    uintptr_t stack_top;
+    void *block;
+    int tid;
+
+    if (!thread || !start_routine) {
+        return EINVAL;
+    }
+    if (!attr) {
+        pthread_attr_init(&defaults);
+        attr = &defaults;
+    }
+
+    pthread_init_main();
+    pthread_reap_dead();
+
+    /* Stack grows down from the control block at the top of the block */
+    size_t stack_size = (attr->stacksize + 15) & ~(size_t)15;
+
+    pthread_mutex_lock(&block_lock);
+    block = malloc(stack_size + sizeof(*pt));
+    pthread_mutex_unlock(&block_lock);
+    if (!block) {
+        return EAGAIN;
+    }
+
+    pt = (struct pthread *)((char *)block + stack_size);
+    pt->self = pt;
+    pt->tid = 0;
+    pt->state = attr->detachstate == PTHREAD_CREATE_DETACHED ?
+                PT_DETACHED : PT_JOINABLE;
+    pt->start_routine = start_routine;
+    pt->arg = arg;
+    pt->result = NULL;
+    pt->block = block;
+    pt->next = NULL;
+
+    /* Entry sees the stack as if called: RSP + 8 is 16-byte aligned */
+    stack_top = ((uintptr_t)pt & ~(uintptr_t)15) - 8;
+
+    tid = thread_create(pthread_entry, pt, (void *)stack_top, pt, &pt->tid);
+    if (tid < 0) {
+        pthread_mutex_lock(&block_lock);
+        free(block);
+        pthread_mutex_unlock(&block_lock);
+        return tid == -ENOMEM ? EAGAIN : -tid;
+    }
+
+    *thread = pt;
+    return 0;
+}
+
+int pthread_join(pthread_t thread, void **retval)
+{
+    if (!thread || thread->state == PT_DETACHED) {
+        return EINVAL;
+    }
+    if (thread == pthread_self()) {
+        return EDEADLK;
+    }
+
+    /* The kernel zeroes tid and wakes us once the thread is gone */
+    uint32_t tid;
+    while ((tid = __atomic_load_n(&thread->tid, __ATOMIC_ACQUIRE)) != 0) {
+        futex(&thread->tid, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, tid);
+    }
+
+    if (retval) {
+        *retval = thread->result;
+    }
+
+    pthread_mutex_lock(&block_lock);
+    free(thread->block);
+    pthread_mutex_unlock(&block_lock);
+    return 0;
+}
+
+int pthread_detach(pthread_t thread)
+{
+    if (!thread || thread == &main_thread) {
+        return EINVAL;
+    }
+
+    uint32_t old = __atomic_exchange_n(&thread->state, PT_DETACHED,
+                                       __ATOMIC_ACQ_REL);
+    if (old == PT_DETACHED) {
+        return EINVAL;
+    }
+    if (old == PT_EXITED) {
+        pthread_bury(thread);
+    }
+
+    pthread_reap_dead();
+    return 0;
+}
+
+void pthread_exit(void *retval)
+{
+    struct pthread *self = pthread_self();
+
+    self->result = retval;
+
+    /* A detached thread cannot free its own stack; leave it for later */
+    if (__atomic_exchange_n(&self->state, PT_EXITED,
+                            __ATOMIC_ACQ_REL) == PT_DETACHED) {
+        pthread_bury(self);
+    }
+
+    thread_exit(0);
+}
+
+pthread_t pthread_self(void)
+{
+    struct pthread *self;
+
+    /* Only the main thread can run before the first pthread_create */
+    if (!main_thread_ready) {
+        pthread_init_main();
+    }
+
+    __asm__ volatile("mov %%fs:0, %0" : "=r"(self));
+    return self;
+}
+
+int pthread_equal(pthread_t t1, pthread_t t2)
+{
+    return t1 == t2;
+}
+
+/*
+ * Mutexes and condition variables are the futex-backed ones from
+ * <ocean/sync.h>.
+ */
+
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
+{
+    (void)attr;
+    mutex->state = 0;
+    return 0;
+}
+
+int pthread_mutex_destroy(pthread_mutex_t *mutex)
+{
+    return mutex->state ? EBUSY : 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    ocean_mutex_lock(mutex);
+    return 0;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex)
+{
+    return ocean_mutex_trylock(mutex) ? 0 : EBUSY;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *mutex)
+{
+    ocean_mutex_unlock(mutex);
+    return 0;
+}
+
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr)
+{
+    (void)attr;
+    cond->seq = 0;
+    cond->waiters = 0;
+    return 0;
+}
+
+int pthread_cond_destroy(pthread_cond_t *cond)
+{
+    return cond->waiters ? EBUSY : 0;
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    ocean_cond_wait(cond, mutex);
+    return 0;
+}
+
+int pthread_cond_signal(pthread_cond_t *cond)
+{
+    ocean_cond_signal(cond);
+    return 0;
+}
+
+int pthread_cond_broadcast(pthread_cond_t *cond)
+{
+    ocean_cond_broadcast(cond);
+    return 0;
+}
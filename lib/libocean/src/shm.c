@@ -0,0 +1,55 @@
+/*
+ * Ocean libocean - Named shared memory
+ *
+ * Calls to the memory server's MEM_SHM_* protocol. The name travels
+ * NUL-padded in the last three message words, so no IPC window slice is
+ * needed.
+ */
+
+#include <string.h>
+#include <ocean/shm.h>
+#include <ocean/ipc_proto.h>
+
+static int shm_call(uint64_t label, uint64_t arg, const char *name)
+{
+    uint64_t words[MEM_SHM_NAME_MAX / sizeof(uint64_t)] = { 0 };
+    size_t len = strlen(name);
+
+    if (len == 0 || len >= MEM_SHM_NAME_MAX) {
+        return -E_INVAL;
+    }
+    memcpy(words, name, len);
+
+    struct ipc_call_frame frame = {
+        .tag = IPC_MAKE_TAG(label, 4, 0, 0),
+        .r1 = arg,
+        .r2 = words[0],
+        .r3 = words[1],
+        .r4 = words[2],
+    };
+
+    if (ipc_call(EP_MEM, &frame) < 0) {
+        return -E_NODEV;
+    }
+    if (IPC_TAG_FLAGS(frame.tag) & IPC_FLAG_ERROR) {
+        return -(int)IPC_TAG_ERROR(frame.tag);
+    }
+    return (int)frame.r1;
+}
+
+int shm_create_named(const char *name, uint64_t pages)
+{
+    return shm_call(MEM_SHM_CREATE, pages, name);
+}
+
+int shm_open_named(const char *name, uint32_t rights)
+{
+    return shm_call(MEM_SHM_OPEN, rights, name);
+}
+
+int shm_unlink_named(const char *name)
+{
+    int err = shm_call(MEM_SHM_UNLINK, 0, name);
+
+    return err < 0 ? err : 0;
+}
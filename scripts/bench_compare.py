@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Compare Ocean benchmark results with a checked-in baseline.
+
+Usage: scripts/bench_compare.py [--baseline FILE] build/bench/run-*.log
+       scripts/bench_compare.py --update build/bench/run-*.log
+
+Every log is scanned for `BENCH <name> <value> <unit>` lines; a metric seen
+in several logs (or several times in one) is reduced to its median. Each
+baseline metric has a value and an optional tolerance_pct (falling back to
+the file's default). Units ending in /s are higher-is-better, everything
+else (cycles/op, cycles/page, ...) lower-is-better, unless the metric sets
+higher_is_better. A baseline metric whose value is null has never been
+recorded; it is reported but cannot catch a regression. Exits 1 if any
+metric regressed past its tolerance, without --allow-missing is missing
+from the logs, or with --require-recorded has no recorded baseline value.
+"""
+
+import argparse
+import collections
+import json
+import os
+import re
+import statistics
+import sys
+
+BENCH_RE = re.compile(r"BENCH (\S+) (\d+) (\S+)")
+
+DEFAULT_BASELINE = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "bench-baseline.json")
+DEFAULT_TOLERANCE_PCT = 10.0
+
+
+def parse(paths):
+    samples = collections.defaultdict(list)
+    units = {}
+    for path in paths:
+        with open(path, errors="replace") as f:
+            for line in f:
+                m = BENCH_RE.search(line)
+                if m:
+                    samples[m.group(1)].append(int(m.group(2)))
+                    units[m.group(1)] = m.group(3)
+    return {name: (statistics.median(vals), units[name])
+            for name, vals in samples.items()}
+
+
+def higher_is_better(unit):
+    return unit.endswith("/s")
+
+
+def compare(results, baseline, allow_missing, require_recorded):
+    default_tol = baseline.get("tolerance_pct", DEFAULT_TOLERANCE_PCT)
+    metrics = baseline.get("metrics", {})
+    failed = False
+    unrecorded = 0
+
+    print(f"{'METRIC':<32} {'BASELINE':>12} {'CURRENT':>12} {'DELTA':>8}  STATUS")
+    for name in sorted(set(metrics) | set(results)):
+        spec = metrics.get(name)
+        if name not in results:
+            print(f"{name:<32} {'':>12} {'-':>12} {'':>8}  MISSING")
+            failed = failed or not allow_missing
+            continue
+
+        value, unit = results[name]
+        if not spec:
+            print(f"{name:<32} {'-':>12} {value:>12.0f} {'':>8}  NEW ({unit})")
+            continue
+        if spec.get("value") is None:
+            print(f"{name:<32} {'null':>12} {value:>12.0f} {'':>8}  UNRECORDED")
+            unrecorded += 1
+            failed = failed or require_recorded
+            continue
+
+        base = spec["value"]
+        tol = spec.get("tolerance_pct", default_tol)
+        delta = (value - base) * 100.0 / base if base else 0.0
+        worse = -delta if spec.get("higher_is_better", higher_is_better(unit)) else delta
+
+        if worse > tol:
+            status = f"REGRESSED (> {tol:g}%)"
+            failed = True
+        elif worse < -tol:
+            status = "IMPROVED"
+        else:
+            status = "ok"
+        print(f"{name:<32} {base:>12.0f} {value:>12.0f} {delta:>+7.1f}%  {status}")
+
+    if unrecorded:
+        print(f"warning: {unrecorded} baseline metric(s) have no recorded value "
+              "and were not checked; run `make bench-update` and commit "
+              "scripts/bench-baseline.json", file=sys.stderr)
+    return failed
+
+
+def update(results, baseline, path):
+    metrics = baseline.setdefault("metrics", {})
+    for name, (value, unit) in sorted(results.items()):
+        spec = metrics.setdefault(name, {})
+        spec["value"] = int(value)
+        spec["unit"] = unit
+    baseline["metrics"] = dict(sorted(metrics.items()))
+    with open(path, "w") as f:
+        json.dump(baseline, f, indent=2)
+        f.write("\n")
+    print(f"Recorded {len(results)} metrics in {path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("logs", nargs="+", help="serial logs from bench runs")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE,
+                        help="baseline JSON (default: scripts/bench-baseline.json)")
+    parser.add_argument("--update", action="store_true",
+                        help="write the results into the baseline instead of comparing")
+    parser.add_argument("--allow-missing", action="store_true",
+                        help="do not fail on baseline metrics absent from the logs")
+    parser.add_argument("--require-recorded", action="store_true",
+                        help="fail on baseline metrics whose value is null")
+    opts = parser.parse_args()
+
+    results = parse(opts.logs)
+    if not results:
+        print("error: no BENCH lines found", file=sys.stderr)
+        return 1
+
+    try:
+        with open(opts.baseline) as f:
+            baseline = json.load(f)
+    except FileNotFoundError:
+        baseline = {"tolerance_pct": DEFAULT_TOLERANCE_PCT, "metrics": {}}
+
+    if opts.update:
+        update(results, baseline, opts.baseline)
+        return 0
+
+    if compare(results, baseline, opts.allow_missing, opts.require_recorded):
+        print("Bench check failed: regressions, missing or unrecorded metrics")
+        return 1
+    print("Bench check passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Symbolize an Ocean `profile dump` into folded stacks for flame graphs.
+
+Usage: scripts/prof2folded.py build/qemu-smoke.log > profile.folded
+       flamegraph.pl profile.folded > profile.svg
+
+Kernel samples are symbolized against build/kernel.elf. User samples are
+matched to an ELF by process name: `sh` or `/boot/sh.elf` both resolve to
+build/sh.elf. Use --elf NAME=PATH for anything the lookup misses. Each
+stack is rooted at the process name, so one graph shows every process.
+"""
+
+import argparse
+import bisect
+import collections
+import os
+import re
+import subprocess
+import sys
+
+SAMPLE_RE = re.compile(
+    r"PROF (\d+) (\d+) (\d+) (\S+) (\d+) (0x[0-9a-fA-F]+)((?: 0x[0-9a-fA-F]+)*)")
+LOST_RE = re.compile(r"PROF-LOST (\d+) (\d+)")
+NM_RE = re.compile(r"^([0-9a-fA-F]+) [TtWw] (\S+)$")
+
+DEFAULT_BUILD_DIR = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "build")
+
+
+class SymbolTable:
+    """Address -> function name for one ELF, from `nm -n`."""
+
+    def __init__(self, path):
+        self.path = path
+        self.addrs = []
+        self.names = []
+        try:
+            out = subprocess.run(["nm", "-n", "--defined-only", path],
+                                 capture_output=True, text=True, check=True).stdout
+        except (OSError, subprocess.CalledProcessError) as err:
+            print(f"warning: cannot read symbols from {path}: {err}", file=sys.stderr)
+            return
+        for line in out.splitlines():
+            m = NM_RE.match(line)
+            if m:
+                self.addrs.append(int(m.group(1), 16))
+                self.names.append(m.group(2))
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return None
+        return self.names[i]
+
+
+class Symbolizer:
+    def __init__(self, build_dir, kernel_elf, overrides):
+        self.build_dir = build_dir
+        self.kernel = SymbolTable(kernel_elf)
+        self.overrides = overrides
+        self.user = {}
+
+    def elf_for(self, comm):
+        if comm in self.overrides:
+            return self.overrides[comm]
+        base = os.path.basename(comm)
+        if base.endswith(".elf"):
+            base = base[:-4]
+        for candidate in (f"{base}.elf", base):
+            path = os.path.join(self.build_dir, candidate)
+            if os.path.isfile(path):
+                return path
+        return None
+
+    def table_for(self, comm):
+        if comm not in self.user:
+            path = self.elf_for(comm)
+            self.user[comm] = SymbolTable(path) if path else None
+            if not path:
+                print(f"warning: no ELF for process '{comm}'", file=sys.stderr)
+        return self.user[comm]
+
+    def name(self, table, addr):
+        sym = table.lookup(addr) if table else None
+        return sym if sym else hex(addr)
+
+
+def parse(lines):
+    samples = []
+    for line in lines:
+        m = LOST_RE.search(line)
+        if m:
+            print(f"warning: CPU {m.group(1)} dropped {m.group(2)} samples",
+                  file=sys.stderr)
+            continue
+        m = SAMPLE_RE.search(line)
+        if not m:
+            continue
+        samples.append({
+            "pid": int(m.group(2)),
+            "comm": m.group(4),
+            "cpl": int(m.group(5)),
+            "rip": int(m.group(6), 16),
+            "frames": [int(a, 16) for a in m.group(7).split()],
+        })
+    return samples
+
+
+def fold(samples, symbolizer):
+    stacks = collections.Counter()
+    for s in samples:
+        if s["cpl"] == 0:
+            table, root = symbolizer.kernel, f"{s['comm']} [kernel]"
+        else:
+            table, root = symbolizer.table_for(s["comm"]), s["comm"]
+
+        # Return addresses point after the call; look up the call itself
+        leaf = [symbolizer.name(table, s["rip"])]
+        callers = [symbolizer.name(table, addr - 1) for addr in s["frames"]]
+        frames = [root] + list(reversed(callers)) + leaf
+        stacks[";".join(f.replace(";", ":") for f in frames)] += 1
+    return stacks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    parser.add_argument("--build-dir", default=DEFAULT_BUILD_DIR,
+                        help="directory holding kernel.elf and the user ELFs")
+    parser.add_argument("--kernel", help="kernel ELF (default: BUILD_DIR/kernel.elf)")
+    parser.add_argument("--elf", action="append", default=[], metavar="NAME=PATH",
+                        help="ELF to use for process NAME (repeatable)")
+    opts = parser.parse_args()
+
+    overrides = {}
+    for spec in opts.elf:
+        name, sep, path = spec.partition("=")
+        if not sep:
+            parser.error(f"--elf expects NAME=PATH, got '{spec}'")
+        overrides[name] = path
+
+    if opts.log:
+        with open(opts.log, errors="replace") as f:
+            samples = parse(f)
+    else:
+        samples = parse(sys.stdin)
+
+    kernel_elf = opts.kernel or os.path.join(opts.build_dir, "kernel.elf")
+    stacks = fold(samples, Symbolizer(opts.build_dir, kernel_elf, overrides))
+
+    out = open(opts.output, "w") if opts.output else sys.stdout
+    for stack, count in sorted(stacks.items()):
+        out.write(f"{stack} {count}\n")
+    print(f"{len(samples)} samples -> {len(stacks)} stacks", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Boot a benchmark ISO (init runs `bench` instead of the shell), collect the
+# BENCH lines from serial and compare them with the checked-in baseline.
+#
+#   BENCH_ARGS       suite and iterations passed to bench (default: all)
+#   BENCH_RUNS       boots to run; the comparison uses the median (default: 3)
+#   ICOUNT           QEMU -icount setting, or "off" for wall-clock TSC
+#                    (default: shift=0, one virtual ns per instruction)
+#   BASELINE         baseline JSON (default: scripts/bench-baseline.json)
+#   BENCH_UPDATE=1   record the results as the new baseline instead
+#   BENCH_REQUIRE_RECORDED=1
+#                    fail metrics whose baseline value is still null
+
+ISO_ROOT="${ISO_ROOT:-build/iso_root}"
+BENCH_ISO="${BENCH_ISO:-build/ocean-bench.iso}"
+LOG_DIR="${1:-build/bench}"
+BENCH_ARGS="${BENCH_ARGS:-all}"
+BENCH_RUNS="${BENCH_RUNS:-3}"
+ICOUNT="${ICOUNT:-shift=0}"
+BASELINE="${BASELINE:-scripts/bench-baseline.json}"
+TIMEOUT_SECONDS="${TIMEOUT_SECONDS:-300}"
+
+if [ ! -d "$ISO_ROOT/boot" ]; then
+  echo "Bench failed: $ISO_ROOT not found (build the ISO first)"
+  exit 1
+fi
+
+# Same tree as the normal ISO. The boot configuration is the ISO's own
+# limine.conf with no menu delay and init told to run bench instead of the
+# shell (init takes its argv from its module command line).
+BENCH_ROOT="$(dirname "$BENCH_ISO")/bench_iso_root"
+rm -rf "$BENCH_ROOT"
+cp -r "$ISO_ROOT" "$BENCH_ROOT"
+if ! grep -q "^ *module_cmdline: /boot/init.elf$" "$ISO_ROOT/boot/limine.conf"; then
+  echo "Bench failed: no init module_cmdline in $ISO_ROOT/boot/limine.conf"
+  exit 1
+fi
+sed -e "s|^timeout:.*|timeout: 0|" \
+    -e "s|^\( *module_cmdline: /boot/init.elf\)$|\1 bench $BENCH_ARGS|" \
+  "$ISO_ROOT/boot/limine.conf" >"$BENCH_ROOT/boot/limine.conf"
+
+xorriso -as mkisofs -b boot/limine-bios-cd.bin \
+  -no-emul-boot -boot-load-size 4 -boot-info-table \
+  --efi-boot boot/limine-uefi-cd.bin \
+  -efi-boot-part --efi-boot-image --protective-msdos-label \
+  "$BENCH_ROOT" -o "$BENCH_ISO" 2>/dev/null
+if command -v limine >/dev/null 2>&1; then
+  limine bios-install "$BENCH_ISO" 2>/dev/null || true
+elif [ -x limine/limine ]; then
+  ./limine/limine bios-install "$BENCH_ISO" 2>/dev/null || true
+fi
+
+mkdir -p "$LOG_DIR"
+logs=()
+
+for run in $(seq 1 "$BENCH_RUNS"); do
+  log_file="$LOG_DIR/run-${run}.log"
+  : >"$log_file"
+  logs+=("$log_file")
+  echo "[bench] run $run/$BENCH_RUNS: bench $BENCH_ARGS (icount: $ICOUNT)"
+
+  QEMU_CMD=(
+    qemu-system-x86_64
+    -cdrom "$BENCH_ISO"
+    -serial "file:$log_file"
+    -display none
+    -m 256M
+    -smp 1
+    -no-reboot
+    -no-shutdown
+  )
+  if [ "$ICOUNT" != "off" ]; then
+    QEMU_CMD+=(-icount "$ICOUNT")
+  fi
+
+  "${QEMU_CMD[@]}" &
+  QEMU_PID=$!
+
+  deadline=$((SECONDS + TIMEOUT_SECONDS))
+  while (( SECONDS < deadline )); do
+    if grep -q "BENCH-DONE" "$log_file" ||
+       grep -Eq "panic|System halted" "$log_file"; then
+      break
+    fi
+    sleep 1
+  done
+
+  kill "$QEMU_PID" 2>/dev/null || true
+  wait "$QEMU_PID" 2>/dev/null || true
+
+  if ! grep -q "BENCH-DONE 0" "$log_file"; then
+    echo "Bench failed: run $run did not finish cleanly (see $log_file)"
+    grep -nE "BENCH-DONE|bench:|panic|System halted" "$log_file" || true
+    exit 1
+  fi
+done
+
+COMPARE=(python3 scripts/bench_compare.py --baseline "$BASELINE")
+if [ "${BENCH_UPDATE:-0}" = "1" ]; then
+  COMPARE+=(--update)
+fi
+if [ "$BENCH_ARGS" != "all" ]; then
+  COMPARE+=(--allow-missing)
+fi
+if [ "${BENCH_REQUIRE_RECORDED:-0}" = "1" ]; then
+  COMPARE+=(--require-recorded)
+fi
+
+"${COMPARE[@]}" "${logs[@]}"
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Convert an Ocean serial log containing a `trace dump` into Chrome trace JSON.
+
+Usage: scripts/trace2chrome.py build/qemu-smoke.log > trace.json
+
+Open the result in chrome://tracing or https://ui.perfetto.dev. Each thread
+gets a track. Time spent on the CPU and inside syscalls become slices, and
+every other event becomes an instant marker carrying its arguments.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+RECORD_RE = re.compile(r"TRACE (\d+) (\d+) (\d+) (\w+)((?: \w+=0x[0-9a-fA-F]+)*)")
+CLOCK_RE = re.compile(r"TRACE-CLOCK (-?\d+)")
+LOST_RE = re.compile(r"TRACE-LOST (\d+) (\d+)")
+SYSCALL_RE = re.compile(r"#define\s+SYS_(\w+)\s+(\d+)")
+
+# Arguments that hold signed values (negative errno and IPC results)
+SIGNED_ARGS = {"ret", "result"}
+
+DEFAULT_SYSCALL_HEADER = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)),
+    "..", "lib", "libocean", "include", "ocean", "syscall.h")
+
+
+def load_syscall_names(path):
+    names = {}
+    try:
+        with open(path) as f:
+            for line in f:
+                m = SYSCALL_RE.match(line)
+                if m and m.group(1) != "NR":
+                    names.setdefault(int(m.group(2)), m.group(1).lower())
+    except OSError:
+        pass
+    return names
+
+
+def to_signed(value):
+    return value - (1 << 64) if value >= 1 << 63 else value
+
+
+def parse(lines):
+    tsc_hz = 0
+    records = []
+    for line in lines:
+        m = CLOCK_RE.search(line)
+        if m:
+            tsc_hz = int(m.group(1))
+            continue
+        m = LOST_RE.search(line)
+        if m:
+            print(f"warning: CPU {m.group(1)} lost {m.group(2)} records",
+                  file=sys.stderr)
+            continue
+        m = RECORD_RE.search(line)
+        if not m:
+            continue
+        args = {}
+        for field in m.group(5).split():
+            key, value = field.split("=", 1)
+            value = int(value, 16)
+            args[key] = to_signed(value) if key in SIGNED_ARGS else value
+        records.append({
+            "tsc": int(m.group(1)),
+            "cpu": int(m.group(2)),
+            "tid": int(m.group(3)),
+            "event": m.group(4),
+            "args": args,
+        })
+    records.sort(key=lambda r: r["tsc"])
+    return tsc_hz, records
+
+
+def convert(tsc_hz, records, syscall_names):
+    if not records:
+        return []
+
+    base = records[0]["tsc"]
+    scale = 1e6 / tsc_hz                    # µs per TSC tick
+
+    def ts(rec):
+        return (rec["tsc"] - base) * scale
+
+    events = []
+    seen_tids = set()
+
+    def slice_event(ph, name, tid, when, args=None):
+        seen_tids.add(tid)
+        ev = {"ph": ph, "name": name, "pid": 0, "tid": tid, "ts": when}
+        if args:
+            ev["args"] = args
+        events.append(ev)
+
+    for rec in records:
+        name, args, when = rec["event"], rec["args"], ts(rec)
+
+        if name == "sched_switch":
+            slice_event("E", "running", args["prev"], when)
+            slice_event("B", "running", args["next"], when, {"cpu": rec["cpu"]})
+        elif name == "syscall_enter":
+            nr = args["nr"]
+            slice_event("B", syscall_names.get(nr, f"syscall {nr}"), rec["tid"],
+                        when, {"arg1": hex(args["arg1"]), "arg2": hex(args["arg2"])})
+        elif name == "syscall_exit":
+            slice_event("E", syscall_names.get(args["nr"], f"syscall {args['nr']}"),
+                        rec["tid"], when, {"ret": args["ret"]})
+        else:
+            shown = {k: (v if k in SIGNED_ARGS else hex(v)) for k, v in args.items()}
+            slice_event("i", name, rec["tid"], when, shown)
+            events[-1]["s"] = "t"
+
+    for tid in sorted(seen_tids):
+        events.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": tid,
+                       "args": {"name": f"tid {tid}" if tid else "boot/idle"}})
+    events.append({"ph": "M", "name": "process_name", "pid": 0,
+                   "args": {"name": "ocean"}})
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    parser.add_argument("--tsc-hz", type=int, default=0,
+                        help="override the TSC frequency from TRACE-CLOCK")
+    parser.add_argument("--syscalls", default=DEFAULT_SYSCALL_HEADER,
+                        help="syscall.h used to name syscall numbers")
+    opts = parser.parse_args()
+
+    if opts.log:
+        with open(opts.log, errors="replace") as f:
+            tsc_hz, records = parse(f)
+    else:
+        tsc_hz, records = parse(sys.stdin)
+
+    if opts.tsc_hz:
+        tsc_hz = opts.tsc_hz
+    if tsc_hz <= 0:
+        print("warning: no TSC clock in log, assuming 1 GHz", file=sys.stderr)
+        tsc_hz = 1_000_000_000
+
+    events = convert(tsc_hz, records, load_syscall_names(opts.syscalls))
+    out = open(opts.output, "w") if opts.output else sys.stdout
+    json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, out)
+    out.write("\n")
+    print(f"{len(records)} records -> {len(events)} trace events", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
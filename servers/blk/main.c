@@ -12,6 +12,7 @@
 #include <string.h>
 #include <ocean/syscall.h>
 #include <ocean/ipc_proto.h>
+#include <ocean/service.h>
 
 #define BLK_VERSION "0.1.0"
 #define MAX_DEVICES 16
@@ -305,14 +306,15 @@ static void blk_init(void)
     memset(devices, 0, sizeof(devices));
     memset(partitions, 0, sizeof(partitions));
 
-    blk_endpoint = endpoint_create(0);
+    blk_endpoint = endpoint_create_well_known(EP_BLK, 0);
     if (blk_endpoint < 0) {
-        printf("[blk] Failed to create endpoint\n");
+        printf("[blk] Failed to claim EP_BLK\n");
         return;
     }
-    printf("[blk] Created endpoint %d\n", blk_endpoint);
+    printf("[blk] Serving on endpoint %d\n", blk_endpoint);
 
     printf("[blk] Block server initialized\n");
+    service_ready(EP_BLK);
 }
 
 /*
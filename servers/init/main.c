@@ -6,26 +6,51 @@
  *   - Starting core system servers
  *   - Managing server lifecycle
  *   - Providing a service registry
+ *
+ * Services start in parallel: every service whose needs (well-known
+ * endpoints, see ocean/userspace_manifest.h) are up is spawned at once,
+ * and a service counts as up when it calls INIT_SVC_READY on EP_INIT.
+ * Boot to ready therefore takes as long as the longest chain of needs,
+ * not the sum of all start times.
+ *
+ * A service with a standby (see servers/rs) may be taken over by an
+ * instance init did not start; it is then announced to us again.
+ *
+ * Everything arrives on EP_INIT, which the main thread serves. A reaper
+ * thread blocks in wait() and reports exits with INIT_CHILD_EXIT, so a
+ * service dying before it is ready wakes the main loop like any other
+ * event. The exit itself is passed through a table under reaper_lock;
+ * the message only says to look. While services start, a watchdog thread
+ * wakes the main loop the same way so a service that never says it is
+ * ready fails at its deadline instead of holding up the boot.
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #include <ocean/syscall.h>
 #include <ocean/ipc_proto.h>
 #include <ocean/userspace_manifest.h>
 
 /* Version */
-#define INIT_VERSION "0.3.0"
+#define INIT_VERSION "0.4.0"
 
 /* Maximum services we track */
 #define MAX_SERVICES 16
 
+/* Reaped children the main loop has not picked up yet */
+#define MAX_EXITS 16
+
 /* Service states */
-#define SVC_STOPPED     0
-#define SVC_STARTING    1
-#define SVC_PLANNED     2
-#define SVC_STOPPING    3
-#define SVC_FAILED      4
+#define SVC_STOPPED     0       /* Not started; needs not met yet */
+#define SVC_STARTING    1       /* Spawned, not ready yet */
+#define SVC_RUNNING     2       /* Signalled INIT_SVC_READY */
+#define SVC_EXITED      3       /* Exited after becoming ready */
+#define SVC_FAILED      4       /* Spawn failed, died early, missed its start
+                                   deadline or a need failed */
+
+/* How often the watchdog wakes the main loop while services start */
+#define START_TICK_MS   50
 
 /* Service entry */
 struct service {
@@ -33,17 +58,60 @@ struct service {
     const char *path;           /* Binary path */
     const char *summary;        /* Human-readable description */
     uint32_t    well_known_ep;  /* Well-known endpoint ID */
+    uint32_t    needs;          /* OCEAN_SERVICE_NEEDS() of endpoints */
+    uint32_t    start_timeout_ms; /* Time allowed to become ready */
     int         state;          /* Current state */
     int         pid;            /* Process ID (if running) */
-    int         endpoint;       /* Actual endpoint */
-    int         priority;       /* Start priority (lower = earlier) */
+    int         status;         /* Exit status, once exited */
+    uint64_t    spawn_tsc;      /* When it was spawned */
+    uint64_t    ready_tsc;      /* When INIT_SVC_READY arrived */
+    uint64_t    deadline_tsc;   /* Failed if not ready by then; 0 for none */
+    struct service *gate;       /* The need that came up last */
 };
 
 static struct service services[MAX_SERVICES];
 static int num_services = 0;
 
 static int init_endpoint = -1;
-static int num_planned = 0;
+
+/* Start of the service phase and the TSC rate, for the report */
+static uint64_t boot_tsc = 0;
+static uint64_t tsc_hz = 0;
+
+/* Set while start_all_services runs; the watchdog stops when it clears */
+static int starting_phase = 0;
+
+/* Children the reaper thread collected; guarded by reaper_lock */
+struct child_exit {
+    int pid;
+    int status;
+};
+
+static pthread_mutex_t reaper_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct child_exit exits[MAX_EXITS];
+static int num_exits = 0;
+static int num_spawned = 0;         /* Successful spawns */
+static int reaper_running = 0;
+
+/* The shell or bench run the main loop is waiting for */
+static int fg_pid = -1;
+static int fg_status = 0;
+static int fg_exited = 0;
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* TSC ticks since boot_tsc in microseconds */
+static uint64_t tsc_to_us(uint64_t tsc)
+{
+    uint64_t ticks = tsc - boot_tsc;
+
+    return tsc_hz ? ticks * 1000000 / tsc_hz : ticks;
+}
 
 /*
  * Print startup banner
@@ -76,66 +144,485 @@ static void init_logf(const char *fmt, const char *arg)
 }
 
 /*
- * Start a service
+ * Reaper thread
  *
- * NOTE: In a full implementation, this would:
- * 1. Load the ELF binary from the filesystem
- * 2. Create a new process with its own address space
- * 3. Start the process running
+ * wait() returns -1 at once when there are no children, so the thread
+ * exits then and spawn_child() starts a new one. num_spawned closes the
+ * race with a spawn that lands between that wait() and the exit: if it
+ * moved, there may be a child after all and we wait again.
+ */
+static void *reaper_thread(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&reaper_lock);
+        int seen = num_spawned;
+        pthread_mutex_unlock(&reaper_lock);
+
+        int status = 0;
+        int pid = wait(&status);
+
+        pthread_mutex_lock(&reaper_lock);
+        if (pid < 0) {
+            if (num_spawned == seen) {
+                reaper_running = 0;
+                pthread_mutex_unlock(&reaper_lock);
+                return NULL;
+            }
+            pthread_mutex_unlock(&reaper_lock);
+            continue;
+        }
+
+        while (num_exits == MAX_EXITS) {
+            pthread_mutex_unlock(&reaper_lock);
+            yield();
+            pthread_mutex_lock(&reaper_lock);
+        }
+        exits[num_exits].pid = pid;
+        exits[num_exits].status = status;
+        num_exits++;
+        pthread_mutex_unlock(&reaper_lock);
+
+        if (init_endpoint >= 0) {
+            ipc_send((uint32_t)init_endpoint,
+                     IPC_MAKE_TAG(INIT_CHILD_EXIT, 0, 0, 0), 0, 0, 0, 0);
+        }
+    }
+}
+
+/*
+ * Spawn a privileged child and make sure someone will reap it
+ */
+static int spawn_child(const char *path, char *const argv[])
+{
+    int pid = spawn(path, argv, NULL, 0, SPAWN_PRIVILEGED);
+    if (pid < 0) {
+        return pid;
+    }
+
+    pthread_mutex_lock(&reaper_lock);
+    num_spawned++;
+    if (!reaper_running) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, reaper_thread, NULL) == 0) {
+            pthread_detach(thread);
+            reaper_running = 1;
+        } else {
+            init_log("Failed to start reaper thread");
+        }
+    }
+    pthread_mutex_unlock(&reaper_lock);
+
+    return pid;
+}
+
+static struct service *find_service_by_pid(int pid)
+{
+    for (int i = 0; i < num_services; i++) {
+        if (services[i].pid == pid &&
+            (services[i].state == SVC_STARTING ||
+             services[i].state == SVC_RUNNING)) {
+            return &services[i];
+        }
+    }
+    return NULL;
+}
+
+static struct service *find_service_by_ep(uint32_t ep)
+{
+    for (int i = 0; i < num_services; i++) {
+        if (services[i].well_known_ep == ep) {
+            return &services[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Start a service
  *
- * Today we only record the boot plan honestly. The server binaries are built,
- * but they are not spawned here because only boot modules can currently be
- * exec'd through the kernel bootstrap path.
+ * Loads the ELF from its boot module. The service is up once it says so
+ * with INIT_SVC_READY.
  */
 static int start_service(struct service *svc)
 {
-    if (!svc || svc->state == SVC_PLANNED) {
+    char *argv[] = { (char *)svc->name, NULL };
+
+    svc->spawn_tsc = rdtsc();
+
+    int pid = spawn_child(svc->path, argv);
+    if (pid < 0) {
+        printf("[init] spawn %s failed: %s (%d)\n", svc->name, svc->path, pid);
+        svc->state = SVC_FAILED;
         return -1;
     }
 
-    init_logf("Planning service: %s", svc->name);
+    svc->pid = pid;
     svc->state = SVC_STARTING;
-    svc->state = SVC_PLANNED;
-    num_planned++;
-
-    printf("[init] Service '%s' remains planned only; spawn path is not wired up yet\n",
-           svc->name);
+    /* Only the watchdog gets a deadline noticed without an event */
+    svc->deadline_tsc = __atomic_load_n(&starting_phase, __ATOMIC_ACQUIRE) ?
+        svc->spawn_tsc + (uint64_t)svc->start_timeout_ms * tsc_hz / 1000 : 0;
+    printf("[init] Started %s (PID %d)\n", svc->name, pid);
 
     return 0;
 }
 
-/*
- * Start all services in priority order
- */
-static void start_all_services(void)
+/* What stands between svc and its start */
+#define NEEDS_MET       0
+#define NEEDS_WAITING   1
+#define NEEDS_FAILED    2
+
+static int check_needs(struct service *svc)
 {
-    init_log("Starting core services...");
+    int result = NEEDS_MET;
 
-    /* Find maximum priority */
-    int max_priority = 0;
-    for (int i = 0; i < num_services; i++) {
-        if (services[i].priority > max_priority) {
-            max_priority = services[i].priority;
+    svc->gate = NULL;
+    for (uint32_t ep = EP_WKE_MIN; ep <= EP_WKE_MAX; ep++) {
+        if (!(svc->needs & OCEAN_SERVICE_NEEDS(ep))) {
+            continue;
+        }
+
+        struct service *provider = find_service_by_ep(ep);
+        if (!provider || provider->state == SVC_FAILED) {
+            printf("[init] %s: nothing serves endpoint %u\n", svc->name, ep);
+            return NEEDS_FAILED;
+        }
+        if (!provider->ready_tsc) {
+            result = NEEDS_WAITING;
+        } else if (!svc->gate || provider->ready_tsc > svc->gate->ready_tsc) {
+            svc->gate = provider;
         }
     }
 
-    /* Start services in priority order */
-    for (int prio = 0; prio <= max_priority; prio++) {
-        printf("[init] === Priority level %d ===\n", prio);
+    return result;
+}
+
+/*
+ * Start every stopped service whose needs are up, and fail the ones
+ * whose needs never will be
+ */
+static void start_ready_services(void)
+{
+    int progress = 1;
+
+    /* A failure can doom services earlier in the table */
+    while (progress) {
+        progress = 0;
 
         for (int i = 0; i < num_services; i++) {
-            if (services[i].priority == prio) {
-                start_service(&services[i]);
+            struct service *svc = &services[i];
+
+            if (svc->state != SVC_STOPPED) {
+                continue;
+            }
 
-                /* Give service time to initialize */
-                for (int j = 0; j < 5; j++) {
-                    yield();
+            switch (check_needs(svc)) {
+            case NEEDS_MET:
+                if (start_service(svc) < 0) {
+                    progress = 1;
                 }
+                break;
+            case NEEDS_FAILED:
+                svc->state = SVC_FAILED;
+                progress = 1;
+                break;
+            default:
+                break;
             }
         }
     }
+}
+
+/* Is caller the running rs, which reports the standbys that take over? */
+static int is_rs(int caller)
+{
+    struct service *rs = find_service_by_ep(EP_RS);
+
+    return rs && rs->state == SVC_RUNNING && rs->pid == caller;
+}
+
+/*
+ * Handle INIT_SVC_READY. caller is the PID the kernel gives for the
+ * sender; only rs may announce a PID other than its own.
+ */
+static int service_up(int caller, uint64_t pid, uint64_t ep)
+{
+    struct service *svc;
+
+    if (caller < 0) {
+        return E_NOENT;
+    }
+    if ((int)pid != caller && !is_rs(caller)) {
+        return E_PERM;
+    }
+
+    svc = find_service_by_pid((int)pid);
+    if (!svc) {
+        /* A standby rs started has taken over from the instance we did */
+        svc = ep && is_rs(caller) ? find_service_by_ep((uint32_t)ep) : NULL;
+        if (!svc || !svc->ready_tsc || svc->state == SVC_FAILED) {
+            return E_NOENT;
+        }
+        printf("[init] %s taken over by PID %llu\n", svc->name,
+               (unsigned long long)pid);
+        svc->pid = (int)pid;
+        svc->state = SVC_RUNNING;
+        return E_OK;
+    }
+    if (svc->state != SVC_STARTING) {
+        return E_NOENT;
+    }
+    if (ep != svc->well_known_ep) {
+        printf("[init] %s announced endpoint %llu, expected %u\n",
+               svc->name, (unsigned long long)ep, svc->well_known_ep);
+        svc->state = SVC_FAILED;
+        return E_INVAL;
+    }
 
-    printf("[init] Core service plan recorded (%d planned, 0 spawned)\n", num_planned);
+    svc->ready_tsc = rdtsc();
+    svc->state = SVC_RUNNING;
+    printf("[init] %s ready after %llu us\n", svc->name,
+           (unsigned long long)(tsc_to_us(svc->ready_tsc) -
+                                tsc_to_us(svc->spawn_tsc)));
+    return E_OK;
+}
+
+/*
+ * Record a child the reaper collected
+ */
+static void child_exited(int pid, int status)
+{
+    struct service *svc = find_service_by_pid(pid);
+
+    if (svc) {
+        svc->status = status;
+        if (svc->state == SVC_STARTING) {
+            printf("[init] %s exited with status %d before it was ready\n",
+                   svc->name, status);
+            svc->state = SVC_FAILED;
+        } else if (svc->state != SVC_FAILED) {
+            svc->state = SVC_EXITED;
+        }
+    } else if (pid == fg_pid) {
+        fg_status = status;
+        fg_exited = 1;
+    }
+}
+
+/*
+ * Handle one event: a message on EP_INIT, then whatever the reaper has
+ */
+static void serve_one(void)
+{
+    struct child_exit batch[MAX_EXITS];
+    int count;
+
+    if (init_endpoint < 0) {
+        /* No endpoint to sleep on; poll the reaper instead */
+        yield();
+    } else {
+        uint64_t tag, r1, r2, r3, r4;
+        int err = E_OK;
+
+        if (ipc_recv((uint32_t)init_endpoint, &tag, &r1, &r2, &r3, &r4) < 0) {
+            init_log("Receive on init endpoint failed");
+            yield();
+            return;
+        }
+
+        switch (IPC_TAG_LABEL(tag)) {
+        case INIT_SVC_READY:
+            err = service_up(ipc_caller_pid(), r1, r2);
+            break;
+        case INIT_CHILD_EXIT:
+            /* The exit itself is in the table */
+            break;
+        case INIT_START_TICK:
+            /* services_starting() checks the deadlines */
+            break;
+        default:
+            err = E_NOSYS;
+            break;
+        }
+
+        /* Sends have no caller, and that is harmless */
+        ipc_reply(IPC_MAKE_REPLY(IPC_TAG_LABEL(tag), 0, err), 0, 0, 0, 0);
+    }
+
+    pthread_mutex_lock(&reaper_lock);
+    count = num_exits;
+    memcpy(batch, exits, (size_t)count * sizeof(batch[0]));
+    num_exits = 0;
+    pthread_mutex_unlock(&reaper_lock);
+
+    for (int i = 0; i < count; i++) {
+        child_exited(batch[i].pid, batch[i].status);
+    }
+}
+
+/*
+ * Is any service still starting? One past its deadline has failed; its
+ * process is left running, but a late INIT_SVC_READY is refused.
+ */
+static int services_starting(void)
+{
+    uint64_t now = rdtsc();
+    int starting = 0;
+
+    for (int i = 0; i < num_services; i++) {
+        struct service *svc = &services[i];
+
+        if (svc->state != SVC_STARTING) {
+            continue;
+        }
+        if (svc->deadline_tsc && now >= svc->deadline_tsc) {
+            printf("[init] %s not ready after %u ms\n",
+                   svc->name, svc->start_timeout_ms);
+            svc->state = SVC_FAILED;
+            continue;
+        }
+        starting = 1;
+    }
+    return starting;
+}
+
+/*
+ * Wake the main loop every START_TICK_MS while services start, so the
+ * deadlines are checked even when no service talks to us. There is no
+ * timed sleep, so it polls the TSC and yields in between.
+ */
+static void *start_watchdog(void *arg)
+{
+    uint64_t period = tsc_hz * START_TICK_MS / 1000;
+    uint64_t next = rdtsc() + period;
+
+    (void)arg;
+
+    while (__atomic_load_n(&starting_phase, __ATOMIC_ACQUIRE)) {
+        if (rdtsc() < next) {
+            yield();
+            continue;
+        }
+        ipc_send((uint32_t)init_endpoint,
+                 IPC_MAKE_TAG(INIT_START_TICK, 0, 0, 0), 0, 0, 0, 0);
+        next = rdtsc() + period;
+    }
+    return NULL;
+}
+
+/*
+ * Print when each service was spawned and ready, and the chain of needs
+ * that decided when the last one came up
+ */
+static void print_start_report(void)
+{
+    struct service *last = NULL;
+    uint64_t serial_us = 0;
+
+    printf("\n[init] Service start times (us since the first spawn):\n");
+    printf("  NAME     SPAWN    READY   STARTUP  GATED BY\n");
+    printf("  -------  -------  -------  -------  --------\n");
+
+    for (int i = 0; i < num_services; i++) {
+        struct service *svc = &services[i];
+
+        if (!svc->ready_tsc) {
+            printf("  %-7s  %-7s  %-7s  %-7s  %s\n", svc->name,
+                   svc->spawn_tsc ? "-" : "never", "-", "-",
+                   svc->state == SVC_FAILED ? "(failed)" : "(not ready)");
+            continue;
+        }
+
+        uint64_t spawn_us = tsc_to_us(svc->spawn_tsc);
+        uint64_t ready_us = tsc_to_us(svc->ready_tsc);
+
+        printf("  %-7s  %7llu  %7llu  %7llu  %s\n", svc->name,
+               (unsigned long long)spawn_us,
+               (unsigned long long)ready_us,
+               (unsigned long long)(ready_us - spawn_us),
+               svc->gate ? svc->gate->name : "-");
+
+        serial_us += ready_us - spawn_us;
+        if (!last || svc->ready_tsc > last->ready_tsc) {
+            last = svc;
+        }
+    }
+
+    if (!last) {
+        printf("\n");
+        return;
+    }
+
+    /* Walk back from the last service to come up */
+    struct service *path[MAX_SERVICES];
+    int depth = 0;
+
+    for (struct service *svc = last; svc && depth < MAX_SERVICES; svc = svc->gate) {
+        path[depth++] = svc;
+    }
+
+    printf("[init] Critical path:");
+    for (int i = depth - 1; i >= 0; i--) {
+        printf(" %s%s", path[i]->name, i ? " ->" : "");
+    }
+    printf(" (%llu us)\n", (unsigned long long)tsc_to_us(last->ready_tsc));
+    printf("[init] Services ready after %llu us; started one by one: %llu us\n\n",
+           (unsigned long long)tsc_to_us(last->ready_tsc),
+           (unsigned long long)serial_us);
+}
+
+/*
+ * Start all services, each as soon as its needs are up
+ */
+static void start_all_services(void)
+{
+    int ready = 0;
+
+    if (init_endpoint < 0) {
+        init_log("No init endpoint; not starting services");
+        return;
+    }
+
+    init_log("Starting core services...");
+
+    int64_t hz = trace_ctl(TRACE_CTL_CLOCK, 0, NULL, 0);
+    tsc_hz = hz > 0 ? (uint64_t)hz : 0;
+    boot_tsc = rdtsc();
+
+    if (tsc_hz) {
+        pthread_t thread;
+
+        __atomic_store_n(&starting_phase, 1, __ATOMIC_RELEASE);
+        if (pthread_create(&thread, NULL, start_watchdog, NULL) == 0) {
+            pthread_detach(thread);
+        } else {
+            __atomic_store_n(&starting_phase, 0, __ATOMIC_RELEASE);
+            init_log("Failed to start watchdog; no start deadlines");
+        }
+    } else {
+        init_log("No TSC rate; no start deadlines");
+    }
+
+    start_ready_services();
+    while (services_starting()) {
+        serve_one();
+        start_ready_services();
+    }
+    __atomic_store_n(&starting_phase, 0, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < num_services; i++) {
+        if (services[i].ready_tsc) {
+            ready++;
+        } else if (services[i].state == SVC_STOPPED) {
+            init_logf("Service '%s' left stopped: its needs never came up",
+                      services[i].name);
+        }
+    }
+
+    printf("[init] Core services started (%d of %d ready)\n", ready, num_services);
+    print_start_report();
 }
 
 /*
@@ -152,8 +639,8 @@ static void print_service_status(void)
         switch (services[i].state) {
             case SVC_STOPPED:  state_str = "stopped";  break;
             case SVC_STARTING: state_str = "starting"; break;
-            case SVC_PLANNED:  state_str = "planned";  break;
-            case SVC_STOPPING: state_str = "stopping"; break;
+            case SVC_RUNNING:  state_str = "running";  break;
+            case SVC_EXITED:   state_str = "exited";   break;
             case SVC_FAILED:   state_str = "FAILED";   break;
             default:           state_str = "unknown";  break;
         }
@@ -168,6 +655,23 @@ static void print_service_status(void)
     printf("\n");
 }
 
+/*
+ * Serve EP_INIT until pid exits; returns its status
+ */
+static int wait_child(int pid)
+{
+    fg_pid = pid;
+    fg_status = 0;
+    fg_exited = 0;
+
+    while (!fg_exited) {
+        serve_one();
+    }
+
+    fg_pid = -1;
+    return fg_status;
+}
+
 /*
  * Spawn the interactive shell
  */
@@ -184,44 +688,59 @@ static int spawn_shell(void)
 
     init_log("Spawning shell...");
 
-    int pid = fork();
+    int pid = spawn_child(shell->path, shell_argv);
     if (pid < 0) {
-        init_log("Failed to fork for shell");
+        printf("[init] spawn shell failed: %s (%d)\n", shell->path, pid);
         return 1;
     }
 
-    if (pid == 0) {
-        execv(shell->path, shell_argv);
-        /* If exec returns, it failed */
-        printf("[init] exec shell failed: %s\n", shell->path);
-        _exit(1);
+    printf("[init] Shell spawned with PID %d\n", pid);
+
+    int status = wait_child(pid);
+    printf("[init] Shell exited with status %d\n", status);
+    return status;
+}
+
+/*
+ * Benchmark boot (init cmdline "/boot/init.elf bench [SUITE [ITERATIONS]]"):
+ * run bench instead of the shell and mark the end of the run on the
+ * console so scripts/qemu_bench.sh knows when to stop QEMU.
+ */
+#define BENCH_MAX_ARGS 4
+
+static int run_bench(int argc, char **argv)
+{
+    const struct ocean_boot_module_spec *bench =
+        ocean_find_boot_module_spec("bench");
+    char *bench_argv[BENCH_MAX_ARGS + 2] = { "bench", "all", NULL };
+    int status = 1;
+
+    for (int i = 2; i < argc && i - 1 <= BENCH_MAX_ARGS; i++) {
+        bench_argv[i - 1] = argv[i];
+        bench_argv[i] = NULL;
     }
 
-    printf("[init] Shell spawned with PID %d\n", pid);
+    if (!bench) {
+        init_log("Bench boot module not found in manifest");
+    } else {
+        int pid = spawn_child(bench->path, bench_argv);
 
-    while (1) {
-        int status = 0;
-        int child_pid = wait(&status);
-        if (child_pid == pid) {
-            printf("[init] Shell exited with status %d\n", status);
-            return status;
+        if (pid < 0) {
+            printf("[init] spawn bench failed: %s (%d)\n", bench->path, pid);
+        } else {
+            status = wait_child(pid);
         }
-        if (child_pid < 0) {
-            init_log("wait() failed while monitoring shell");
-            return 1;
-        }
-        yield();
     }
+
+    printf("BENCH-DONE %d\n", status);
+    return status;
 }
 
 /*
  * Main idle/event loop
  *
- * In a full implementation, this would:
- * - Wait for IPC messages from services
- * - Handle service registration requests
- * - Monitor service health
- * - Restart failed services
+ * Runs the shell, restarting it if it fails. Service messages and exits
+ * keep being handled while it runs.
  */
 static void main_loop(void)
 {
@@ -248,7 +767,6 @@ static void load_service_manifest(void)
 {
     memset(services, 0, sizeof(services));
     num_services = 0;
-    num_planned = 0;
 
     for (size_t i = 0; i < OCEAN_SERVICE_SPEC_COUNT; i++) {
         if (num_services >= MAX_SERVICES) {
@@ -260,10 +778,12 @@ static void load_service_manifest(void)
         services[num_services].path = ocean_service_specs[i].path;
         services[num_services].summary = ocean_service_specs[i].summary;
         services[num_services].well_known_ep = ocean_service_specs[i].well_known_ep;
+        services[num_services].needs = ocean_service_specs[i].needs;
+        services[num_services].start_timeout_ms =
+            ocean_service_specs[i].start_timeout_ms ?
+            ocean_service_specs[i].start_timeout_ms : OCEAN_SERVICE_START_TIMEOUT_MS;
         services[num_services].state = SVC_STOPPED;
         services[num_services].pid = -1;
-        services[num_services].endpoint = -1;
-        services[num_services].priority = ocean_service_specs[i].priority;
         num_services++;
     }
 }
@@ -272,12 +792,12 @@ static void init_init(void)
 {
     load_service_manifest();
 
-    /* Create our IPC endpoint */
-    init_endpoint = endpoint_create(0);
+    /* Services announce themselves on EP_INIT */
+    init_endpoint = endpoint_create_well_known(EP_INIT, 0);
     if (init_endpoint < 0) {
-        init_log("Failed to create init endpoint");
+        init_log("Failed to claim EP_INIT");
     } else {
-        printf("[init] Created init endpoint %d\n", init_endpoint);
+        printf("[init] Serving on endpoint %d\n", init_endpoint);
     }
 }
 
@@ -288,11 +808,11 @@ static void shutdown(void)
 {
     init_log("Initiating shutdown...");
 
-    /* Stop services in reverse priority order */
+    /* There is no way to stop a service yet; say what is left behind */
     for (int i = num_services - 1; i >= 0; i--) {
-        if (services[i].state == SVC_PLANNED) {
-            init_logf("Clearing planned service: %s", services[i].name);
-            services[i].state = SVC_STOPPED;
+        if (services[i].state == SVC_STARTING ||
+            services[i].state == SVC_RUNNING) {
+            init_logf("Leaving service running: %s", services[i].name);
         }
     }
 
@@ -304,9 +824,6 @@ static void shutdown(void)
  */
 int main(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
-
     print_banner();
 
     printf("[init] PID: %d, PPID: %d\n", getpid(), getppid());
@@ -316,7 +833,11 @@ int main(int argc, char **argv)
     start_all_services();
     print_service_status();
 
-    main_loop();
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        run_bench(argc, argv);
+    } else {
+        main_loop();
+    }
 
     shutdown();
 
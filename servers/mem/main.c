@@ -2,37 +2,51 @@
  * Ocean Memory Server
  *
  * Userspace memory management server that handles:
- *   - Physical page allocation tracking
- *   - Virtual memory mapping requests
- *   - Memory grants between processes
+ *   - DMA buffer allocation for drivers (MEM_ALLOC_PHYS, MEM_FREE_PHYS)
+ *   - Named shared memory (MEM_SHM_CREATE, MEM_SHM_OPEN, MEM_SHM_UNLINK)
+ *   - Memory statistics (MEM_QUERY)
  *
- * This server delegates actual memory operations to the kernel
- * via syscalls, but tracks ownership and enforces policy.
+ * The server owns EP_MEM and with it SYS_DMA. The kernel does the
+ * allocation, maps the buffer into the driver whose call is being
+ * answered and keeps it pinned; the server applies the policy (request
+ * size, memory type) and keeps the books. A driver that exits gets its
+ * buffers reclaimed by the kernel without telling us.
+ *
+ * Named shared memory objects belong to this server, so a name stays
+ * valid after its creator exits, until someone unlinks it. The namespace
+ * is open to every client; the kernel enforces the rights each one was
+ * granted when it maps.
+ *
+ * rs runs a second instance as a hot standby. It finds EP_MEM taken and
+ * parks on it until the running server dies, then serves the callers that
+ * were queued. Named objects die with the server that owned them, so the
+ * standby starts with an empty namespace.
  */
 
 #include <stdio.h>
+#include <errno.h>
 #include <string.h>
 #include <ocean/syscall.h>
-
-/* Will use shared protocol definitions once available */
+#include <ocean/dma.h>
+#include <ocean/shm.h>
+#include <ocean/service.h>
+#include <ocean/rs.h>
 #include <ocean/ipc_proto.h>
 
-#define MEM_VERSION "0.1.0"
-#define MAX_ALLOCS  256
+#define MEM_VERSION "0.2.0"
+#define MAX_SHM_NAMES   64
 
-/* Allocation tracking */
-struct mem_alloc {
-    uint64_t phys_addr;     /* Physical address */
-    uint64_t pages;         /* Number of pages */
-    uint32_t owner_pid;     /* Owning process */
-    uint32_t flags;         /* Allocation flags */
+/* Named shared memory objects */
+struct shm_name {
+    char name[MEM_SHM_NAME_MAX];
+    uint32_t id;                    /* 0 = free slot */
+    uint64_t pages;
 };
 
-static struct mem_alloc allocs[MAX_ALLOCS];
-static int num_allocs = 0;
+static struct shm_name shm_names[MAX_SHM_NAMES];
 static int mem_endpoint = -1;
 
-/* Statistics */
+/* Statistics; pages of drivers that exited stay counted */
 static uint64_t total_pages_allocated = 0;
 static uint64_t total_alloc_requests = 0;
 static uint64_t total_free_requests = 0;
@@ -40,165 +54,202 @@ static uint64_t total_free_requests = 0;
 /*
  * Initialize the memory server
  */
-static void mem_init(void)
+static int mem_init(void)
 {
     printf("[mem] Memory Server v%s starting\n", MEM_VERSION);
 
-    /* Initialize allocation table */
-    memset(allocs, 0, sizeof(allocs));
-
-    /* Create our IPC endpoint */
-    mem_endpoint = endpoint_create(0);
+    /* Owning EP_MEM is what lets us hand out DMA memory */
+    mem_endpoint = endpoint_create_well_known(EP_MEM, 0);
     if (mem_endpoint < 0) {
-        printf("[mem] Failed to create endpoint: %d\n", mem_endpoint);
-        return;
+        /* Another instance serves it: stand by for it */
+        printf("[mem] EP_MEM is taken, standing by\n");
+        int err = rs_standby(EP_MEM);
+        if (err < 0) {
+            printf("[mem] Failed to claim EP_MEM: %d\n", err);
+            return -1;
+        }
+        mem_endpoint = EP_MEM;
+        printf("[mem] Took over endpoint %d\n", mem_endpoint);
+        return 0;
     }
-    printf("[mem] Created endpoint %d\n", mem_endpoint);
-
-    /* TODO: Register with init server as EP_MEM */
+    printf("[mem] Serving on endpoint %d\n", mem_endpoint);
 
     printf("[mem] Memory server initialized\n");
+    service_ready(EP_MEM);
+    return 0;
 }
 
-/*
- * Find a free allocation slot
- */
-static int find_free_slot(void)
-{
-    for (int i = 0; i < MAX_ALLOCS; i++) {
-        if (allocs[i].pages == 0) {
-            return i;
-        }
-    }
-    return -1;
-}
-
-/*
- * Find allocation by physical address
- */
-static int find_alloc(uint64_t phys_addr)
+static int errno_to_mem_error(int err)
 {
-    for (int i = 0; i < MAX_ALLOCS; i++) {
-        if (allocs[i].phys_addr == phys_addr && allocs[i].pages > 0) {
-            return i;
-        }
+    switch (err) {
+    case -ENOMEM: return E_NOMEM;
+    case -ENOSPC: return E_NOMEM;
+    case -ENOENT: return E_NOENT;
+    case -EBUSY:  return E_BUSY;
+    case -EPERM:  return E_PERM;
+    case -EFAULT: return E_FAULT;
+    case -EACCES: return E_PERM;
+    default:      return E_INVAL;
     }
-    return -1;
 }
 
 /*
  * Handle MEM_ALLOC_PHYS request
- * Allocates physical pages and tracks ownership
+ * Allocates a pinned DMA buffer in the caller
  */
-static int handle_alloc_phys(uint32_t client_pid, uint64_t pages, uint64_t flags,
-                             uint64_t *out_addr)
+static int handle_alloc_phys(uint64_t pages, uint64_t flags,
+                             struct mem_alloc_reply *reply)
 {
+    struct dma_region region;
+
     total_alloc_requests++;
 
-    if (pages == 0 || pages > 1024) {
+    if (pages == 0 || pages > MEM_MAX_ALLOC_PAGES) {
         printf("[mem] Invalid allocation size: %llu pages\n",
                (unsigned long long)pages);
         return E_INVAL;
     }
-
-    int slot = find_free_slot();
-    if (slot < 0) {
-        printf("[mem] No free allocation slots\n");
-        return E_NOMEM;
+    if (flags > MEM_CACHE_WC) {
+        return E_INVAL;
     }
 
-    /* TODO: Actually allocate physical pages via kernel syscall
-     * For now, just simulate with a fake address
-     */
-    uint64_t phys_addr = 0x100000 + (num_allocs * 0x1000 * pages);
-
-    /* Record the allocation */
-    allocs[slot].phys_addr = phys_addr;
-    allocs[slot].pages = pages;
-    allocs[slot].owner_pid = client_pid;
-    allocs[slot].flags = (uint32_t)flags;
-    num_allocs++;
-
-    total_pages_allocated += pages;
-    *out_addr = phys_addr;
-
-    printf("[mem] Allocated %llu pages at 0x%llx for PID %u\n",
-           (unsigned long long)pages,
-           (unsigned long long)phys_addr,
-           client_pid);
+    int err = dma_region_alloc(pages, (uint32_t)flags, &region);
+    if (err < 0) {
+        printf("[mem] Allocation of %llu pages failed: %d\n",
+               (unsigned long long)pages, err);
+        return errno_to_mem_error(err);
+    }
 
+    total_pages_allocated += region.pages;
+    reply->phys_addr = region.phys;
+    reply->pages = region.pages;
+    reply->virt_addr = region.virt;
     return E_OK;
 }
 
 /*
  * Handle MEM_FREE_PHYS request
  */
-static int handle_free_phys(uint32_t client_pid, uint64_t phys_addr)
+static int handle_free_phys(uint64_t phys_addr)
 {
     total_free_requests++;
 
-    int slot = find_alloc(phys_addr);
-    if (slot < 0) {
-        printf("[mem] Unknown allocation at 0x%llx\n",
-               (unsigned long long)phys_addr);
-        return E_NOENT;
+    /* The kernel only finds buffers of the caller, so no one frees another's */
+    int pages = dma_region_free(phys_addr);
+    if (pages < 0) {
+        return errno_to_mem_error(pages);
+    }
+
+    total_pages_allocated -= (uint64_t)pages;
+    return E_OK;
+}
+
+/* Unpack a name sent in r2-r4; NULL if it is empty or unterminated */
+static const char *shm_unpack_name(uint64_t words[3], uint64_t r2, uint64_t r3,
+                                   uint64_t r4)
+{
+    const char *name = (const char *)words;
+
+    words[0] = r2;
+    words[1] = r3;
+    words[2] = r4;
+    if (name[0] == '\0' || memchr(name, '\0', MEM_SHM_NAME_MAX) == NULL) {
+        return NULL;
     }
+    return name;
+}
 
-    /* Check ownership */
-    if (allocs[slot].owner_pid != client_pid) {
-        printf("[mem] PID %u cannot free memory owned by PID %u\n",
-               client_pid, allocs[slot].owner_pid);
-        return E_PERM;
+static struct shm_name *shm_find_name(const char *name)
+{
+    for (int i = 0; i < MAX_SHM_NAMES; i++) {
+        if (shm_names[i].id && strcmp(shm_names[i].name, name) == 0) {
+            return &shm_names[i];
+        }
     }
+    return NULL;
+}
 
-    /* TODO: Actually free physical pages via kernel syscall */
+/*
+ * Handle MEM_SHM_CREATE: a new object under name, all rights to the caller
+ */
+static int handle_shm_create(const char *name, uint64_t pages, uint64_t *out)
+{
+    struct shm_name *slot = NULL;
 
-    uint64_t freed_pages = allocs[slot].pages;
-    total_pages_allocated -= freed_pages;
+    if (pages == 0 || pages > SHM_MAX_PAGES) {
+        return E_INVAL;
+    }
+    if (shm_find_name(name)) {
+        return E_EXIST;
+    }
+    for (int i = 0; i < MAX_SHM_NAMES && !slot; i++) {
+        if (shm_names[i].id == 0) {
+            slot = &shm_names[i];
+        }
+    }
+    if (!slot) {
+        return E_NOMEM;
+    }
+
+    int id = shm_create(pages);
+    if (id < 0) {
+        return errno_to_mem_error(id);
+    }
 
-    allocs[slot].phys_addr = 0;
-    allocs[slot].pages = 0;
-    allocs[slot].owner_pid = 0;
-    allocs[slot].flags = 0;
-    num_allocs--;
+    int err = shm_grant((uint32_t)id, 0, SHM_RIGHTS_RW | SHM_RIGHT_GRANT);
+    if (err < 0) {
+        shm_destroy((uint32_t)id);
+        return errno_to_mem_error(err);
+    }
 
-    printf("[mem] Freed %llu pages at 0x%llx\n",
-           (unsigned long long)freed_pages,
-           (unsigned long long)phys_addr);
+    strcpy(slot->name, name);
+    slot->id = (uint32_t)id;
+    slot->pages = pages;
+    printf("[mem] Created shared memory '%s' (%llu pages)\n",
+           name, (unsigned long long)pages);
 
+    out[0] = slot->id;
+    out[1] = slot->pages;
     return E_OK;
 }
 
 /*
- * Handle MEM_MAP request
+ * Handle MEM_SHM_OPEN: grant the caller rights on a named object
  */
-static int handle_map(uint32_t client_pid, uint64_t virt_addr, uint64_t phys_addr,
-                      uint64_t pages, uint64_t flags, uint64_t *out_virt)
+static int handle_shm_open(const char *name, uint64_t rights, uint64_t *out)
 {
-    (void)flags;
+    struct shm_name *slot = shm_find_name(name);
 
-    /* TODO: Implement virtual memory mapping via kernel syscall */
-    printf("[mem] Map request: PID %u, virt=0x%llx, phys=0x%llx, pages=%llu\n",
-           client_pid,
-           (unsigned long long)virt_addr,
-           (unsigned long long)phys_addr,
-           (unsigned long long)pages);
+    if (!slot) {
+        return E_NOENT;
+    }
+    if (!(rights & SHM_RIGHT_READ) || (rights & ~(uint64_t)SHM_RIGHTS_RW)) {
+        return E_INVAL;
+    }
 
-    /* For now, just return the requested address */
-    *out_virt = virt_addr ? virt_addr : 0x40000000;
+    int err = shm_grant(slot->id, 0, (uint32_t)rights);
+    if (err < 0) {
+        return errno_to_mem_error(err);
+    }
 
+    out[0] = slot->id;
+    out[1] = slot->pages;
     return E_OK;
 }
 
 /*
- * Handle MEM_QUERY request
+ * Handle MEM_SHM_UNLINK: drop the name; mappings stay until unmapped
  */
-static int handle_query(uint64_t *out_total, uint64_t *out_allocs,
-                        uint64_t *out_frees)
+static int handle_shm_unlink(const char *name)
 {
-    *out_total = total_pages_allocated;
-    *out_allocs = total_alloc_requests;
-    *out_frees = total_free_requests;
+    struct shm_name *slot = shm_find_name(name);
+
+    if (!slot) {
+        return E_NOENT;
+    }
+
+    shm_destroy(slot->id);
+    memset(slot, 0, sizeof(*slot));
     return E_OK;
 }
 
@@ -209,19 +260,60 @@ static void mem_serve(void)
 {
     printf("[mem] Entering service loop\n");
 
-    /* For now, just yield since we don't have full IPC recv implemented */
-    for (int i = 0; i < 50; i++) {
-        yield();
+    for (;;) {
+        uint64_t tag, r1, r2, r3, r4;
+        uint64_t out[3] = { 0, 0, 0 };
+        uint64_t name_words[3];
+        const char *name;
+        int err;
+
+        if (ipc_recv((uint32_t)mem_endpoint, &tag, &r1, &r2, &r3, &r4) < 0) {
+            printf("[mem] Receive failed, stopping\n");
+            return;
+        }
+
+        switch (IPC_TAG_LABEL(tag)) {
+        case MEM_ALLOC_PHYS: {
+            struct mem_alloc_reply reply;
 
-        /* Simulate handling a request every 10 ticks */
-        if (i % 10 == 0 && i > 0) {
-            uint64_t addr = 0;
-            int err = handle_alloc_phys(1, 4, 0, &addr);
+            err = handle_alloc_phys(r1, r2, &reply);
             if (err == E_OK) {
-                printf("[mem] Self-test allocation at 0x%llx\n",
-                       (unsigned long long)addr);
+                out[0] = reply.phys_addr;
+                out[1] = reply.pages;
+                out[2] = reply.virt_addr;
             }
+            break;
         }
+        case MEM_FREE_PHYS:
+            err = handle_free_phys(r1);
+            break;
+        case MEM_SHM_CREATE:
+        case MEM_SHM_OPEN:
+        case MEM_SHM_UNLINK:
+            name = shm_unpack_name(name_words, r2, r3, r4);
+            if (!name) {
+                err = E_INVAL;
+            } else if (IPC_TAG_LABEL(tag) == MEM_SHM_CREATE) {
+                err = handle_shm_create(name, r1, out);
+            } else if (IPC_TAG_LABEL(tag) == MEM_SHM_OPEN) {
+                err = handle_shm_open(name, r1, out);
+            } else {
+                err = handle_shm_unlink(name);
+            }
+            break;
+        case MEM_QUERY:
+            out[0] = total_pages_allocated;
+            out[1] = total_alloc_requests;
+            out[2] = total_free_requests;
+            err = E_OK;
+            break;
+        default:
+            err = E_NOSYS;
+            break;
+        }
+
+        ipc_reply(IPC_MAKE_REPLY(IPC_TAG_LABEL(tag), 3, err),
+                  out[0], out[1], out[2], 0);
     }
 }
 
@@ -237,7 +329,6 @@ static void mem_stats(void)
            (unsigned long long)total_alloc_requests);
     printf("  Free requests: %llu\n",
            (unsigned long long)total_free_requests);
-    printf("  Active allocations: %d\n", num_allocs);
     printf("\n");
 }
 
@@ -255,7 +346,9 @@ int main(int argc, char **argv)
 
     printf("[mem] PID: %d, PPID: %d\n", getpid(), getppid());
 
-    mem_init();
+    if (mem_init() < 0) {
+        return 1;
+    }
     mem_serve();
     mem_stats();
 
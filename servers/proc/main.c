@@ -15,6 +15,7 @@
 #include <string.h>
 #include <ocean/syscall.h>
 #include <ocean/ipc_proto.h>
+#include <ocean/service.h>
 
 #define PROC_VERSION "0.1.0"
 #define MAX_PROCS    64
@@ -98,14 +99,15 @@ static void proc_init(void)
     num_procs = 1;
 
     /* Create our IPC endpoint */
-    proc_endpoint = endpoint_create(0);
+    proc_endpoint = endpoint_create_well_known(EP_PROC, 0);
     if (proc_endpoint < 0) {
-        printf("[proc] Failed to create endpoint: %d\n", proc_endpoint);
+        printf("[proc] Failed to claim EP_PROC: %d\n", proc_endpoint);
         return;
     }
-    printf("[proc] Created endpoint %d\n", proc_endpoint);
+    printf("[proc] Serving on endpoint %d\n", proc_endpoint);
 
     printf("[proc] Process server initialized\n");
+    service_ready(EP_PROC);
 }
 
 /*
@@ -0,0 +1,321 @@
+/*
+ * Ocean Reincarnation Server
+ *
+ * Keeps a hot standby for each core service the manifest marks .standby:
+ * a second instance, started here, that initializes and then parks on the
+ * service's well-known endpoint. rs names it the endpoint's standby with
+ * RS_CTL_SUPERVISE, so when the running instance dies the kernel passes
+ * the endpoint to it on the spot, with the callers queued there, and
+ * replays the calls the dead instance had taken but not answered.
+ * Recovery costs a wakeup instead of an exec and a cold start.
+ *
+ * The standby reports with RS_TAKEOVER. We tell init who serves the
+ * endpoint now and start the next standby. rs is the fallback heir too:
+ * an endpoint whose standby is gone comes to us, and goes to the next
+ * standby as soon as that is spawned.
+ *
+ * As in init, a reaper thread waits for our children and wakes the main
+ * loop with RS_CHILD_EXIT, passing the exits through a table.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <ocean/syscall.h>
+#include <ocean/ipc_proto.h>
+#include <ocean/rs.h>
+#include <ocean/service.h>
+#include <ocean/userspace_manifest.h>
+
+#define RS_VERSION "0.1.0"
+
+/* Supervised services and pending exits */
+#define MAX_SUPERVISED  8
+#define MAX_EXITS       16
+
+struct supervised {
+    const char *name;
+    const char *path;
+    uint32_t    well_known_ep;
+    int         pid;            /* Instance we started that serves, if any */
+    int         standby;        /* Parked instance, 0 if none */
+    int         takeovers;      /* Times a standby took over */
+};
+
+static struct supervised supervised[MAX_SUPERVISED];
+static int num_supervised = 0;
+
+static int rs_endpoint = -1;
+
+/* Children the reaper thread collected; guarded by reaper_lock */
+struct child_exit {
+    int pid;
+    int status;
+};
+
+static pthread_mutex_t reaper_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct child_exit exits[MAX_EXITS];
+static int num_exits = 0;
+static int num_spawned = 0;
+static int reaper_running = 0;
+
+/*
+ * Reaper thread (see init: wait() fails at once without children, so
+ * num_spawned tells a real end from a spawn that raced us)
+ */
+static void *reaper_thread(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&reaper_lock);
+        int seen = num_spawned;
+        pthread_mutex_unlock(&reaper_lock);
+
+        int status = 0;
+        int pid = wait(&status);
+
+        pthread_mutex_lock(&reaper_lock);
+        if (pid < 0) {
+            if (num_spawned == seen) {
+                reaper_running = 0;
+                pthread_mutex_unlock(&reaper_lock);
+                return NULL;
+            }
+            pthread_mutex_unlock(&reaper_lock);
+            continue;
+        }
+
+        while (num_exits == MAX_EXITS) {
+            pthread_mutex_unlock(&reaper_lock);
+            yield();
+            pthread_mutex_lock(&reaper_lock);
+        }
+        exits[num_exits].pid = pid;
+        exits[num_exits].status = status;
+        num_exits++;
+        pthread_mutex_unlock(&reaper_lock);
+
+        ipc_send((uint32_t)rs_endpoint,
+                 IPC_MAKE_TAG(RS_CHILD_EXIT, 0, 0, 0), 0, 0, 0, 0);
+    }
+}
+
+/*
+ * Spawn a privileged child and make sure someone will reap it
+ */
+static int spawn_child(const char *path, char *const argv[])
+{
+    int pid = spawn(path, argv, NULL, 0, SPAWN_PRIVILEGED);
+    if (pid < 0) {
+        return pid;
+    }
+
+    pthread_mutex_lock(&reaper_lock);
+    num_spawned++;
+    if (!reaper_running) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, reaper_thread, NULL) == 0) {
+            pthread_detach(thread);
+            reaper_running = 1;
+        } else {
+            printf("[rs] Failed to start reaper thread\n");
+        }
+    }
+    pthread_mutex_unlock(&reaper_lock);
+
+    return pid;
+}
+
+static struct supervised *find_by_ep(uint64_t ep)
+{
+    for (int i = 0; i < num_supervised; i++) {
+        if (supervised[i].well_known_ep == ep) {
+            return &supervised[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Start a standby for svc. It finds the endpoint taken and parks on it.
+ */
+static void start_standby(struct supervised *svc)
+{
+    char *argv[] = { (char *)svc->name, NULL };
+
+    svc->standby = 0;
+
+    int pid = spawn_child(svc->path, argv);
+    if (pid < 0) {
+        printf("[rs] spawn %s standby failed: %d\n", svc->name, pid);
+        return;
+    }
+    svc->standby = pid;
+
+    int err = rs_supervise(svc->well_known_ep, pid);
+    if (err < 0) {
+        printf("[rs] Cannot supervise endpoint %u: %d\n",
+               svc->well_known_ep, err);
+        return;
+    }
+
+    /* The endpoint came back to us if its last standby was gone */
+    if (rs_handover(svc->well_known_ep, pid) == 0) {
+        printf("[rs] %s: endpoint %u was ours, handed to PID %d\n",
+               svc->name, svc->well_known_ep, pid);
+    } else {
+        printf("[rs] %s standby is PID %d\n", svc->name, pid);
+    }
+}
+
+/*
+ * Handle RS_TAKEOVER: a standby serves ep now
+ */
+static int took_over(uint64_t pid, uint64_t ep)
+{
+    struct supervised *svc = find_by_ep(ep);
+
+    if (!svc || svc->standby != (int)pid) {
+        return E_NOENT;
+    }
+
+    svc->pid = (int)pid;
+    svc->takeovers++;
+    printf("[rs] %s: standby PID %d took over endpoint %u (%d so far)\n",
+           svc->name, svc->pid, svc->well_known_ep, svc->takeovers);
+    return E_OK;
+}
+
+/* Tell init that pid is the service on ep now */
+static void report_to_init(int pid, uint32_t ep)
+{
+    struct ipc_call_frame frame = {
+        .tag = IPC_MAKE_TAG(INIT_SVC_READY, 2, 0, 0),
+        .r1 = (uint64_t)pid,
+        .r2 = ep,
+    };
+
+    ipc_call(EP_INIT, &frame);
+}
+
+/*
+ * Record a child the reaper collected
+ */
+static void child_exited(int pid, int status)
+{
+    for (int i = 0; i < num_supervised; i++) {
+        struct supervised *svc = &supervised[i];
+
+        if (pid == svc->standby) {
+            /* Died parked, or before it took over: replace it */
+            printf("[rs] %s standby PID %d exited with status %d\n",
+                   svc->name, pid, status);
+            start_standby(svc);
+            return;
+        }
+        if (pid == svc->pid) {
+            printf("[rs] %s PID %d exited with status %d\n",
+                   svc->name, pid, status);
+            svc->pid = 0;
+            return;
+        }
+    }
+}
+
+/*
+ * Handle one event: a message on EP_RS, then whatever the reaper has
+ */
+static void serve_one(void)
+{
+    struct child_exit batch[MAX_EXITS];
+    struct supervised *takeover = NULL;
+    uint64_t tag, r1, r2, r3, r4;
+    int count;
+    int err = E_OK;
+
+    if (ipc_recv((uint32_t)rs_endpoint, &tag, &r1, &r2, &r3, &r4) < 0) {
+        printf("[rs] Receive on endpoint failed\n");
+        yield();
+        return;
+    }
+
+    switch (IPC_TAG_LABEL(tag)) {
+    case RS_TAKEOVER:
+        err = took_over((uint64_t)ipc_caller_pid(), r2);
+        if (err == E_OK) {
+            takeover = find_by_ep(r2);
+        }
+        break;
+    case RS_CHILD_EXIT:
+        /* The exit itself is in the table */
+        break;
+    default:
+        err = E_NOSYS;
+        break;
+    }
+
+    /* Let a new instance serve before we spawn its standby */
+    ipc_reply(IPC_MAKE_REPLY(IPC_TAG_LABEL(tag), 0, err), 0, 0, 0, 0);
+
+    if (takeover) {
+        report_to_init(takeover->pid, takeover->well_known_ep);
+        start_standby(takeover);
+    }
+
+    pthread_mutex_lock(&reaper_lock);
+    count = num_exits;
+    memcpy(batch, exits, (size_t)count * sizeof(batch[0]));
+    num_exits = 0;
+    pthread_mutex_unlock(&reaper_lock);
+
+    for (int i = 0; i < count; i++) {
+        child_exited(batch[i].pid, batch[i].status);
+    }
+}
+
+/*
+ * Main entry point
+ */
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("\n========================================\n");
+    printf("  Ocean Reincarnation Server v%s\n", RS_VERSION);
+    printf("========================================\n\n");
+
+    printf("[rs] PID: %d, PPID: %d\n", getpid(), getppid());
+
+    rs_endpoint = endpoint_create_well_known(EP_RS, 0);
+    if (rs_endpoint < 0) {
+        printf("[rs] Failed to claim EP_RS: %d\n", rs_endpoint);
+        return 1;
+    }
+    printf("[rs] Serving on endpoint %d\n", rs_endpoint);
+    service_ready(EP_RS);
+
+    for (size_t i = 0; i < OCEAN_SERVICE_SPEC_COUNT; i++) {
+        const struct ocean_service_spec *spec = &ocean_service_specs[i];
+
+        if (!spec->standby) {
+            continue;
+        }
+        if (num_supervised >= MAX_SUPERVISED) {
+            printf("[rs] Too many standby services\n");
+            break;
+        }
+
+        struct supervised *svc = &supervised[num_supervised++];
+        svc->name = spec->name;
+        svc->path = spec->path;
+        svc->well_known_ep = spec->well_known_ep;
+        start_standby(svc);
+    }
+
+    for (;;) {
+        serve_one();
+    }
+}
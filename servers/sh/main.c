@@ -4,10 +4,16 @@
  * A simple interactive shell for the Ocean microkernel.
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
 #include <ocean/syscall.h>
+#include <ocean/trace.h>
+#include <ocean/profile.h>
+#include <ocean/scstat.h>
+#include <ocean/schedstat.h>
+#include <ocean/pci.h>
 #include <ocean/userspace_manifest.h>
 
 #define SHELL_VERSION "0.3.0"
@@ -214,6 +220,15 @@ static void cmd_help(void)
     printf("  services         Show the init service plan\n");
     printf("  which <name>     Resolve a boot module or service path\n");
     printf("  version          Show shell version details\n");
+    printf("  lockstat [reset] Dump kernel lock contention statistics\n");
+    printf("  trace start [event...] | stop | dump | reset\n");
+    printf("                   Kernel tracepoints; dump stops tracing first\n");
+    printf("  profile start [hz] | stop | dump | reset\n");
+    printf("                   Sampling profiler; dump stops sampling first\n");
+    printf("  scstat [start | stop | reset | top [n]]\n");
+    printf("                   Syscall counts and latency; default shows the top 10\n");
+    printf("  schedstat [pid]  Per-thread CPU, run-queue wait and sleep times (us)\n");
+    printf("  lspci [-v]       List PCI functions; -v adds BARs and claims\n");
     print_boot_commands();
     printf("\nUse quotes to keep spaces together, for example: echo \"hello ocean\"\n");
 }
@@ -275,18 +290,35 @@ static void cmd_modules(void)
     }
 }
 
+/* Format a service's needs as the endpoint numbers, "-" if none */
+static const char *format_needs(uint32_t needs, char *buf, size_t len)
+{
+    size_t pos = 0;
+
+    buf[0] = '\0';
+    for (uint32_t ep = EP_WKE_MIN; ep <= EP_WKE_MAX; ep++) {
+        if ((needs & OCEAN_SERVICE_NEEDS(ep)) && pos + 4 < len) {
+            pos += (size_t)snprintf(buf + pos, len - pos, "%s%u",
+                                    pos ? "," : "", ep);
+        }
+    }
+    return pos ? buf : "-";
+}
+
 static void cmd_services(void)
 {
+    char needs[32];
+
     printf("Init service plan:\n");
-    printf("  PRIO  NAME   EP   SUMMARY\n");
-    printf("  ----  -----  ---  ------------------------------\n");
+    printf("  NAME   EP   NEEDS  SUMMARY\n");
+    printf("  -----  ---  -----  ------------------------------\n");
 
     for (size_t i = 0; i < OCEAN_SERVICE_SPEC_COUNT; i++) {
         const struct ocean_service_spec *service = &ocean_service_specs[i];
-        printf("  %-4d  %-5s  %-3u  %s\n",
-               service->priority,
+        printf("  %-5s  %-3u  %-5s  %s\n",
                service->name,
                service->well_known_ep,
+               format_needs(service->needs, needs, sizeof(needs)),
                service->summary);
     }
 }
@@ -311,8 +343,8 @@ static void cmd_which(void)
         }
 
         if (service) {
-            printf("%s: %s [service, priority %d]\n",
-                   argv[i], service->path, service->priority);
+            printf("%s: %s [service, endpoint %u]\n",
+                   argv[i], service->path, service->well_known_ep);
             continue;
         }
 
@@ -327,6 +359,448 @@ static void cmd_version(void)
     printf("  declared core services: %u\n", (unsigned)OCEAN_SERVICE_SPEC_COUNT);
 }
 
+static void cmd_lockstat(void)
+{
+    uint32_t flags = 0;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "reset") != 0) {
+            printf("usage: lockstat [reset]\n");
+            return;
+        }
+        flags |= KSTAT_RESET;
+    }
+
+    /* The kernel prints the table on the console */
+    if (kstat(KSTAT_LOCKS, flags) < 0) {
+        printf("lockstat: not supported by this kernel\n");
+    }
+}
+
+/* Records drained per SYS_TRACE call */
+#define TRACE_BATCH 64
+
+static struct trace_record trace_batch[TRACE_BATCH];
+
+static uint64_t trace_event_bit(const char *name)
+{
+    for (int i = 1; i < TRACE_NR_EVENTS; i++) {
+        if (strcmp(trace_event_info[i].name, name) == 0) {
+            return 1ULL << i;
+        }
+    }
+    return 0;
+}
+
+static void print_trace_record(const struct trace_record *rec)
+{
+    const struct trace_event_info *info = NULL;
+
+    if (rec->event < TRACE_NR_EVENTS) {
+        info = &trace_event_info[rec->event];
+    }
+
+    printf("TRACE %llu %u %u %s", (unsigned long long)rec->tsc,
+           (unsigned)rec->cpu, (unsigned)rec->tid,
+           info && info->name ? info->name : "unknown");
+    for (int i = 0; i < 3; i++) {
+        if (info && info->args[i][0]) {
+            printf(" %s=0x%llx", info->args[i], (unsigned long long)rec->args[i]);
+        }
+    }
+    printf("\n");
+}
+
+/*
+ * Print every buffered record in the format scripts/trace2chrome.py reads.
+ * Tracing is stopped first, or our own output would keep refilling the
+ * buffer.
+ */
+static void trace_dump(void)
+{
+    trace_ctl(TRACE_CTL_STOP, 0, NULL, 0);
+
+    printf("TRACE-CLOCK %lld\n", (long long)trace_ctl(TRACE_CTL_CLOCK, 0, NULL, 0));
+
+    for (int cpu = 0; ; cpu++) {
+        int64_t n;
+
+        while ((n = trace_ctl(TRACE_CTL_READ, cpu, trace_batch, TRACE_BATCH)) > 0) {
+            for (int64_t i = 0; i < n; i++) {
+                print_trace_record(&trace_batch[i]);
+            }
+        }
+        if (n < 0) {
+            break;      /* No such CPU */
+        }
+
+        int64_t lost = trace_ctl(TRACE_CTL_LOST, cpu, NULL, 0);
+        if (lost > 0) {
+            printf("TRACE-LOST %d %lld\n", cpu, (long long)lost);
+        }
+    }
+}
+
+static void cmd_trace(void)
+{
+    if (argc < 2) {
+        printf("usage: trace start [event...] | stop | dump | reset\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "start") == 0) {
+        uint64_t mask = 0;
+
+        for (int i = 2; i < argc; i++) {
+            uint64_t bit = trace_event_bit(argv[i]);
+            if (!bit) {
+                printf("trace: unknown event '%s'; events are:", argv[i]);
+                for (int e = 1; e < TRACE_NR_EVENTS; e++) {
+                    printf(" %s", trace_event_info[e].name);
+                }
+                printf("\n");
+                return;
+            }
+            mask |= bit;
+        }
+        if (trace_ctl(TRACE_CTL_START, mask, NULL, 0) < 0) {
+            printf("trace: not supported by this kernel\n");
+        }
+    } else if (strcmp(argv[1], "stop") == 0) {
+        trace_ctl(TRACE_CTL_STOP, 0, NULL, 0);
+    } else if (strcmp(argv[1], "dump") == 0) {
+        trace_dump();
+    } else if (strcmp(argv[1], "reset") == 0) {
+        trace_ctl(TRACE_CTL_RESET, 0, NULL, 0);
+    } else {
+        printf("usage: trace start [event...] | stop | dump | reset\n");
+    }
+}
+
+/* Samples drained per SYS_PROFILE call */
+#define PROFILE_BATCH 16
+
+static struct profile_sample profile_batch[PROFILE_BATCH];
+
+static void print_profile_sample(const struct profile_sample *s)
+{
+    printf("PROF %u %u %u %s %u 0x%llx", (unsigned)s->cpu, (unsigned)s->pid,
+           (unsigned)s->tid, s->comm[0] ? s->comm : "-", (unsigned)s->cpl,
+           (unsigned long long)s->rip);
+    for (int i = 0; i < s->depth && i < PROFILE_MAX_FRAMES; i++) {
+        printf(" 0x%llx", (unsigned long long)s->frames[i]);
+    }
+    printf("\n");
+}
+
+/*
+ * Print every buffered sample in the format scripts/prof2folded.py reads.
+ * Sampling is stopped first so the dump does not profile itself.
+ */
+static void profile_dump(void)
+{
+    profile_ctl(PROFILE_CTL_STOP, 0, NULL, 0);
+
+    for (int cpu = 0; ; cpu++) {
+        int64_t n;
+
+        while ((n = profile_ctl(PROFILE_CTL_READ, cpu, profile_batch, PROFILE_BATCH)) > 0) {
+            for (int64_t i = 0; i < n; i++) {
+                print_profile_sample(&profile_batch[i]);
+            }
+        }
+        if (n < 0) {
+            break;      /* No such CPU */
+        }
+
+        int64_t lost = profile_ctl(PROFILE_CTL_LOST, cpu, NULL, 0);
+        if (lost > 0) {
+            printf("PROF-LOST %d %lld\n", cpu, (long long)lost);
+        }
+    }
+}
+
+static void cmd_profile(void)
+{
+    if (argc < 2) {
+        printf("usage: profile start [hz] | stop | dump | reset\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "start") == 0) {
+        uint64_t hz = 0;
+
+        if (argc > 2) {
+            for (const char *p = argv[2]; *p; p++) {
+                if (*p < '0' || *p > '9') {
+                    printf("profile: bad rate '%s'\n", argv[2]);
+                    return;
+                }
+                hz = hz * 10 + (uint64_t)(*p - '0');
+            }
+        }
+
+        int64_t rate = profile_ctl(PROFILE_CTL_START, hz, NULL, 0);
+        if (rate < 0) {
+            printf("profile: cannot start (rate too high or not supported)\n");
+        } else {
+            printf("profile: sampling at %lld Hz\n", (long long)rate);
+        }
+    } else if (strcmp(argv[1], "stop") == 0) {
+        profile_ctl(PROFILE_CTL_STOP, 0, NULL, 0);
+    } else if (strcmp(argv[1], "dump") == 0) {
+        profile_dump();
+    } else if (strcmp(argv[1], "reset") == 0) {
+        profile_ctl(PROFILE_CTL_RESET, 0, NULL, 0);
+    } else {
+        printf("usage: profile start [hz] | stop | dump | reset\n");
+    }
+}
+
+/* Records read per SYS_SCSTAT call */
+#define SCSTAT_BATCH 16
+
+struct scstat_summary {
+    int nr;
+    uint64_t count;
+    uint64_t errors;
+    uint64_t avg;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+};
+
+static struct scstat_record scstat_batch[SCSTAT_BATCH];
+static struct scstat_summary scstat_rows[SCSTAT_NR_SYSCALLS];
+
+/* Upper bound, in cycles, of the bucket holding the pct-th percentile */
+static uint64_t scstat_percentile(const struct scstat_record *rec, uint64_t done,
+                                  unsigned pct)
+{
+    uint64_t seen = 0;
+
+    for (int i = 0; i < SCSTAT_HIST_BUCKETS; i++) {
+        seen += rec->hist[i];
+        if (seen * 100 >= done * pct) {
+            return i + 1 < SCSTAT_HIST_BUCKETS ? 1ULL << (i + 1) : rec->max_cycles;
+        }
+    }
+    return rec->max_cycles;
+}
+
+static uint64_t scstat_ns(uint64_t cycles, uint64_t hz)
+{
+    if (hz == 0) {
+        return cycles;
+    }
+    return cycles / hz * 1000000000ULL + cycles % hz * 1000000000ULL / hz;
+}
+
+static void scstat_top(int limit)
+{
+    int64_t hz = scstat_ctl(SCSTAT_CTL_CLOCK, 0, NULL, 0);
+    int rows = 0;
+
+    for (uint64_t first = 0; first < SCSTAT_NR_SYSCALLS; ) {
+        int64_t n = scstat_ctl(SCSTAT_CTL_READ, first, scstat_batch, SCSTAT_BATCH);
+        if (n <= 0) {
+            break;
+        }
+        for (int64_t i = 0; i < n; i++) {
+            const struct scstat_record *rec = &scstat_batch[i];
+            uint64_t done = 0;
+
+            for (int b = 0; b < SCSTAT_HIST_BUCKETS; b++) {
+                done += rec->hist[b];
+            }
+            if (rec->count == 0) {
+                continue;
+            }
+
+            struct scstat_summary *row = &scstat_rows[rows++];
+            row->nr = (int)(first + (uint64_t)i);
+            row->count = rec->count;
+            row->errors = rec->errors;
+            row->avg = done ? rec->cycles / done : 0;
+            row->p50 = done ? scstat_percentile(rec, done, 50) : 0;
+            row->p99 = done ? scstat_percentile(rec, done, 99) : 0;
+            row->max = rec->max_cycles;
+        }
+        first += (uint64_t)n;
+    }
+
+    if (rows == 0) {
+        printf("scstat: no syscalls counted (use 'scstat start')\n");
+        return;
+    }
+    if (hz <= 0) {
+        printf("scstat: TSC rate unknown, latencies are in cycles\n");
+        hz = 0;
+    }
+
+    printf("%-20s %10s %8s %10s %10s %10s %10s\n",
+           "syscall", "count", "errors", "avg ns", "p50 ns", "p99 ns", "max ns");
+
+    /* Selection sort by count; there are at most a few dozen rows */
+    for (int i = 0; i < rows && i < limit; i++) {
+        int best = i;
+        for (int j = i + 1; j < rows; j++) {
+            if (scstat_rows[j].count > scstat_rows[best].count) {
+                best = j;
+            }
+        }
+        struct scstat_summary row = scstat_rows[best];
+        scstat_rows[best] = scstat_rows[i];
+        scstat_rows[i] = row;
+
+        const char *name = scstat_syscall_names[row.nr];
+        char unnamed[16];
+        if (!name) {
+            snprintf(unnamed, sizeof(unnamed), "syscall %d", row.nr);
+            name = unnamed;
+        }
+        printf("%-20s %10llu %8llu %10llu %10llu %10llu %10llu\n", name,
+               (unsigned long long)row.count, (unsigned long long)row.errors,
+               (unsigned long long)scstat_ns(row.avg, (uint64_t)hz),
+               (unsigned long long)scstat_ns(row.p50, (uint64_t)hz),
+               (unsigned long long)scstat_ns(row.p99, (uint64_t)hz),
+               (unsigned long long)scstat_ns(row.max, (uint64_t)hz));
+    }
+}
+
+static void cmd_scstat(void)
+{
+    const char *op = argc > 1 ? argv[1] : "top";
+
+    if (strcmp(op, "start") == 0) {
+        if (scstat_ctl(SCSTAT_CTL_START, 0, NULL, 0) < 0) {
+            printf("scstat: not supported by this kernel\n");
+        }
+    } else if (strcmp(op, "stop") == 0) {
+        scstat_ctl(SCSTAT_CTL_STOP, 0, NULL, 0);
+    } else if (strcmp(op, "reset") == 0) {
+        scstat_ctl(SCSTAT_CTL_RESET, 0, NULL, 0);
+    } else if (strcmp(op, "top") == 0) {
+        int limit = 10;
+
+        if (argc > 2) {
+            limit = 0;
+            for (const char *p = argv[2]; *p; p++) {
+                if (*p < '0' || *p > '9') {
+                    printf("scstat: bad count '%s'\n", argv[2]);
+                    return;
+                }
+                limit = limit * 10 + (*p - '0');
+            }
+        }
+        scstat_top(limit);
+    } else {
+        printf("usage: scstat [start | stop | reset | top [n]]\n");
+    }
+}
+
+#define SCHEDSTAT_MAX_THREADS 16
+
+static struct sched_thread_info schedstat_buf[SCHEDSTAT_MAX_THREADS];
+
+static unsigned long long ns_to_us(uint64_t ns)
+{
+    return (unsigned long long)(ns / 1000);
+}
+
+static void cmd_schedstat(void)
+{
+    int pid = 0;
+
+    if (argc > 1) {
+        for (const char *p = argv[1]; *p; p++) {
+            if (*p < '0' || *p > '9') {
+                printf("usage: schedstat [pid]\n");
+                return;
+            }
+            pid = pid * 10 + (*p - '0');
+        }
+    }
+
+    int64_t n = schedstat(pid, schedstat_buf, SCHEDSTAT_MAX_THREADS);
+    if (n < 0) {
+        printf("schedstat: %s\n", n == -ESRCH ? "no such process" : "not available");
+        return;
+    }
+
+    for (int64_t i = 0; i < n; i++) {
+        const struct sched_thread_info *st = &schedstat_buf[i];
+
+        printf("tid %u: user %llu system %llu run-wait %llu (max %llu, %llu waits)\n",
+               (unsigned)st->tid, ns_to_us(st->user_ns), ns_to_us(st->system_ns),
+               ns_to_us(st->run_delay_ns), ns_to_us(st->run_delay_max_ns),
+               (unsigned long long)st->nr_run_waits);
+        printf("  switches: %llu voluntary, %llu involuntary; blocked:",
+               (unsigned long long)st->nvcsw, (unsigned long long)st->nivcsw);
+        for (int r = 0; r < SCHED_BLOCK_NR; r++) {
+            if (st->blocked_ns[r]) {
+                printf(" %s %llu", sched_block_reason_names[r], ns_to_us(st->blocked_ns[r]));
+            }
+        }
+        printf("\n");
+    }
+}
+
+#define LSPCI_MAX_DEVICES 64
+
+static struct pci_device_info lspci_buf[LSPCI_MAX_DEVICES];
+
+static void cmd_lspci(void)
+{
+    int verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    int64_t total = pci_list(lspci_buf, LSPCI_MAX_DEVICES);
+
+    if (total < 0) {
+        printf("lspci: not available (%lld)\n", (long long)total);
+        return;
+    }
+
+    int64_t n = total < LSPCI_MAX_DEVICES ? total : LSPCI_MAX_DEVICES;
+    for (int64_t i = 0; i < n; i++) {
+        const struct pci_device_info *d = &lspci_buf[i];
+
+        printf("%04x:%02x:%02x.%u %04x:%04x class %02x.%02x.%02x",
+               d->segment, d->bus, d->slot, d->func, d->vendor_id, d->device_id,
+               d->class_code, d->subclass, d->prog_if);
+        if (d->irq_pin) {
+            printf(" INT%c irq %u", 'A' + d->irq_pin - 1, d->irq_line);
+        }
+        if (d->msi_cap) {
+            printf(" MSI");
+        }
+        if (d->msix_cap) {
+            printf(" MSI-X(%u)", d->msix_vectors);
+        }
+        printf("\n");
+
+        if (!verbose) {
+            continue;
+        }
+        for (int b = 0; b < PCI_MAX_BARS; b++) {
+            const struct pci_bar *bar = &d->bars[b];
+
+            if (!bar->size) {
+                continue;
+            }
+            printf("  BAR%d %s 0x%llx size 0x%llx%s\n", b,
+                   (bar->flags & PCI_BAR_IO) ? "io " : "mem",
+                   (unsigned long long)bar->base, (unsigned long long)bar->size,
+                   (bar->flags & PCI_BAR_PREFETCH) ? " prefetchable" : "");
+        }
+        if (d->owner) {
+            printf("  claimed by pid %u\n", d->owner);
+        }
+    }
+    if (total > n) {
+        printf("(%lld more not shown)\n", (long long)(total - n));
+    }
+}
+
 static int resolve_external_path(const char *name, char *path, size_t path_size)
 {
     const struct ocean_boot_module_spec *module;
@@ -381,25 +855,18 @@ static void exec_external(void)
         return;
     }
 
-    /* Fork and exec */
-    int pid = fork();
-
+    const struct ocean_boot_module_spec *module = ocean_find_boot_module_spec(path);
+    int pid = spawn(path, argv, NULL, 0,
+                    module && module->privileged ? SPAWN_PRIVILEGED : 0);
     if (pid < 0) {
-        printf("fork failed\n");
+        printf("%s: spawn failed (%d)\n", argv[0], pid);
         return;
     }
 
-    if (pid == 0) {
-        execv(path, argv);
-        /* If exec returns, it failed */
-        printf("%s: exec failed\n", argv[0]);
-        _exit(1);
-    } else {
-        /* Parent waits for the child it launched */
-        int status = wait_for_pid(pid);
-        if (status != 0) {
-            printf("sh: %s exited with status %d\n", argv[0], status);
-        }
+    /* Wait for the child we launched */
+    int status = wait_for_pid(pid);
+    if (status != 0) {
+        printf("sh: %s exited with status %d\n", argv[0], status);
     }
 }
 
@@ -436,6 +903,18 @@ static void execute(void)
         cmd_which();
     } else if (strcmp(argv[0], "version") == 0) {
         cmd_version();
+    } else if (strcmp(argv[0], "lockstat") == 0) {
+        cmd_lockstat();
+    } else if (strcmp(argv[0], "trace") == 0) {
+        cmd_trace();
+    } else if (strcmp(argv[0], "profile") == 0) {
+        cmd_profile();
+    } else if (strcmp(argv[0], "scstat") == 0) {
+        cmd_scstat();
+    } else if (strcmp(argv[0], "schedstat") == 0) {
+        cmd_schedstat();
+    } else if (strcmp(argv[0], "lspci") == 0) {
+        cmd_lspci();
     } else {
         exec_external();
     }
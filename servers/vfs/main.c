@@ -15,6 +15,7 @@
 #include <string.h>
 #include <ocean/syscall.h>
 #include <ocean/ipc_proto.h>
+#include <ocean/service.h>
 
 #define VFS_VERSION "0.1.0"
 #define MAX_MOUNTS      16
@@ -76,14 +77,15 @@ static void vfs_init(void)
     memset(files, 0, sizeof(files));
 
     /* Create our IPC endpoint */
-    vfs_endpoint = endpoint_create(0);
+    vfs_endpoint = endpoint_create_well_known(EP_VFS, 0);
     if (vfs_endpoint < 0) {
-        printf("[vfs] Failed to create endpoint: %d\n", vfs_endpoint);
+        printf("[vfs] Failed to claim EP_VFS: %d\n", vfs_endpoint);
         return;
     }
-    printf("[vfs] Created endpoint %d\n", vfs_endpoint);
+    printf("[vfs] Serving on endpoint %d\n", vfs_endpoint);
 
     printf("[vfs] VFS server initialized\n");
+    service_ready(EP_VFS);
 }
 
 /*
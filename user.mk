@@ -13,6 +13,7 @@ INCLUDE_DIR := include
 # Userspace compiler flags
 USER_CFLAGS := -std=gnu11 -g \
                -ffreestanding \
+               -fno-omit-frame-pointer \
                -fno-stack-protector \
                -fno-pie \
                -fPIC \
@@ -33,6 +34,10 @@ USER_ASM_SRCS := $(LIBC_ASM_SRCS)
 LIBC_OBJS := $(LIBC_SRCS:$(LIBC_DIR)/src/%.c=$(BUILD_DIR)/libc/%.o) \
              $(LIBC_ASM_SRCS:$(LIBC_DIR)/src/%.S=$(BUILD_DIR)/libc/%.o)
 
+# libocean runtime (pthreads); linked into every binary alongside libc
+LIBOCEAN_SRCS := $(wildcard $(LIBOCEAN_DIR)/src/*.c)
+LIBOCEAN_OBJS := $(LIBOCEAN_SRCS:$(LIBOCEAN_DIR)/src/%.c=$(BUILD_DIR)/libocean/%.o)
+
 # Init server
 INIT_SRCS := $(wildcard $(SERVERS_DIR)/init/*.c)
 INIT_OBJS := $(INIT_SRCS:$(SERVERS_DIR)/init/%.c=$(BUILD_DIR)/servers/init/%.o)
@@ -53,6 +58,10 @@ VFS_OBJS := $(VFS_SRCS:$(SERVERS_DIR)/vfs/%.c=$(BUILD_DIR)/servers/vfs/%.o)
 BLK_SRCS := $(wildcard $(SERVERS_DIR)/blk/*.c)
 BLK_OBJS := $(BLK_SRCS:$(SERVERS_DIR)/blk/%.c=$(BUILD_DIR)/servers/blk/%.o)
 
+# Reincarnation server
+RS_SRCS := $(wildcard $(SERVERS_DIR)/rs/*.c)
+RS_OBJS := $(RS_SRCS:$(SERVERS_DIR)/rs/%.c=$(BUILD_DIR)/servers/rs/%.o)
+
 # RAMFS driver
 RAMFS_SRCS := $(wildcard $(FS_DIR)/ramfs/*.c)
 RAMFS_OBJS := $(RAMFS_SRCS:$(FS_DIR)/ramfs/%.c=$(BUILD_DIR)/fs/ramfs/%.o)
@@ -84,19 +93,26 @@ CAT_OBJS := $(CAT_SRCS:$(BIN_DIR)/%.c=$(BUILD_DIR)/bin/%.o)
 LS_SRCS := $(wildcard $(BIN_DIR)/ls.c)
 LS_OBJS := $(LS_SRCS:$(BIN_DIR)/%.c=$(BUILD_DIR)/bin/%.o)
 
+# Benchmark utility
+BENCH_SRCS := $(wildcard $(BIN_DIR)/bench.c)
+BENCH_OBJS := $(BENCH_SRCS:$(BIN_DIR)/%.c=$(BUILD_DIR)/bin/%.o)
+
 USER_C_SRCS := $(LIBC_SRCS) \
+               $(LIBOCEAN_SRCS) \
                $(INIT_SRCS) \
                $(MEM_SRCS) \
                $(PROC_SRCS) \
                $(VFS_SRCS) \
                $(BLK_SRCS) \
+               $(RS_SRCS) \
                $(RAMFS_SRCS) \
                $(EXT2_SRCS) \
                $(ATA_SRCS) \
                $(SH_SRCS) \
                $(ECHO_SRCS) \
                $(CAT_SRCS) \
-               $(LS_SRCS)
+               $(LS_SRCS) \
+               $(BENCH_SRCS)
 
 # Userspace linker script
 USER_LD_SCRIPT := user.ld
@@ -107,13 +123,15 @@ SERVER_BINS := $(BUILD_DIR)/init.elf \
                $(BUILD_DIR)/proc.elf \
                $(BUILD_DIR)/vfs.elf \
                $(BUILD_DIR)/blk.elf \
+               $(BUILD_DIR)/rs.elf \
                $(BUILD_DIR)/ramfs.elf \
                $(BUILD_DIR)/ext2.elf \
                $(BUILD_DIR)/ata.elf \
                $(BUILD_DIR)/sh.elf \
                $(BUILD_DIR)/echo.elf \
                $(BUILD_DIR)/cat.elf \
-               $(BUILD_DIR)/ls.elf
+               $(BUILD_DIR)/ls.elf \
+               $(BUILD_DIR)/bench.elf
 
 # Build libc objects
 $(BUILD_DIR)/libc/%.o: $(LIBC_DIR)/src/%.c
@@ -126,6 +144,12 @@ $(BUILD_DIR)/libc/%.o: $(LIBC_DIR)/src/%.S
 	@mkdir -p $(dir $@)
 	@$(CC) $(USER_CFLAGS) -c $< -o $@
 
+# Build libocean objects
+$(BUILD_DIR)/libocean/%.o: $(LIBOCEAN_DIR)/src/%.c
+	@echo "  CC [user] $<"
+	@mkdir -p $(dir $@)
+	@$(CC) $(USER_CFLAGS) -c $< -o $@
+
 # Build init server
 $(BUILD_DIR)/servers/init/%.o: $(SERVERS_DIR)/init/%.c
 	@echo "  CC [init] $<"
@@ -156,6 +180,12 @@ $(BUILD_DIR)/servers/blk/%.o: $(SERVERS_DIR)/blk/%.c
 	@mkdir -p $(dir $@)
 	@$(CC) $(USER_CFLAGS) -c $< -o $@
 
+# Build reincarnation server
+$(BUILD_DIR)/servers/rs/%.o: $(SERVERS_DIR)/rs/%.c
+	@echo "  CC [rs] $<"
+	@mkdir -p $(dir $@)
+	@$(CC) $(USER_CFLAGS) -c $< -o $@
+
 # Build RAMFS driver
 $(BUILD_DIR)/fs/ramfs/%.o: $(FS_DIR)/ramfs/%.c
 	@echo "  CC [ramfs] $<"
@@ -190,9 +220,12 @@ $(BUILD_DIR)/bin/%.o: $(BIN_DIR)/%.c
 define link_user_binary
 	@echo "  LD [user] $@"
 	@mkdir -p $(dir $@)
-	@$(LD) $(USER_LDFLAGS) -T $(USER_LD_SCRIPT) -o $@ $(BUILD_DIR)/libc/crt0.o $(1) $(filter-out $(BUILD_DIR)/libc/crt0.o,$(LIBC_OBJS))
+	@$(LD) $(USER_LDFLAGS) -T $(USER_LD_SCRIPT) -o $@ $(BUILD_DIR)/libc/crt0.o $(1) $(filter-out $(BUILD_DIR)/libc/crt0.o,$(LIBC_OBJS)) $(LIBOCEAN_OBJS)
 endef
 
+# Every binary links the libocean runtime
+$(SERVER_BINS): $(LIBOCEAN_OBJS)
+
 # Link init binary
 $(BUILD_DIR)/init.elf: $(INIT_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
 	$(call link_user_binary,$(INIT_OBJS))
@@ -213,6 +246,10 @@ $(BUILD_DIR)/vfs.elf: $(VFS_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
 $(BUILD_DIR)/blk.elf: $(BLK_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
 	$(call link_user_binary,$(BLK_OBJS))
 
+# Link reincarnation server
+$(BUILD_DIR)/rs.elf: $(RS_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
+	$(call link_user_binary,$(RS_OBJS))
+
 # Link RAMFS driver
 $(BUILD_DIR)/ramfs.elf: $(RAMFS_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
 	$(call link_user_binary,$(RAMFS_OBJS))
@@ -241,6 +278,10 @@ $(BUILD_DIR)/cat.elf: $(CAT_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
 $(BUILD_DIR)/ls.elf: $(LS_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
 	$(call link_user_binary,$(LS_OBJS))
 
+# Link benchmark utility
+$(BUILD_DIR)/bench.elf: $(BENCH_OBJS) $(LIBC_OBJS) $(USER_LD_SCRIPT)
+	$(call link_user_binary,$(BENCH_OBJS))
+
 # Phony targets
 .PHONY: userspace
 userspace: $(SERVER_BINS)
@@ -250,4 +291,4 @@ servers: $(SERVER_BINS)
 
 .PHONY: clean-user
 clean-user:
-	@rm -rf $(BUILD_DIR)/libc $(BUILD_DIR)/servers $(BUILD_DIR)/drivers $(BUILD_DIR)/fs $(SERVER_BINS)
+	@rm -rf $(BUILD_DIR)/libc $(BUILD_DIR)/libocean $(BUILD_DIR)/servers $(BUILD_DIR)/drivers $(BUILD_DIR)/fs $(SERVER_BINS)